@@ -29,6 +29,7 @@ enum ControlCode : uint8_t {
 	// Control characters
 	Null           = 0x00,
 	CtrlC          = 0x03,
+	Bell           = 0x07,
 	Backspace      = 0x08,
 	LineFeed       = 0x0a,
 	FormFeed       = 0x0c,
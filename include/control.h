@@ -57,13 +57,17 @@ struct CommandLineArguments {
 	bool exit;
 	bool securemode;
 	bool noautoexec;
+	bool headless;
 	std::string working_dir;
 	std::string lang;
 	std::string machine;
+	std::string speed;
+	std::string snapshot;
 	std::vector<std::string> conf;
 	std::vector<std::string> set;
 	std::optional<std::vector<std::string>> editconf;
 	std::optional<int> socket;
+	std::optional<int> ipx_server;
 };
 
 class Config {
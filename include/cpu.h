@@ -111,6 +111,9 @@ Bits CPU_Core_Prefetch_Trap_Run() noexcept;
 
 void CPU_ResetAutoAdjust();
 
+// Discards the dynamic core's translated code
+void CPU_ResetCodeCache();
+
 extern uint16_t parity_lookup[256];
 
 bool CPU_LLDT(Bitu selector);
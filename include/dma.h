@@ -45,6 +45,10 @@ using DMA_ReservationCallback = std::function<void(Section*)>;
 class DmaChannel;
 using DMA_Callback = std::function<void(const DmaChannel* chan, DmaEvent event)>;
 
+// Receives a contiguous span of the guest memory covered by a DMA transfer.
+// The data is only valid for the duration of the call.
+using DMA_SpanCallback = std::function<void(const uint8_t* data, size_t num_bytes)>;
+
 class DmaChannel {
 public:
 	// Defaults at the time of initialization
@@ -79,6 +83,14 @@ public:
 	void ClearRequest();
 	size_t Read(size_t words, uint8_t* const dest_buffer);
 	size_t Write(size_t words, uint8_t* const src_buffer);
+
+	// Performs the same transfer as Read(), but instead of copying the
+	// data into a buffer, passes the guest memory it covers to the
+	// callback as one or more spans in transfer order. Spans point
+	// straight into guest RAM; only memory not backed by RAM is copied
+	// into a bounce buffer first.
+	size_t ReadSpans(size_t words, const DMA_SpanCallback& span_callback);
+
 	void LogDetails() const;
 
 	// Reset the channel back to defaults, without callbacks or reservations.
@@ -93,8 +105,8 @@ public:
 private:
 	void EvictReserver();
 	bool HasReservation() const;
-	size_t ReadOrWrite(DmaDirection direction, size_t words,
-	                   uint8_t* const buffer);
+	using DMA_TransferFunction = std::function<void(uint32_t mem_address, size_t words)>;
+	size_t Transfer(size_t words, const DMA_TransferFunction& transfer_function);
 
 	DMA_ReservationCallback reservation_callback = {};
 	std::string reservation_owner                = {};
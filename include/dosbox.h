@@ -69,6 +69,7 @@ const char* DOSBOX_GetDetailedVersion() noexcept;
 double DOSBOX_GetUptime();
 
 void DOSBOX_RunMachine();
+int DOSBOX_GetRunDepth();
 void DOSBOX_SetLoop(LoopHandler * handler);
 void DOSBOX_SetNormalLoop();
 
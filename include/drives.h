@@ -525,8 +525,10 @@ private:
 	void remove_DOSdir_from_cache(const char* name);
 	void update_cache(bool read_directory_contents = false);
 
-	std::vector<std::string> deleted_files_in_base; //Set is probably better, or some other solution (involving the disk).
-	std::vector<std::string> deleted_paths_in_base; //Currently only used to hide the overlay folder.
+	// Hashed indexes keyed by the DOS path (backslash separated, as passed
+	// in by the DOS layer), so lookups stay O(1) with many overlay files.
+	std::unordered_set<std::string> deleted_files_in_base;
+	std::unordered_set<std::string> deleted_paths_in_base; //Currently only used to hide the overlay folder.
 	std::string overlap_folder;
 	void add_deleted_file(const char* name, bool create_on_disk);
 	void remove_deleted_file(const char* name, bool create_on_disk);
@@ -544,8 +546,11 @@ private:
 	std::string create_filename_of_special_operation(const char* dosname, const char* operation);
 	void convert_overlay_to_DOSname_in_base(char* dirname );
 	//For caching the update_cache routine.
-	std::vector<std::string> DOSnames_cache; //Also set is probably better.
-	std::vector<std::string> DOSdirs_cache; //Can not blindly change its type. it is important that subdirs come after the parent directory.
+	std::unordered_set<std::string> DOSnames_cache;
+	// Unordered, but subdirs must be added to the drive cache after their
+	// parent directory: use DOSdirs_parents_first() when iterating.
+	std::unordered_set<std::string> DOSdirs_cache;
+	std::vector<std::string> DOSdirs_parents_first() const;
 	const std::string special_prefix;
 };
 
@@ -0,0 +1,116 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_HOST_CPU_H
+#define DOSBOX_HOST_CPU_H
+
+// Runtime detection of the instruction set extensions of the host CPU, so hot
+// loops can pick the fastest implementation while the rest of the build keeps
+// targeting the baseline.
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define HOST_CPU_X86 1
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Compiles a function for an instruction set extension the rest of the build
+// doesn't target. MSVC accepts the intrinsics of every extension as they are.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define HOST_CPU_TARGET(extension)
+#else
+#define HOST_CPU_TARGET(extension) __attribute__((target(extension)))
+#endif
+
+#endif // x86
+
+// NEON is part of the AArch64 baseline, so it needs no runtime check
+#if defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#define HOST_CPU_NEON 1
+#include <arm_neon.h>
+#endif
+
+struct HostCpuFeatures {
+	bool sse2  = false;
+	bool ssse3 = false;
+	bool avx2  = false;
+};
+
+#if HOST_CPU_X86 && defined(_MSC_VER)
+
+inline HostCpuFeatures detect_host_cpu_features()
+{
+	HostCpuFeatures features = {};
+
+	int regs[4] = {};
+	__cpuid(regs, 0);
+	const auto max_leaf = regs[0];
+
+	if (max_leaf >= 1) {
+		__cpuid(regs, 1);
+		features.sse2  = (regs[3] >> 26) & 1;
+		features.ssse3 = (regs[2] >> 9) & 1;
+
+		// AVX state has to be enabled by the OS as well
+		const auto has_osxsave = (regs[2] >> 27) & 1;
+		const auto has_avx     = (regs[2] >> 28) & 1;
+		const auto has_ymm_state = has_osxsave && has_avx &&
+		                           (_xgetbv(0) & 0x6) == 0x6;
+
+		if (has_ymm_state && max_leaf >= 7) {
+			__cpuidex(regs, 7, 0);
+			features.avx2 = (regs[1] >> 5) & 1;
+		}
+	}
+	return features;
+}
+
+#elif HOST_CPU_X86
+
+inline HostCpuFeatures detect_host_cpu_features()
+{
+	__builtin_cpu_init();
+
+	HostCpuFeatures features = {};
+	features.sse2  = __builtin_cpu_supports("sse2");
+	features.ssse3 = __builtin_cpu_supports("ssse3");
+	features.avx2  = __builtin_cpu_supports("avx2");
+	return features;
+}
+
+#else
+
+inline HostCpuFeatures detect_host_cpu_features()
+{
+	return {};
+}
+
+#endif
+
+inline const HostCpuFeatures& get_host_cpu_features()
+{
+	static const auto features = detect_host_cpu_features();
+	return features;
+}
+
+#endif
@@ -21,6 +21,9 @@
 
 #if C_IPX
 
+#include <cstdint>
+#include <vector>
+
 #include <SDL_net.h>
 
 struct packetBuffer {
@@ -32,14 +35,27 @@ struct packetBuffer {
 	bool waitsize;
 };
 
-#define SOCKETTABLESIZE 16
 #define CONVIP(hostvar) hostvar & 0xff, (hostvar >> 8) & 0xff, (hostvar >> 16) & 0xff, (hostvar >> 24) & 0xff
 #define CONVIPX(hostvar) hostvar[0], hostvar[1], hostvar[2], hostvar[3], hostvar[4], hostvar[5]
 
+// A client registered with the server, and the traffic relayed for it
+struct IpxServerClient {
+	IPaddress address      = {};
+	uint64_t packets_in    = 0;
+	uint64_t bytes_in      = 0;
+	uint64_t packets_out   = 0;
+	uint64_t bytes_out     = 0;
+};
 
 void IPX_StopServer();
 bool IPX_StartServer(uint16_t portnum);
-bool IPX_isConnectedToServer(Bits tableNum, IPaddress ** ptrAddr);
+
+// Returns a snapshot of the registered clients
+std::vector<IpxServerClient> IPX_GetServerClients();
+
+// Runs only the server, without the emulated machine, until interrupted.
+// Returns the process exit code.
+int IPX_RunStandaloneServer(const int portnum);
 
 uint8_t packetCRC(uint8_t *buffer, uint16_t bufSize);
 
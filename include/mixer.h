@@ -40,6 +40,7 @@
 #include "control.h"
 #include "envelope.h"
 #include "math_utils.h"
+#include "tracy.h"
 
 #include <Iir.h>
 
@@ -179,6 +180,7 @@ public:
 	bool HasFeature(ChannelFeature feature) const;
 	std::set<ChannelFeature> GetFeatures() const;
 	const std::string& GetName() const;
+	const char* GetQueuePlotName();
 	int GetSampleRate() const;
 	float GetFramesPerTick() const;
 	float GetFramesPerBlock() const;
@@ -332,6 +334,7 @@ private:
 	AudioFrame ApplyCrossfeed(const AudioFrame frame) const;
 
 	std::string name = {};
+	const char* queue_plot_name = nullptr;
 	Envelope envelope;
 	MIXER_Handler handler = nullptr;
 
@@ -469,6 +472,13 @@ void MIXER_Unmute();
 
 void MIXER_LockMixerThread();
 void MIXER_UnlockMixerThread();
+
+// Test hook that mixes a block of frames from all channels into the master
+// output, effects included, as the mixer thread does for every block. Lets
+// the benchmarks measure the real mixing path; the caller must hold the mixer
+// lock.
+void MIXER_MixBlock(const int frames_requested);
+
 void MIXER_CloseAudioDevice();
 
 // Return true if the mixer was explicitly muted by the user (as opposed to
@@ -527,6 +537,9 @@ inline void MIXER_PullFromQueueCallback(const int frames_requested, DeviceType*
 	}
 	static std::vector<AudioType> to_mix = {};
 
+	TracyPlot(device->channel->GetQueuePlotName(),
+	          static_cast<int64_t>(device->output_queue.Size()));
+
 	const auto frames_received = check_cast<int>(
 	        device->output_queue.BulkDequeue(to_mix, frames_requested));
 
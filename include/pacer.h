@@ -24,6 +24,7 @@
 
 #include "dosbox.h"
 
+#include <array>
 #include <string>
 
 #include "timer.h"
@@ -73,4 +74,41 @@ private:
 	bool was_reset = false;
 };
 
+/*
+Tick pacing
+~~~~~~~~~~~
+The emulation runs in 1 ms ticks. When it gets ahead of the host, it waits for
+the absolute deadline of its next tick rather than sleeping for a fixed period,
+so waking up late from one wait doesn't push back all the following ticks.
+
+The host's sleep is used up to a short margin before the deadline and the rest
+is spun away. The margin follows how late the host tends to wake us up, so the
+spinning stays short on hosts with precise timers.
+*/
+
+// Waits until the given GetTicksUs() time. Returns how many microseconds
+// past the deadline we actually woke up.
+int64_t PACER_WaitUntilUs(const int64_t deadline_us);
+
+// Counts time spent rendering and presenting towards the timing stats
+void PACER_AddRenderTime(const int64_t render_us);
+
+struct PacingStats {
+	// Upper bounds of the tick lateness histogram's buckets; the last
+	// bucket holds everything later than these
+	static constexpr std::array<int64_t, 5> LatenessBucketsUs = {
+	        25, 50, 100, 250, 1000};
+
+	std::array<int, LatenessBucketsUs.size() + 1> lateness_counts = {};
+
+	// Where the host's time went during the period
+	int64_t sleep_us   = 0;
+	int64_t render_us  = 0;
+	int64_t emulate_us = 0;
+	int64_t period_us  = 0;
+};
+
+// Returns the timing stats of the last completed one-second period
+PacingStats PACER_GetStats();
+
 #endif
@@ -50,6 +50,7 @@ class PageDirectory;
 #define PFLAG_NOCODE		0x10			//No dynamic code can be generated here
 #define PFLAG_INIT			0x20			//No dynamic code can be generated here
 #define PFLAG_HASCODE16		0x40			//Page contains 16-bit dynamic code
+#define PFLAG_BLOCKACCESS	0x80			//Handler implements fast block accesses
 #define PFLAG_HASCODE		(PFLAG_HASCODE32|PFLAG_HASCODE16)
 
 #define LINK_START	((1024+64)/4)			//Start right after the HMA
@@ -80,6 +81,19 @@ public:
 	virtual bool writed_checked(PhysPt addr, uint32_t val);
 	virtual bool writeq_checked(PhysPt addr, uint64_t val);
 
+	// Block accesses perform the same as `num_bytes / access_size`
+	// consecutive ascending reads or writes of `access_size` (1, 2, or 4)
+	// bytes each, starting at `addr`. The block must not cross a page
+	// boundary. Handlers with the PFLAG_BLOCKACCESS flag implement these
+	// without going through the individual accesses; the defaults below
+	// only forward to them.
+	virtual void readblock(PhysPt addr, uint8_t* dest, size_t num_bytes,
+	                       uint8_t access_size);
+	virtual void writeblock(PhysPt addr, const uint8_t* src,
+	                        size_t num_bytes, uint8_t access_size);
+	virtual void fillblock(PhysPt addr, uint8_t val, size_t num_bytes,
+	                       uint8_t access_size);
+
 	uint_fast8_t flags = 0x0;
 };
 
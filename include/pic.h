@@ -67,9 +67,22 @@ void PIC_runIRQs();
 bool PIC_RunQueue();
 
 //Delay in milliseconds
+#if C_TRACY
+// Profiling builds record the handler's name so the profiler can show which
+// event ran.
+void PIC_AddNamedEvent(const char* name, PIC_EventHandler handler,
+                       double delay, uint32_t val = 0);
+#define PIC_AddEvent(handler, ...) \
+	PIC_AddNamedEvent(#handler, handler, __VA_ARGS__)
+#else
 void PIC_AddEvent(PIC_EventHandler handler, double delay, uint32_t val = 0);
+#endif
 void PIC_RemoveEvents(PIC_EventHandler handler);
 void PIC_RemoveSpecificEvents(PIC_EventHandler handler, uint32_t val);
 
+// Marks the events of a module whose state is part of machine snapshots, so
+// they're saved and restored with it
+void PIC_AddSnapshotEventHandler(PIC_EventHandler handler);
+
 void PIC_SetIRQMask(uint32_t irq, bool masked);
 #endif
@@ -26,6 +26,7 @@
 #include <deque>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "../src/gui/render_scalers.h"
 #include "fraction.h"
@@ -185,6 +186,30 @@ struct RenderedImage {
 	}
 };
 
+// Work queued for the optional render thread, in the order the emulation
+// produced it
+struct RenderThreadWork {
+	enum class Type : uint8_t { Line, StartFrame, EndFrame };
+
+	Type type = Type::Line;
+
+	// The source line for Line work (empty for a null line), and the
+	// palette for StartFrame work if any of its entries changed
+	std::vector<uint8_t> data = {};
+
+	// The output buffer the frame is scaled into
+	uint8_t frame = 0;
+
+	// StartFrame
+	bool clear_cache   = false;
+	uint16_t pal_first = 256;
+	uint16_t pal_last  = 0;
+
+	// EndFrame
+	bool abort   = false;
+	bool capture = false;
+};
+
 extern Render_t render;
 extern ScalerLineHandler_t RENDER_DrawLine;
 
@@ -164,6 +164,13 @@ public:
 	// The caller is responsible for sizing the target's array to accomodate
 	// the number requested.
 	size_t BulkDequeue(T* const into_target, const size_t num_requested);
+
+	// Never blocks. Dequeues up to the requested number of items that are
+	// already in the queue into the given container, and returns the
+	// quantity dequeued (0 if the queue is empty). On return, the vector's
+	// size matches the number dequeued.
+	size_t NonblockingBulkDequeue(std::vector<T>& into_target,
+	                              const size_t num_requested);
 };
 
 #endif
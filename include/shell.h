@@ -26,6 +26,8 @@
 #include <optional>
 #include <stack>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "callback.h"
 #include "programs.h"
@@ -45,6 +47,13 @@ public:
 	virtual void Reset()       = 0;
 	virtual std::optional<std::string> Read() = 0;
 
+	// Returns a stamp that changes whenever the contents change, or
+	// nothing if the reader can't tell. Only stamped contents are cached.
+	virtual std::optional<uint64_t> GetContentsStamp()
+	{
+		return {};
+	}
+
 	virtual ~LineReader() = default;
 };
 
@@ -65,14 +74,41 @@ public:
 	void SetEcho(bool echo_on);
 	[[nodiscard]] bool Echo() const;
 
+	[[nodiscard]] const char* GetFileName() const;
+
+	// Byte offset of the next line to run, or nothing if the batch file
+	// isn't cached and so can't tell
+	[[nodiscard]] std::optional<uint32_t> GetOffset();
+
+	// Carries on from the first line at or after the byte offset
+	void SeekTo(uint32_t offset);
+
+	// Looks for changes to the batch file the next time it's read from
+	void RecheckContents();
+
 private:
 	[[nodiscard]] std::string ExpandedBatchLine(std::string_view line) const;
 	[[nodiscard]] std::optional<std::string> GetLine();
+	bool UpdateCache();
+	void RebuildCache(uint64_t stamp);
 
 	const Environment& shell;
 	CommandLine cmd;
 	std::unique_ptr<LineReader> reader;
 	bool echo;
+
+	// The cleaned-up lines of the batch file and where its labels are, so
+	// that reading and jumping don't go back to the file until it changes
+	struct CachedLine {
+		std::string text = {};
+		uint32_t offset  = 0; // byte offset of the line in the file
+	};
+	std::vector<CachedLine> cached_lines = {};
+	std::unordered_map<std::string, size_t> label_index = {};
+	std::optional<uint64_t> cache_stamp = {};
+	bool contents_checked = false;
+	uint32_t cached_size = 0;
+	size_t next_line     = 0;
 };
 
 class AutoexecEditor;
@@ -129,6 +165,19 @@ public:
 	void Run() override;
 	void RunBatchFile();
 
+	// The first shell's progress through AUTOEXEC.BAT, as saved in
+	// snapshots. Without an offset, the snapshot wasn't taken from it.
+	struct SnapshotState {
+		std::optional<uint32_t> autoexec_offset = {};
+		bool autoexec_echo                      = false;
+		bool echo                               = true;
+	};
+	[[nodiscard]] SnapshotState GetSnapshotState();
+
+	// Makes the next Run() carry on from the state instead of starting
+	// AUTOEXEC.BAT from the top
+	void ResumeFromSnapshot(const SnapshotState& state);
+
 	/* A load of subfunctions */
 	void ParseLine(char* line);
 	void InputCommand(char* line);
@@ -190,6 +239,9 @@ public:
 	void CMD_MOVE(char* args);
 
 	bool echo = true;
+
+private:
+	std::optional<SnapshotState> resume_state = {};
 };
 
 std::tuple<std::string, std::string, std::string, bool> parse_drive_conf(
@@ -0,0 +1,160 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_SNAPSHOT_H
+#define DOSBOX_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "std_filesystem.h"
+
+/*
+Machine snapshots
+~~~~~~~~~~~~~~~~~
+A snapshot holds the state of the emulated machine so a later session can
+carry on from it instead of booting and running AUTOEXEC.BAT again.
+
+Each module that owns machine state registers a save and a load function
+for it, normally from its init function. When saving or loading, the
+components are visited in the order they were first registered, which
+matches the order the modules were initialised in.
+
+Modules that aren't part of snapshots, such as the sound devices, can hold
+off saving while their state matters by registering a save check. Saving
+refuses with the check's reason instead of silently losing that state.
+
+Snapshots are raw images of the modules' state, so they can only be loaded
+by the same build with the same start-up configuration. Both are recorded
+in the file and checked before anything is restored.
+*/
+
+class SnapshotWriter {
+public:
+	template <typename T>
+	void Write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		WriteBytes(&value, sizeof(T));
+	}
+
+	void WriteBytes(const void* data, size_t num_bytes);
+	void WriteString(const std::string& str);
+
+	// Data that lives inside the executable, such as function pointers
+	// and pointers to static objects, is stored relative to the
+	// executable's position, which can change between sessions
+	template <typename T>
+	void WriteCodePointer(T* ptr)
+	{
+		Write(ToCodeOffset(reinterpret_cast<uintptr_t>(ptr)));
+	}
+
+	const std::vector<uint8_t>& GetData() const
+	{
+		return data;
+	}
+
+private:
+	static int64_t ToCodeOffset(uintptr_t address);
+
+	std::vector<uint8_t> data = {};
+};
+
+class SnapshotReader {
+public:
+	SnapshotReader(const uint8_t* data, size_t num_bytes);
+
+	template <typename T>
+	void Read(T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		ReadBytes(&value, sizeof(T));
+	}
+
+	template <typename T>
+	T Read()
+	{
+		T value = {};
+		Read(value);
+		return value;
+	}
+
+	void ReadBytes(void* dest, size_t num_bytes);
+	void Skip(size_t num_bytes);
+	std::string ReadString();
+
+	// For validating untrusted data before reading it
+	bool CanRead(size_t num_bytes) const
+	{
+		return num_bytes <= GetNumBytesLeft();
+	}
+	bool CanReadString() const;
+
+	template <typename T>
+	T* ReadCodePointer()
+	{
+		return reinterpret_cast<T*>(FromCodeOffset(Read<int64_t>()));
+	}
+
+	size_t GetNumBytesLeft() const
+	{
+		return size - pos;
+	}
+
+private:
+	static uintptr_t FromCodeOffset(int64_t offset);
+
+	const uint8_t* data = nullptr;
+	size_t size         = 0;
+	size_t pos          = 0;
+};
+
+using SnapshotSaveFunction = void (*)(SnapshotWriter& writer);
+using SnapshotLoadFunction = void (*)(SnapshotReader& reader);
+
+// Registers (or replaces) the state handlers for a named component
+void SNAPSHOT_AddComponent(const std::string& name, SnapshotSaveFunction save,
+                           SnapshotLoadFunction load);
+
+// Returns why saving has to wait, or nothing if the module's state can be
+// left out of the snapshot right now
+using SnapshotSaveCheck = std::optional<std::string> (*)();
+
+void SNAPSHOT_AddSaveCheck(SnapshotSaveCheck check);
+
+// Returns the reason of the first save check that holds off saving, if any
+std::optional<std::string> SNAPSHOT_GetSaveBlocker();
+
+// Snapshots can only be taken while the first shell's program is running,
+// because the shell itself isn't part of the emulated machine
+bool SNAPSHOT_CanSave();
+
+bool SNAPSHOT_Save(const std_fs::path& path, bool compress);
+
+// Validates the snapshot file and restores the machine state from it.
+// Returns false without changing anything if the file can't be used.
+bool SNAPSHOT_Load(const std_fs::path& path);
+
+#endif
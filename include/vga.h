@@ -332,6 +332,10 @@ struct VgaDraw {
 	uint8_t font[64 * 1024] = {};
 	uint8_t* font_tables[2] = {nullptr, nullptr};
 
+	// Incremented whenever the font memory is written, so drawers caching
+	// glyph pixels know when to discard them
+	uint32_t font_generation = 0;
+
 	Bitu blinking                      = 0;
 	bool blink                         = false;
 	PixelsPerChar pixels_per_character = PixelsPerChar::Eight;
@@ -990,6 +994,9 @@ struct VgaDac {
 	Rgb666 rgb[NumVgaColors]           = {};
 	Bgrx8888 palette_map[NumVgaColors] = {};
 
+	// Incremented whenever an entry of the palette map changes
+	uint32_t palette_generation = 0;
+
 	uint8_t combine[16] = {};
 
 	// DAC 8-bit registers
@@ -1127,6 +1134,7 @@ void VGA_StartResize();
 void VGA_StartResizeAfter(const uint16_t delay_ms);
 
 void VGA_SetupDrawing(uint32_t val);
+void VGA_AddSnapshotEvents();
 void VGA_CheckScanLength(void);
 void VGA_ChangedBank(void);
 
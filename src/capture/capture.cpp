@@ -28,6 +28,7 @@
 
 #include "capture_audio.h"
 #include "capture_midi.h"
+#include "capture_stream.h"
 #include "capture_video.h"
 #include "checks.h"
 #include "control.h"
@@ -50,6 +51,7 @@ static struct {
 		std::atomic<CaptureState> audio = {};
 		std::atomic<CaptureState> midi  = {};
 		std::atomic<CaptureState> video = {};
+		std::atomic<bool> stream        = {};
 	} state = {};
 
 	struct {
@@ -69,6 +71,7 @@ static struct {
 		state.audio = CaptureState::Off;
 		state.midi = CaptureState::Off;
 		state.video = CaptureState::Off;
+		state.stream = false;
 		next_index = {};
 	}
 } capture = {};
@@ -106,6 +109,11 @@ bool CAPTURE_IsCapturingVideo()
 	return capture.state.video != CaptureState::Off;
 }
 
+bool CAPTURE_IsStreaming()
+{
+	return capture.state.stream;
+}
+
 static const char* capture_type_to_string(const CaptureType type)
 {
 	switch (type) {
@@ -412,6 +420,10 @@ void CAPTURE_AddFrame(const RenderedImage& image, const float frames_per_second)
 		capture_video_add_frame(image, frames_per_second);
 		break;
 	}
+
+	if (capture.state.stream) {
+		capture_stream_add_frame(image, frames_per_second);
+	}
 }
 
 void CAPTURE_AddPostRenderImage(const RenderedImage& image)
@@ -445,6 +457,12 @@ void CAPTURE_AddAudioData(const uint32_t sample_rate, const uint32_t num_sample_
 		capture_audio_add_data(sample_rate, num_sample_frames, sample_frames);
 		break;
 	}
+
+	if (capture.state.stream) {
+		capture_stream_add_audio_data(sample_rate,
+		                              num_sample_frames,
+		                              sample_frames);
+	}
 }
 
 void CAPTURE_AddMidiData(const bool sysex, const size_t len, const uint8_t* data)
@@ -587,6 +605,11 @@ static void capture_destroy(Section* /*sec*/)
 		capture.state.video = CaptureState::Off;
 	}
 
+	if (capture.state.stream) {
+		capture_stream_finalise();
+		capture.state.stream = false;
+	}
+
 	capture.reset();
 }
 
@@ -614,6 +637,11 @@ static void capture_init(Section* sec)
 
 	image_capturer = std::make_unique<ImageCapturer>(prefs);
 
+	const std::string stream_destination = secprop->Get_string("capture_stream");
+	if (!stream_destination.empty()) {
+		capture.state.stream = capture_stream_start(stream_destination);
+	}
+
 	constexpr auto changeable_at_runtime = true;
 	sec->AddDestroyFunction(&capture_destroy, changeable_at_runtime);
 }
@@ -699,6 +727,18 @@ static void init_capture_dosbox_settings(Section_prop& secprop)
 	        "Keybindings for taking single screenshots in specific formats are also\n"
 	        "available.");
 	assert(str_prop);
+
+	str_prop = secprop.Add_string("capture_stream", when_idle, "");
+	str_prop->Set_help(
+	        "Stream the raw video frames and audio output to a file, named pipe (FIFO),\n"
+	        "or Unix domain socket for an external encoder to consume (unset by default).\n"
+	        "Use 'unix:<path>' to connect to a listening Unix domain socket; any other\n"
+	        "value is opened as a file or pipe (e.g., '/tmp/dosbox.fifo' or\n"
+	        "'\\\\.\\pipe\\dosbox' on Windows). Frames are sent uncompressed as 32-bit\n"
+	        "BGRX pixels at the raw framebuffer resolution, audio as 16-bit stereo PCM;\n"
+	        "see 'src/capture/capture_stream.h' for the packet format. Packets are dropped\n"
+	        "if the consumer can't keep up.");
+	assert(str_prop);
 }
 
 void CAPTURE_AddConfigSection(const ConfigPtr& conf)
@@ -75,6 +75,10 @@ bool CAPTURE_IsCapturingPostRenderImage();
 bool CAPTURE_IsCapturingMidi();
 bool CAPTURE_IsCapturingVideo();
 
+// True if the raw video and audio output is being streamed to an external
+// consumer (see the `capture_stream` setting)
+bool CAPTURE_IsStreaming();
+
 // Only used internally in the capture module
 int32_t get_next_capture_index(const CaptureType type);
 
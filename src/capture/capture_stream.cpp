@@ -0,0 +1,413 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "capture_stream.h"
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if !defined(WIN32)
+#include <csignal>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "checks.h"
+#include "image/image_decoder.h"
+#include "logging.h"
+#include "mem_host.h"
+#include "pic.h"
+#include "rwqueue.h"
+#include "support.h"
+#include "tracy.h"
+
+CHECK_NARROWING();
+
+// About one second's worth of frames plus the audio chunks in between; the
+// queue only fills up when the consumer stalls
+constexpr size_t QueueCapacity = 256;
+
+constexpr size_t PacketHeaderSize = 16;
+constexpr size_t VideoHeaderSize  = 8;
+constexpr size_t AudioHeaderSize  = 8;
+constexpr size_t BytesPerPixel    = 4;
+
+constexpr auto UnixSocketPrefix = "unix:";
+
+static struct {
+	RWQueue<StreamPacket> queue{QueueCapacity};
+	std::thread writer = {};
+
+	std::string destination = {};
+	double start_index_ms   = 0.0;
+
+	// Only accessed from the writer thread
+	FILE* out                = nullptr;
+	std::vector<uint8_t> buf = {};
+
+	// Only accessed from the main thread; that's where the frames and the
+	// audio are captured, even when the render thread scales the frames
+	uint64_t num_dropped = 0;
+
+	// Set when finalising, so a writer still waiting for a FIFO reader
+	// to appear gives up
+	std::atomic<bool> should_stop = false;
+
+	bool is_running = false;
+} stream = {};
+
+#if !defined(WIN32)
+static FILE* connect_unix_socket(const std::string& path)
+{
+	sockaddr_un addr = {};
+	if (path.size() >= sizeof(addr.sun_path)) {
+		LOG_WARNING("CAPTURE: Socket path '%s' is too long", path.c_str());
+		return nullptr;
+	}
+	addr.sun_family = AF_UNIX;
+	std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+	const auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		LOG_WARNING("CAPTURE: Error creating socket: %s", safe_strerror(errno).c_str());
+		return nullptr;
+	}
+	if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+		LOG_WARNING("CAPTURE: Error connecting to socket '%s': %s",
+		            path.c_str(),
+		            safe_strerror(errno).c_str());
+		close(fd);
+		return nullptr;
+	}
+	auto file = fdopen(fd, "wb");
+	if (!file) {
+		close(fd);
+	}
+	return file;
+}
+#endif
+
+static FILE* open_destination(const std::string& destination)
+{
+	if (destination.starts_with(UnixSocketPrefix)) {
+#if defined(WIN32)
+		LOG_WARNING("CAPTURE: Unix domain sockets are not supported on this platform");
+		return nullptr;
+#else
+		return connect_unix_socket(
+		        destination.substr(std::strlen(UnixSocketPrefix)));
+#endif
+	}
+
+	// Plain files, named pipes (FIFOs), and Windows pipes ("\\.\pipe\name")
+#if defined(WIN32)
+	auto file = fopen(destination.c_str(), "wb");
+	if (!file) {
+		LOG_WARNING("CAPTURE: Error opening stream destination '%s': %s",
+		            destination.c_str(),
+		            safe_strerror(errno).c_str());
+	}
+	return file;
+#else
+	// A blocking open of a FIFO would wait for the reader indefinitely, so
+	// poll for it instead to remain stoppable
+	constexpr auto RetryInterval = std::chrono::milliseconds(100);
+	auto logged_waiting          = false;
+
+	while (!stream.should_stop) {
+		const auto fd = open(destination.c_str(),
+		                     O_WRONLY | O_CREAT | O_NONBLOCK,
+		                     0644);
+		if (fd >= 0) {
+			// Writes should block rather than fail when the
+			// consumer is momentarily behind
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+			auto file = fdopen(fd, "wb");
+			if (!file) {
+				close(fd);
+			}
+			return file;
+		}
+		if (errno != ENXIO) {
+			LOG_WARNING("CAPTURE: Error opening stream destination '%s': %s",
+			            destination.c_str(),
+			            safe_strerror(errno).c_str());
+			return nullptr;
+		}
+		// The FIFO has no reader yet
+		if (!logged_waiting) {
+			LOG_MSG("CAPTURE: Waiting for a reader to open '%s'",
+			        destination.c_str());
+			logged_waiting = true;
+		}
+		std::this_thread::sleep_for(RetryInterval);
+	}
+	return nullptr;
+#endif
+}
+
+static void write_packet_header(uint8_t* out, const char* type,
+                                const uint32_t payload_bytes,
+                                const uint64_t timestamp_us)
+{
+	std::memcpy(out, type, 4);
+	host_writed(out + 4, payload_bytes);
+	host_writeq(out + 8, timestamp_us);
+}
+
+static void encode_video_frame(const StreamPacket& packet)
+{
+	ZoneScoped;
+
+	const auto& src = packet.image.params;
+
+	// Undo the "baked-in" double scanning and pixel doubling, same as the
+	// raw screenshots do
+	const uint8_t row_skip_count   = (src.rendered_double_scan ? 1 : 0);
+	const uint8_t pixel_skip_count = (src.rendered_pixel_doubling ? 1 : 0);
+
+	const auto width  = check_cast<uint16_t>(src.width / (pixel_skip_count + 1));
+	const auto height = check_cast<uint16_t>(src.height / (row_skip_count + 1));
+
+	const auto payload_bytes = VideoHeaderSize +
+	                           static_cast<size_t>(width) * height * BytesPerPixel;
+
+	stream.buf.resize(PacketHeaderSize + payload_bytes);
+	auto out = stream.buf.data();
+
+	write_packet_header(out,
+	                    "VIDF",
+	                    check_cast<uint32_t>(payload_bytes),
+	                    packet.timestamp_us);
+	out += PacketHeaderSize;
+
+	host_writew(out, width);
+	host_writew(out + 2, height);
+	host_writed(out + 4,
+	            static_cast<uint32_t>(
+	                    std::lround(packet.frames_per_second * 1000.0f)));
+	out += VideoHeaderSize;
+
+	ImageDecoder image_decoder = {};
+	image_decoder.Init(packet.image, row_skip_count, pixel_skip_count);
+
+	for (auto y = 0; y < height; ++y) {
+		for (auto x = 0; x < width; ++x) {
+			const auto pixel = image_decoder.GetNextPixelAsRgb888();
+
+			*out++ = pixel.blue;
+			*out++ = pixel.green;
+			*out++ = pixel.red;
+			*out++ = 0;
+		}
+		image_decoder.AdvanceRow();
+	}
+}
+
+static void encode_audio_data(const StreamPacket& packet)
+{
+	ZoneScoped;
+
+	const auto num_frames    = packet.samples.size() / 2;
+	const auto payload_bytes = AudioHeaderSize +
+	                           packet.samples.size() * sizeof(int16_t);
+
+	stream.buf.resize(PacketHeaderSize + payload_bytes);
+	auto out = stream.buf.data();
+
+	write_packet_header(out,
+	                    "AUDF",
+	                    check_cast<uint32_t>(payload_bytes),
+	                    packet.timestamp_us);
+	out += PacketHeaderSize;
+
+	host_writed(out, packet.sample_rate);
+	host_writed(out + 4, check_cast<uint32_t>(num_frames));
+	out += AudioHeaderSize;
+
+	for (const auto sample : packet.samples) {
+		host_writew(out, static_cast<uint16_t>(sample));
+		out += sizeof(int16_t);
+	}
+}
+
+static void write_queued_packets()
+{
+	stream.out = open_destination(stream.destination);
+	if (stream.out) {
+		// Frames are large; let stdio pass them through in as few
+		// writes as possible
+		setvbuf(stream.out, nullptr, _IOFBF, 1024 * 1024);
+		LOG_MSG("CAPTURE: Streaming raw output to '%s'",
+		        stream.destination.c_str());
+	}
+
+	while (auto packet = stream.queue.Dequeue()) {
+		if (stream.out) {
+			if (packet->type == StreamPacketType::VideoFrame) {
+				encode_video_frame(*packet);
+			} else {
+				encode_audio_data(*packet);
+			}
+
+			const auto written = fwrite(stream.buf.data(),
+			                            1,
+			                            stream.buf.size(),
+			                            stream.out);
+
+			// Flush per frame so the consumer isn't left waiting for
+			// a full buffer at low frame rates
+			if (written != stream.buf.size() ||
+			    (packet->type == StreamPacketType::VideoFrame &&
+			     fflush(stream.out) != 0)) {
+				LOG_WARNING("CAPTURE: Stream consumer disconnected, "
+				            "stopping streaming");
+				fclose(stream.out);
+				stream.out = nullptr;
+			}
+		}
+		packet->image.free();
+	}
+
+	if (stream.out) {
+		fclose(stream.out);
+		stream.out = nullptr;
+	}
+	stream.buf.clear();
+	stream.buf.shrink_to_fit();
+}
+
+bool capture_stream_start(const std::string& destination)
+{
+	if (stream.is_running) {
+		capture_stream_finalise();
+	}
+	if (destination.empty()) {
+		return false;
+	}
+
+#if !defined(WIN32)
+	// Without this, the consumer going away would terminate the process
+	// on the next write
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	stream.destination    = destination;
+	stream.start_index_ms = PIC_FullIndex();
+	stream.num_dropped    = 0;
+	stream.should_stop    = false;
+
+	stream.queue.Clear();
+	stream.queue.Start();
+
+	stream.writer = std::thread(write_queued_packets);
+	set_thread_name(stream.writer, "dosbox:stream");
+
+	stream.is_running = true;
+	return true;
+}
+
+static uint64_t get_timestamp_us()
+{
+	const auto elapsed_ms = PIC_FullIndex() - stream.start_index_ms;
+	return elapsed_ms > 0.0 ? static_cast<uint64_t>(elapsed_ms * 1000.0) : 0;
+}
+
+static void enqueue_packet(StreamPacket&& packet)
+{
+	if (!stream.queue.NonblockingEnqueue(std::move(packet))) {
+		packet.image.free();
+		++stream.num_dropped;
+	}
+}
+
+void capture_stream_add_frame(const RenderedImage& image,
+                              const float frames_per_second)
+{
+	if (!stream.is_running) {
+		return;
+	}
+	// Don't copy the frame if it would be dropped anyway
+	if (stream.queue.IsFull()) {
+		++stream.num_dropped;
+		return;
+	}
+
+	StreamPacket packet      = {};
+	packet.type              = StreamPacketType::VideoFrame;
+	packet.timestamp_us      = get_timestamp_us();
+	packet.image             = image.deep_copy();
+	packet.frames_per_second = frames_per_second;
+
+	enqueue_packet(std::move(packet));
+}
+
+void capture_stream_add_audio_data(const uint32_t sample_rate,
+                                   const uint32_t num_sample_frames,
+                                   const int16_t* sample_frames)
+{
+	if (!stream.is_running || num_sample_frames == 0) {
+		return;
+	}
+	assert(sample_frames);
+
+	StreamPacket packet = {};
+	packet.type         = StreamPacketType::AudioData;
+	packet.timestamp_us = get_timestamp_us();
+	packet.sample_rate  = sample_rate;
+	packet.samples.assign(sample_frames, sample_frames + num_sample_frames * 2);
+
+	enqueue_packet(std::move(packet));
+}
+
+void capture_stream_finalise()
+{
+	if (!stream.is_running) {
+		return;
+	}
+
+	// Let the writer drain the packets already queued
+	stream.should_stop = true;
+	stream.queue.Stop();
+	if (stream.writer.joinable()) {
+		stream.writer.join();
+	}
+
+	if (stream.num_dropped > 0) {
+		LOG_WARNING("CAPTURE: Dropped %llu stream packets because the "
+		            "consumer couldn't keep up",
+		            static_cast<unsigned long long>(stream.num_dropped));
+	}
+	LOG_MSG("CAPTURE: Stopped streaming raw output to '%s'",
+	        stream.destination.c_str());
+
+	stream.destination.clear();
+	stream.is_running = false;
+}
@@ -0,0 +1,88 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_CAPTURE_STREAM_H
+#define DOSBOX_CAPTURE_STREAM_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "render.h"
+
+/*
+Raw stream capture
+~~~~~~~~~~~~~~~~~~
+Streams the unencoded video frames and audio output to a file, a named pipe
+(FIFO), or a Unix domain socket ("unix:<path>"), for an external encoder to
+consume. Nothing is compressed on our side; frames are only unpacked to BGRX.
+
+The stream is a sequence of packets. All values are little-endian.
+
+  Packet header (16 bytes):
+    char[4]   type           "VIDF" for a video frame, "AUDF" for audio
+    uint32    payload_bytes  size of the payload following the header
+    uint64    timestamp_us   emulated time since the stream started
+
+  VIDF payload:
+    uint16    width
+    uint16    height
+    uint32    frames_per_second * 1000
+    then width * height pixels, 4 bytes each, in B, G, R, X order
+
+  AUDF payload:
+    uint32    sample_rate_hz
+    uint32    num_frames
+    then num_frames stereo frames of two int16 samples (left, right)
+
+The frames are the raw framebuffer contents, so double-scanned and
+pixel-doubled modes are undone, and they need the pixel aspect ratio of the
+video mode applied for display. Writing happens on a separate thread; if the
+consumer can't keep up, packets are dropped rather than slowing down the
+emulation.
+*/
+
+enum class StreamPacketType { VideoFrame, AudioData };
+
+struct StreamPacket {
+	StreamPacketType type = StreamPacketType::VideoFrame;
+	uint64_t timestamp_us = 0;
+
+	// Video frames
+	RenderedImage image     = {};
+	float frames_per_second = 0.0f;
+
+	// Audio data
+	uint32_t sample_rate         = 0;
+	std::vector<int16_t> samples = {};
+};
+
+bool capture_stream_start(const std::string& destination);
+
+void capture_stream_add_frame(const RenderedImage& image,
+                              const float frames_per_second);
+
+void capture_stream_add_audio_data(const uint32_t sample_rate,
+                                   const uint32_t num_sample_frames,
+                                   const int16_t* sample_frames);
+
+void capture_stream_finalise();
+
+#endif
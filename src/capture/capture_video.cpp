@@ -28,6 +28,7 @@
 #include "mem.h"
 #include "render.h"
 #include "support.h"
+#include "tracy.h"
 
 #include "zmbv/zmbv.h"
 
@@ -441,6 +442,8 @@ static void compress_raw_frame(const RenderedImage& image)
 
 void capture_video_add_frame(const RenderedImage& image, const float frames_per_second)
 {
+	ZoneScoped;
+
 	const auto& src = image.params;
 	assert(src.width <= SCALER_MAXWIDTH);
 
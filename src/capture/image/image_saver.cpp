@@ -29,6 +29,7 @@
 #include "checks.h"
 #include "png_writer.h"
 #include "support.h"
+#include "tracy.h"
 
 CHECK_NARROWING();
 
@@ -100,6 +101,8 @@ static CaptureType to_capture_type(const CapturedImageType type)
 
 void ImageSaver::SaveImage(const SaveImageTask& task)
 {
+	ZoneScoped;
+
 	CaptureType capture_type = to_capture_type(task.image_type);
 
 	outfile = CAPTURE_CreateFile(capture_type, task.path);
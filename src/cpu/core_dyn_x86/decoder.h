@@ -2213,6 +2213,7 @@ static void dyn_larlsl(bool islar) {
 #endif
 
 static CacheBlock * CreateCacheBlock(CodePageHandler * codepage,PhysPt start,Bitu max_opcodes) {
+	ZoneScoped;
 	Bits i;
 /* Init a load of variables */
 	decode.code_start=start;
@@ -393,4 +393,9 @@ void CPU_Core_Dynrec_Cache_Close(void) {
 	cache_close();
 }
 
+void CPU_Core_Dynrec_Cache_Reset()
+{
+	cache_reset();
+}
+
 #endif
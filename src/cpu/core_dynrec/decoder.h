@@ -32,6 +32,8 @@
 
 static CacheBlock *CreateCacheBlock(CodePageHandler *codepage, PhysPt start, Bitu max_opcodes)
 {
+	ZoneScoped;
+
 	// initialize a load of variables
 	decode.code_start=start;
 	decode.code=start;
@@ -96,47 +96,35 @@
 		}
 		break;
 	case R_STOSB:
-		for (;count>0;count--) {
-			SaveMb(di_base+di_index,reg_al);
-			di_index=(di_index+add_index) & add_mask;
-		}
+		rep_stos<uint8_t>(di_base, di_index, add_mask, add_index, count, reg_al,
+		                  [](PhysPt address, uint8_t value) { SaveMb(address, value); });
 		break;
 	case R_STOSW:
 		add_index *= 2;
-		for (;count>0;count--) {
-			SaveMw(di_base+di_index,reg_ax);
-			di_index=(di_index+add_index) & add_mask;
-		}
+		rep_stos<uint16_t>(di_base, di_index, add_mask, add_index, count, reg_ax,
+		                   [](PhysPt address, uint16_t value) { SaveMw(address, value); });
 		break;
 	case R_STOSD:
 		add_index *= 4;
-		for (;count>0;count--) {
-			SaveMd(di_base+di_index,reg_eax);
-			di_index=(di_index+add_index) & add_mask;
-		}
+		rep_stos<uint32_t>(di_base, di_index, add_mask, add_index, count, reg_eax,
+		                   [](PhysPt address, uint32_t value) { SaveMd(address, value); });
 		break;
 	case R_MOVSB:
-		for (;count>0;count--) {
-			SaveMb(di_base+di_index,LoadMb(si_base+si_index));
-			di_index=(di_index+add_index) & add_mask;
-			si_index=(si_index+add_index) & add_mask;
-		}
+		rep_movs<uint8_t>(si_base, si_index, di_base, di_index, add_mask, add_index, count,
+		                  [](PhysPt address) { return LoadMb(address); },
+		                  [](PhysPt address, uint8_t value) { SaveMb(address, value); });
 		break;
 	case R_MOVSW:
 		add_index *= 2;
-		for (;count>0;count--) {
-			SaveMw(di_base+di_index,LoadMw(si_base+si_index));
-			di_index=(di_index+add_index) & add_mask;
-			si_index=(si_index+add_index) & add_mask;
-		}
+		rep_movs<uint16_t>(si_base, si_index, di_base, di_index, add_mask, add_index, count,
+		                   [](PhysPt address) { return LoadMw(address); },
+		                   [](PhysPt address, uint16_t value) { SaveMw(address, value); });
 		break;
 	case R_MOVSD:
 		add_index *= 4;
-		for (;count>0;count--) {
-			SaveMd(di_base+di_index,LoadMd(si_base+si_index));
-			di_index=(di_index+add_index) & add_mask;
-			si_index=(si_index+add_index) & add_mask;
-		}
+		rep_movs<uint32_t>(si_base, si_index, di_base, di_index, add_mask, add_index, count,
+		                   [](PhysPt address) { return LoadMd(address); },
+		                   [](PhysPt address, uint32_t value) { SaveMd(address, value); });
 		break;
 	case R_LODSB:
 		for (;count>0;count--) {
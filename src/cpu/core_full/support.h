@@ -17,6 +17,7 @@
  */
 
 #include "../string_ops.h"
+#include "../string_spans.h"
 
 enum {
 	L_N=0,
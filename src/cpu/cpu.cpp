@@ -24,6 +24,7 @@
 #include <cassert>
 #include <cstddef>
 #include <sstream>
+#include <vector>
 
 #include "control.h"
 #include "debug.h"
@@ -35,6 +36,7 @@
 #include "pic.h"
 #include "programs.h"
 #include "setup.h"
+#include "snapshot.h"
 #include "string_utils.h"
 #include "support.h"
 #include "video.h"
@@ -119,12 +121,14 @@ void CPU_Core_Simple_Init();
 void CPU_Core_Dyn_X86_Init();
 void CPU_Core_Dyn_X86_Cache_Init(bool enable_cache);
 void CPU_Core_Dyn_X86_Cache_Close();
+void CPU_Core_Dyn_X86_Cache_Reset();
 void CPU_Core_Dyn_X86_SetFPUMode(bool dh_fpu);
 
 #elif C_DYNREC
 void CPU_Core_Dynrec_Init();
 void CPU_Core_Dynrec_Cache_Init(bool enable_cache);
 void CPU_Core_Dynrec_Cache_Close();
+void CPU_Core_Dynrec_Cache_Reset();
 #endif
 
 /* In debug mode exceptions are tested and dosbox exits when
@@ -3225,11 +3229,109 @@ static void cpu_shutdown([[maybe_unused]] Section* sec)
 	cpu_instance.reset();
 }
 
+void CPU_ResetCodeCache()
+{
+#if C_DYNAMIC_X86
+	CPU_Core_Dyn_X86_Cache_Reset();
+#elif C_DYNREC
+	CPU_Core_Dynrec_Cache_Reset();
+#endif
+}
+
+static void cpu_save_snapshot(SnapshotWriter& writer)
+{
+	writer.Write(cpu_regs);
+	writer.Write(Segs);
+	writer.Write(cpu);
+	writer.WriteCodePointer(cpu.hlt.old_decoder);
+	writer.Write(cpu_tss);
+	writer.Write(lflags);
+
+	writer.Write(CPU_Cycles.load());
+	writer.Write(CPU_CycleLeft.load());
+	writer.Write(CPU_CycleMax.load());
+	writer.Write(CPU_IODelayRemoved);
+	writer.Write(CPU_CycleAutoAdjust);
+	writer.Write(auto_determine_mode);
+	writer.Write(last_auto_determine_mode);
+
+	writer.WriteCodePointer(cpudecoder);
+}
+
+// The decoders the CPU can be left running between emulation steps. The
+// decoder pointers come from the snapshot file, so anything else is either
+// corrupt or from a different build and must never be called.
+static bool is_snapshot_decoder(CPU_Decoder* decoder)
+{
+	static const std::vector<CPU_Decoder*> decoders = {
+	        &CPU_Core_Normal_Run,
+	        &CPU_Core_Normal_Trap_Run,
+	        &CPU_Core_Simple_Run,
+	        &CPU_Core_Simple_Trap_Run,
+	        &CPU_Core_Full_Run,
+	        &CPU_Core_Prefetch_Run,
+	        &CPU_Core_Prefetch_Trap_Run,
+#if C_DYNAMIC_X86
+	        &CPU_Core_Dyn_X86_Run,
+	        &CPU_Core_Dyn_X86_Trap_Run,
+#elif C_DYNREC
+	        &CPU_Core_Dynrec_Run,
+	        &CPU_Core_Dynrec_Trap_Run,
+#endif
+	};
+	return contains(decoders, decoder);
+}
+
+static void cpu_load_snapshot(SnapshotReader& reader)
+{
+	reader.Read(cpu_regs);
+	reader.Read(Segs);
+	reader.Read(cpu);
+	cpu.hlt.old_decoder = reader.ReadCodePointer<CPU_Decoder>();
+	reader.Read(cpu_tss);
+	reader.Read(lflags);
+
+	CPU_Cycles    = reader.Read<int>();
+	CPU_CycleLeft = reader.Read<int>();
+	CPU_CycleMax  = reader.Read<int>();
+	reader.Read(CPU_IODelayRemoved);
+	reader.Read(CPU_CycleAutoAdjust);
+	reader.Read(auto_determine_mode);
+	reader.Read(last_auto_determine_mode);
+
+	cpudecoder = reader.ReadCodePointer<CPU_Decoder>();
+
+	// The decoder before a HLT is only needed while halted
+	const auto is_halted = (cpudecoder == &hlt_decode);
+	if (!is_halted) {
+		cpu.hlt.old_decoder = nullptr;
+	}
+	if (!(is_halted || is_snapshot_decoder(cpudecoder)) ||
+	    (is_halted && !is_snapshot_decoder(cpu.hlt.old_decoder))) {
+		E_Exit("CPU: Snapshot has an unknown CPU core");
+	}
+
+	// A halted CPU carries on with its core after the next interrupt
+	[[maybe_unused]] const auto core = is_halted ? cpu.hlt.old_decoder
+	                                             : cpudecoder;
+#if C_DYNAMIC_X86
+	if (core == &CPU_Core_Dyn_X86_Run) {
+		CPU_Core_Dyn_X86_Cache_Init(true);
+	}
+#elif C_DYNREC
+	if (core == &CPU_Core_Dynrec_Run) {
+		CPU_Core_Dynrec_Cache_Init(true);
+	}
+#endif
+}
+
 static void cpu_init(Section* sec)
 {
 	assert(sec);
 	cpu_instance = std::make_unique<Cpu>(sec);
 
+	SNAPSHOT_AddComponent("cpu", cpu_save_snapshot, cpu_load_snapshot);
+
 	constexpr auto ChangeableAtRuntime = true;
 	sec->AddDestroyFunction(&cpu_shutdown, ChangeableAtRuntime);
 }
@@ -26,6 +26,7 @@
 
 #include "mem_unaligned.h"
 #include "paging.h"
+#include "tracy.h"
 #include "types.h"
 
 #if defined(HAVE_MMAP)
@@ -190,6 +191,8 @@ public:
 	// clear out blocks that contain code which has been modified
 	bool InvalidateRange(Bitu start, Bitu end)
 	{
+		ZoneScoped;
+
 		Bits index=1+(end>>DYN_HASH_SHIFT);
 		bool is_current_block = false; // if the current block is
 		                               // modified, it has to be exited
@@ -504,6 +507,8 @@ public:
 
 	void ClearRelease()
 	{
+		ZoneScoped;
+
 		// clear out all cache blocks in this page
 		Bitu count=active_blocks;
 		CacheBlock **map=hash_map;
@@ -1084,6 +1089,18 @@ static void cache_init(bool enable) {
 	}
 }
 
+// Drops all translated code, for when the guest memory has been replaced
+// behind the code page handlers' backs
+static void cache_reset()
+{
+	if (!cache_initialized) {
+		return;
+	}
+	while (cache.used_pages) {
+		cache.used_pages->ClearRelease();
+	}
+}
+
 static void cache_close(void) {
 /*	for (;;) {
 		if (cache.used_pages) {
@@ -25,11 +25,14 @@
 #include <memory>
 
 #include "mem.h"
+#include "mem_host.h"
 #include "regs.h"
 #include "lazyflags.h"
 #include "cpu.h"
 #include "debug.h"
 #include "setup.h"
+#include "snapshot.h"
+#include "tracy.h"
 
 #define LINK_TOTAL		(64*1024)
 
@@ -135,6 +138,54 @@ bool PageHandler::writeq_checked(PhysPt addr, uint64_t val)
 	return false;
 }
 
+void PageHandler::readblock(PhysPt addr, uint8_t* dest, size_t num_bytes,
+                            uint8_t access_size)
+{
+	assert(access_size == 1 || access_size == 2 || access_size == 4);
+	assert(num_bytes % access_size == 0);
+
+	for (size_t offset = 0; offset < num_bytes; offset += access_size) {
+		const auto address = addr + static_cast<PhysPt>(offset);
+		switch (access_size) {
+		case 1: dest[offset] = readb(address); break;
+		case 2: host_writew(dest + offset, readw(address)); break;
+		case 4: host_writed(dest + offset, readd(address)); break;
+		}
+	}
+}
+
+void PageHandler::writeblock(PhysPt addr, const uint8_t* src,
+                             size_t num_bytes, uint8_t access_size)
+{
+	assert(access_size == 1 || access_size == 2 || access_size == 4);
+	assert(num_bytes % access_size == 0);
+
+	for (size_t offset = 0; offset < num_bytes; offset += access_size) {
+		const auto address = addr + static_cast<PhysPt>(offset);
+		switch (access_size) {
+		case 1: writeb(address, src[offset]); break;
+		case 2: writew(address, host_readw(src + offset)); break;
+		case 4: writed(address, host_readd(src + offset)); break;
+		}
+	}
+}
+
+void PageHandler::fillblock(PhysPt addr, uint8_t val, size_t num_bytes,
+                            uint8_t access_size)
+{
+	assert(access_size == 1 || access_size == 2 || access_size == 4);
+	assert(num_bytes % access_size == 0);
+
+	for (size_t offset = 0; offset < num_bytes; offset += access_size) {
+		const auto address = addr + static_cast<PhysPt>(offset);
+		switch (access_size) {
+		case 1: writeb(address, val); break;
+		case 2: writew(address, static_cast<uint16_t>(val * 0x0101u)); break;
+		case 4: writed(address, val * 0x01010101u); break;
+		}
+	}
+}
+
 struct PF_Entry {
 	uint32_t cs;
 	uint32_t eip;
@@ -790,6 +841,9 @@ void PAGING_InitTLB()
 
 void PAGING_ClearTLB()
 {
+	ZoneScoped;
+	TracyPlot("TLB pages flushed", static_cast<int64_t>(paging.links.used));
+
 	uint32_t * entries=&paging.links.entries[0];
 	for (;paging.links.used>0;paging.links.used--) {
 		const auto page=*entries++;
@@ -893,6 +947,9 @@ void PAGING_InitTLB()
 
 void PAGING_ClearTLB()
 {
+	ZoneScoped;
+	TracyPlot("TLB pages flushed", static_cast<int64_t>(paging.links.used));
+
 	uint32_t* entries = &paging.links.entries[0];
 	for (;paging.links.used>0;paging.links.used--) {
 		Bitu page=*entries++;
@@ -1028,7 +1085,34 @@ public:
 
 static std::unique_ptr<PAGING> paging_instance = nullptr;
 
+// The TLB and links only cache the page tables in guest memory, so they're
+// rebuilt rather than saved
+static void paging_save_snapshot(SnapshotWriter& writer)
+{
+	writer.Write(paging.cr2);
+	writer.Write(paging.cr3);
+	writer.Write(paging.enabled);
+}
+
+static void paging_load_snapshot(SnapshotReader& reader)
+{
+	// Start from the default page directory; A20 and EMS map their pages
+	// again when they're restored
+	paging.enabled = false;
+	PAGING_InitTLB();
+	for (auto i = 0; i < LINK_START; i++) {
+		paging.firstmb[i] = i;
+	}
+	pf_queue.used = 0;
+
+	reader.Read(paging.cr2);
+	PAGING_SetDirBase(reader.Read<uint32_t>());
+	PAGING_Enable(reader.Read<bool>());
+}
+
 void PAGING_Init(Section *sec)
 {
 	paging_instance = std::make_unique<PAGING>(sec);
+
+	SNAPSHOT_AddComponent("paging", paging_save_snapshot, paging_load_snapshot);
 }
@@ -0,0 +1,286 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef DOSBOX_STRING_SPANS_H
+#define DOSBOX_STRING_SPANS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "mem_host.h"
+#include "paging.h"
+
+// Fast paths for forward REP MOVS and REP STOS in the interpreter cores.
+//
+// Instead of going through the memory handlers element by element, as many
+// elements as fit in the current 4K pages of the source and destination are
+// handled in one go, provided both pages are mapped directly to host memory
+// in the TLB. That excludes pages with memory handlers, such as ROM and the
+// code pages of the dynamic cores, as well as pages that aren't in the TLB
+// yet. Handlers with the PFLAG_BLOCKACCESS flag (video memory) are the
+// exception: spans between them and host memory use their block accesses.
+//
+// The span functions return the number of elements they've handled. When
+// they return zero, the next element has to go through the memory handlers
+// (which also takes care of page faults and filling the TLB).
+//
+// The cycles of the whole instruction are accounted for up front by the
+// callers, so the spans never run past the point where the instruction is
+// interrupted.
+
+#if C_DEBUG && C_HEAVY_DEBUG
+// The memory read breakpoints need to see every access
+constexpr bool StringSpansEnabled = false;
+#else
+constexpr bool StringSpansEnabled = true;
+#endif
+
+constexpr uint32_t StringSpanPageSize = 4096;
+
+// Returns the number of elements that can be accessed from `index` onwards
+// without crossing a page boundary or wrapping the index
+template <typename T>
+static inline uint64_t string_span_elements(const PhysPt base,
+                                            const uint64_t index,
+                                            const uint64_t add_mask)
+{
+	const PhysPt address         = base + static_cast<PhysPt>(index);
+	const uint64_t to_page_end   = StringSpanPageSize - (address & 0xfff);
+	const uint64_t to_index_wrap = add_mask - index + 1;
+
+	return std::min(to_page_end, to_index_wrap) / sizeof(T);
+}
+
+// Returns the number of elements to handle through the memory handlers before
+// trying a span again, which is when the next page is reached
+template <typename T>
+static inline uint64_t string_handler_elements(const PhysPt base,
+                                               const uint64_t index,
+                                               const uint64_t add_mask,
+                                               const uint64_t count)
+{
+	return std::clamp<uint64_t>(string_span_elements<T>(base, index, add_mask),
+	                            1,
+	                            count);
+}
+
+template <typename T>
+static inline uint64_t string_handler_elements(const PhysPt si_base,
+                                               const uint64_t si_index,
+                                               const PhysPt di_base,
+                                               const uint64_t di_index,
+                                               const uint64_t add_mask,
+                                               const uint64_t count)
+{
+	return std::min(string_handler_elements<T>(si_base, si_index, add_mask, count),
+	                string_handler_elements<T>(di_base, di_index, add_mask, count));
+}
+
+template <typename T>
+static inline uint64_t movs_span(const PhysPt si_base, const uint64_t si_index,
+                                 const PhysPt di_base, const uint64_t di_index,
+                                 const uint64_t add_mask, const uint64_t count)
+{
+	if constexpr (!StringSpansEnabled) {
+		return 0;
+	}
+
+	const auto num_elements = std::min({count,
+	                                    string_span_elements<T>(si_base, si_index, add_mask),
+	                                    string_span_elements<T>(di_base, di_index, add_mask)});
+	if (num_elements < 2) {
+		return 0;
+	}
+
+	const PhysPt src_address = si_base + static_cast<PhysPt>(si_index);
+	const PhysPt dst_address = di_base + static_cast<PhysPt>(di_index);
+
+	const auto src_page = get_tlb_read(src_address);
+	const auto dst_page = get_tlb_write(dst_address);
+
+	const auto num_bytes = num_elements * sizeof(T);
+
+	// Copies between two handlers stay element by element, as the reads
+	// and writes of video memory interact through the latches
+	if (src_page && !dst_page) {
+		const auto handler = get_tlb_writehandler(dst_address);
+		if (!(handler->flags & PFLAG_BLOCKACCESS)) {
+			return 0;
+		}
+		handler->writeblock(dst_address, src_page + src_address, num_bytes, sizeof(T));
+		return num_elements;
+	}
+	if (!src_page && dst_page) {
+		const auto handler = get_tlb_readhandler(src_address);
+		if (!(handler->flags & PFLAG_BLOCKACCESS)) {
+			return 0;
+		}
+		handler->readblock(src_address, dst_page + dst_address, num_bytes, sizeof(T));
+		return num_elements;
+	}
+	if (!src_page || !dst_page) {
+		return 0;
+	}
+	const auto src = src_page + src_address;
+	const auto dst = dst_page + dst_address;
+
+	const auto src_start = reinterpret_cast<uintptr_t>(src);
+	const auto dst_start = reinterpret_cast<uintptr_t>(dst);
+
+	if (dst_start > src_start && dst_start < src_start + num_bytes) {
+		// A forward copy onto an overlapping higher destination repeats
+		// the start of the source, which programs use to fill memory
+		// with a pattern, so this has to go element by element
+		for (uint64_t i = 0; i < num_elements; ++i) {
+			T value = 0;
+			std::memcpy(&value, src + i * sizeof(T), sizeof(T));
+			std::memcpy(dst + i * sizeof(T), &value, sizeof(T));
+		}
+	} else {
+		std::memmove(dst, src, num_bytes);
+	}
+	return num_elements;
+}
+
+// Stores into a page with a block access handler
+template <typename T>
+static inline uint64_t stos_block(const PhysPt dst_address,
+                                  const uint64_t num_elements, const T value)
+{
+	const auto handler = get_tlb_writehandler(dst_address);
+	if (!(handler->flags & PFLAG_BLOCKACCESS)) {
+		return 0;
+	}
+	const auto num_bytes = num_elements * sizeof(T);
+
+	const auto low_byte = static_cast<uint8_t>(value & 0xff);
+	if (value == static_cast<T>(low_byte * static_cast<T>(0x01010101u))) {
+		handler->fillblock(dst_address, low_byte, num_bytes, sizeof(T));
+	} else {
+		uint8_t pattern[StringSpanPageSize];
+		for (uint64_t i = 0; i < num_elements; ++i) {
+			if constexpr (sizeof(T) == 2) {
+				host_writew(pattern + i * sizeof(T), value);
+			} else {
+				host_writed(pattern + i * sizeof(T), value);
+			}
+		}
+		handler->writeblock(dst_address, pattern, num_bytes, sizeof(T));
+	}
+	return num_elements;
+}
+
+template <typename T>
+static inline uint64_t stos_span(const PhysPt di_base, const uint64_t di_index,
+                                 const uint64_t add_mask,
+                                 const uint64_t count, const T value)
+{
+	if constexpr (!StringSpansEnabled) {
+		return 0;
+	}
+
+	const auto num_elements = std::min(
+	        count, string_span_elements<T>(di_base, di_index, add_mask));
+	if (num_elements < 2) {
+		return 0;
+	}
+
+	const PhysPt dst_address = di_base + static_cast<PhysPt>(di_index);
+
+	const auto dst_page = get_tlb_write(dst_address);
+	if (!dst_page) {
+		return stos_block(dst_address, num_elements, value);
+	}
+	auto dst = dst_page + dst_address;
+
+	if constexpr (sizeof(T) == 1) {
+		std::memset(dst, value, num_elements);
+	} else {
+		for (uint64_t i = 0; i < num_elements; ++i) {
+			if constexpr (sizeof(T) == 2) {
+				host_writew(dst, value);
+			} else {
+				host_writed(dst, value);
+			}
+			dst += sizeof(T);
+		}
+	}
+	return num_elements;
+}
+
+// The REP STOS and REP MOVS loops of the interpreter cores. Forward runs use
+// the spans where they can, and everything else goes element by element
+// through the core's own memory accessors, passed in as `load` and `store`.
+// `add_index` is the signed step per element.
+template <typename T, typename Index, typename Count, typename Store>
+static inline void rep_stos(const PhysPt di_base, Index& di_index,
+                            const Index add_mask, const Bits add_index,
+                            Count& count, const T value, Store store)
+{
+	while (count > 0) {
+		uint64_t num_handled = count;
+		if (add_index > 0) {
+			const auto n = stos_span<T>(di_base, di_index, add_mask, count, value);
+			if (n > 0) {
+				di_index = (di_index + n * sizeof(T)) & add_mask;
+				count -= n;
+				continue;
+			}
+			num_handled = string_handler_elements<T>(di_base,
+			                                         di_index,
+			                                         add_mask,
+			                                         count);
+		}
+		for (; num_handled > 0; --num_handled, --count) {
+			store(di_base + di_index, value);
+			di_index = (di_index + add_index) & add_mask;
+		}
+	}
+}
+
+template <typename T, typename Index, typename Count, typename Load, typename Store>
+static inline void rep_movs(const PhysPt si_base, Index& si_index,
+                            const PhysPt di_base, Index& di_index,
+                            const Index add_mask, const Bits add_index,
+                            Count& count, Load load, Store store)
+{
+	while (count > 0) {
+		uint64_t num_handled = count;
+		if (add_index > 0) {
+			const auto n = movs_span<T>(
+			        si_base, si_index, di_base, di_index, add_mask, count);
+			if (n > 0) {
+				si_index = (si_index + n * sizeof(T)) & add_mask;
+				di_index = (di_index + n * sizeof(T)) & add_mask;
+				count -= n;
+				continue;
+			}
+			num_handled = string_handler_elements<T>(
+			        si_base, si_index, di_base, di_index, add_mask, count);
+		}
+		for (; num_handled > 0; --num_handled, --count) {
+			store(di_base + di_index, load(si_base + si_index));
+			di_index = (di_index + add_index) & add_mask;
+			si_index = (si_index + add_index) & add_mask;
+		}
+	}
+}
+
+#endif
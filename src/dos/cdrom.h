@@ -24,13 +24,18 @@
 
 #include "dosbox.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "support.h"
@@ -329,32 +334,74 @@ public:
 	}
 
 private:
+	// A range of Redbook sectors handed to the decode-ahead worker,
+	// along with a snapshot of the tracks it may play through.
+	struct PlaybackRequest {
+		std::vector<Track> tracks = {};
+		uint32_t startSector      = 0;
+		uint32_t redbookFrames    = 0;
+	};
+
+	// Marks where in the decoded stream a track's playback begins, so the
+	// reported play position follows the frames the mixer has consumed.
+	struct PlaybackSegment {
+		std::weak_ptr<TrackFile> trackFile = {};
+		uint64_t firstFrame                = 0;
+		uint32_t startSector               = 0;
+	};
+
+	// Up to one second of decoded audio is kept ahead of the play position
+	static constexpr size_t DecodeAheadFrames = REDBOOK_PCM_FRAMES_PER_SECOND;
+
 	static struct imagePlayer {
 		// Objects, pointers, and then scalars; in descending size-order.
 		std::weak_ptr<TrackFile> trackFile = {};
 		MixerChannelPtr channel            = nullptr;
 		CDROM_Interface_Image* cd          = nullptr;
 
-		void (MixerChannel::*addFrames)(int, const int16_t*) = nullptr;
-
-		uint32_t playedTrackFrames  = 0;
-		uint32_t totalTrackFrames   = 0;
-		uint32_t startSector        = 0;
-		uint32_t totalRedbookFrames = 0;
-		bool isPlaying              = false;
-		bool isPaused               = false;
-
-		// TODO `MixerBufferByteSize` is hardcoded to 1024 * 16 bytes,
-		// so this buffer has been 32k long for a while now. There's
-		// potential for buffer overflows, though; the code that writes
-		// to the buffer asserts the max length of the writes, but
-		// allows lengths far greater than the 32k limit. So it kinda
-		// works, but by fluke.
-		//
-		// Probably the safest way going forward is to turn this into a
-		// `std::vector` and size it as needed at runtime.
-		//
-		int16_t buffer[MixerBufferByteSize * 2] = {};
+		// The decode-ahead worker decodes the requested range (crossing
+		// into the following tracks without a gap) into the queue, so
+		// the mixer callback never has to decode or seek.
+		std::thread decoder                  = {};
+		std::mutex mutex                     = {};
+		std::condition_variable waiter       = {};
+		RWQueue<AudioFrame> queue{DecodeAheadFrames};
+		std::vector<AudioFrame> frames       = {}; // reused by the callback
+		std::deque<PlaybackSegment> segments = {};
+		PlaybackRequest request              = {};
+
+		uint64_t dequeuedFrames         = 0;
+		uint64_t segmentFirstFrame      = 0;
+		uint32_t playedTrackFrames      = 0;
+		uint32_t startSector            = 0;
+		uint32_t resumeSector           = 0;
+		uint32_t resumeRedbookFrames    = 0;
+		std::atomic<uint32_t> generation = 0;
+		bool hasRequest                 = false;
+		bool decodeDone                 = false;
+		bool shouldExit                 = false;
+		bool isPlaying                  = false;
+		bool isPaused                   = false;
+
+		void StopDecoder()
+		{
+			if (!decoder.joinable()) {
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				shouldExit = true;
+				++generation;
+				queue.Stop();
+			}
+			waiter.notify_all();
+			decoder.join();
+		}
+
+		~imagePlayer()
+		{
+			StopDecoder();
+		}
 	} player;
 
 	// Private utility functions
@@ -364,6 +411,11 @@ private:
 	                 const bool mode2);
 	std::vector<Track>::iterator GetTrack(const uint32_t sector);
 	void CDAudioCallback(const int desired_track_frames);
+	static void DecodeAheadLoop();
+	static void DecodeRange(const PlaybackRequest& request,
+	                        const uint32_t generation);
+	static void UpdatePlayPosition(const size_t dequeued_frames);
+	static void CancelDecoding();
 
 	// Private functions for cue sheet processing
 	bool  LoadCueSheet(const char *cuefile);
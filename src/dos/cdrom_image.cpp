@@ -23,6 +23,7 @@
 
 #include "cdrom.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <chrono>
@@ -41,12 +42,14 @@
 #include <cstring>
 #endif
 
+#include "byteorder.h"
 #include "channel_names.h"
 #include "drives.h"
 #include "fs_utils.h"
 #include "math_utils.h"
 #include "setup.h"
 #include "string_utils.h"
+#include "tracy.h"
 
 // String maximums, local to this file
 #define MAX_LINE_LENGTH 512
@@ -499,6 +502,9 @@ CDROM_Interface_Image::CDROM_Interface_Image()
 			                                   ChannelFeature::DigitalAudio});
 
 			player.channel->Enable(false); // only enabled during playback periods
+
+			player.shouldExit = false;
+			player.decoder = std::thread(&CDROM_Interface_Image::DecodeAheadLoop);
 			MIXER_UnlockMixerThread();
 		}
 #ifdef DEBUG
@@ -520,10 +526,12 @@ CDROM_Interface_Image::~CDROM_Interface_Image()
 		if (player.cd) {
 			StopAudio();
 		}
+		player.StopDecoder();
 		MIXER_DeregisterChannel(player.channel);
 		player.channel.reset();
 	}
 	if (player.cd == this) {
+		StopAudio();
 		player.cd = nullptr;
 	}
 	MIXER_UnlockMixerThread();
@@ -632,14 +640,21 @@ bool CDROM_Interface_Image::GetAudioSub(unsigned char& attr,
 		track_iter track = tracks.begin();
 		// the CD's current track is valid
 
-		 // reserve the track_file as a shared_ptr to avoid deletion in another thread
+		// The mixer callback advances the play position, so take a
+		// consistent snapshot of it
+		std::unique_lock<std::mutex> lock(player.mutex);
+		// reserve the track_file as a shared_ptr to avoid deletion in another thread
 		const auto track_file = player.trackFile.lock();
+		const auto played_track_frames = player.playedTrackFrames;
+		const auto start_sector = player.startSector;
+		lock.unlock();
+
 		if (track_file) {
 			LagDriveResponse();
 			const uint32_t sample_rate = track_file->getRate();
-			const uint32_t played_frames = ceil_udivide(player.playedTrackFrames
+			const uint32_t played_frames = ceil_udivide(played_track_frames
 			                               * REDBOOK_FRAMES_PER_SECOND, sample_rate);
-			absolute_sector = player.startSector + played_frames;
+			absolute_sector = start_sector + played_frames;
 			track_iter current_track = GetTrack(absolute_sector);
 			if (current_track != tracks.end()) {
 				track = current_track;
@@ -728,75 +743,48 @@ bool CDROM_Interface_Image::PlayAudioSector(uint32_t start, uint32_t len)
 		start = track->start;
 	}
 
-	// Calculate the requested byte offset from the sector offset
-	const auto sector_offset = start - track->start;
-	const auto byte_offset = track->skip + sector_offset * track->sectorSize;
-
-	// Guard: Bail if our track could not be seeked
-	if (!track_file->seek(byte_offset)) {
-		LOG_MSG("CDROM: Track %d failed to seek to byte %u, so cancelling playback",
-		        track->number, byte_offset);
-		StopAudio();
-		return false;
-	}
-
-	// We're performing an audio-task, so update the audio position
-	track_file->setAudioPosition(byte_offset);
-
-	// Get properties about the current track
-	const uint8_t track_channels = track_file->getChannels();
 	const uint32_t track_rate = track_file->getRate();
 
-	// Update our player with properties about this playback sequence
-	player.cd = this;
-	player.trackFile = track_file;
-	player.startSector = start;
-	player.totalRedbookFrames = len;
-	player.isPlaying = true;
-	player.isPaused = false;
-
-	// Assign the mixer function associated with this track's content type
-	if (track_file->getEndian() == AUDIO_S16SYS) {
-		player.addFrames = (track_channels == 2)
-		                         ? &MixerChannel::AddSamples_s16
-		                         : &MixerChannel::AddSamples_m16;
-	} else {
-		player.addFrames = (track_channels == 2)
-		                         ? &MixerChannel::AddSamples_s16_nonnative
-		                         : &MixerChannel::AddSamples_m16_nonnative;
+	// Hand the range over to the decode-ahead worker, which seeks and
+	// decodes off the emulation and mixer threads
+	{
+		std::lock_guard<std::mutex> lock(player.mutex);
+		CancelDecoding();
+
+		player.request    = {tracks, start, len};
+		player.hasRequest = true;
+
+		// Update our player with properties about this playback sequence
+		player.cd                = this;
+		player.trackFile         = track_file;
+		player.startSector       = start;
+		player.playedTrackFrames = 0;
+		player.dequeuedFrames    = 0;
+		player.segmentFirstFrame = 0;
+		player.isPlaying         = true;
+		player.isPaused          = false;
 	}
-
-	/**
-	 *  Convert Redbook frames (len) to Track PCM frames, rounding up to whole
-	 *  integer frames. Note: the intermediate numerator in the calculation
-	 *  below can overflow uint32_t, so the variable types used must stay
-	 *  64-bit.
-	 */
-	player.playedTrackFrames = 0;
-	player.totalTrackFrames = player.totalRedbookFrames *
-	                          (track_rate / REDBOOK_FRAMES_PER_SECOND);
+	player.waiter.notify_all();
 
 #ifdef DEBUG
 	if (start < track->start) {
 		LOG_MSG("CDROM: Play sector %u to %u in the pregap of track %d [pregap %d,"
-		        " start %u, end %u] for %u PCM frames at rate %u",
+		        " start %u, end %u] at rate %u",
 		        start,
 		        start + len,
 		        track->number,
 		        prev(track)->start - prev(track)->length,
 		        track->start,
 		        track->start + track->length,
-		        player.totalTrackFrames,
 		        track_rate);
 	} else {
-		LOG_MSG("CDROM: Play sector %u to %u in track %d [start %u, end %u],"
-		        " for %u PCM frames at rate %u",
+		LOG_MSG("CDROM: Play sector %u to %u in track %d [start %u, end %u]"
+		        " at rate %u",
 		        start,
 		        start + len,
 		        track->number,
 		        track->start,
 		        track->start + track->length,
-		        player.totalTrackFrames,
 		        track_rate);
 	}
 #endif
@@ -822,6 +810,10 @@ bool CDROM_Interface_Image::PauseAudio(bool resume)
 
 bool CDROM_Interface_Image::StopAudio(void)
 {
+	{
+		std::lock_guard<std::mutex> lock(player.mutex);
+		CancelDecoding();
+	}
 	player.isPlaying = false;
 	player.isPaused = false;
 	if (player.channel) {
@@ -866,6 +858,8 @@ bool CDROM_Interface_Image::ReadSectors(PhysPt buffer,
                                         const uint32_t sector,
                                         const uint16_t num)
 {
+	ZoneScoped;
+
 	const uint16_t sectorSize = (raw ? BYTES_PER_RAW_REDBOOK_FRAME
 	                                 : BYTES_PER_COOKED_REDBOOK_FRAME);
 	const uint32_t requested_bytes = num * sectorSize;
@@ -991,6 +985,7 @@ bool CDROM_Interface_Image::ReadSector(uint8_t *buffer, const bool raw, const ui
 
 bool CDROM_Interface_Image::ReadSectorsHost(void *buffer, bool raw, unsigned long sector, unsigned long num)
 {
+	ZoneScoped;
 	unsigned int sectorSize = raw ? BYTES_PER_RAW_REDBOOK_FRAME : BYTES_PER_COOKED_REDBOOK_FRAME;
 	bool success = true; //Gobliiins reads 0 sectors
 	for(unsigned long i = 0; i < num; i++) {
@@ -1001,68 +996,280 @@ bool CDROM_Interface_Image::ReadSectorsHost(void *buffer, bool raw, unsigned lon
 	return success;
 }
 
+// Caller must hold the player's mutex
+void CDROM_Interface_Image::CancelDecoding()
+{
+	// Unblocks the worker if it's waiting for room in the queue; it then
+	// sees the generation change and abandons the range it was decoding.
+	++player.generation;
+	player.queue.Stop();
+
+	player.request             = {};
+	player.hasRequest          = false;
+	player.decodeDone          = false;
+	player.resumeSector        = 0;
+	player.resumeRedbookFrames = 0;
+	player.segments.clear();
+}
+
+// Caller must hold the player's mutex
+void CDROM_Interface_Image::UpdatePlayPosition(const size_t dequeued_frames)
+{
+	player.dequeuedFrames += dequeued_frames;
+
+	while (!player.segments.empty() &&
+	       player.segments.front().firstFrame <= player.dequeuedFrames) {
+		const auto& segment      = player.segments.front();
+		player.trackFile         = segment.trackFile;
+		player.startSector       = segment.startSector;
+		player.segmentFirstFrame = segment.firstFrame;
+		player.segments.pop_front();
+	}
+	player.playedTrackFrames = check_cast<uint32_t>(player.dequeuedFrames -
+	                                                player.segmentFirstFrame);
+}
+
 void CDROM_Interface_Image::CDAudioCallback(const int desired_track_frames)
 {
 	/**
-	 *  This callback runs in SDL's mixer thread, so there's a risk
-	 *  our track_file pointer could be removed by the main thread.
-	 *  We reserve the track_file up-front for the scope of this call.
+	 *  This callback runs in the mixer thread. All decoding and seeking
+	 *  happens in the decode-ahead worker, so here we only move frames
+	 *  that are already decoded out of the queue.
 	 */
-	std::shared_ptr<TrackFile> track_file = player.trackFile.lock();
-
-	// Guards: Bail if the request or our player is invalid
-	if (desired_track_frames == 0 || !player.cd || !track_file) {
+	if (desired_track_frames <= 0 || !player.cd) {
 #ifdef DEBUG
 		LOG_MSG("CDROM: CDAudioCallback called with one more empty dependencies:\n"
-		        "\t - frames to play (%" PRIuPTR ")\n"
-		        "\t - pointer to the CD object (%p)\n"
-		        "\t - pointer to the track's file (%p)\n",
-		        desired_track_frames, static_cast<void *>(player.cd),
-		        static_cast<void *>(track_file.get()));
+		        "\t - frames to play (%d)\n"
+		        "\t - pointer to the CD object (%p)\n",
+		        desired_track_frames, static_cast<void *>(player.cd));
 #endif
 		if (player.cd)
 			player.cd->StopAudio();
 		return;
 	}
 
-	const auto decoded_track_frames = check_cast<uint16_t>(
-	        track_file->decode(player.buffer, desired_track_frames));
+	const auto generation = player.generation.load();
+
+	// Only take what's already decoded; the queue can be cleared at any
+	// time by a seek or stop, so we must never wait on it here
+	const auto desired_frames  = static_cast<size_t>(desired_track_frames);
+	const auto dequeued_frames = player.queue.NonblockingBulkDequeue(
+	        player.frames, desired_frames);
+
+	bool reached_end      = false;
+	uint32_t resume_sector = 0;
+	uint32_t resume_frames = 0;
+	{
+		std::lock_guard<std::mutex> lock(player.mutex);
+		// Skip the bookkeeping if playback was restarted or stopped
+		// while we were dequeuing
+		if (generation == player.generation) {
+			UpdatePlayPosition(dequeued_frames);
+			reached_end   = player.decodeDone && player.queue.IsEmpty();
+			resume_sector = player.resumeSector;
+			resume_frames = player.resumeRedbookFrames;
+		}
+	}
 
-	if (!decoded_track_frames) {
-		// This particular CDDA track has come to an end, but the
-		// program has requested we continue playing for a longer
-		// period. So keep going!
-		const auto fraction_played = static_cast<double>(
-		                                     player.playedTrackFrames) /
-		                             player.totalTrackFrames;
+	// Pad with silence if the worker hasn't caught up yet (i.e., right
+	// after a seek) or we've reached the end of the requested range
+	player.frames.resize(desired_frames);
+	player.channel->AddSamples_sfloat(desired_track_frames,
+	                                  &player.frames[0][0]);
 
-		const auto played_redbook_frames = static_cast<uint32_t>(
-		        ceil(fraction_played * player.totalRedbookFrames));
+	if (!reached_end) {
+		return;
+	}
+	if (resume_frames > 0) {
+		// The worker stopped at a track it can't play through without
+		// a gap (i.e., it has a different sample rate), but the program
+		// has requested we continue playing for a longer period. So
+		// restart playback from that track.
+		player.cd->PlayAudioSector(resume_sector, resume_frames);
+		return;
+	}
+#ifdef DEBUG
+	LOG_MSG("CDROM: CDAudioCallback stopping because the requested range "
+	        "has been played");
+#endif
+	player.cd->StopAudio();
+}
 
-		const auto new_redbook_start_frame = player.startSector +
-		                                     played_redbook_frames;
+static void append_audio_frames(const int16_t* pcm, const uint32_t num_frames,
+                                const uint8_t channels, const bool is_native,
+                                std::vector<AudioFrame>& audio_frames)
+{
+	auto to_sample = [is_native](const int16_t sample) {
+		return is_native ? sample
+		                 : static_cast<int16_t>(
+		                           bswap_u16(static_cast<uint16_t>(sample)));
+	};
+	if (channels == 2) {
+		for (uint32_t i = 0; i < num_frames; ++i) {
+			audio_frames.emplace_back(to_sample(pcm[i * 2]),
+			                          to_sample(pcm[i * 2 + 1]));
+		}
+	} else {
+		for (uint32_t i = 0; i < num_frames; ++i) {
+			audio_frames.emplace_back(to_sample(pcm[i]));
+		}
+	}
+}
 
-		const auto remaining_redbook_frames = player.totalRedbookFrames -
-		                                      played_redbook_frames;
+void CDROM_Interface_Image::DecodeRange(const PlaybackRequest& request,
+                                        const uint32_t generation)
+{
+	auto is_cancelled = [generation]() {
+		return generation != player.generation;
+	};
+
+	auto track = std::find_if(request.tracks.begin(),
+	                          request.tracks.end(),
+	                          [&](const Track& t) {
+		                          return t.start <= request.startSector &&
+		                                 request.startSector < t.start + t.length;
+	                          });
+	if (track == request.tracks.end() || !track->file) {
+		return;
+	}
 
-		player.cd->PlayAudioSector(new_redbook_start_frame,
-		                           remaining_redbook_frames);
+	// Tracks with the same format as the first one are decoded back-to-back
+	// into the queue, so the start of the next track is ready before the
+	// current one finishes playing
+	const uint32_t rate    = track->file->getRate();
+	const uint8_t channels = track->file->getChannels();
+	const uint16_t endian  = track->file->getEndian();
 
+	const uint32_t track_frames_per_sector = rate / REDBOOK_FRAMES_PER_SECOND;
+	if (track_frames_per_sector == 0 || channels == 0 || channels > 2) {
 		return;
 	}
 
-	// Use the stereo or mono and native or nonnative AddSamples call
-	// assigned during construction
-	(player.channel.get()->*player.addFrames)(decoded_track_frames, player.buffer);
+	constexpr uint32_t DecodeChunkFrames = 4096;
+	std::vector<int16_t> pcm(DecodeChunkFrames * REDBOOK_CHANNELS);
+	std::vector<AudioFrame> audio_frames = {};
+	audio_frames.reserve(DecodeChunkFrames);
 
-	player.playedTrackFrames += decoded_track_frames;
-	if (player.playedTrackFrames >= player.totalTrackFrames) {
-#ifdef DEBUG
-		LOG_MSG("CDROM: CDAudioCallback stopping because "
-		"playedTrackFrames (%u) >= totalTrackFrames (%u)",
-		player.playedTrackFrames, player.totalTrackFrames);
-#endif
-		player.cd->StopAudio();
+	uint32_t sector         = request.startSector;
+	uint32_t remaining      = request.redbookFrames;
+	uint64_t decoded_frames = 0;
+
+	while (remaining > 0 && !is_cancelled()) {
+		const auto& track_file = track->file;
+		if (!track_file || track->attr == 0x40) {
+			break;
+		}
+		if (track_file->getRate() != rate ||
+		    track_file->getChannels() != channels ||
+		    track_file->getEndian() != endian) {
+			std::lock_guard<std::mutex> lock(player.mutex);
+			if (!is_cancelled()) {
+				player.resumeSector        = sector;
+				player.resumeRedbookFrames = remaining;
+			}
+			break;
+		}
+
+		const auto byte_offset = track->skip +
+		                         (sector - track->start) * track->sectorSize;
+		if (!track_file->seek(byte_offset)) {
+			LOG_MSG("CDROM: Track %d failed to seek to byte %u, so cancelling playback",
+			        track->number, byte_offset);
+			break;
+		}
+		// We're performing an audio-task, so update the audio position
+		track_file->setAudioPosition(byte_offset);
+
+		{
+			std::lock_guard<std::mutex> lock(player.mutex);
+			if (is_cancelled()) {
+				return;
+			}
+			player.segments.push_back({track_file, decoded_frames, sector});
+		}
+
+		// Note: the track frame count can overflow uint32_t for long
+		// requests, so it stays 64-bit.
+		uint64_t frames_left = static_cast<uint64_t>(remaining) *
+		                       track_frames_per_sector;
+		uint64_t frames_in_track = 0;
+		while (frames_left > 0 && !is_cancelled()) {
+			const auto frames_wanted = static_cast<uint32_t>(
+			        std::min<uint64_t>(DecodeChunkFrames, frames_left));
+
+			const auto frames = track_file->decode(pcm.data(), frames_wanted);
+			if (frames == 0) {
+				// This track has come to an end
+				break;
+			}
+			append_audio_frames(pcm.data(),
+			                    frames,
+			                    channels,
+			                    endian == AUDIO_S16SYS,
+			                    audio_frames);
+
+			// Blocks while the queue is full; returns early if
+			// playback was stopped or restarted
+			player.queue.BulkEnqueue(audio_frames);
+			audio_frames.clear();
+
+			frames_left -= frames;
+			frames_in_track += frames;
+			decoded_frames += frames;
+		}
+
+		const auto sectors_played = static_cast<uint32_t>(
+		        ceil_udivide(frames_in_track, track_frames_per_sector));
+		if (frames_left == 0 || sectors_played >= remaining) {
+			remaining = 0;
+			break;
+		}
+		remaining -= sectors_played;
+		sector += sectors_played;
+
+		// Move onto the next track, skipping its pregap the same way
+		// PlayAudioSector does
+		if (++track == request.tracks.end()) {
+			break;
+		}
+		if (sector < track->start) {
+			const auto pregap = track->start - sector;
+			if (pregap >= remaining) {
+				break;
+			}
+			remaining -= pregap;
+			sector = track->start;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(player.mutex);
+	if (!is_cancelled()) {
+		player.decodeDone = true;
+	}
+}
+
+void CDROM_Interface_Image::DecodeAheadLoop()
+{
+	std::unique_lock<std::mutex> lock(player.mutex);
+	while (true) {
+		player.waiter.wait(lock, [] {
+			return player.hasRequest || player.shouldExit;
+		});
+		if (player.shouldExit) {
+			return;
+		}
+
+		const auto request    = std::move(player.request);
+		const auto generation = player.generation.load();
+		player.hasRequest     = false;
+
+		player.queue.Clear();
+		player.queue.Start();
+
+		// Decoding and seeking are slow; avoid holding the lock
+		lock.unlock();
+		DecodeRange(request, generation);
+		lock.lock();
 	}
 }
 
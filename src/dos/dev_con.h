@@ -53,6 +53,7 @@ public:
 private:
 	void ClearAnsi();
 	void Output(uint8_t chr);
+	bool OutputText(const uint8_t* text, uint16_t count);
 
 	uint8_t readcache = 0;
 	struct ansi {
@@ -168,8 +169,29 @@ bool device_CON::Write(uint8_t* data, uint16_t* size)
 	uint16_t ncols, nrows;
 	uint8_t tempdata;
 	INT10_SetCurMode();
+
+	// End of the last run that couldn't be output in one go; its characters
+	// are output one by one without looking for a run again
+	uint16_t unbatched_end = 0;
+
 	while (*size > count) {
 		if (!ansi.esc) {
+			// Output runs of plain text in one go
+			if (count >= unbatched_end) {
+				uint16_t run = 0;
+				while (count + run < *size &&
+				       data[count + run] != Ascii::Escape &&
+				       data[count + run] != Ascii::Bell) {
+					++run;
+				}
+				if (run > 1) {
+					if (OutputText(data + count, run)) {
+						count += run;
+						continue;
+					}
+					unbatched_end = count + run;
+				}
+			}
 			if (data[count] == Ascii::Escape) {
 				// Clear the datastructure
 				ClearAnsi();
@@ -520,6 +542,26 @@ uint16_t device_CON::GetInformation()
 	return 0x80D3;
 }
 
+bool device_CON::OutputText(const uint8_t* text, const uint16_t count)
+{
+	if (INT10_IsVectorHooked()) {
+		// Programs that hook the video interrupt get to see every
+		// character
+		return false;
+	}
+	const auto expand_tabs = !dos.direct_output;
+
+	if (dos.internal_output || ansi.enabled) {
+		constexpr auto use_attribute = true;
+		return INT10_TeletypeOutputText(
+		        text, count, ansi.attr, use_attribute, expand_tabs, ansi.attr);
+	} else {
+		constexpr auto use_attribute = false;
+		return INT10_TeletypeOutputText(
+		        text, count, 7, use_attribute, expand_tabs, {});
+	}
+}
+
 void device_CON::Output(uint8_t chr)
 {
 	if (dos.internal_output || ansi.enabled) {
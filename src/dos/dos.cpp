@@ -35,6 +35,7 @@
 #include "regs.h"
 #include "serialport.h"
 #include "setup.h"
+#include "snapshot.h"
 #include "string_utils.h"
 #include "support.h"
 
@@ -266,10 +267,22 @@ static Bitu DOS_21Handler(void) {
 		};
 	case 0x09:		/* Write string to STDOUT */
 		{	
-			uint8_t c;uint16_t n=1;
+			// Pass the string on in chunks, so the console can output
+			// it in one go
+			constexpr uint16_t max_chunk = 4096;
+			uint8_t chunk[max_chunk];
+			uint16_t n = 0;
+			uint8_t c;
 			PhysPt buf=SegPhys(ds)+reg_dx;
 			while ((c=mem_readb(buf++))!='$') {
-				DOS_WriteFile(STDOUT,&c,&n);
+				chunk[n++] = c;
+				if (n == max_chunk) {
+					DOS_WriteFile(STDOUT, chunk, &n);
+					n = 0;
+				}
+			}
+			if (n > 0) {
+				DOS_WriteFile(STDOUT, chunk, &n);
 			}
 			reg_al=c;
 		}
@@ -1553,6 +1566,207 @@ public:
 	}
 };
 
+// Plain directory mounts are recreated from their settings; other drives
+// only keep their current directory, provided the new session has them too
+enum class SnapshotDriveKind : uint8_t { None, Local, Other };
+
+// Open files on plain directory mounts are reopened at the same position
+enum class SnapshotFileKind : uint8_t { None, Device, Local, Other };
+
+static bool is_plain_local_drive(const std::shared_ptr<DOS_Drive>& drive)
+{
+	return drive && drive->GetType() == DosDriveType::Local &&
+	       !std::dynamic_pointer_cast<Overlay_Drive>(drive);
+}
+
+static void dos_save_snapshot(SnapshotWriter& writer)
+{
+	// The country table is a host allocation owned by this session
+	auto dos_block           = dos;
+	dos_block.tables.country = nullptr;
+	writer.Write(dos_block);
+	writer.Write(countryNo);
+
+	for (const auto& drive : Drives) {
+		if (!drive) {
+			writer.Write(SnapshotDriveKind::None);
+			continue;
+		}
+		if (!is_plain_local_drive(drive)) {
+			writer.Write(SnapshotDriveKind::Other);
+			writer.WriteString(drive->curdir);
+			continue;
+		}
+		const auto local_drive = std::static_pointer_cast<localDrive>(drive);
+
+		uint16_t bytes_sector   = 0;
+		uint8_t sectors_cluster = 0;
+		uint16_t total_clusters = 0;
+		uint16_t free_clusters  = 0;
+		local_drive->AllocationInfo(&bytes_sector,
+		                            &sectors_cluster,
+		                            &total_clusters,
+		                            &free_clusters);
+
+		writer.Write(SnapshotDriveKind::Local);
+		writer.WriteString(drive->curdir);
+		writer.WriteString(local_drive->GetBasedir());
+		writer.Write(bytes_sector);
+		writer.Write(sectors_cluster);
+		writer.Write(total_clusters);
+		writer.Write(free_clusters);
+		writer.Write(local_drive->GetMediaByte());
+		writer.Write(local_drive->IsReadOnly());
+		writer.WriteString(local_drive->GetLabel());
+	}
+
+	for (const auto& file : Files) {
+		if (!file) {
+			writer.Write(SnapshotFileKind::None);
+			continue;
+		}
+		const auto drive = file->GetDrive();
+
+		auto kind = SnapshotFileKind::Other;
+		if (dynamic_cast<DOS_Device*>(file.get())) {
+			kind = SnapshotFileKind::Device;
+		} else if (drive < DOS_DRIVES && is_plain_local_drive(Drives[drive])) {
+			kind = SnapshotFileKind::Local;
+		}
+		writer.Write(kind);
+		writer.WriteString(file->name);
+		writer.Write(drive);
+		writer.Write(file->flags);
+		writer.Write(file->time);
+		writer.Write(file->date);
+		writer.Write(file->attr._data);
+		writer.Write(file->refCtr);
+		writer.Write(file->flush_time_on_close);
+
+		if (kind == SnapshotFileKind::Local) {
+			uint32_t pos = 0;
+			file->Seek(&pos, DOS_SEEK_CUR);
+			writer.Write(pos);
+		}
+	}
+}
+
+static void dos_load_snapshot(SnapshotReader& reader)
+{
+	const auto country = dos.tables.country;
+	reader.Read(dos);
+	dos.tables.country = country;
+	reader.Read(countryNo);
+
+	// Close everything first, as the files refer to the drives
+	for (auto& file : Files) {
+		file = nullptr;
+	}
+
+	const Section_prop* section = static_cast<Section_prop*>(
+	        control->GetSection("dosbox"));
+	assert(section);
+
+	for (uint8_t i = 0; i < DOS_DRIVES; ++i) {
+		const auto kind = reader.Read<SnapshotDriveKind>();
+		if (kind == SnapshotDriveKind::None) {
+			if (Drives[i] && i != ZDRIVE_NUM) {
+				DriveManager::UnmountDrive(i);
+				Drives[i] = nullptr;
+			}
+			continue;
+		}
+		const auto curdir = reader.ReadString();
+
+		if (kind == SnapshotDriveKind::Other) {
+			if (Drives[i]) {
+				safe_strcpy(Drives[i]->curdir, curdir.c_str());
+			} else {
+				LOG_WARNING("DOS: Drive %c: from the snapshot can't be restored, "
+				            "only directory mounts are",
+				            drive_letter(i));
+			}
+			continue;
+		}
+
+		const auto basedir = reader.ReadString();
+
+		const auto bytes_sector    = reader.Read<uint16_t>();
+		const auto sectors_cluster = reader.Read<uint8_t>();
+		const auto total_clusters  = reader.Read<uint16_t>();
+		const auto free_clusters   = reader.Read<uint16_t>();
+		const auto media_byte      = reader.Read<uint8_t>();
+		const auto read_only       = reader.Read<bool>();
+		const auto label           = reader.ReadString();
+
+		if (Drives[i]) {
+			DriveManager::UnmountDrive(i);
+		}
+		const auto drive = std::make_shared<localDrive>(
+		        basedir.c_str(),
+		        bytes_sector,
+		        sectors_cluster,
+		        total_clusters,
+		        free_clusters,
+		        media_byte,
+		        read_only,
+		        section->Get_bool("allow_write_protected_files"));
+
+		DriveManager::RegisterFilesystemImage(i, drive);
+		Drives[i] = drive;
+
+		safe_strcpy(drive->curdir, curdir.c_str());
+		if (!label.empty()) {
+			drive->dirCache.SetLabel(label.c_str(), false, false);
+		}
+	}
+
+	for (uint8_t i = 0; i < DOS_FILES; ++i) {
+		const auto kind = reader.Read<SnapshotFileKind>();
+		if (kind == SnapshotFileKind::None) {
+			continue;
+		}
+		const auto name  = reader.ReadString();
+		const auto drive = reader.Read<uint8_t>();
+		const auto flags = reader.Read<uint8_t>();
+
+		std::unique_ptr<DOS_File> file = {};
+		if (kind == SnapshotFileKind::Device) {
+			const auto devnum = DOS_FindDevice(name.c_str());
+			if (devnum != DOS_DEVICES) {
+				file = std::make_unique<DOS_Device>(*Devices[devnum]);
+			}
+		} else if (kind == SnapshotFileKind::Local && drive < DOS_DRIVES &&
+		           Drives[drive]) {
+			file = Drives[drive]->FileOpen(name.c_str(), flags);
+		}
+
+		if (file) {
+			file->SetDrive(drive);
+			file->flags = flags;
+			reader.Read(file->time);
+			reader.Read(file->date);
+			file->attr = reader.Read<uint8_t>();
+			reader.Read(file->refCtr);
+			reader.Read(file->flush_time_on_close);
+		} else {
+			reader.Skip(sizeof(DOS_File::time) + sizeof(DOS_File::date) +
+			            sizeof(uint8_t) + sizeof(DOS_File::refCtr) +
+			            sizeof(DOS_File::flush_time_on_close));
+			LOG_WARNING("DOS: File '%s' from the snapshot couldn't be reopened",
+			            name.c_str());
+		}
+
+		if (kind == SnapshotFileKind::Local) {
+			auto pos = reader.Read<uint32_t>();
+			if (file) {
+				file->Seek(&pos, DOS_SEEK_SET);
+			}
+		}
+		Files[i] = std::move(file);
+	}
+}
+
 static DOS* test;
 
 void DOS_ShutDown(Section* /*sec*/) {
@@ -1565,4 +1779,6 @@ void DOS_Init(Section* sec)
 	test = new DOS(sec);
 
 	sec->AddDestroyFunction(&DOS_ShutDown);
+
+	SNAPSHOT_AddComponent("dos", dos_save_snapshot, dos_load_snapshot);
 }
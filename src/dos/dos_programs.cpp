@@ -45,6 +45,7 @@
 #include "program_rescan.h"
 #include "program_serial.h"
 #include "program_setver.h"
+#include "program_snapshot.h"
 #include "program_subst.h"
 #include "program_tree.h"
 
@@ -101,6 +102,7 @@ void Add_VFiles(const bool add_autoexec)
 	PROGRAMS_MakeFile("RESCAN.COM", ProgramCreate<RESCAN>);
 	PROGRAMS_MakeFile("SERIAL.COM", ProgramCreate<SERIAL>);
 	PROGRAMS_MakeFile("SETVER.EXE", ProgramCreate<SETVER>);
+	PROGRAMS_MakeFile("SNAPSHOT.COM", ProgramCreate<SNAPSHOT>);
 	PROGRAMS_MakeFile("SUBST.EXE", ProgramCreate<SUBST>);
 	PROGRAMS_MakeFile("TREE.COM", ProgramCreate<TREE>);
 
@@ -27,6 +27,7 @@
 #include <cstring>
 #include <ctime>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "dos_inc.h"
@@ -594,17 +595,11 @@ std::unique_ptr<DOS_File> Overlay_Drive::FileCreate(const char* name,
 }
 
 void Overlay_Drive::add_DOSname_to_cache(const char* name) {
-	for (std::vector<std::string>::const_iterator itc = DOSnames_cache.begin(); itc != DOSnames_cache.end(); ++itc){
-		if (name == (*itc)) return;
-	}
-	DOSnames_cache.push_back(name);
+	DOSnames_cache.emplace(name);
 }
 
 void Overlay_Drive::remove_DOSname_from_cache(const char* name) {
-	for (std::vector<std::string>::iterator it = DOSnames_cache.begin(); it != DOSnames_cache.end(); ++it) {
-		if (name == (*it)) { DOSnames_cache.erase(it); return;}
-	}
-
+	DOSnames_cache.erase(name);
 }
 
 bool Overlay_Drive::Sync_leading_dirs(const char* dos_filename){
@@ -787,24 +782,24 @@ void Overlay_Drive::update_cache(bool read_directory_contents) {
 			upcase(dosname);  //Should not be really needed, as uppercase in the overlay is a requirement...
 			CROSS_DOSFILENAME(dosname);
 			if (logoverlay) LOG_MSG("update cache add dosname %s",dosname);
-			DOSnames_cache.push_back(dosname);
+			DOSnames_cache.emplace(dosname);
 		}
 	}
 
 #if OVERLAY_DIR
-	for (i = DOSdirs_cache.begin(); i !=DOSdirs_cache.end(); ++i) {
+	for (const auto& dos_dir : DOSdirs_parents_first()) {
 		char fakename[CROSS_LEN];
 		safe_strcpy(fakename, basedir);
-		safe_strcat(fakename, (*i).c_str());
+		safe_strcat(fakename, dos_dir.c_str());
 		CROSS_FILENAME(fakename);
 		dirCache.AddEntryDirOverlay(fakename,true);
 	}
 #endif
 
-	for (i = DOSnames_cache.begin(); i != DOSnames_cache.end(); ++i) {
+	for (const auto& dos_name : DOSnames_cache) {
 		char fakename[CROSS_LEN];
 		safe_strcpy(fakename, basedir);
-		safe_strcat(fakename, (*i).c_str());
+		safe_strcat(fakename, dos_name.c_str());
 		CROSS_FILENAME(fakename);
 		dirCache.AddEntry(fakename,true);
 	}
@@ -1073,10 +1068,8 @@ bool Overlay_Drive::SetFileAttr(const char* name, FatAttributeFlags attr)
 
 void Overlay_Drive::add_deleted_file(const char* name,bool create_on_disk) {
 	if (logoverlay) LOG_MSG("add del file %s",name);
-	if (!is_deleted_file(name)) {
-		deleted_files_in_base.push_back(name);
+	if (deleted_files_in_base.emplace(name).second) {
 		if (create_on_disk) add_special_file_to_disk(name, "DEL");
-
 	}
 }
 
@@ -1119,52 +1112,50 @@ std::string Overlay_Drive::create_filename_of_special_operation(const char* dosn
 bool Overlay_Drive::is_dir_only_in_overlay(const char* name) {
 	if (!name || !*name) return false;
 	if (DOSdirs_cache.empty()) return false;
-	for(std::vector<std::string>::iterator it = DOSdirs_cache.begin(); it != DOSdirs_cache.end(); ++it) {
-		if (*it == name) return true;
-	}
-	return false;
+	return DOSdirs_cache.contains(name);
 }
 
 bool Overlay_Drive::is_deleted_file(const char* name) {
 	if (!name || !*name) return false;
 	if (deleted_files_in_base.empty()) return false;
-	for(std::vector<std::string>::iterator it = deleted_files_in_base.begin(); it != deleted_files_in_base.end(); ++it) {
-		if (*it == name) return true;
-	}
-	return false;
+	return deleted_files_in_base.contains(name);
 }
 
 void Overlay_Drive::add_DOSdir_to_cache(const char* name) {
 	if (!name || !*name ) return; //Skip empty file.
 	LOG_MSG("Adding name to overlay_only_dir_cache %s",name);
-	if (!is_dir_only_in_overlay(name)) {
-		DOSdirs_cache.push_back(name); 
-	}
+	DOSdirs_cache.emplace(name);
 }
 
 void Overlay_Drive::remove_DOSdir_from_cache(const char* name) {
-	for(std::vector<std::string>::iterator it = DOSdirs_cache.begin(); it != DOSdirs_cache.end(); ++it) {
-		if ( *it == name) {
-			DOSdirs_cache.erase(it);
-			return;
-		}
-	}
+	DOSdirs_cache.erase(name);
+}
+
+// The drive cache needs a parent directory to exist before any of its
+// subdirectories can be added. A parent always has fewer path separators
+// than its children, so ordering by depth is sufficient.
+std::vector<std::string> Overlay_Drive::DOSdirs_parents_first() const
+{
+	auto depth = [](const std::string& path) {
+		return std::count(path.begin(), path.end(), '\\');
+	};
+	std::vector<std::string> dirs(DOSdirs_cache.begin(), DOSdirs_cache.end());
+	std::stable_sort(dirs.begin(), dirs.end(), [&](const auto& a, const auto& b) {
+		return depth(a) < depth(b);
+	});
+	return dirs;
 }
 
 void Overlay_Drive::remove_deleted_file(const char* name,bool create_on_disk) {
-	for(std::vector<std::string>::iterator it = deleted_files_in_base.begin(); it != deleted_files_in_base.end(); ++it) {
-		if (*it == name) {
-			deleted_files_in_base.erase(it);
-			if (create_on_disk) remove_special_file_from_disk(name, "DEL");
-			return;
-		}
+	if (deleted_files_in_base.erase(name) != 0) {
+		if (create_on_disk) remove_special_file_from_disk(name, "DEL");
 	}
 }
 void Overlay_Drive::add_deleted_path(const char* name, bool create_on_disk) {
 	if (!name || !*name ) return; //Skip empty file.
 	if (logoverlay) LOG_MSG("add del path %s",name);
 	if (!is_deleted_path(name)) {
-		deleted_paths_in_base.push_back(name);
+		deleted_paths_in_base.emplace(name);
 		//Add it to deleted files as well, so it gets skipped in FindNext. 
 		//Maybe revise that.
 		if (create_on_disk) add_special_file_to_disk(name,"RMD");
@@ -1174,26 +1165,23 @@ void Overlay_Drive::add_deleted_path(const char* name, bool create_on_disk) {
 bool Overlay_Drive::is_deleted_path(const char* name) {
 	if (!name || !*name) return false;
 	if (deleted_paths_in_base.empty()) return false;
-	std::string sname(name);
-	std::string::size_type namelen = sname.length();;
-	for(std::vector<std::string>::iterator it = deleted_paths_in_base.begin(); it != deleted_paths_in_base.end(); ++it) {
-		std::string::size_type blockedlen = (*it).length();
-		if (namelen < blockedlen) continue;
-		//See if input starts with name. 
-		std::string::size_type n = sname.find(*it);
-		if (n == 0 && ((namelen == blockedlen) || *(name + blockedlen) == '\\' )) return true;
+	// A path is deleted if it, or any of its leading directories, is
+	// marked as deleted. Probe each leading component instead of scanning
+	// every deleted path.
+	const std::string_view sname(name);
+	for (auto pos = sname.find('\\'); pos != std::string_view::npos;
+	     pos = sname.find('\\', pos + 1)) {
+		if (deleted_paths_in_base.contains(std::string(sname.substr(0, pos)))) {
+			return true;
+		}
 	}
-	return false;
+	return deleted_paths_in_base.contains(name);
 }
 
 void Overlay_Drive::remove_deleted_path(const char* name, bool create_on_disk) {
-	for(std::vector<std::string>::iterator it = deleted_paths_in_base.begin(); it != deleted_paths_in_base.end(); ++it) {
-		if (*it == name) {
-			deleted_paths_in_base.erase(it);
-			remove_deleted_file(name,false); //Rethink maybe.
-			if (create_on_disk) remove_special_file_from_disk(name,"RMD");
-			break;
-		}
+	if (deleted_paths_in_base.erase(name) != 0) {
+		remove_deleted_file(name,false); //Rethink maybe.
+		if (create_on_disk) remove_special_file_from_disk(name,"RMD");
 	}
 }
 bool Overlay_Drive::check_if_leading_is_deleted(const char* name){
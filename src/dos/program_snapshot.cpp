@@ -0,0 +1,131 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "program_snapshot.h"
+
+#include "checks.h"
+#include "dos_inc.h"
+#include "drives.h"
+#include "program_more_output.h"
+#include "snapshot.h"
+
+CHECK_NARROWING();
+
+void SNAPSHOT::Run()
+{
+	if (HelpRequested()) {
+		MoreOutputStrings output(*this);
+		output.AddString(MSG_Get("PROGRAM_SNAPSHOT_HELP_LONG"));
+		output.Display();
+		return;
+	}
+
+	constexpr bool remove_if_found = true;
+	const bool is_uncompressed = cmd->FindExist("/u", remove_if_found);
+
+	std::string tmp_str;
+	if (cmd->FindStringBegin("/", tmp_str)) {
+		tmp_str = std::string("/") + tmp_str;
+		WriteOut(MSG_Get("SHELL_ILLEGAL_SWITCH"), tmp_str.c_str());
+		return;
+	}
+
+	const auto params = cmd->GetArguments();
+	if (params.size() != 1) {
+		WriteOut(MSG_Get("PROGRAM_SNAPSHOT_SPECIFY_FILE"));
+		return;
+	}
+
+	if (!SNAPSHOT_CanSave()) {
+		WriteOut(MSG_Get("PROGRAM_SNAPSHOT_NOT_FROM_FIRST_SHELL"));
+		return;
+	}
+	if (const auto reason = SNAPSHOT_GetSaveBlocker()) {
+		WriteOut(MSG_Get("PROGRAM_SNAPSHOT_BLOCKED"), reason->c_str());
+		return;
+	}
+
+	// Snapshots are written to the host directory behind the DOS path
+	uint8_t drive = 0;
+	char fullname[DOS_PATHLENGTH];
+	if (!DOS_MakeName(params[0].c_str(), fullname, &drive)) {
+		WriteOut(MSG_Get("SHELL_ILLEGAL_PATH"));
+		return;
+	}
+	const auto ldp = std::dynamic_pointer_cast<localDrive>(Drives.at(drive));
+	const auto is_overlay = std::dynamic_pointer_cast<Overlay_Drive>(ldp) != nullptr;
+	if (!ldp || is_overlay || ldp->GetType() != DosDriveType::Local ||
+	    ldp->IsReadOnly()) {
+		WriteOut(MSG_Get("PROGRAM_SNAPSHOT_NOT_WRITABLE"));
+		return;
+	}
+
+	// Creating the file through DOS keeps the drive's directory cache up
+	// to date
+	uint16_t handle = 0;
+	if (!DOS_CreateFile(params[0].c_str(), {}, &handle)) {
+		WriteOut(MSG_Get("PROGRAM_SNAPSHOT_NOT_WRITABLE"));
+		return;
+	}
+	DOS_CloseFile(handle);
+
+	const auto host_path = ldp->MapDosToHostFilename(fullname);
+	if (!SNAPSHOT_Save(host_path, !is_uncompressed)) {
+		WriteOut(MSG_Get("PROGRAM_SNAPSHOT_FAILED"));
+		return;
+	}
+	WriteOut(MSG_Get("PROGRAM_SNAPSHOT_SAVED"), params[0].c_str());
+}
+
+void SNAPSHOT::AddMessages()
+{
+	MSG_Add("PROGRAM_SNAPSHOT_HELP_LONG",
+	        "Save the state of the emulated machine to resume from it later.\n"
+	        "\n"
+	        "Usage:\n"
+	        "  [color=light-green]snapshot[reset] [/u] [color=light-cyan]FILE[reset]\n"
+	        "\n"
+	        "Parameters:\n"
+	        "  [color=light-cyan]FILE[reset]  file to save the snapshot to, on a mounted host directory\n"
+	        "  /u    don't compress the snapshot\n"
+	        "\n"
+	        "Notes:\n"
+	        "  - Start DOSBox Staging with [color=light-cyan]--snapshot[reset] FILE to resume from a snapshot\n"
+	        "    instead of booting. The rest of AUTOEXEC.BAT runs from the line after the\n"
+	        "    one that saved the snapshot.\n"
+	        "  - Snapshots only work with the same DOSBox Staging version and start-up\n"
+	        "    settings that saved them.\n"
+	        "  - Sound, CD-ROM, network, and input devices aren't part of the snapshot.\n"
+	        "    Saving waits until the sound devices have gone quiet, and isn't possible\n"
+	        "    once a program has set up the Sound Blaster, OPL, or Gravis UltraSound.\n"
+	        "\n"
+	        "Examples:\n"
+	        "  [color=light-green]snapshot[reset] [color=light-cyan]c:\\ready.snp[reset]\n");
+
+	MSG_Add("PROGRAM_SNAPSHOT_SPECIFY_FILE", "Must specify the file to save to.\n");
+	MSG_Add("PROGRAM_SNAPSHOT_NOT_FROM_FIRST_SHELL",
+	        "Snapshots can only be saved from the first command shell.\n");
+	MSG_Add("PROGRAM_SNAPSHOT_NOT_WRITABLE",
+	        "Snapshots can only be saved to a writable mounted host directory.\n");
+	MSG_Add("PROGRAM_SNAPSHOT_BLOCKED",
+	        "Can't save a snapshot while %s.\n");
+	MSG_Add("PROGRAM_SNAPSHOT_FAILED", "Failed to save the snapshot.\n");
+	MSG_Add("PROGRAM_SNAPSHOT_SAVED", "Saved the snapshot to %s.\n");
+}
@@ -22,6 +22,7 @@
 #include "dosbox.h"
 
 #include <chrono>
+#include <cmath>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
@@ -48,6 +49,7 @@
 #include "mixer.h"
 #include "mouse.h"
 #include "ne2000.h"
+#include "pacer.h"
 #include "pci_bus.h"
 #include "pic.h"
 #include "programs.h"
@@ -55,6 +57,7 @@
 #include "render.h"
 #include "setup.h"
 #include "shell.h"
+#include "string_utils.h"
 #include "support.h"
 #include "timer.h"
 #include "tracy.h"
@@ -134,6 +137,12 @@ static struct {
 	int64_t done      = {};
 	int64_t scheduled = {};
 	bool locked       = {};
+
+	// Set by the '--speed' command line argument. The host clock is scaled
+	// by the multiplier, unless the emulation runs unthrottled.
+	double speed_multiplier = 1.0;
+	int64_t speed_base_us   = {};
+	bool is_unthrottled     = {};
 } ticks = {};
 
 int64_t DOSBOX_GetTicksDone()
@@ -201,27 +210,49 @@ static Bitu Normal_Loop()
 
 constexpr auto auto_cpu_cycles_min = 200;
 
+constexpr auto MicrosInMillisecond = 1000;
+
+// Converts host time to the time the emulation is paced to, which runs faster
+// or slower than the host clock if requested with '--speed'
+static int64_t to_paced_ticks_us(const int64_t host_ticks_us)
+{
+	if (ticks.speed_multiplier == 1.0) {
+		return host_ticks_us;
+	}
+	const auto elapsed_us = host_ticks_us - ticks.speed_base_us;
+	return ticks.speed_base_us +
+	       llround(static_cast<double>(elapsed_us) * ticks.speed_multiplier);
+}
+
+static int64_t to_host_ticks_us(const int64_t paced_ticks_us)
+{
+	if (ticks.speed_multiplier == 1.0) {
+		return paced_ticks_us;
+	}
+	const auto elapsed_us = paced_ticks_us - ticks.speed_base_us;
+	return ticks.speed_base_us +
+	       llround(static_cast<double>(elapsed_us) / ticks.speed_multiplier);
+}
+
 static void increase_ticks()
 {
 	// Make it return ticks.remain and set it in the function above to
 	// remove the global variable.
 	ZoneScoped;
 
-	// For fast-forward mode
+	// For fast-forward and unthrottled modes
 	if (ticks.locked) {
 		ticks.remain = 5;
 
 		// Reset any auto cycle guessing for this frame
-		ticks.last      = GetTicks();
+		ticks.last = to_paced_ticks_us(GetTicksUs()) / MicrosInMillisecond;
 		ticks.added     = 0;
 		ticks.done      = 0;
 		ticks.scheduled = 0;
 		return;
 	}
 
-	constexpr auto MicrosInMillisecond = 1000;
-
-	const auto ticks_new_us = GetTicksUs();
+	const auto ticks_new_us = to_paced_ticks_us(GetTicksUs());
 	const auto ticks_new    = ticks_new_us / MicrosInMillisecond;
 
 	ticks.scheduled += ticks.added;
@@ -232,10 +263,15 @@ static void increase_ticks()
 
 		static int64_t cumulative_time_slept_us = 0;
 
-		constexpr auto sleep_duration = std::chrono::microseconds(1000);
-		std::this_thread::sleep_for(sleep_duration);
+		// Wait for the start of the next tick. Waiting for its absolute
+		// deadline keeps the ticks on a steady 1 ms grid, whereas
+		// sleeping for a fixed 1 ms added the host's oversleep to every
+		// tick.
+		const auto next_tick_us = (ticks.last + 1) * MicrosInMillisecond;
+		PACER_WaitUntilUs(to_host_ticks_us(next_tick_us));
 
-		const auto time_slept_us = GetTicksUsSince(ticks_new_us);
+		const auto time_slept_us = to_paced_ticks_us(GetTicksUs()) -
+		                           ticks_new_us;
 		cumulative_time_slept_us += time_slept_us;
 
 		// Update ticks.done with the total time spent sleeping
@@ -279,6 +315,7 @@ static void increase_ticks()
 	}
 
 	ticks.added = ticks.remain;
+	TracyPlot("Ticks added", static_cast<int64_t>(ticks.added));
 
 	// Is the system in auto cycle guessing mode? If not, do nothing.
 	if (!CPU_CycleAutoAdjust) {
@@ -445,10 +482,20 @@ void DOSBOX_SetNormalLoop() {
 	loop=Normal_Loop;
 }
 
+// How many machine runs are nested; the shell starts each program in one
+static int run_depth = 0;
+
 void DOSBOX_RunMachine()
 {
+	++run_depth;
 	while ((*loop)() == 0 && !shutdown_requested)
 		;
+	--run_depth;
+}
+
+int DOSBOX_GetRunDepth()
+{
+	return run_depth;
 }
 
 static void DOSBOX_UnlockSpeed( bool pressed ) {
@@ -467,8 +514,12 @@ static void DOSBOX_UnlockSpeed( bool pressed ) {
 		}
 	} else {
 		LOG_MSG("Fast Forward OFF");
-		ticks.locked = false;
-		MIXER_DisableFastForwardMode();
+
+		// Return to the speed requested on the command line
+		ticks.locked = ticks.is_unthrottled;
+		if (!ticks.is_unthrottled && ticks.speed_multiplier == 1.0) {
+			MIXER_DisableFastForwardMode();
+		}
 
 		if (autoadjust) {
 			autoadjust = false;
@@ -522,14 +573,55 @@ void DOSBOX_SetMachineTypeFromConfig(Section_prop* section)
 	       (machine != MCH_VGA && svgaCard == SVGA_None));
 }
 
+// Applies the '--speed' command line argument. Headless runs default to
+// running unthrottled, as fast as the host allows.
+static void setup_emulation_speed()
+{
+	const auto& arguments = control->arguments;
+
+	auto speed = arguments.speed;
+	lowcase(speed);
+	if (speed.empty()) {
+		speed = arguments.headless ? "max" : "1";
+	}
+
+	ticks.speed_multiplier = 1.0;
+	ticks.speed_base_us    = GetTicksUs();
+	ticks.is_unthrottled   = false;
+
+	if (speed == "max") {
+		ticks.is_unthrottled = true;
+		LOG_MSG("DOSBOX: Running unthrottled");
+
+	} else if (const auto multiplier = parse_float(speed);
+	           multiplier && *multiplier > 0.0f) {
+		ticks.speed_multiplier = *multiplier;
+		if (ticks.speed_multiplier != 1.0) {
+			LOG_MSG("DOSBOX: Running at %.2fx real-time speed",
+			        ticks.speed_multiplier);
+		}
+	} else {
+		LOG_WARNING("DOSBOX: Invalid speed '%s', using real-time speed",
+		            arguments.speed.c_str());
+	}
+
+	// The mixer has to consume audio at the emulated rate rather than at
+	// the host's when they differ
+	if (ticks.is_unthrottled || ticks.speed_multiplier != 1.0) {
+		MIXER_EnableFastForwardMode();
+	}
+}
+
 static void DOSBOX_RealInit(Section* sec)
 {
 	Section_prop* section = static_cast<Section_prop*>(sec);
 
 	// Initialize some dosbox internals
+	setup_emulation_speed();
+
 	ticks.remain = 0;
 	ticks.last   = GetTicks();
-	ticks.locked = false;
+	ticks.locked = ticks.is_unthrottled;
 
 	DOSBOX_SetLoop(&Normal_Loop);
 
@@ -853,6 +945,14 @@ void DOSBOX_Init()
 	        "(disabled by default). Only suggested if you have a fast desktop-class CPU, as\n"
 	        "it can impact frame rates on slower systems.");
 
+	pbool = secprop->Add_bool("voodoo_async", only_at_start, false);
+	pbool->Set_help(
+	        "Process the commands sent to the 3dfx Voodoo on a separate thread (disabled by\n"
+	        "default). Like the real card's PCI FIFO, this lets 3D rendering run in parallel\n"
+	        "with the CPU emulation, which only waits for the card when reading from it or\n"
+	        "swapping buffers. Improves frame rates in CPU-heavy 3D games on multi-core\n"
+	        "systems.");
+
 	// Configure capture
 	CAPTURE_AddConfigSection(control);
 
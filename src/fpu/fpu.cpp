@@ -24,6 +24,7 @@
 #include "cross.h"
 #include "fpu.h"
 #include "mem.h"
+#include "snapshot.h"
 #include <cmath>
 
 FPU_rec fpu = {};
@@ -624,11 +625,23 @@ void FPU_ESC7_Normal(Bitu rm) {
 }
 
 
+static void fpu_save_snapshot(SnapshotWriter& writer)
+{
+	writer.Write(fpu);
+}
+
+static void fpu_load_snapshot(SnapshotReader& reader)
+{
+	reader.Read(fpu);
+}
+
 void FPU_Init(Section*) {
 #if !C_FPU_X86
 	LOG_WARNING("FPU: Using reduced-precision floating-point emulation");
 #endif
 	FPU_FINIT();
+
+	SNAPSHOT_AddComponent("fpu", fpu_save_snapshot, fpu_load_snapshot);
 }
 
 #endif
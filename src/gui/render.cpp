@@ -21,11 +21,17 @@
 
 #include "dosbox.h"
 
+#include <array>
 #include <cassert>
 #include <cmath>
+#include <condition_variable>
 #include <cstdlib>
+#include <cstring>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 
 #include "../capture/capture.h"
 #include "control.h"
@@ -33,11 +39,15 @@
 #include "mapper.h"
 #include "math_utils.h"
 #include "render.h"
+#include "render_line_cache.h"
+#include "rwqueue.h"
 #include "setup.h"
 #include "shader_manager.h"
 #include "shell.h"
 #include "string_utils.h"
 #include "support.h"
+#include "timer.h"
+#include "tracy.h"
 #include "vga.h"
 #include "video.h"
 
@@ -69,14 +79,18 @@ uint8_t get_bits_per_pixel(const PixelFormat pf)
 
 static void render_callback(GFX_CallbackFunctions_t function);
 
-static void check_palette()
+using Palette = decltype(RenderPal_t::rgb);
+
+// Converts the palette entries that changed since the last frame for the
+// scalers
+static void check_palette(const Palette& rgb, const uint32_t first, const uint32_t last)
 {
 	// Clean up any previous changed palette data
 	if (render.pal.changed) {
 		memset(render.pal.modified, 0, sizeof(render.pal.modified));
 		render.pal.changed = false;
 	}
-	if (render.pal.first > render.pal.last) {
+	if (first > last) {
 		return;
 	}
 	Bitu i;
@@ -84,10 +98,10 @@ static void check_palette()
 	case scalerMode8: break;
 	case scalerMode15:
 	case scalerMode16:
-		for (i = render.pal.first; i <= render.pal.last; i++) {
-			uint8_t r = render.pal.rgb[i].red;
-			uint8_t g = render.pal.rgb[i].green;
-			uint8_t b = render.pal.rgb[i].blue;
+		for (i = first; i <= last; i++) {
+			uint8_t r = rgb[i].red;
+			uint8_t g = rgb[i].green;
+			uint8_t b = rgb[i].blue;
 
 			uint16_t new_pal = GFX_GetRGB(r, g, b);
 			if (new_pal != render.pal.lut.b16[i]) {
@@ -99,10 +113,10 @@ static void check_palette()
 		break;
 	case scalerMode32:
 	default:
-		for (i = render.pal.first; i <= render.pal.last; i++) {
-			uint8_t r = render.pal.rgb[i].red;
-			uint8_t g = render.pal.rgb[i].green;
-			uint8_t b = render.pal.rgb[i].blue;
+		for (i = first; i <= last; i++) {
+			uint8_t r = rgb[i].red;
+			uint8_t g = rgb[i].green;
+			uint8_t b = rgb[i].blue;
 
 			uint32_t new_pal = GFX_GetRGB(r, g, b);
 			if (new_pal != render.pal.lut.b32[i]) {
@@ -113,8 +127,11 @@ static void check_palette()
 		}
 		break;
 	}
+}
 
-	// Setup pal index to startup values
+// Setup pal index to startup values
+static void reset_palette_range()
+{
 	render.pal.first = 256;
 	render.pal.last  = 0;
 }
@@ -136,74 +153,122 @@ void RENDER_SetPalette(const uint8_t entry, const uint8_t red,
 
 static void empty_line_handler(const void*) {}
 
-static void start_line_handler(const void* s)
+// Optional render thread
+// ~~~~~~~~~~~~~~~~~~~~~~
+// When enabled, the emulation thread only copies the source lines of the frame
+// into a queue. The render thread performs the change detection and scales
+// the changed lines into one of two output buffers, while the emulation
+// carries on with the next frame.
+//
+// The main thread presents a finished frame at the start of the next one if
+// it's ready by then, or at the end of the next one at the latest, because
+// that's the thread the SDL renderer and OpenGL context are bound to. Frames
+// are also handed to the capturers at that point, as the capture module
+// isn't thread-safe; the render thread only copies the source image of the
+// frame for them. It only
+// waits for the render thread when the output buffer of a frame that's still
+// being scaled is about to be reused, or when the video mode changes.
+//
+
+// Two frames of lines plus their start and end markers
+constexpr size_t MaxQueuedWork = 2 * (SCALER_MAXHEIGHT + 2);
+
+struct OutputFrame {
+	std::vector<uint8_t> pixels = {};
+
+	// Runs of unchanged and changed output lines, as in Scaler_ChangedLines
+	std::vector<uint16_t> changed_lines = {};
+
+	// Copy of the source image and palette of the frame, if it's captured
+	std::vector<uint8_t> capture_pixels = {};
+	Palette capture_palette             = {};
+
+	bool has_output  = false;
+	bool has_capture = false;
+	bool is_aborted  = false;
+
+	// Set by the render thread once the frame is finished; guarded by the
+	// mutex
+	bool is_done = false;
+};
+
+struct RenderThread {
+	std::thread thread = {};
+
+	// Work waiting to be processed; null lines are queued as empty
+	// vectors. Processed line buffers are handed back for reuse.
+	RWQueue<RenderThreadWork> work{MaxQueuedWork};
+	RWQueue<std::vector<uint8_t>> spare_lines{MaxQueuedWork};
+
+	// The frames are scaled into alternating output buffers
+	std::array<OutputFrame, 2> frames = {};
+	int out_pitch  = 0;
+	int out_height = 0;
+
+	// Only touched by the main thread: the frame the emulation is drawing
+	// and the one waiting to be presented
+	std::optional<uint8_t> drawn_frame   = {};
+	std::optional<uint8_t> pending_frame = {};
+
+	// Only touched by the render thread while work is in flight: the
+	// handler processing the next queued line, the frame it belongs to,
+	// and the palette the frames were drawn with
+	ScalerLineHandler_t line_handler = empty_line_handler;
+	uint8_t scaled_frame             = 0;
+	Palette palette                  = {};
+
+	std::mutex mutex                  = {};
+	std::condition_variable caught_up = {};
+	size_t num_queued                 = 0;
+	size_t num_processed              = 0;
+
+	bool is_running = false;
+
+	~RenderThread();
+};
+
+static RenderThread render_thread = {};
+
+// Switches the handler that processes the remaining lines of the frame
+static void set_line_handler(const ScalerLineHandler_t handler)
 {
-	if (s) {
-		auto src = static_cast<const uintptr_t*>(s);
-		auto cache = reinterpret_cast<uintptr_t*>(render.scale.cacheRead);
-		for (Bits x = render.src_start; x > 0;) {
-			const auto src_ptr = reinterpret_cast<const uint8_t*>(src);
-			const auto src_val = read_unaligned_size_t(src_ptr);
-			if (src_val != cache[0]) {
-				if (!GFX_StartUpdate(render.scale.outWrite,
-				                     render.scale.outPitch)) {
-					RENDER_DrawLine = empty_line_handler;
-					return;
-				}
-				render.scale.outWrite += render.scale.outPitch *
-				                         Scaler_ChangedLines[0];
-				RENDER_DrawLine = render.scale.lineHandler;
-				RENDER_DrawLine(s);
-				return;
-			}
-			x--;
-			src++;
-			cache++;
-		}
+	if (render_thread.is_running) {
+		render_thread.line_handler = handler;
+	} else {
+		RENDER_DrawLine = handler;
 	}
-	render.scale.cacheRead += render.scale.cachePitch;
-	Scaler_ChangedLines[0] += Scaler_Aspect[render.scale.inLine];
-	render.scale.inLine++;
-	render.scale.outLine++;
 }
 
-static void finish_line_handler(const void* s)
+// Gets the buffer the changed lines of the frame are scaled into
+static bool start_output()
 {
-	if (s) {
-		auto src = static_cast<const uintptr_t*>(s);
-		auto cache = reinterpret_cast<uintptr_t*>(render.scale.cacheRead);
-		for (Bits x = render.src_start; x > 0;) {
-			cache[0] = src[0];
-			x--;
-			src++;
-			cache++;
-		}
+	if (render_thread.is_running) {
+		auto& frame = render_thread.frames[render_thread.scaled_frame];
+
+		render.scale.outWrite = frame.pixels.data();
+		render.scale.outPitch = render_thread.out_pitch;
+		return true;
 	}
-	render.scale.cacheRead += render.scale.cachePitch;
+	return GFX_StartUpdate(render.scale.outWrite, render.scale.outPitch);
 }
 
-static void clear_cache_handler(const void* src)
+static void resize_output_frames()
 {
-	const uint32_t* srcLine = (const uint32_t*)src;
-	uint32_t* cacheLine     = (uint32_t*)render.scale.cacheRead;
-	Bitu width              = render.scale.cachePitch / 4;
-	for (Bitu x = 0; x < width; x++) {
-		cacheLine[x] = ~srcLine[x];
+	const auto num_bytes = static_cast<size_t>(render_thread.out_pitch) *
+	                       static_cast<size_t>(render_thread.out_height);
+
+	for (auto& frame : render_thread.frames) {
+		frame.pixels.resize(num_bytes);
 	}
-	render.scale.lineHandler(src);
 }
 
-bool RENDER_StartUpdate()
+static void start_line_handler(const void* s);
+static void clear_cache_handler(const void* src);
+
+// Sets up the scaler state for a new frame and picks the handler for its
+// lines. Runs on the render thread if it's enabled.
+static bool begin_frame(const bool clear_cache)
 {
-	if (render.updating) {
-		return false;
-	}
-	if (!render.active) {
-		return false;
-	}
-	if (render.scale.inMode == scalerMode8) {
-		check_palette();
-	}
 	render.scale.inLine     = 0;
 	render.scale.outLine    = 0;
 	render.scale.cacheRead  = (uint8_t*)&scalerSourceCache;
@@ -214,43 +279,488 @@ bool RENDER_StartUpdate()
 
 	// Clearing the cache will first process the line to make sure it's
 	// never the same
-	if (render.scale.clearCache) {
+	if (clear_cache) {
 		// LOG_MSG("Clearing cache");
 
 		// Will always have to update the screen with this one anyway,
 		// so let's update already
-		if (!GFX_StartUpdate(render.scale.outWrite, render.scale.outPitch)) {
+		if (!start_output()) {
 			return false;
 		}
-		render.fullFrame        = true;
-		render.scale.clearCache = false;
-		RENDER_DrawLine         = clear_cache_handler;
+		set_line_handler(clear_cache_handler);
 	} else {
 		if (render.pal.changed) {
 			// Assume pal changes always do a full screen update
 			// anyway
-			if (!GFX_StartUpdate(render.scale.outWrite,
-			                     render.scale.outPitch)) {
+			if (!start_output()) {
 				return false;
 			}
-			RENDER_DrawLine  = render.scale.linePalHandler;
-			render.fullFrame = true;
+			set_line_handler(render.scale.linePalHandler);
 		} else {
-			RENDER_DrawLine = start_line_handler;
-			if (CAPTURE_IsCapturingImage() ||
-			    CAPTURE_IsCapturingVideo()) {
-				render.fullFrame = true;
+			set_line_handler(start_line_handler);
+		}
+	}
+	return true;
+}
+
+static void capture_frame(const uint8_t* source_image, const Palette& palette)
+{
+	bool double_width  = false;
+	bool double_height = false;
+	if (render.src.double_width != render.src.double_height) {
+		if (render.src.double_width) {
+			double_width = true;
+		}
+		if (render.src.double_height) {
+			double_height = true;
+		}
+	}
+
+	RenderedImage image = {};
+
+	image.params               = render.src;
+	image.params.double_width  = double_width;
+	image.params.double_height = double_height;
+	image.pitch                = render.scale.cachePitch;
+	image.image_data           = const_cast<uint8_t*>(source_image);
+	image.palette_data         = (uint8_t*)&palette;
+
+	const auto frames_per_second = static_cast<float>(render.fps);
+
+	CAPTURE_AddFrame(image, frames_per_second);
+}
+
+static bool is_capturing_frames()
+{
+	return CAPTURE_IsCapturingImage() || CAPTURE_IsCapturingVideo() ||
+	       CAPTURE_IsStreaming();
+}
+
+static void start_scaled_frame(const RenderThreadWork& work)
+{
+	render_thread.scaled_frame = work.frame;
+
+	if (render.scale.inMode == scalerMode8) {
+		if (!work.data.empty()) {
+			assert(work.data.size() == sizeof(Palette));
+			std::memcpy(&render_thread.palette, work.data.data(), sizeof(Palette));
+		}
+		check_palette(render_thread.palette, work.pal_first, work.pal_last);
+	}
+
+	[[maybe_unused]] const auto has_started = begin_frame(work.clear_cache);
+	assert(has_started);
+}
+
+static void end_scaled_frame(const RenderThreadWork& work)
+{
+	render_thread.line_handler = empty_line_handler;
+
+	auto& frame = render_thread.frames[work.frame];
+
+	// The main thread captures the frame when it presents it, by which
+	// time the source cache already holds the next frame
+	frame.has_capture = work.capture;
+	if (frame.has_capture) {
+		const auto num_bytes = std::min(
+		        sizeof(scalerSourceCache),
+		        static_cast<size_t>(render.src.height) *
+		                static_cast<size_t>(render.scale.cachePitch));
+		const auto source_image = reinterpret_cast<const uint8_t*>(
+		        &scalerSourceCache);
+
+		frame.capture_pixels.assign(source_image, source_image + num_bytes);
+		std::memcpy(&frame.capture_palette,
+		            &render_thread.palette,
+		            sizeof(Palette));
+	}
+
+	frame.has_output = (render.scale.outWrite != nullptr);
+	frame.is_aborted = work.abort;
+
+	if (frame.has_output) {
+		frame.changed_lines.assign(Scaler_ChangedLines,
+		                           Scaler_ChangedLines + Scaler_ChangedLineIndex + 1);
+
+		// Account for the lines the frame didn't get to as unchanged
+		int num_lines = 0;
+		for (const auto n : frame.changed_lines) {
+			num_lines += n;
+		}
+		if (num_lines < render_thread.out_height) {
+			const auto remaining = static_cast<uint16_t>(
+			        render_thread.out_height - num_lines);
+			if (frame.changed_lines.size() % 2 == 1) {
+				frame.changed_lines.back() += remaining;
 			} else {
-				render.fullFrame = false;
+				frame.changed_lines.push_back(remaining);
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(render_thread.mutex);
+	frame.is_done = true;
+}
+
+static void render_thread_loop()
+{
+#if C_TRACY
+	// The lines come in one at a time while the frame is drawn, which is
+	// too often for a zone each, so the time spent scaling them is plotted
+	// once per frame instead
+	constexpr auto ScaleFrameName = "Scale frame";
+	int64_t scale_time_us         = 0;
+#endif
+	while (auto work = render_thread.work.Dequeue()) {
+		switch (work->type) {
+		case RenderThreadWork::Type::Line: {
+#if C_TRACY
+			const auto start_us = GetTicksUs();
+#endif
+			render_thread.line_handler(work->data.empty()
+			                                   ? nullptr
+			                                   : work->data.data());
+#if C_TRACY
+			scale_time_us += GetTicksUsSince(start_us);
+#endif
+		} break;
+		case RenderThreadWork::Type::StartFrame:
+			FrameMarkStart(ScaleFrameName);
+			start_scaled_frame(*work);
+			break;
+		case RenderThreadWork::Type::EndFrame: {
+			ZoneScopedN("End scaled frame");
+			end_scaled_frame(*work);
+#if C_TRACY
+			TracyPlot("Scale time per frame (us)", scale_time_us);
+			scale_time_us = 0;
+#endif
+			FrameMarkEnd(ScaleFrameName);
+		} break;
+		}
+		render_thread.spare_lines.NonblockingEnqueue(std::move(work->data));
+		{
+			std::lock_guard<std::mutex> lock(render_thread.mutex);
+			++render_thread.num_processed;
+		}
+		render_thread.caught_up.notify_one();
+	}
+}
+
+static std::vector<uint8_t> get_spare_buffer()
+{
+	if (!render_thread.spare_lines.IsEmpty()) {
+		return std::move(*render_thread.spare_lines.Dequeue());
+	}
+	return {};
+}
+
+static void queue_work(RenderThreadWork&& work)
+{
+	++render_thread.num_queued;
+	render_thread.work.Enqueue(std::move(work));
+}
+
+// Copies the source line and queues it for the render thread
+static void queue_line_handler(const void* src)
+{
+	RenderThreadWork work = {};
+	work.data             = get_spare_buffer();
+
+	if (src) {
+		// The change detection compares whole words, which can extend
+		// past the pixels of the line
+		const auto num_bytes = std::max<size_t>(render.scale.cachePitch,
+		                                        render.src_start *
+		                                                sizeof(uintptr_t));
+		const auto bytes = static_cast<const uint8_t*>(src);
+		work.data.assign(bytes, bytes + num_bytes);
+	} else {
+		work.data.clear();
+	}
+
+	queue_work(std::move(work));
+}
+
+// Blocks until the render thread has processed all the queued work
+static void wait_for_render_thread()
+{
+	if (!render_thread.is_running) {
+		return;
+	}
+	ZoneScoped;
+	std::unique_lock<std::mutex> lock(render_thread.mutex);
+	render_thread.caught_up.wait(lock, [] {
+		return render_thread.num_processed == render_thread.num_queued;
+	});
+}
+
+// Copies the changed lines of the frame to the rendering backend and
+// presents it
+static void present_frame(const OutputFrame& frame)
+{
+	if (!frame.has_output || frame.is_aborted) {
+		GFX_EndUpdate(nullptr);
+		return;
+	}
+
+	uint8_t* pixels = nullptr;
+	int pitch       = 0;
+	if (!GFX_StartUpdate(pixels, pitch)) {
+		// The frame is lost, so redraw everything with the next one
+		render.scale.clearCache = true;
+		GFX_EndUpdate(nullptr);
+		return;
+	}
+
+	const auto row_bytes = static_cast<size_t>(
+	        std::min(pitch, render_thread.out_pitch));
+
+	int y = 0;
+	for (size_t i = 0; i < frame.changed_lines.size(); ++i) {
+		const auto num_rows = std::min<int>(frame.changed_lines[i],
+		                                    render_thread.out_height - y);
+		const auto is_changed = (i % 2 == 1);
+
+		for (auto row = y; is_changed && row < y + num_rows; ++row) {
+			std::memcpy(pixels + row * pitch,
+			            frame.pixels.data() + row * render_thread.out_pitch,
+			            row_bytes);
+		}
+		y += num_rows;
+	}
+
+	GFX_EndUpdate(frame.changed_lines.data());
+}
+
+// Presents the frame waiting for presentation, if any. Without 'wait', a
+// frame the render thread hasn't finished yet is left for later.
+static void present_pending_frame(const bool wait)
+{
+	if (!render_thread.pending_frame) {
+		return;
+	}
+	const auto& frame = render_thread.frames[*render_thread.pending_frame];
+	{
+		std::unique_lock<std::mutex> lock(render_thread.mutex);
+		if (!frame.is_done) {
+			if (!wait) {
+				return;
 			}
+			ZoneScopedN("Wait for frame");
+			render_thread.caught_up.wait(lock, [&frame] {
+				return frame.is_done;
+			});
 		}
 	}
-	render.updating = true;
+	render_thread.pending_frame.reset();
+
+	if (frame.has_capture) {
+		capture_frame(frame.capture_pixels.data(), frame.capture_palette);
+	}
+	present_frame(frame);
+}
+
+static void start_threaded_frame()
+{
+	// Present the previous frame already if the render thread is done
+	// with it
+	present_pending_frame(false);
+
+	RenderThreadWork work = {};
+	work.type             = RenderThreadWork::Type::StartFrame;
+
+	// Use the output buffer the pending frame isn't using
+	work.frame = render_thread.pending_frame
+	                   ? static_cast<uint8_t>(*render_thread.pending_frame ^ 1)
+	                   : uint8_t(0);
+	{
+		std::lock_guard<std::mutex> lock(render_thread.mutex);
+		render_thread.frames[work.frame].is_done = false;
+	}
+
+	work.clear_cache        = render.scale.clearCache;
+	render.scale.clearCache = false;
+
+	const auto has_palette_changes = (render.scale.inMode == scalerMode8 &&
+	                                  render.pal.first <= render.pal.last);
+	if (has_palette_changes) {
+		const auto palette = reinterpret_cast<const uint8_t*>(&render.pal.rgb);
+
+		work.data = get_spare_buffer();
+		work.data.assign(palette, palette + sizeof(Palette));
+		work.pal_first = check_cast<uint16_t>(render.pal.first);
+		work.pal_last  = check_cast<uint16_t>(render.pal.last);
+		reset_palette_range();
+	}
+
+	render.fullFrame = work.clear_cache || has_palette_changes ||
+	                   is_capturing_frames();
+
+	render_thread.drawn_frame = work.frame;
+	queue_work(std::move(work));
+
+	RENDER_DrawLine = queue_line_handler;
+}
+
+static void end_threaded_frame(const bool abort)
+{
+	RenderThreadWork work = {};
+	work.type             = RenderThreadWork::Type::EndFrame;
+	work.frame            = *render_thread.drawn_frame;
+	work.abort            = abort;
+	work.capture          = is_capturing_frames();
+	queue_work(std::move(work));
+
+	// Only one frame can wait for presentation, so the previous one has to
+	// be presented before this one can take its place
+	present_pending_frame(true);
+
+	render_thread.pending_frame = render_thread.drawn_frame;
+	render_thread.drawn_frame.reset();
+}
+
+// Drops the rest of the frame the emulation is drawing and makes sure the
+// next one is redrawn in full
+static void abandon_drawn_frame()
+{
+	RENDER_DrawLine         = empty_line_handler;
+	render.scale.outWrite   = nullptr;
+	render.scale.clearCache = true;
+
+	render_thread.drawn_frame.reset();
+}
+
+static void start_render_thread()
+{
+	if (render_thread.is_running) {
+		return;
+	}
+	render_thread.work.Clear();
+	render_thread.work.Start();
+
+	render_thread.num_queued    = 0;
+	render_thread.num_processed = 0;
+
+	std::memcpy(&render_thread.palette, &render.pal.rgb, sizeof(Palette));
+	resize_output_frames();
+
+	// Threading starts with the next frame
+	if (render.updating) {
+		RENDER_DrawLine         = empty_line_handler;
+		render.scale.clearCache = true;
+	}
+
+	render_thread.is_running = true;
+	render_thread.thread     = std::thread(render_thread_loop);
+	set_thread_name(render_thread.thread, "dosbox:render");
+}
+
+static void stop_render_thread()
+{
+	if (!render_thread.is_running) {
+		return;
+	}
+	wait_for_render_thread();
+
+	render_thread.work.Stop();
+	render_thread.thread.join();
+	render_thread.is_running   = false;
+	render_thread.line_handler = empty_line_handler;
+
+	present_pending_frame(false);
+
+	if (render_thread.drawn_frame) {
+		abandon_drawn_frame();
+	}
+}
+
+RenderThread::~RenderThread()
+{
+	if (is_running) {
+		work.Stop();
+		thread.join();
+	}
+}
+
+static void start_line_handler(const void* s)
+{
+	if (s && RENDER_LineDiffers(static_cast<const uint8_t*>(s),
+	                            render.scale.cacheRead,
+	                            render.src_start * sizeof(uintptr_t))) {
+		if (!start_output()) {
+			set_line_handler(empty_line_handler);
+			return;
+		}
+		render.scale.outWrite += render.scale.outPitch * Scaler_ChangedLines[0];
+		set_line_handler(render.scale.lineHandler);
+		render.scale.lineHandler(s);
+		return;
+	}
+	render.scale.cacheRead += render.scale.cachePitch;
+	Scaler_ChangedLines[0] += Scaler_Aspect[render.scale.inLine];
+	render.scale.inLine++;
+	render.scale.outLine++;
+}
+
+static void finish_line_handler(const void* s)
+{
+	if (s) {
+		std::memcpy(render.scale.cacheRead, s, render.src_start * sizeof(uintptr_t));
+	}
+	render.scale.cacheRead += render.scale.cachePitch;
+}
+
+static void clear_cache_handler(const void* src)
+{
+	const uint32_t* srcLine = (const uint32_t*)src;
+	uint32_t* cacheLine     = (uint32_t*)render.scale.cacheRead;
+	Bitu width              = render.scale.cachePitch / 4;
+	for (Bitu x = 0; x < width; x++) {
+		cacheLine[x] = ~srcLine[x];
+	}
+	render.scale.lineHandler(src);
+}
+
+bool RENDER_StartUpdate()
+{
+	if (render.updating) {
+		return false;
+	}
+	if (!render.active) {
+		return false;
+	}
+
+	if (render_thread.is_running) {
+		start_threaded_frame();
+		render.updating = true;
+		return true;
+	}
+
+	if (render.scale.inMode == scalerMode8) {
+		check_palette(render.pal.rgb, render.pal.first, render.pal.last);
+		reset_palette_range();
+	}
+	if (!begin_frame(render.scale.clearCache)) {
+		return false;
+	}
+	render.fullFrame = render.scale.clearCache || render.pal.changed ||
+	                   is_capturing_frames();
+
+	render.scale.clearCache = false;
+	render.updating         = true;
 	return true;
 }
 
 static void halt_render()
 {
+	wait_for_render_thread();
+
+	if (render_thread.drawn_frame) {
+		abandon_drawn_frame();
+	}
+	present_pending_frame(false);
+
 	RENDER_DrawLine = empty_line_handler;
 	GFX_EndUpdate(nullptr);
 	render.updating = false;
@@ -265,32 +775,19 @@ void RENDER_EndUpdate(bool abort)
 		return;
 	}
 
-	RENDER_DrawLine = empty_line_handler;
-
-	if (CAPTURE_IsCapturingImage() || CAPTURE_IsCapturingVideo()) {
-		bool double_width  = false;
-		bool double_height = false;
-		if (render.src.double_width != render.src.double_height) {
-			if (render.src.double_width) {
-				double_width = true;
-			}
-			if (render.src.double_height) {
-				double_height = true;
-			}
-		}
-
-		RenderedImage image = {};
+	ZoneScoped;
 
-		image.params               = render.src;
-		image.params.double_width  = double_width;
-		image.params.double_height = double_height;
-		image.pitch                = render.scale.cachePitch;
-		image.image_data           = (uint8_t*)&scalerSourceCache;
-		image.palette_data         = (uint8_t*)&render.pal.rgb;
+	RENDER_DrawLine = empty_line_handler;
 
-		const auto frames_per_second = static_cast<float>(render.fps);
+	if (render_thread.drawn_frame) {
+		end_threaded_frame(abort);
+		render.updating = false;
+		return;
+	}
 
-		CAPTURE_AddFrame(image, frames_per_second);
+	if (is_capturing_frames()) {
+		capture_frame(reinterpret_cast<const uint8_t*>(&scalerSourceCache),
+		              render.pal.rgb);
 	}
 
 	if (render.scale.outWrite) {
@@ -487,6 +984,22 @@ static void render_reset()
 		       static_cast<uint8_t>(render.src.pixel_format));
 	}
 
+	// Output buffers for the render thread
+	const auto out_pixel_bytes = [] {
+		switch (render.scale.outMode) {
+		case scalerMode8: return 1;
+		case scalerMode15:
+		case scalerMode16: return 2;
+		case scalerMode32: return 4;
+		}
+		return 4;
+	}();
+	render_thread.out_pitch  = render_width_px * out_pixel_bytes;
+	render_thread.out_height = check_cast<int>(render_height_px);
+	if (render_thread.is_running) {
+		resize_output_frames();
+	}
+
 	render.scale.blocks    = render.src.width / SCALER_BLOCKSIZE;
 	render.scale.lastBlock = render.src.width % SCALER_BLOCKSIZE;
 	render.scale.inHeight  = render.src.height;
@@ -498,7 +1011,7 @@ static void render_reset()
 	memset(render.pal.modified, 0, sizeof(render.pal.modified));
 
 	// Finish this frame using a copy only handler
-	RENDER_DrawLine       = finish_line_handler;
+	set_line_handler(finish_line_handler);
 	render.scale.outWrite = nullptr;
 
 	// Signal the next frame to first reinit the cache
@@ -515,6 +1028,10 @@ static void render_callback(GFX_CallbackFunctions_t function)
 		render.scale.clearCache = true;
 		return;
 	} else if (function == GFX_CallbackReset) {
+		// The reset changes the state the render thread works with
+		wait_for_render_thread();
+		present_pending_frame(false);
+
 		GFX_EndUpdate(nullptr);
 		render_reset();
 	} else {
@@ -1178,6 +1695,14 @@ static void init_render_settings(Section_prop& secprop)
 	        "  #000000 #0000aa #00aa00 #00aaaa #aa0000 #aa00aa #aa5500 #aaaaaa\n"
 	        "  #555555 #5555ff #55ff55 #55ffff #ff5555 #ff55ff #ffff55 #ffffff");
 
+	auto* bool_prop = secprop.Add_bool("render_thread", always, false);
+	bool_prop->Set_help(
+	        "Detect the changes in, scale and capture the emulated video output in a\n"
+	        "separate thread (disabled by default). The emulation carries on with the next\n"
+	        "frame while the previous one is processed, at the cost of copying the video\n"
+	        "lines and up to one frame of extra latency. This can help on multi-core systems\n"
+	        "when running demanding games or high-resolution video modes.");
+
 	string_prop = secprop.Add_string("scaler", deprecated, "none");
 	string_prop->Set_help(
 	        "Software scalers are deprecated in favour of hardware-accelerated options:\n"
@@ -1381,6 +1906,12 @@ void RENDER_Init(Section* sec)
 
 	setup_scan_and_pixel_doubling();
 
+	if (section->Get_bool("render_thread")) {
+		start_render_thread();
+	} else {
+		stop_render_thread();
+	}
+
 	const auto needs_reinit =
 	        ((aspect_ratio_correction_mode != prev_aspect_ratio_correction_mode) ||
 	         (viewport_settings != prev_viewport_settings) ||
@@ -0,0 +1,273 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "render_line_cache.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "host_cpu.h"
+
+using LineDiffer = bool (*)(const uint8_t* src, const uint8_t* cache,
+                            size_t num_bytes);
+
+using LineCacheUpdater = bool (*)(const uint8_t* src, uint8_t* cache,
+                                  size_t num_bytes,
+                                  LineCacheDirtyBitmap dirty_blocks);
+
+static void mark_dirty(LineCacheDirtyBitmap dirty_blocks, const size_t block)
+{
+	dirty_blocks[block / 64] |= uint64_t{1} << (block % 64);
+}
+
+// Handles the partial block at the end of a line
+static bool update_tail(const uint8_t* src, uint8_t* cache,
+                        const size_t num_bytes, const size_t offset,
+                        LineCacheDirtyBitmap dirty_blocks)
+{
+	const auto tail_bytes = num_bytes - offset;
+	if (tail_bytes == 0 || std::memcmp(src + offset, cache + offset, tail_bytes) == 0) {
+		return false;
+	}
+	std::memcpy(cache + offset, src + offset, tail_bytes);
+	mark_dirty(dirty_blocks, offset / LineCacheBlockSize);
+	return true;
+}
+
+// Scalar implementations
+// ~~~~~~~~~~~~~~~~~~~~~~
+static bool line_differs_scalar(const uint8_t* src, const uint8_t* cache,
+                                const size_t num_bytes)
+{
+	return std::memcmp(src, cache, num_bytes) != 0;
+}
+
+static bool update_line_cache_scalar(const uint8_t* src, uint8_t* cache,
+                                     const size_t num_bytes,
+                                     LineCacheDirtyBitmap dirty_blocks)
+{
+	auto changed = false;
+
+	size_t offset = 0;
+	for (; offset + LineCacheBlockSize <= num_bytes; offset += LineCacheBlockSize) {
+		if (std::memcmp(src + offset, cache + offset, LineCacheBlockSize) != 0) {
+			std::memcpy(cache + offset, src + offset, LineCacheBlockSize);
+			mark_dirty(dirty_blocks, offset / LineCacheBlockSize);
+			changed = true;
+		}
+	}
+	return update_tail(src, cache, num_bytes, offset, dirty_blocks) || changed;
+}
+
+// x86 implementations
+// ~~~~~~~~~~~~~~~~~~~
+// These are compiled for their instruction set extensions on their own and
+// only called if the CPU supports them
+#if HOST_CPU_X86
+
+HOST_CPU_TARGET("avx2") static bool line_differs_avx2(
+        const uint8_t* src, const uint8_t* cache, const size_t num_bytes)
+{
+	size_t offset = 0;
+	for (; offset + LineCacheBlockSize <= num_bytes; offset += LineCacheBlockSize) {
+		const auto a = _mm256_loadu_si256(
+		        reinterpret_cast<const __m256i*>(src + offset));
+		const auto b = _mm256_loadu_si256(
+		        reinterpret_cast<const __m256i*>(cache + offset));
+		const auto diff = _mm256_xor_si256(a, b);
+		if (!_mm256_testz_si256(diff, diff)) {
+			return true;
+		}
+	}
+	return line_differs_scalar(src + offset, cache + offset, num_bytes - offset);
+}
+
+HOST_CPU_TARGET("avx2") static bool update_line_cache_avx2(
+        const uint8_t* src, uint8_t* cache, const size_t num_bytes,
+        LineCacheDirtyBitmap dirty_blocks)
+{
+	auto changed = false;
+
+	size_t offset = 0;
+	for (; offset + LineCacheBlockSize <= num_bytes; offset += LineCacheBlockSize) {
+		const auto a = _mm256_loadu_si256(
+		        reinterpret_cast<const __m256i*>(src + offset));
+		const auto cache_ptr = reinterpret_cast<__m256i*>(cache + offset);
+		const auto b         = _mm256_loadu_si256(cache_ptr);
+
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) != -1) {
+			_mm256_storeu_si256(cache_ptr, a);
+			mark_dirty(dirty_blocks, offset / LineCacheBlockSize);
+			changed = true;
+		}
+	}
+	return update_tail(src, cache, num_bytes, offset, dirty_blocks) || changed;
+}
+
+// SSE2 is the x86-64 baseline, but not of 32-bit builds
+HOST_CPU_TARGET("sse2") static bool line_differs_sse2(
+        const uint8_t* src, const uint8_t* cache, const size_t num_bytes)
+{
+	size_t offset = 0;
+	for (; offset + LineCacheBlockSize <= num_bytes; offset += LineCacheBlockSize) {
+		const auto src_ptr   = reinterpret_cast<const __m128i*>(src + offset);
+		const auto cache_ptr = reinterpret_cast<const __m128i*>(cache + offset);
+
+		const auto eq = _mm_and_si128(
+		        _mm_cmpeq_epi8(_mm_loadu_si128(src_ptr),
+		                       _mm_loadu_si128(cache_ptr)),
+		        _mm_cmpeq_epi8(_mm_loadu_si128(src_ptr + 1),
+		                       _mm_loadu_si128(cache_ptr + 1)));
+		if (_mm_movemask_epi8(eq) != 0xffff) {
+			return true;
+		}
+	}
+	return line_differs_scalar(src + offset, cache + offset, num_bytes - offset);
+}
+
+HOST_CPU_TARGET("sse2") static bool update_line_cache_sse2(
+        const uint8_t* src, uint8_t* cache, const size_t num_bytes,
+        LineCacheDirtyBitmap dirty_blocks)
+{
+	auto changed = false;
+
+	size_t offset = 0;
+	for (; offset + LineCacheBlockSize <= num_bytes; offset += LineCacheBlockSize) {
+		const auto src_ptr   = reinterpret_cast<const __m128i*>(src + offset);
+		const auto cache_ptr = reinterpret_cast<__m128i*>(cache + offset);
+
+		const auto lo = _mm_loadu_si128(src_ptr);
+		const auto hi = _mm_loadu_si128(src_ptr + 1);
+
+		const auto eq = _mm_and_si128(
+		        _mm_cmpeq_epi8(lo, _mm_loadu_si128(cache_ptr)),
+		        _mm_cmpeq_epi8(hi, _mm_loadu_si128(cache_ptr + 1)));
+
+		if (_mm_movemask_epi8(eq) != 0xffff) {
+			_mm_storeu_si128(cache_ptr, lo);
+			_mm_storeu_si128(cache_ptr + 1, hi);
+			mark_dirty(dirty_blocks, offset / LineCacheBlockSize);
+			changed = true;
+		}
+	}
+	return update_tail(src, cache, num_bytes, offset, dirty_blocks) || changed;
+}
+
+#endif // HOST_CPU_X86
+
+// ARM implementations
+// ~~~~~~~~~~~~~~~~~~~
+#if HOST_CPU_NEON
+
+static bool line_differs_neon(const uint8_t* src, const uint8_t* cache,
+                              const size_t num_bytes)
+{
+	size_t offset = 0;
+	for (; offset + LineCacheBlockSize <= num_bytes; offset += LineCacheBlockSize) {
+		const auto diff = vorrq_u8(veorq_u8(vld1q_u8(src + offset),
+		                                    vld1q_u8(cache + offset)),
+		                           veorq_u8(vld1q_u8(src + offset + 16),
+		                                    vld1q_u8(cache + offset + 16)));
+		if (vmaxvq_u8(diff) != 0) {
+			return true;
+		}
+	}
+	return line_differs_scalar(src + offset, cache + offset, num_bytes - offset);
+}
+
+static bool update_line_cache_neon(const uint8_t* src, uint8_t* cache,
+                                   const size_t num_bytes,
+                                   LineCacheDirtyBitmap dirty_blocks)
+{
+	auto changed = false;
+
+	size_t offset = 0;
+	for (; offset + LineCacheBlockSize <= num_bytes; offset += LineCacheBlockSize) {
+		const auto lo = vld1q_u8(src + offset);
+		const auto hi = vld1q_u8(src + offset + 16);
+
+		const auto diff = vorrq_u8(veorq_u8(lo, vld1q_u8(cache + offset)),
+		                           veorq_u8(hi, vld1q_u8(cache + offset + 16)));
+		if (vmaxvq_u8(diff) != 0) {
+			vst1q_u8(cache + offset, lo);
+			vst1q_u8(cache + offset + 16, hi);
+			mark_dirty(dirty_blocks, offset / LineCacheBlockSize);
+			changed = true;
+		}
+	}
+	return update_tail(src, cache, num_bytes, offset, dirty_blocks) || changed;
+}
+
+#endif // HOST_CPU_NEON
+
+// Runtime selection
+// ~~~~~~~~~~~~~~~~~
+static LineDiffer select_line_differ()
+{
+#if HOST_CPU_X86
+	const auto& cpu = get_host_cpu_features();
+	if (cpu.avx2) {
+		return line_differs_avx2;
+	}
+	if (cpu.sse2) {
+		return line_differs_sse2;
+	}
+#endif
+#if HOST_CPU_NEON
+	return line_differs_neon;
+#endif
+	return line_differs_scalar;
+}
+
+static LineCacheUpdater select_line_cache_updater()
+{
+#if HOST_CPU_X86
+	const auto& cpu = get_host_cpu_features();
+	if (cpu.avx2) {
+		return update_line_cache_avx2;
+	}
+	if (cpu.sse2) {
+		return update_line_cache_sse2;
+	}
+#endif
+#if HOST_CPU_NEON
+	return update_line_cache_neon;
+#endif
+	return update_line_cache_scalar;
+}
+
+bool RENDER_LineDiffers(const uint8_t* src, const uint8_t* cache,
+                        const size_t num_bytes)
+{
+	static const auto differs = select_line_differ();
+	return differs(src, cache, num_bytes);
+}
+
+bool RENDER_UpdateLineCache(const uint8_t* src, uint8_t* cache,
+                            const size_t num_bytes,
+                            LineCacheDirtyBitmap dirty_blocks)
+{
+	assert(num_bytes <= LineCacheMaxBlocks * LineCacheBlockSize);
+
+	static const auto update = select_line_cache_updater();
+
+	std::memset(dirty_blocks, 0, sizeof(LineCacheDirtyBitmap));
+	return update(src, cache, num_bytes, dirty_blocks);
+}
@@ -0,0 +1,105 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_RENDER_LINE_CACHE_H
+#define DOSBOX_RENDER_LINE_CACHE_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "render_scalers.h"
+
+// Change detection of the scaler source cache. Lines are compared in blocks
+// of 32 bytes; the fastest implementation the host CPU supports is selected
+// at runtime.
+
+constexpr size_t LineCacheBlockSize = 32;
+
+constexpr size_t LineCacheMaxBlocks = (SCALER_MAXWIDTH * sizeof(uint32_t) +
+                                       LineCacheBlockSize - 1) /
+                                      LineCacheBlockSize;
+
+constexpr size_t LineCacheDirtyWords = (LineCacheMaxBlocks + 63) / 64;
+
+// One bit per block of a line, set if the block has changed
+using LineCacheDirtyBitmap = uint64_t[LineCacheDirtyWords];
+
+// Returns true if the first `num_bytes` of the source line differ from the
+// cached line.
+bool RENDER_LineDiffers(const uint8_t* src, const uint8_t* cache, size_t num_bytes);
+
+// Compares the first `num_bytes` of the source line against the cached line,
+// copies the changed blocks into the cache, and marks them in the bitmap.
+// Returns true if any block has changed.
+bool RENDER_UpdateLineCache(const uint8_t* src, uint8_t* cache,
+                            size_t num_bytes, LineCacheDirtyBitmap dirty_blocks);
+
+// Finds the next run of consecutive changed blocks, starting the search at
+// `first_block`. On success, the run spans [first_block, end_block).
+inline bool find_dirty_run(const LineCacheDirtyBitmap dirty_blocks,
+                           const size_t num_blocks, size_t& first_block,
+                           size_t& end_block)
+{
+	auto is_dirty = [&](const size_t block) {
+		return (dirty_blocks[block / 64] >> (block % 64)) & 1;
+	};
+
+	auto block = first_block;
+	while (block < num_blocks) {
+		// Skip whole clean words at a time
+		const auto remaining = dirty_blocks[block / 64] >> (block % 64);
+		if (remaining == 0) {
+			block = (block / 64 + 1) * 64;
+			continue;
+		}
+		block += static_cast<size_t>(std::countr_zero(remaining));
+		break;
+	}
+	if (block >= num_blocks) {
+		return false;
+	}
+	first_block = block;
+
+	end_block = block + 1;
+	while (end_block < num_blocks && is_dirty(end_block)) {
+		++end_block;
+	}
+	return true;
+}
+
+// Returns the pixels [first_px, end_px) covered by a run of changed blocks.
+// Pixels straddling a block boundary belong to both blocks.
+inline std::pair<size_t, size_t> dirty_run_to_pixels(const size_t first_block,
+                                                     const size_t end_block,
+                                                     const size_t bytes_per_pixel,
+                                                     const size_t width)
+{
+	const auto first_px = first_block * LineCacheBlockSize / bytes_per_pixel;
+	const auto end_px   = std::min(width,
+                                     (end_block * LineCacheBlockSize +
+                                      bytes_per_pixel - 1) /
+                                             bytes_per_pixel);
+	return {first_px, end_px};
+}
+
+#endif
@@ -24,6 +24,8 @@
 
 #include "dosbox.h"
 #include "render.h"
+
+#include <algorithm>
 #include <cstring>
 
 uint8_t Scaler_Aspect[SCALER_MAXHEIGHT]        = {};
@@ -17,6 +17,7 @@
  */
 
 #include "mem_unaligned.h"
+#include "render_line_cache.h"
 
 #if SCALER_MAX_MUL_HEIGHT < SCALERHEIGHT
 #error "Scaler goes too high"
@@ -58,22 +59,6 @@ static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 			src += 4;
 			cache+=4;
 			line0+=4*SCALERWIDTH;
-#else
-	constexpr uint8_t address_step = sizeof(Bitu) / sizeof(SRCTYPE);
-
-	for (Bits x = render.src.width; x > 0;) {
-		const auto src_ptr = reinterpret_cast<const uint8_t *>(src);
-		const auto src_val = read_unaligned_size_t(src_ptr);
-
-		const auto cache_ptr = reinterpret_cast<uint8_t *>(cache);
-		const auto cache_val = read_unaligned_size_t(cache_ptr);
-
-		if (src_val == cache_val) {
-			x -= address_step;
-			src += address_step;
-			cache += address_step;
-			line0 += address_step * SCALERWIDTH;
-#endif
 		} else {
 #if defined(SCALERLINEAR)
 #if (SCALERHEIGHT > 1) 
@@ -104,6 +89,57 @@ static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 #endif //defined(SCALERLINEAR)
 		}
 	}
+#else
+	// Compare and update the whole line in one pass, then only scale the
+	// runs of pixels covered by the changed blocks
+	const auto line_bytes = static_cast<size_t>(render.src.width) * sizeof(SRCTYPE);
+
+	LineCacheDirtyBitmap dirty_blocks;
+	hadChange = RENDER_UpdateLineCache(reinterpret_cast<const uint8_t*>(src),
+	                                   reinterpret_cast<uint8_t*>(cache),
+	                                   line_bytes,
+	                                   dirty_blocks);
+
+	const auto num_blocks = (line_bytes + LineCacheBlockSize - 1) / LineCacheBlockSize;
+
+	size_t first_block = 0;
+	size_t end_block   = 0;
+	while (hadChange && find_dirty_run(dirty_blocks, num_blocks, first_block, end_block)) {
+		const auto [first_px, end_px] = dirty_run_to_pixels(
+		        first_block,
+		        end_block,
+		        sizeof(SRCTYPE),
+		        static_cast<size_t>(render.src.width));
+		first_block = end_block;
+
+		const SRCTYPE* run_src = src + first_px;
+		line0 = reinterpret_cast<PTYPE*>(render.scale.outWrite) + first_px * SCALERWIDTH;
+#if defined(SCALERLINEAR)
+#if (SCALERHEIGHT > 1)
+		PTYPE *line1 = WC[0];
+#endif
+#else
+#if (SCALERHEIGHT > 1)
+		PTYPE *line1 = (PTYPE *)(((uint8_t*)line0)+ render.scale.outPitch);
+#endif
+#endif //defined(SCALERLINEAR)
+		for (auto px = first_px; px < end_px; ++px) {
+			const SRCTYPE S = *run_src++;
+			const PTYPE P = PMAKE(S);
+			SCALERFUNC;
+			line0 += SCALERWIDTH;
+#if (SCALERHEIGHT > 1)
+			line1 += SCALERWIDTH;
+#endif
+		}
+#if defined(SCALERLINEAR)
+#if (SCALERHEIGHT > 1)
+		const auto copyLen = static_cast<size_t>((uint8_t*)line1 - (uint8_t*)WC[0]);
+		std::memcpy(((uint8_t*)line0) - copyLen + render.scale.outPitch, WC[0], copyLen);
+#endif
+#endif //defined(SCALERLINEAR)
+	}
+#endif
 #if defined(SCALERLINEAR) 
 	Bitu scaleLines = SCALERHEIGHT;
 #else
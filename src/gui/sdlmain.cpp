@@ -55,8 +55,10 @@
 #include "cpu.h"
 #include "cross.h"
 #include "debug.h"
+#include "dos_inc.h"
 #include "fs_utils.h"
 #include "gui_msgs.h"
+#include "ipxserver.h"
 #include "joystick.h"
 #include "keyboard.h"
 #include "mapper.h"
@@ -2474,8 +2476,17 @@ bool GFX_StartUpdate(uint8_t * &pixels, int &pitch)
 
 void GFX_EndUpdate(const uint16_t* changedLines)
 {
+	ZoneScoped;
+
 	static int64_t cumulative_time_rendered_us = 0;
 
+	// Headless mode has nothing to present to, except for the rendered
+	// image captures that are read back from the presented frame
+	if (control->arguments.headless && !CAPTURE_IsCapturingPostRenderImage()) {
+		sdl.updating = false;
+		return;
+	}
+
 	const auto start_us = GetTicksUs();
 
 	sdl.frame.update(changedLines);
@@ -2519,6 +2530,7 @@ void GFX_EndUpdate(const uint16_t* changedLines)
 
 	const auto elapsed_us = GetTicksUsSince(start_us);
 	cumulative_time_rendered_us += elapsed_us;
+	PACER_AddRenderTime(elapsed_us);
 
 	// Update "ticks done" with the rendering time
 	constexpr auto MicrosInMillisecond = 1000;
@@ -2543,6 +2555,7 @@ void GFX_EndUpdate(const uint16_t* changedLines)
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 static void update_frame_texture([[maybe_unused]] const uint16_t *changedLines)
 {
+	ZoneScoped;
 	SDL_UpdateTexture(sdl.texture.texture,
 	                  nullptr, // update entire texture
 	                  sdl.texture.input_surface->pixels,
@@ -2671,6 +2684,7 @@ static std::optional<RenderedImage> get_rendered_output_from_backbuffer()
 
 static bool present_frame_texture()
 {
+	ZoneScoped;
 	const auto is_presenting = render_pacer->CanRun();
 	if (is_presenting) {
 		SDL_RenderClear(sdl.renderer);
@@ -2698,6 +2712,7 @@ static bool present_frame_texture()
 #if C_OPENGL
 static void update_frame_gl(const uint16_t* changedLines)
 {
+	ZoneScoped;
 	if (changedLines) {
 		const auto framebuf = static_cast<uint8_t *>(sdl.opengl.framebuf);
 		const auto pitch = sdl.opengl.pitch;
@@ -2723,6 +2738,7 @@ static void update_frame_gl(const uint16_t* changedLines)
 
 static bool present_frame_gl()
 {
+	ZoneScoped;
 	const auto is_presenting = render_pacer->CanRun();
 	if (is_presenting) {
 		glClear(GL_COLOR_BUFFER_BIT);
@@ -3273,13 +3289,21 @@ static void set_output(Section* sec, const bool wants_aspect_ratio_correction)
 		sdl.want_rendering_backend = RenderingBackend::Texture;
 	}
 
+	// The null video driver of headless mode only supports software
+	// rendering, which is selected below
+	if (control->arguments.headless) {
+		sdl.want_rendering_backend = RenderingBackend::Texture;
+	}
+
 	const std::string screensaver = section->Get_string("screensaver");
 	if (screensaver == "allow")
 		SDL_EnableScreenSaver();
 	if (screensaver == "block")
 		SDL_DisableScreenSaver();
 
-	sdl.render_driver = section->Get_string("texture_renderer");
+	sdl.render_driver = control->arguments.headless
+	                          ? "software"
+	                          : section->Get_string("texture_renderer");
 	lowcase(sdl.render_driver);
 	if (sdl.render_driver != "auto") {
 		if (SDL_SetHint(SDL_HINT_RENDER_DRIVER,
@@ -4299,6 +4323,18 @@ static void messages_add_command_line()
 	        "\n"
 	        "  --exit                   Exit after running '-c <command>'s and [autoexec] sections.\n"
 	        "\n"
+	        "  --headless               Run without a window and sound output, as fast as the\n"
+	        "                           host allows, then exit with the DOS errorlevel of the\n"
+	        "                           last program. Implies --exit. Captures still work.\n"
+	        "\n"
+	        "  --speed <speed>          Run the emulation at <speed> times real-time speed\n"
+	        "                           (e.g., 0.5 or 4), or as fast as possible if set to\n"
+	        "                           'max' (default in headless mode).\n"
+	        "\n"
+	        "  --snapshot <file>        Resume from a snapshot saved with SNAPSHOT.COM instead of\n"
+	        "                           starting AUTOEXEC.BAT from the top. Needs the same\n"
+	        "                           DOSBox build and configuration it was saved with.\n"
+	        "\n"
 	        "  --startmapper            Run the mapper GUI.\n"
 	        "\n"
 	        "  --erasemapper            Delete the default mapper file.\n"
@@ -4308,6 +4344,9 @@ static void messages_add_command_line()
 	        "\n"
 	        "  --socket <num>           Run nullmodem on the specified socket number.\n"
 	        "\n"
+	        "  --ipx-server <port>      Only run an IPX tunneling server on the given UDP port,\n"
+	        "                           without starting the emulator, until interrupted.\n"
+	        "\n"
 	        "  -h, -?, --help           Print help message and exit.\n"
 	        "\n"
 	        "  -V, --version            Print version information and exit.\n");
@@ -4919,6 +4958,11 @@ int sdl_main(int argc, char* argv[])
 			list_glshaders();
 			return 0;
 		}
+#if C_IPX
+		if (arguments->ipx_server) {
+			return IPX_RunStandaloneServer(*arguments->ipx_server);
+		}
+#endif
 
 		// Can't disable the console with debugger enabled
 #if defined(WIN32) && !(C_DEBUG)
@@ -4968,6 +5012,13 @@ int sdl_main(int argc, char* argv[])
 			return err;
 		}
 
+		// Use SDL's null video and audio drivers in headless mode, so
+		// we can run without a display or sound server
+		if (arguments->headless) {
+			SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+			SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+		}
+
 		// Timer is needed for title bar animations
 		if (SDL_Init(SDL_INIT_AUDIO | SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0) {
 			E_Exit("SDL: Can't init SDL %s", SDL_GetError());
@@ -5095,13 +5146,19 @@ int sdl_main(int argc, char* argv[])
 		// to ensure their hotkeys appear in the graphical mapper.
 		MAPPER_BindKeys(sdl_sec);
 
-		if (arguments->startmapper) {
+		if (arguments->startmapper && !arguments->headless) {
 			MAPPER_DisplayUI();
 		}
 
 		// Run the machine until shutdown
 		control->StartUp();
 
+		// Batch jobs run headless need the result of the last DOS
+		// program
+		if (arguments->headless) {
+			return_code = dos.return_code;
+		}
+
 		// Shutdown and release
 		control.reset();
 
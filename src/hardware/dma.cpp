@@ -20,6 +20,7 @@
 #include "dosbox.h"
 
 #include <algorithm>
+#include <array>
 #include <cstring>
 #include <memory>
 
@@ -29,6 +30,7 @@
 #include "pic.h"
 #include "paging.h"
 #include "setup.h"
+#include "snapshot.h"
 
 std::unique_ptr<DmaController> primary   = {};
 std::unique_ptr<DmaController> secondary = {};
@@ -53,11 +55,13 @@ static void UpdateEMSMapping()
 	}
 }
 
-// Generic function to read or write a block of data to or from memory.
-// Don't use this directly; call two helpers: DMA_BlockRead or DMA_BlockWrite
-static void perform_dma_io(const DmaDirection direction, const PhysPt spage,
-                           PhysPt mem_address, void* const data_start,
-                           const size_t num_words, const uint8_t is_dma16)
+// Walks the guest memory covered by a DMA transfer, resolving EMS-mapped
+// pages, and passes each page-bounded chunk's physical address and size to
+// the given function.
+template <typename ChunkFunction>
+static void for_each_dma_chunk(const PhysPt spage, PhysPt mem_address,
+                               const size_t num_words, const uint8_t is_dma16,
+                               ChunkFunction&& chunk_function)
 {
 	assert(is_dma16 == 0 || is_dma16 == 1);
 
@@ -66,9 +70,6 @@ static void perform_dma_io(const DmaDirection direction, const PhysPt spage,
 	// Maybe move the mem_address into the 16-bit range
 	mem_address <<= is_dma16;
 
-	// The data pointer will be incremented per transfer
-	auto data_pt = reinterpret_cast<uint8_t*>(data_start);
-
 	// Convert from DMA 'words' to actual bytes, no greater than 64 KB
 	auto remaining_bytes = check_cast<uint16_t>(num_words << is_dma16);
 	do {
@@ -92,24 +93,70 @@ static void perform_dma_io(const DmaDirection direction, const PhysPt spage,
 		// Determine how many bytes to transfer within this page
 		const auto chunk_bytes = std::min(remaining_bytes, bytes_to_page_end);
 
+		chunk_function(page, chunk_start, chunk_bytes);
+
+		mem_address += chunk_bytes;
+		remaining_bytes -= chunk_bytes;
+	} while (remaining_bytes);
+}
+
+// Only pages backed by RAM can be accessed through MemBase; anything beyond
+// reads as open bus and ignores writes, like the illegal page handler.
+static bool is_ram_page(const uint32_t page)
+{
+	return page < MEM_TotalPages();
+}
+
+// Generic function to read or write a block of data to or from memory.
+// Don't use this directly; call two helpers: DMA_BlockRead or DMA_BlockWrite
+static void perform_dma_io(const DmaDirection direction, const PhysPt spage,
+                           PhysPt mem_address, void* const data_start,
+                           const size_t num_words, const uint8_t is_dma16)
+{
+	// The data pointer will be incremented per transfer
+	auto data_pt = reinterpret_cast<uint8_t*>(data_start);
+
+	auto copy_chunk = [&](const uint32_t page, const PhysPt chunk_start,
+	                      const uint16_t chunk_bytes) {
+		const auto is_ram = is_ram_page(page);
+
 		// Copy the data from the page address into the data pointer
 		if (direction == DmaDirection::Read) {
-			for (auto i = 0; i < chunk_bytes; ++i) {
-				data_pt[i] = phys_readb(chunk_start + i);
+			if (is_ram) {
+				memcpy(data_pt, MemBase + chunk_start, chunk_bytes);
+			} else {
+				memset(data_pt, 0xff, chunk_bytes);
 			}
 		}
 
 		// Copy the data from the data pointer into the page address
 		else if (direction == DmaDirection::Write) {
-			for (auto i = 0; i < chunk_bytes; ++i) {
-				phys_writeb(chunk_start + i, data_pt[i]);
+			if (is_ram) {
+				memcpy(MemBase + chunk_start, data_pt, chunk_bytes);
 			}
 		}
-
-		mem_address += chunk_bytes;
 		data_pt += chunk_bytes;
-		remaining_bytes -= chunk_bytes;
-	} while (remaining_bytes);
+	};
+	for_each_dma_chunk(spage, mem_address, num_words, is_dma16, copy_chunk);
+}
+
+// Passes the guest memory of a DMA read to the span callback without copying,
+// except for memory not backed by RAM
+static void perform_dma_span_read(const PhysPt spage, PhysPt mem_address,
+                                  const size_t num_words, const uint8_t is_dma16,
+                                  const DMA_SpanCallback& span_callback)
+{
+	auto visit_chunk = [&](const uint32_t page, const PhysPt chunk_start,
+	                       const uint16_t chunk_bytes) {
+		if (is_ram_page(page)) {
+			span_callback(MemBase + chunk_start, chunk_bytes);
+			return;
+		}
+		static std::array<uint8_t, dos_pagesize> open_bus = {};
+		open_bus.fill(0xff);
+		span_callback(open_bus.data(), chunk_bytes);
+	};
+	for_each_dma_chunk(spage, mem_address, num_words, is_dma16, visit_chunk);
 }
 
 void TANDYSOUND_ShutDown(Section* = nullptr);
@@ -423,33 +470,67 @@ void DmaChannel::ClearRequest()
 
 size_t DmaChannel::Read(const size_t words, uint8_t* const dest_buffer)
 {
-	return ReadOrWrite(DmaDirection::Read, words, dest_buffer);
+	// incremented per transfer
+	auto curr_buffer = dest_buffer;
+
+	auto transfer = [&](const uint32_t mem_address, const size_t num_words) {
+		perform_dma_io(DmaDirection::Read,
+		               page_base,
+		               mem_address,
+		               curr_buffer,
+		               num_words,
+		               is_16bit);
+		curr_buffer += num_words << is_16bit;
+	};
+	return Transfer(words, transfer);
 }
 
 size_t DmaChannel::Write(const size_t words, uint8_t* const src_buffer)
 {
-	return ReadOrWrite(DmaDirection::Write, words, src_buffer);
+	// incremented per transfer
+	auto curr_buffer = src_buffer;
+
+	auto transfer = [&](const uint32_t mem_address, const size_t num_words) {
+		perform_dma_io(DmaDirection::Write,
+		               page_base,
+		               mem_address,
+		               curr_buffer,
+		               num_words,
+		               is_16bit);
+		curr_buffer += num_words << is_16bit;
+	};
+	return Transfer(words, transfer);
 }
 
-size_t DmaChannel::ReadOrWrite(const DmaDirection direction, const size_t words,
-                               uint8_t* const buffer)
+size_t DmaChannel::ReadSpans(const size_t words,
+                             const DMA_SpanCallback& span_callback)
+{
+	auto transfer = [&](const uint32_t mem_address, const size_t num_words) {
+		perform_dma_span_read(
+		        page_base, mem_address, num_words, is_16bit, span_callback);
+	};
+	return Transfer(words, transfer);
+}
+
+// Advances the channel's address and count over the requested words, handling
+// terminal count and auto-initialisation, and calls the transfer function for
+// each contiguous run of words.
+size_t DmaChannel::Transfer(const size_t words,
+                            const DMA_TransferFunction& transfer_function)
 {
 	auto want     = check_cast<uint16_t>(words);
 	uint16_t done = 0;
 	curr_addr &= dma_wrapping;
 
-	// incremented per transfer
-	auto curr_buffer = buffer;
 again:
 	Bitu left = (curr_count + 1);
 	if (want < left) {
-		perform_dma_io(direction, page_base, curr_addr, curr_buffer, want, is_16bit);
+		transfer_function(curr_addr, want);
 		done += want;
 		curr_addr += want;
 		curr_count -= want;
 	} else {
-		perform_dma_io(direction, page_base, curr_addr, curr_buffer, left, is_16bit);
-		curr_buffer += left << is_16bit;
+		transfer_function(curr_addr, left);
 		want -= left;
 		done += left;
 		ReachedTerminalCount();
@@ -657,6 +738,66 @@ void DMA_Destroy(Section* /*sec*/)
 	primary   = {};
 	secondary = {};
 }
+// Only the channels' registers are saved. The devices that own the
+// callbacks aren't part of the snapshot and re-register them themselves, and
+// the controllers' flip-flops simply start out cleared.
+static void dma_save_snapshot(SnapshotWriter& writer)
+{
+	writer.Write(dma_wrapping);
+	writer.Write(ems_board_mapping);
+
+	for (const auto& controller : {primary.get(), secondary.get()}) {
+		writer.Write(controller != nullptr);
+		if (!controller) {
+			continue;
+		}
+		for (uint8_t i = 0; i < 4; ++i) {
+			const auto channel = controller->GetChannel(i);
+			assert(channel);
+			writer.Write(channel->page_base);
+			writer.Write(channel->curr_addr);
+			writer.Write(channel->base_addr);
+			writer.Write(channel->base_count);
+			writer.Write(channel->curr_count);
+			writer.Write(channel->page_num);
+			writer.Write(channel->is_incremented);
+			writer.Write(channel->is_autoiniting);
+			writer.Write(channel->is_masked);
+			writer.Write(channel->has_reached_terminal_count);
+			writer.Write(channel->has_raised_request);
+		}
+	}
+}
+
+static void dma_load_snapshot(SnapshotReader& reader)
+{
+	reader.Read(dma_wrapping);
+	reader.Read(ems_board_mapping);
+
+	for (const uint8_t first_channel : {uint8_t{0}, SecondaryMin}) {
+		if (!reader.Read<bool>()) {
+			continue;
+		}
+		for (uint8_t i = 0; i < 4; ++i) {
+			// Activates the controller if needed
+			const auto channel = DMA_GetChannel(
+			        static_cast<uint8_t>(first_channel + i));
+			assert(channel);
+			reader.Read(channel->page_base);
+			reader.Read(channel->curr_addr);
+			reader.Read(channel->base_addr);
+			reader.Read(channel->base_count);
+			reader.Read(channel->curr_count);
+			reader.Read(channel->page_num);
+			reader.Read(channel->is_incremented);
+			reader.Read(channel->is_autoiniting);
+			reader.Read(channel->is_masked);
+			reader.Read(channel->has_reached_terminal_count);
+			reader.Read(channel->has_raised_request);
+		}
+	}
+}
+
 void DMA_Init(Section* sec)
 {
 	DMA_SetWrapping(0xffff);
@@ -665,4 +806,6 @@ void DMA_Init(Section* sec)
 	for (i = 0; i < LINK_START; i++) {
 		ems_board_mapping[i] = i;
 	}
+
+	SNAPSHOT_AddComponent("dma", dma_save_snapshot, dma_load_snapshot);
 }
@@ -41,6 +41,7 @@
 #include "pic.h"
 #include "setup.h"
 #include "shell.h"
+#include "snapshot.h"
 #include "string_utils.h"
 #include "timer.h"
 
@@ -51,6 +52,18 @@ static void GUS_DMA_Event(uint32_t val);
 
 std::unique_ptr<Gus> gus = nullptr;
 
+// The card's registers and sample RAM aren't part of snapshots, so saving is
+// refused once a program has written to the card
+static bool has_register_writes = false;
+
+static std::optional<std::string> check_gus_unused()
+{
+	if (gus && has_register_writes) {
+		return "the Gravis UltraSound is in use";
+	}
+	return {};
+}
+
 Voice::Voice(uint8_t num, VoiceIrq& irq) noexcept
         : vol_ctrl{irq.vol_state},
           wave_ctrl{irq.wave_state},
@@ -1139,6 +1152,8 @@ void Gus::WriteToPort(io_port_t port, io_val_t value, io_width_t width)
 {
 	RenderUpToNow();
 
+	has_register_writes = true;
+
 	const auto val = check_cast<uint16_t>(value);
 
 	//	LOG_MSG("GUS: Write to port %x val %x", port, val);
@@ -1536,6 +1551,9 @@ static void gus_init(Section* sec)
 
 	// Instantiate the GUS with the settings
 	gus = std::make_unique<Gus>(port, dma, irq, ultradir.c_str(), filter_prefs);
+	has_register_writes = false;
+
+	SNAPSHOT_AddSaveCheck(check_gus_unused);
 
 	constexpr auto changeable_at_runtime = true;
 	sec->AddDestroyFunction(&gus_destroy, changeable_at_runtime);
@@ -55,6 +55,7 @@
 
 #include "dosbox.h"
 
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <cmath>
@@ -65,6 +66,7 @@
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "channel_names.h"
 #include "control.h"
@@ -3165,7 +3167,8 @@ private:
 
 	// Playback related
 	MixerChannelPtr audio_channel = nullptr;
-	std::queue<AudioFrame> fifo   = {};
+	std::vector<AudioFrame> fifo  = {};
+	std::vector<AudioFrame> frames_to_add = {};
 	double last_rendered_ms       = 0.0;
 	double ms_per_render          = 0.0;
 
@@ -4999,7 +5002,7 @@ void ym2151_device::RenderUpToNow()
 	// Keep rendering until we're current
 	while (last_rendered_ms < now) {
 		last_rendered_ms += ms_per_render;
-		fifo.emplace(RenderFrame());
+		fifo.emplace_back(RenderFrame());
 	}
 }
 //-------------------------------------------------
@@ -5018,20 +5021,21 @@ void ym2151_device::sound_stream_update(const int requested_frames)
 	// if (fifo.size())
 	//	LOG_MSG("IMFC: Queued %2lu cycle-accurate frames", fifo.size());
 
-	auto frames_remaining = requested_frames;
+	// First, send any frames we've queued since the last callback, then
+	// render the remainder if the queue's run dry. The frames are handed to
+	// the mixer as a single block.
+	const auto num_queued = std::min(fifo.size(),
+	                                 static_cast<size_t>(requested_frames));
 
-	// First, send any frames we've queued since the last callback
-	while (frames_remaining && fifo.size()) {
-		audio_channel->AddSamples_sfloat(1, &fifo.front()[0]);
-		fifo.pop();
-		--frames_remaining;
-	}
-	// If the queue's run dry, render the remainder and sync-up our time datum
-	while (frames_remaining) {
-		const auto frame = RenderFrame();
-		audio_channel->AddSamples_sfloat(1, &frame[0]);
-		--frames_remaining;
+	frames_to_add.assign(fifo.begin(), fifo.begin() + num_queued);
+	fifo.erase(fifo.begin(), fifo.begin() + num_queued);
+
+	while (frames_to_add.size() < static_cast<size_t>(requested_frames)) {
+		frames_to_add.emplace_back(RenderFrame());
 	}
+	audio_channel->AddAudioFrames(frames_to_add);
+
+	// Sync-up our time datum
 	last_rendered_ms = PIC_FullIndex();
 }
 
@@ -5260,6 +5264,25 @@ private:
 	SDL_mutex* m_interruptHandlerRunningMutex = nullptr;
 	SDL_cond* m_interruptHandlerRunningCond    = nullptr;
 
+	// The firmware main loop sleeps until the system sends data, an
+	// interrupt has been handled, or the bootup sequence has finished
+	SDL_mutex* m_firmwareEventMutex = nullptr;
+	SDL_cond* m_firmwareEventCond   = nullptr;
+	bool m_firmwareEventPending     = false;
+
+	// A safety net in case an event gets lost; the firmware doesn't need
+	// to be woken up periodically otherwise
+	static constexpr uint32_t FirmwareIdleTimeoutMs = 50;
+
+	// Statistics of the system to card messaging, logged on shutdown
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point m_startTime          = {};
+	Clock::time_point m_firmwareEventTime  = {};
+	double m_totalFirmwareLatencyMs        = 0.0;
+	double m_maxFirmwareLatencyMs          = 0.0;
+	uint64_t m_numFirmwareWakeups          = 0;
+	uint64_t m_numBytesFromSystem          = 0;
+
 	static constexpr auto NumIoHandlers                           = 16;
 	std::array<IO_ReadHandleObject, NumIoHandlers> readHandlers   = {};
 	std::array<IO_WriteHandleObject, NumIoHandlers> writeHandlers = {};
@@ -5722,8 +5745,6 @@ private:
 	// and 0xE5 (reboot command). This value will be sent to the system.
 	void softReboot(uint8_t commandThatRequestedTheSoftReboot)
 	{
-		using namespace std::chrono_literals;
-
 		disableInterrupts();
 		// reset the stack pointer :)
 		m_cardMode = MUSIC_MODE;
@@ -5753,7 +5774,11 @@ private:
 		                          1);
 
 		log_debug("softReboot - starting infinite loop");
+		SDL_LockMutex(m_firmwareEventMutex);
 		m_finishedBootupSequence = true;
+		SDL_CondBroadcast(m_firmwareEventCond);
+		SDL_UnlockMutex(m_firmwareEventMutex);
+
 		while (keepRunning.load()) {
 			// log_debug("DEBUG: heartbeat in MUSIC_MODE_LOOP %i",
 			// debug_count++);
@@ -5761,8 +5786,71 @@ private:
 			// reenable
 			MUSIC_MODE_LOOP_read_System_And_Dispatch();
 			logSuccess();
-			std::this_thread::sleep_for(1ms);
+			waitForFirmwareEvent();
+		}
+	}
+
+	// Wakes up the firmware main loop
+	void notifyFirmware()
+	{
+		SDL_LockMutex(m_firmwareEventMutex);
+		if (!m_firmwareEventPending) {
+			m_firmwareEventPending = true;
+			m_firmwareEventTime    = Clock::now();
+		}
+		SDL_CondBroadcast(m_firmwareEventCond);
+		SDL_UnlockMutex(m_firmwareEventMutex);
+	}
+
+	bool hasDataFromSystem()
+	{
+		m_bufferFromSystemState.lock();
+		const bool hasData = m_bufferFromSystemState.hasData();
+		m_bufferFromSystemState.unlock();
+		return hasData;
+	}
+
+	// Blocks the firmware main loop until there's something to process
+	void waitForFirmwareEvent()
+	{
+		// Each pass of the main loop only processes a single byte, so
+		// keep going while there's more data queued up
+		const bool hasPendingData = hasDataFromSystem();
+
+		SDL_LockMutex(m_firmwareEventMutex);
+		if (!hasPendingData && !m_firmwareEventPending && keepRunning.load()) {
+			SDL_CondWaitTimeout(m_firmwareEventCond,
+			                    m_firmwareEventMutex,
+			                    FirmwareIdleTimeoutMs);
+		}
+		if (m_firmwareEventPending) {
+			const std::chrono::duration<double, std::milli> latency =
+			        Clock::now() - m_firmwareEventTime;
+
+			m_totalFirmwareLatencyMs += latency.count();
+			m_maxFirmwareLatencyMs = std::max(m_maxFirmwareLatencyMs,
+			                                  latency.count());
+			++m_numFirmwareWakeups;
+
+			m_firmwareEventPending = false;
 		}
+		SDL_UnlockMutex(m_firmwareEventMutex);
+	}
+
+	void logFirmwareStatistics() const
+	{
+		if (m_numFirmwareWakeups == 0) {
+			return;
+		}
+		const std::chrono::duration<double> elapsed = Clock::now() -
+		                                              m_startTime;
+		LOG_MSG("IMFC: Received %" PRIu64 " bytes from the system (%.1f bytes/s), "
+		        "firmware wake-up latency: %.3f ms average, %.3f ms maximum",
+		        m_numBytesFromSystem,
+		        static_cast<double>(m_numBytesFromSystem) / elapsed.count(),
+		        m_totalFirmwareLatencyMs /
+		                static_cast<double>(m_numFirmwareWakeups),
+		        m_maxFirmwareLatencyMs);
 	}
 
 	// ROM Address: 0x0288
@@ -7851,6 +7939,7 @@ private:
 		}
 		// disableInterrupts();
 		const auto [a, b] = split_uint16_t(m_bufferFromSystemState.popData());
+		++m_numBytesFromSystem;
 
 		// clang-format off
 		//log("DEBUG2(1/2): m_bufferFromSystemState: lastReadByteIndex=%02X indexForNextWriteByte=%02X", m_bufferFromSystemState.getLastReadByteIndex(), m_bufferFromSystemState.getIndexForNextWriteByte());
@@ -12927,8 +13016,6 @@ public:
 	          m_bufferFromSystemState("bufferFromSystemState", 0x2000),
 	          m_bufferToSystemState("bufferToSystemState", 256)
 	{
-		using namespace std::chrono_literals;
-
 		// now wire everything up (see Figure "2-1 Music Card Interrupt
 		// System" in the Techniucal Reference Manual)
 
@@ -13030,16 +13117,20 @@ public:
 		m_interruptHandlerRunning      = false;
 		m_interruptHandlerRunningMutex = SDL_CreateMutex();
 		m_interruptHandlerRunningCond  = SDL_CreateCond();
+		m_firmwareEventMutex           = SDL_CreateMutex();
+		m_firmwareEventCond            = SDL_CreateCond();
+		m_startTime                    = Clock::now();
 		m_mainThread = SDL_CreateThread(&imfMainThreadStart, "imfc-main", this);
 		m_interruptThread = SDL_CreateThread(&imfInterruptThreadStart,
 		                                     "imfc-interrupt",
 		                                     this);
 
-		// wait until we're ready to receive data... it's a workaround
-		// for now, but well....
+		// wait until we're ready to receive data
+		SDL_LockMutex(m_firmwareEventMutex);
 		while (!m_finishedBootupSequence) {
-			std::this_thread::sleep_for(1ms);
+			SDL_CondWait(m_firmwareEventCond, m_firmwareEventMutex);
 		}
+		SDL_UnlockMutex(m_firmwareEventMutex);
 
 		// We're read to receive data, so register the IO handlers
 		RegisterIoHandlers(port);
@@ -13077,6 +13168,7 @@ public:
 			}
 			SDL_UnlockMutex(m_interruptHandlerRunningMutex);
 			interruptHandler();
+			notifyFirmware();
 		}
 		return 0;
 	}
@@ -13109,6 +13201,7 @@ public:
 		SDL_UnlockMutex(m_hardwareMutex);
 		receiveNextValueFromSystemDuringInterruptHandler(); // moved from
 		                                                    // sendOrReceiveNextValueToFromSystemDuringInterruptHandler
+		notifyFirmware();
 	}
 	uint8_t readPortPIU2(const io_port_t, const io_width_t)
 	{
@@ -13236,6 +13329,7 @@ public:
 		LOG_MSG("IMFC: Shutting down");
 
 		keepRunning = false;
+		notifyFirmware();
 
 		// Remove access to the IO ports
 		for (auto& rh : readHandlers)
@@ -13248,6 +13342,8 @@ public:
 
 		SDL_WaitThread(m_mainThread, nullptr);
 		SDL_DestroyMutex(m_hardwareMutex);
+
+		logFirmwareStatistics();
 	}
 };
 
@@ -21,6 +21,9 @@
 
 #include "innovation.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "channel_names.h"
 #include "checks.h"
 #include "control.h"
@@ -29,6 +32,17 @@
 
 CHECK_NARROWING();
 
+// Register writes come in at most a few thousand per second, even when
+// playing digitised sound through the volume register
+constexpr size_t MaxWorkFifoSize = 4096;
+
+// The render thread clocks the SID in chunks of at most this many cycles
+constexpr uint32_t MaxClocksPerChunk = 4096;
+
+// The readable registers
+constexpr uint8_t FirstReadableRegister = 0x19;
+constexpr uint8_t LastReadableRegister  = 0x1c;
+
 void Innovation::Open(const std::string_view model_choice,
                       const std::string_view clock_choice,
                       const int filter_strength_6581,
@@ -117,6 +131,19 @@ void Innovation::Open(const std::string_view model_choice,
 	                                   sample_rate_hz,
 	                                   passband);
 
+	clocks_per_frame = static_cast<uint32_t>(ceil(chip_clock / sample_rate_hz));
+
+	// Size the out-bound audio frame FIFO to render ahead by the mixer's
+	// prebuffer
+	const auto audio_frames_per_ms = iround(sample_rate_hz / MillisInSecond);
+	audio_frame_fifo.Resize(
+	        check_cast<size_t>(MIXER_GetPreBufferMs() * audio_frames_per_ms));
+	audio_frame_fifo.Start();
+
+	// Size the in-bound work FIFO
+	work_fifo.Resize(MaxWorkFifoSize);
+	work_fifo.Start();
+
 	// Setup and assign the port address
 	const auto read_from = std::bind(&Innovation::ReadFromPort, this, _1, _2);
 	const auto write_to = std::bind(&Innovation::WriteToPort, this, _1, _2, _3);
@@ -130,6 +157,14 @@ void Innovation::Open(const std::string_view model_choice,
 
 	// Ready state-values for rendering
 	last_rendered_ms = 0.0;
+	bus_value        = 0;
+	had_underruns    = false;
+	UpdateReadableRegisters();
+
+	// Start rendering audio
+	const auto render = std::bind(&Innovation::Render, this);
+	renderer          = std::thread(render);
+	set_thread_name(renderer, "dosbox:innovation");
 
 	// Variable model_name is only used for logging, so use a const char* here
 	const char* model_name = model_choice == "8580" ? "8580" : "6581";
@@ -158,6 +193,12 @@ void Innovation::Close()
 
 	LOG_MSG("INNOVATION: Shutting down");
 
+	if (had_underruns) {
+		LOG_WARNING(
+		        "INNOVATION: Fix underruns by lowering the CPU load or "
+		        "increasing the 'prebuffer' or 'blocksize' settings");
+	}
+
 	MIXER_LockMixerThread();
 
 	// Stop playback
@@ -168,6 +209,17 @@ void Innovation::Close()
 	read_handler.Uninstall();
 	write_handler.Uninstall();
 
+	// Stop queueing new register writes and audio frames
+	work_fifo.Stop();
+	audio_frame_fifo.Stop();
+
+	// Wait for the rendering thread to finish
+	if (renderer.joinable()) {
+		renderer.join();
+	}
+	work_fifo.Clear();
+	audio_frame_fifo.Clear();
+
 	// Deregister the mixer channel and remove it
 	assert(channel);
 	MIXER_DeregisterChannel(channel);
@@ -181,82 +233,155 @@ void Innovation::Close()
 	MIXER_UnlockMixerThread();
 }
 
+// Reads are served from the state of the last rendered clock, as the SID
+// itself is only accessed by the rendering thread
 uint8_t Innovation::ReadFromPort(io_port_t port, io_width_t)
 {
-	std::lock_guard lock(mutex);
-	const auto sid_port = static_cast<io_port_t>(port - base_port);
-	return service->read(sid_port);
+	const auto sid_port = static_cast<uint8_t>(port - base_port);
+
+	if (sid_port >= FirstReadableRegister && sid_port <= LastReadableRegister) {
+		const auto shift = (sid_port - FirstReadableRegister) * 8;
+		bus_value = static_cast<uint8_t>(readable_registers >> shift);
+	}
+	// Reading the write-only registers returns what's left on the bus
+	return bus_value;
 }
 
+// The register write is placed in the work FIFO, timestamped with the number
+// of clock cycles elapsed since the previous one
 void Innovation::WriteToPort(io_port_t port, io_val_t value, io_width_t)
 {
-	std::lock_guard lock(mutex);
+	const auto data     = check_cast<uint8_t>(value);
+	const auto sid_port = static_cast<uint8_t>(port - base_port);
 
-	RenderUpToNow();
+	bus_value = data;
 
-	const auto data = check_cast<uint8_t>(value);
-	const auto sid_port = static_cast<io_port_t>(port - base_port);
-	service->write(sid_port, data);
+	work_fifo.Enqueue({GetNumPendingClocks(), sid_port, data});
 }
 
-void Innovation::RenderUpToNow()
+uint32_t Innovation::GetNumPendingClocks()
 {
-	const auto now = PIC_FullIndex();
+	const auto now_ms = PIC_FullIndex();
 
 	// Wake up the channel and update the last rendered time datum.
 	assert(channel);
 	if (channel->WakeUp()) {
-		last_rendered_ms = now;
-		return;
+		last_rendered_ms = now_ms;
+		return 0;
 	}
-	// Keep rendering until we're current
-	while (last_rendered_ms < now) {
-		last_rendered_ms += ms_per_clock;
-		if (float frame = 0.0f; MaybeRenderFrame(frame))
-			fifo.emplace(frame);
+	if (last_rendered_ms >= now_ms) {
+		return 0;
 	}
+
+	// Return the number of clock cycles needed to get current again
+	assert(ms_per_clock > 0.0);
+
+	const auto elapsed_ms = now_ms - last_rendered_ms;
+	const auto num_clocks = static_cast<uint32_t>(ceil(elapsed_ms / ms_per_clock));
+	last_rendered_ms += num_clocks * ms_per_clock;
+
+	return num_clocks;
 }
 
-bool Innovation::MaybeRenderFrame(float &frame)
+// The callback operates at the audio frame-level, steadily adding samples to
+// the mixer until the requested numbers of audio frames is met.
+void Innovation::AudioCallback(const int requested_frames)
 {
-	assert(service);
+	assert(channel);
+
+	// Report buffer underruns
+	constexpr auto warning_percent = 5.0f;
 
-	int16_t sample = {0};
+	if (const auto percent_full = audio_frame_fifo.GetPercentFull();
+	    percent_full < warning_percent) {
+		static auto iteration = 0;
+		if (iteration++ % 100 == 0) {
+			LOG_WARNING("INNOVATION: Audio buffer underrun");
+		}
+		had_underruns = true;
+	}
 
-	const auto frame_is_ready = service->clock(1, &sample);
+	static std::vector<float> audio_frames = {};
 
-	// Get the frame
-	if (frame_is_ready)
-		frame = static_cast<float>(sample * 2);
+	const auto has_dequeued = audio_frame_fifo.BulkDequeue(audio_frames,
+	                                                       requested_frames);
+	if (has_dequeued) {
+		assert(check_cast<int>(audio_frames.size()) == requested_frames);
+		channel->AddSamples_mfloat(requested_frames, audio_frames.data());
 
-	return frame_is_ready;
+		last_rendered_ms = PIC_FullIndex();
+	} else {
+		assert(!audio_frame_fifo.IsRunning());
+		channel->AddSilence();
+	}
 }
 
-void Innovation::AudioCallback(const int requested_frames)
+// Clocks the SID and queues the audio frames it produced
+void Innovation::RenderClocksToFifo(uint32_t num_clocks)
 {
-	assert(channel);
+	assert(service);
 
-	std::lock_guard lock(mutex);
+	static std::vector<int16_t> samples     = {};
+	static std::vector<float> audio_frames = {};
 
-	//if (fifo.size())
-	//	LOG_MSG("INNOVATION: Queued %2lu cycle-accurate frames", fifo.size());
+	while (num_clocks > 0 && audio_frame_fifo.IsRunning()) {
+		const auto chunk = std::min(num_clocks, MaxClocksPerChunk);
 
-	auto frames_remaining = requested_frames;
+		// The SID produces at most one sample per clock
+		samples.resize(chunk);
+		const auto num_samples = service->clock(chunk, samples.data());
+		num_clocks -= chunk;
 
-	// First, send any frames we've queued since the last callback
-	while (frames_remaining && fifo.size()) {
-		channel->AddSamples_mfloat(1, &fifo.front());
-		fifo.pop();
-		--frames_remaining;
-	}
-	// If the queue's run dry, render the remainder and sync-up our time datum
-	while (frames_remaining) {
-		if (float frame = 0.0f; MaybeRenderFrame(frame)) {
-			channel->AddSamples_mfloat(1, &frame);
+		if (num_samples <= 0) {
+			continue;
 		}
-		--frames_remaining;
+		audio_frames.resize(check_cast<size_t>(num_samples));
+		std::transform(samples.begin(),
+		               samples.begin() + num_samples,
+		               audio_frames.begin(),
+		               [](const int16_t sample) {
+			               return static_cast<float>(sample * 2);
+		               });
+		audio_frame_fifo.BulkEnqueue(audio_frames);
+	}
+	UpdateReadableRegisters();
+}
+
+// The SID is clocked up to the time of the next register write before
+// applying it
+void Innovation::ProcessWorkFromFifo()
+{
+	const auto work = work_fifo.Dequeue();
+	if (!work) {
+		return;
+	}
+	if (work->num_clocks > 0) {
+		RenderClocksToFifo(work->num_clocks);
+	}
+	service->write(work->reg, work->data);
+}
+
+void Innovation::UpdateReadableRegisters()
+{
+	assert(service);
+
+	uint32_t packed = 0;
+	for (auto reg = FirstReadableRegister; reg <= LastReadableRegister; ++reg) {
+		const auto shift = (reg - FirstReadableRegister) * 8;
+		packed |= static_cast<uint32_t>(service->read(reg)) << shift;
+	}
+	readable_registers = packed;
+}
+
+// Keep the FIFO populated with freshly rendered audio frames
+void Innovation::Render()
+{
+	constexpr uint32_t frames_per_chunk = 16;
+
+	while (work_fifo.IsRunning()) {
+		work_fifo.IsEmpty() ? RenderClocksToFifo(clocks_per_frame * frames_per_chunk)
+		                    : ProcessWorkFromFifo();
 	}
-	last_rendered_ms = PIC_FullIndex();
 }
 
 Innovation innovation;
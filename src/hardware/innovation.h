@@ -23,15 +23,25 @@
 
 #include "dosbox.h"
 
+#include <atomic>
 #include <memory>
-#include <queue>
 #include <string>
+#include <thread>
 
 #include "mixer.h"
 #include "inout.h"
+#include "rwqueue.h"
 
 #include "residfp/SID.h"
 
+// A register write, timestamped by the number of SID clock cycles since the
+// previous write
+struct SidRegisterWrite {
+	uint32_t num_clocks = 0;
+	uint8_t reg         = 0;
+	uint8_t data        = 0;
+};
+
 class Innovation {
 public:
 	void Open(const std::string_view model_choice,
@@ -46,29 +56,41 @@ public:
 	}
 
 private:
-	bool MaybeRenderFrame(float &frame);
 	void AudioCallback(const int requested_frames);
+	uint32_t GetNumPendingClocks();
 	uint8_t ReadFromPort(io_port_t port, io_width_t width);
-	void RenderUpToNow();
-	int16_t TallySilence(const int16_t sample);
 	void WriteToPort(io_port_t port, io_val_t value, io_width_t width);
 
+	// Rendering thread
+	void ProcessWorkFromFifo();
+	void RenderClocksToFifo(uint32_t num_clocks);
+	void Render();
+	void UpdateReadableRegisters();
+
 	// Managed objects
 	MixerChannelPtr channel               = nullptr;
 	IO_ReadHandleObject read_handler      = {};
 	IO_WriteHandleObject write_handler    = {};
 	std::unique_ptr<reSIDfp::SID> service = {};
-	std::queue<float> fifo                = {};
-	std::mutex mutex                      = {};
+	RWQueue<float> audio_frame_fifo{1};
+	RWQueue<SidRegisterWrite> work_fifo{1};
+	std::thread renderer = {};
+
+	// The readable registers (paddles, voice 3 oscillator and envelope) as
+	// of the last rendered clock, packed from 19h in the lowest byte up to
+	// 1Ch in the highest one
+	std::atomic<uint32_t> readable_registers = 0;
 
 	// Initial configuration
-	double chip_clock            = 0.0;
-	double ms_per_clock          = 0.0;
-	io_port_t base_port          = 0;
-	int idle_after_silent_frames = 0;
+	double chip_clock         = 0.0;
+	double ms_per_clock       = 0.0;
+	io_port_t base_port       = 0;
+	uint32_t clocks_per_frame = 0;
 
 	// Runtime states
 	double last_rendered_ms = 0.0;
+	uint8_t bus_value       = 0;
+	bool had_underruns      = false;
 	bool is_open            = false;
 };
 
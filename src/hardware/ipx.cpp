@@ -1026,12 +1026,13 @@ public:
 				}
 				if(isIpxServer) {
 					WriteOut("List of active connections:\n\n");
-					int i;
-					IPaddress *ptrAddr;
-					for(i=0;i<SOCKETTABLESIZE;i++) {
-						if(IPX_isConnectedToServer(i,&ptrAddr)) {
-							WriteOut("     %d.%d.%d.%d from port %d\n", CONVIP(ptrAddr->host), SDLNet_Read16(&ptrAddr->port));
-						}
+					for (const auto& client : IPX_GetServerClients()) {
+						WriteOut("     %d.%d.%d.%d from port %d, %" PRIu64
+						         " packets sent, %" PRIu64 " received\n",
+						         CONVIP(client.address.host),
+						         SDLNet_Read16(&client.address.port),
+						         client.packets_in,
+						         client.packets_out);
 					}
 					WriteOut("\n");
 				}
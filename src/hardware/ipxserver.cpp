@@ -20,27 +20,54 @@
 
 #if C_IPX
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <cinttypes>
+#include <csignal>
+#include <cstring>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 #include "ipx.h"
 #include "ipxserver.h"
 #include "timer.h"
 
-static constexpr int UDP_UNICAST = -1; // SDLNet magic number
+bool NetWrapper_InitializeSDLNet(); // from misc_util.cpp
 
-static IPaddress ipxServerIp;     // IPAddress for server's listening port
-static UDPsocket ipxServerSocket; // Listening server socket
-static SDLNet_SocketSet socket_set = nullptr;
+// Each client's broadcasts are relayed to all the others, so this is well
+// beyond what the IPX games themselves can handle
+static constexpr size_t MaxClients = 1024;
 
-static packetBuffer connBuffer[SOCKETTABLESIZE];
+// Most packets received or sent with a single system call
+static constexpr int BatchSize = 32;
 
-static uint8_t inBuffer[IPXBUFFERSIZE];
-static IPaddress ipconn[SOCKETTABLESIZE]; // Active TCP/IP connection
+static IPaddress ipxServerIp; // IPAddress for server's listening port
+
+// Registered clients, keyed by their address
+static std::mutex clients_mutex;
+static std::unordered_map<uint64_t, IpxServerClient> clients;
 
 static std::thread ipx_server_thread;
 static std::atomic_bool ipx_server_running = false;
 
+struct OutgoingPacket {
+	IPaddress address   = {};
+	const uint8_t* data = nullptr;
+	uint16_t size       = 0;
+};
+
 uint8_t packetCRC(uint8_t* buffer, uint16_t bufSize)
 {
 	uint8_t tmpCRC = 0;
@@ -52,213 +79,496 @@ uint8_t packetCRC(uint8_t* buffer, uint16_t bufSize)
 	return tmpCRC;
 }
 
-/*
-static void closeSocket(uint16_t sockidx) {
-	uint32_t host;
+static uint64_t to_client_key(const uint32_t host, const uint16_t port)
+{
+	return (static_cast<uint64_t>(host) << 16) | port;
+}
+
+static void build_ack(const IPaddress& client_address, IPXHeader& ack)
+{
+	ack = {};
+
+	SDLNet_Write16(0xffff, ack.checkSum);
+	SDLNet_Write16(sizeof(ack), ack.length);
 
-	host = ipconn[sockidx].host;
-	LOG_MSG("IPXSERVER: %d.%d.%d.%d disconnected", CONVIP(host));
+	SDLNet_Write32(0, ack.dest.network);
+	PackIP(client_address, &ack.dest.addr.byIP);
+	SDLNet_Write16(0x2, ack.dest.socket);
 
-	SDLNet_TCP_DelSocket(serverSocketSet,tcpconn[sockidx]);
-	SDLNet_TCP_Close(tcpconn[sockidx]);
-	connBuffer[sockidx].connected = false;
-	connBuffer[sockidx].waitsize = false;
+	SDLNet_Write32(1, ack.src.network);
+	PackIP(ipxServerIp, &ack.src.addr.byIP);
+	SDLNet_Write16(0x2, ack.src.socket);
+	ack.transControl = 0;
 }
-*/
-
-static void sendIPXPacket(uint8_t *buffer, int16_t bufSize) {
-	uint16_t srcport, destport;
-	uint32_t srchost, desthost;
-	UDPpacket outPacket;
-	outPacket.channel = -1;
-	outPacket.data = buffer;
-	outPacket.len = bufSize;
-	outPacket.maxlen = bufSize;
-	IPXHeader *tmpHeader;
-	tmpHeader = (IPXHeader *)buffer;
-
-	srchost = tmpHeader->src.addr.byIP.host;
-	desthost = tmpHeader->dest.addr.byIP.host;
-
-	srcport = tmpHeader->src.addr.byIP.port;
-	destport = tmpHeader->dest.addr.byIP.port;
-
-	if(desthost == 0xffffffff) {
+
+// Caller must hold the clients mutex
+static bool register_client(const IPaddress& from, const IPXHeader& header)
+{
+	IPaddress reported = {};
+	UnpackIP(header.src.addr.byIP, &reported);
+
+	// A known client registering again, possibly from a new port
+	auto it = clients.find(to_client_key(reported.host, reported.port));
+	if (it == clients.end()) {
+		it = clients.find(to_client_key(from.host, from.port));
+	}
+	if (it != clients.end()) {
+		LOG_MSG("IPXSERVER: Reconnect from %d.%d.%d.%d", CONVIP(reported.host));
+		auto client    = it->second;
+		client.address = from;
+		clients.erase(it);
+		clients[to_client_key(from.host, from.port)] = client;
+		return true;
+	}
+
+	if (clients.size() >= MaxClients) {
+		LOG_WARNING("IPXSERVER: Client table is full, ignoring %d.%d.%d.%d",
+		            CONVIP(from.host));
+		return false;
+	}
+
+	IpxServerClient client = {};
+	client.address         = from;
+	clients[to_client_key(from.host, from.port)] = client;
+
+	LOG_MSG("IPXSERVER: Connect from %d.%d.%d.%d", CONVIP(from.host));
+	return true;
+}
+
+// Works out where a received packet has to go and queues it for sending.
+// The server's own reply to a registration is built in 'ack'.
+static void route_packet(const IPaddress& from, const uint8_t* data,
+                         const uint16_t size, IPXHeader& ack,
+                         std::vector<OutgoingPacket>& outgoing)
+{
+	if (size < sizeof(IPXHeader)) {
+		return;
+	}
+	IPXHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	std::lock_guard<std::mutex> lock(clients_mutex);
+
+	// Registration packets spoof the echo protocol designation 0x02 and
+	// have a null destination node
+	if (SDLNet_Read16(header.dest.socket) == 0x2 &&
+	    header.dest.addr.byIP.host == 0x0) {
+		if (register_client(from, header)) {
+			// If the client doesn't get this, it won't be registered
+			build_ack(from, ack);
+			outgoing.push_back({from,
+			                    reinterpret_cast<const uint8_t*>(&ack),
+			                    sizeof(ack)});
+		}
+		return;
+	}
+
+	if (const auto sender = clients.find(to_client_key(from.host, from.port));
+	    sender != clients.end()) {
+		++sender->second.packets_in;
+		sender->second.bytes_in += size;
+	}
+
+	auto queue_to = [&](IpxServerClient& client) {
+		outgoing.push_back({client.address, data, size});
+		++client.packets_out;
+		client.bytes_out += size;
+	};
+
+	const uint32_t srchost  = header.src.addr.byIP.host;
+	const uint16_t srcport  = header.src.addr.byIP.port;
+	const uint32_t desthost = header.dest.addr.byIP.host;
+	const uint16_t destport = header.dest.addr.byIP.port;
+
+	if (desthost == 0xffffffff) {
 		// Broadcast
-		for (uint16_t i = 0; i < SOCKETTABLESIZE; ++i) {
-			if(connBuffer[i].connected && ((ipconn[i].host != srchost)||(ipconn[i].port!=srcport))) {
-				outPacket.address = ipconn[i];
-				const int result = SDLNet_UDP_Send(ipxServerSocket,
-				                                   UDP_UNICAST,
-				                                   &outPacket);
-				if (result == 0) {
-					LOG_MSG("IPXSERVER: %s", SDLNet_GetError());
-					continue;
-				}
-				//LOG_MSG("IPXSERVER: Packet of %d bytes sent from %d.%d.%d.%d to %d.%d.%d.%d (BROADCAST) (%x CRC)", bufSize, CONVIP(srchost), CONVIP(ipconn[i].host), packetCRC(&buffer[30], bufSize-30));
+		for (auto& [key, client] : clients) {
+			if (client.address.host != srchost ||
+			    client.address.port != srcport) {
+				queue_to(client);
 			}
 		}
-	} else {
-		// Specific address
-		for (uint16_t i = 0; i < SOCKETTABLESIZE; ++i) {
-			if((connBuffer[i].connected) && (ipconn[i].host == desthost) && (ipconn[i].port == destport)) {
-				outPacket.address = ipconn[i];
-				const int result = SDLNet_UDP_Send(ipxServerSocket,
-				                                   UDP_UNICAST,
-				                                   &outPacket);
-				if (result == 0) {
-					LOG_MSG("IPXSERVER: %s", SDLNet_GetError());
+	} else if (const auto dest = clients.find(to_client_key(desthost, destport));
+	           dest != clients.end()) {
+		queue_to(dest->second);
+	}
+}
+
+static void log_client_stats()
+{
+	std::lock_guard<std::mutex> lock(clients_mutex);
+	for (const auto& [key, client] : clients) {
+		LOG_MSG("IPXSERVER: %d.%d.%d.%d port %d sent %" PRIu64
+		        " packets (%" PRIu64 " bytes) and received %" PRIu64
+		        " packets (%" PRIu64 " bytes)",
+		        CONVIP(client.address.host),
+		        SDLNet_Read16(&client.address.port),
+		        client.packets_in,
+		        client.bytes_in,
+		        client.packets_out,
+		        client.bytes_out);
+	}
+}
+
+#if defined(__linux__)
+
+// On Linux, the server uses a native socket so packets can be received and
+// sent in batches, and waits with epoll so stopping it is instant
+
+static int server_fd = -1;
+static int wake_fd   = -1;
+static int epoll_fd  = -1;
+
+static void close_server_socket()
+{
+	for (auto fd : {epoll_fd, wake_fd, server_fd}) {
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+	epoll_fd  = -1;
+	wake_fd   = -1;
+	server_fd = -1;
+}
+
+static bool open_server_socket(const uint16_t portnum)
+{
+	server_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	wake_fd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (server_fd < 0 || wake_fd < 0 || epoll_fd < 0) {
+		LOG_ERR("IPXSERVER: %s", strerror(errno));
+		close_server_socket();
+		return false;
+	}
+
+	sockaddr_in addr     = {};
+	addr.sin_family      = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port        = htons(portnum);
+	if (bind(server_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+		LOG_ERR("IPXSERVER: %s", strerror(errno));
+		close_server_socket();
+		return false;
+	}
+
+	for (auto fd : {server_fd, wake_fd}) {
+		epoll_event event = {};
+		event.events      = EPOLLIN;
+		event.data.fd     = fd;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+			LOG_ERR("IPXSERVER: %s", strerror(errno));
+			close_server_socket();
+			return false;
+		}
+	}
+	return true;
+}
+
+static void wake_server()
+{
+	const uint64_t one = 1;
+	if (write(wake_fd, &one, sizeof(one)) < 0) {
+		LOG_WARNING("IPXSERVER: %s", strerror(errno));
+	}
+}
+
+static void send_packets(const std::vector<OutgoingPacket>& packets)
+{
+	std::array<mmsghdr, BatchSize> messages  = {};
+	std::array<iovec, BatchSize> iovecs      = {};
+	std::array<sockaddr_in, BatchSize> addrs = {};
+
+	// A client that went away makes every packet to it fail, so the
+	// failures are reported once per batch rather than per packet
+	size_t num_failed = 0;
+	int last_error    = 0;
+
+	size_t pos = 0;
+	while (pos < packets.size()) {
+		const auto num_packets = std::min(packets.size() - pos,
+		                                  static_cast<size_t>(BatchSize));
+		for (size_t i = 0; i < num_packets; ++i) {
+			const auto& packet = packets[pos + i];
+
+			addrs[i]                 = {};
+			addrs[i].sin_family      = AF_INET;
+			addrs[i].sin_addr.s_addr = packet.address.host;
+			addrs[i].sin_port        = packet.address.port;
+
+			iovecs[i].iov_base = const_cast<uint8_t*>(packet.data);
+			iovecs[i].iov_len  = packet.size;
+
+			messages[i]                    = {};
+			messages[i].msg_hdr.msg_name    = &addrs[i];
+			messages[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+			messages[i].msg_hdr.msg_iov     = &iovecs[i];
+			messages[i].msg_hdr.msg_iovlen  = 1;
+		}
+
+		size_t num_sent = 0;
+		while (num_sent < num_packets) {
+			const auto result = sendmmsg(server_fd,
+			                             &messages[num_sent],
+			                             static_cast<unsigned int>(
+			                                     num_packets - num_sent),
+			                             0);
+			if (result < 0) {
+				if (errno == EINTR) {
 					continue;
 				}
-				//LOG_MSG("IPXSERVER: Packet sent from %d.%d.%d.%d to %d.%d.%d.%d", CONVIP(srchost), CONVIP(desthost));
+				// Skip the packet that failed
+				last_error = errno;
+				++num_failed;
+				++num_sent;
+				continue;
 			}
+			num_sent += static_cast<size_t>(result);
 		}
+		pos += num_packets;
+	}
+
+	if (num_failed > 0) {
+		LOG_MSG("IPXSERVER: Failed sending %zu of %zu packets: %s",
+		        num_failed,
+		        packets.size(),
+		        strerror(last_error));
 	}
 }
 
-bool IPX_isConnectedToServer(Bits tableNum, IPaddress ** ptrAddr) {
-	if(tableNum >= SOCKETTABLESIZE) return false;
-	*ptrAddr = &ipconn[tableNum];
-	return connBuffer[tableNum].connected;
+static void server_loop()
+{
+	std::vector<std::array<uint8_t, IPXBUFFERSIZE>> buffers(BatchSize);
+	std::array<mmsghdr, BatchSize> messages = {};
+	std::array<iovec, BatchSize> iovecs     = {};
+	std::array<sockaddr_in, BatchSize> from = {};
+	std::array<IPXHeader, BatchSize> acks   = {};
+
+	std::vector<OutgoingPacket> outgoing = {};
+
+	while (ipx_server_running) {
+		std::array<epoll_event, 2> events = {};
+		const auto num_events = epoll_wait(epoll_fd,
+		                                   events.data(),
+		                                   static_cast<int>(events.size()),
+		                                   -1);
+		if (num_events < 0) {
+			if (errno != EINTR) {
+				LOG_ERR("IPXSERVER: %s", strerror(errno));
+			}
+			continue;
+		}
+
+		// Drain the socket
+		while (ipx_server_running) {
+			for (size_t i = 0; i < BatchSize; ++i) {
+				iovecs[i].iov_base = buffers[i].data();
+				iovecs[i].iov_len  = buffers[i].size();
+
+				messages[i]                    = {};
+				messages[i].msg_hdr.msg_name    = &from[i];
+				messages[i].msg_hdr.msg_namelen = sizeof(from[i]);
+				messages[i].msg_hdr.msg_iov     = &iovecs[i];
+				messages[i].msg_hdr.msg_iovlen  = 1;
+			}
+			const auto num_received = recvmmsg(
+			        server_fd, messages.data(), BatchSize, MSG_DONTWAIT, nullptr);
+			if (num_received <= 0) {
+				break;
+			}
+
+			outgoing.clear();
+			for (size_t i = 0; i < static_cast<size_t>(num_received); ++i) {
+				IPaddress address = {};
+				address.host      = from[i].sin_addr.s_addr;
+				address.port      = from[i].sin_port;
+
+				route_packet(address,
+				             buffers[i].data(),
+				             static_cast<uint16_t>(messages[i].msg_len),
+				             acks[i],
+				             outgoing);
+			}
+			send_packets(outgoing);
+		}
+	}
+}
+
+#else
+
+static constexpr int UDP_UNICAST = -1; // SDLNet magic number
+
+static UDPsocket ipxServerSocket = nullptr; // Listening server socket
+static SDLNet_SocketSet socket_set = nullptr;
+
+static void close_server_socket()
+{
+	SDLNet_FreeSocketSet(socket_set);
+	SDLNet_UDP_Close(ipxServerSocket);
+	socket_set      = nullptr;
+	ipxServerSocket = nullptr;
+}
+
+static bool open_server_socket(const uint16_t portnum)
+{
+	ipxServerSocket = SDLNet_UDP_Open(portnum);
+	if (!ipxServerSocket) {
+		return false;
+	}
+	socket_set = SDLNet_AllocSocketSet(1);
+	if (!socket_set || SDLNet_UDP_AddSocket(socket_set, ipxServerSocket) == -1) {
+		LOG_ERR("IPXSERVER: %s", SDLNet_GetError());
+		close_server_socket();
+		return false;
+	}
+	return true;
+}
+
+static void wake_server()
+{
+	// The server loop checks for being stopped at least every 100 ms
 }
 
-static void ackClient(IPaddress clientAddr) {
-	IPXHeader regHeader = {};
-	UDPpacket regPacket;
-
-	SDLNet_Write16(0xffff, regHeader.checkSum);
-	SDLNet_Write16(sizeof(regHeader), regHeader.length);
-
-	SDLNet_Write32(0, regHeader.dest.network);
-	PackIP(clientAddr, &regHeader.dest.addr.byIP);
-	SDLNet_Write16(0x2, regHeader.dest.socket);
-
-	SDLNet_Write32(1, regHeader.src.network);
-	PackIP(ipxServerIp, &regHeader.src.addr.byIP);
-	SDLNet_Write16(0x2, regHeader.src.socket);
-	regHeader.transControl = 0;
-
-	regPacket.data = (Uint8 *)&regHeader;
-	regPacket.len = sizeof(regHeader);
-	regPacket.maxlen = sizeof(regHeader);
-	regPacket.address = clientAddr;
-	// Send registration string to client.  If client doesn't get this, client will not be registered
-	const int result = SDLNet_UDP_Send(ipxServerSocket, UDP_UNICAST, &regPacket);
-	if (result == 0)
-		LOG_MSG("IPXSERVER: Connection response not sent: %s",
+static void send_packets(const std::vector<OutgoingPacket>& packets)
+{
+	size_t num_failed = 0;
+	for (const auto& packet : packets) {
+		UDPpacket outPacket = {};
+		outPacket.channel   = UDP_UNICAST;
+		outPacket.data      = const_cast<uint8_t*>(packet.data);
+		outPacket.len       = packet.size;
+		outPacket.maxlen    = packet.size;
+		outPacket.address   = packet.address;
+
+		if (SDLNet_UDP_Send(ipxServerSocket, UDP_UNICAST, &outPacket) == 0) {
+			++num_failed;
+		}
+	}
+
+	if (num_failed > 0) {
+		LOG_MSG("IPXSERVER: Failed sending %zu of %zu packets: %s",
+		        num_failed,
+		        packets.size(),
 		        SDLNet_GetError());
+	}
 }
 
-static void IPX_ServerLoop() {
-	UDPpacket inPacket;
-	IPaddress tmpAddr;
-
-	//char regString[] = "IPX Register\0";
-
-	uint32_t host;
-
-	inPacket.channel = -1;
-	inPacket.data = &inBuffer[0];
-	inPacket.maxlen = IPXBUFFERSIZE;
-
-	const int result = SDLNet_UDP_Recv(ipxServerSocket, &inPacket);
-	if (result != 0) {
-		// Check to see if incoming packet is a registration packet
-		// For this, I just spoofed the echo protocol packet designation 0x02
-		IPXHeader *tmpHeader;
-		tmpHeader = (IPXHeader *)&inBuffer[0];
-
-		// Check to see if echo packet
-		if(SDLNet_Read16(tmpHeader->dest.socket) == 0x2) {
-			// Null destination node means its a server registration packet
-			if(tmpHeader->dest.addr.byIP.host == 0x0) {
-				UnpackIP(tmpHeader->src.addr.byIP, &tmpAddr);
-				for (uint16_t i = 0; i < SOCKETTABLESIZE; ++i) {
-					if(!connBuffer[i].connected) {
-						// Use prefered host IP rather than the reported source IP
-						// It may be better to use the reported source
-						ipconn[i] = inPacket.address;
-
-						connBuffer[i].connected = true;
-						host = ipconn[i].host;
-						LOG_MSG("IPXSERVER: Connect from %d.%d.%d.%d", CONVIP(host));
-						ackClient(inPacket.address);
-						return;
-					} else {
-						if((ipconn[i].host == tmpAddr.host) && (ipconn[i].port == tmpAddr.port)) {
-
-							LOG_MSG("IPXSERVER: Reconnect from %d.%d.%d.%d", CONVIP(tmpAddr.host));
-							// Update anonymous port number if changed
-							ipconn[i].port = inPacket.address.port;
-							ackClient(inPacket.address);
-							return;
-						}
-					}
-				}
-			}
+static void server_loop()
+{
+	std::array<uint8_t, IPXBUFFERSIZE> buffer = {};
+	IPXHeader ack = {};
+
+	std::vector<OutgoingPacket> outgoing = {};
+
+	UDPpacket inPacket = {};
+	inPacket.channel   = -1;
+	inPacket.data      = buffer.data();
+	inPacket.maxlen    = IPXBUFFERSIZE;
+
+	while (ipx_server_running) {
+		const int num_ready = SDLNet_CheckSockets(socket_set, 100);
+		if (num_ready == -1) {
+			LOG_ERR("IPXSERVER: %s", SDLNet_GetError());
+			continue;
 		}
+		while (num_ready > 0 && ipx_server_running &&
+		       SDLNet_UDP_Recv(ipxServerSocket, &inPacket) > 0) {
+			outgoing.clear();
+			route_packet(inPacket.address,
+			             inPacket.data,
+			             static_cast<uint16_t>(inPacket.len),
+			             ack,
+			             outgoing);
+			send_packets(outgoing);
+		}
+	}
+}
+
+#endif
 
-		// IPX packet is complete.  Now interpret IPX header and send to respective IP address
-		sendIPXPacket((uint8_t*)inPacket.data,
-		              static_cast<int16_t>(inPacket.len));
+std::vector<IpxServerClient> IPX_GetServerClients()
+{
+	std::lock_guard<std::mutex> lock(clients_mutex);
+
+	std::vector<IpxServerClient> result = {};
+	result.reserve(clients.size());
+	for (const auto& [key, client] : clients) {
+		result.push_back(client);
 	}
+	return result;
 }
 
 void IPX_StopServer() {
+	if (!ipx_server_running) {
+		return;
+	}
 	ipx_server_running = false;
+	wake_server();
 
 	if (ipx_server_thread.joinable()) {
 		ipx_server_thread.join();
 	}
+	close_server_socket();
 
-	SDLNet_FreeSocketSet(socket_set);
-	SDLNet_UDP_Close(ipxServerSocket);
-	socket_set = nullptr;
+	log_client_stats();
+	std::lock_guard<std::mutex> lock(clients_mutex);
+	clients.clear();
 }
 
 bool IPX_StartServer(uint16_t portnum)
 {
-	if (!SDLNet_ResolveHost(&ipxServerIp, nullptr, portnum)) {
-		//serverSocketSet = SDLNet_AllocSocketSet(SOCKETTABLESIZE);
-		ipxServerSocket = SDLNet_UDP_Open(portnum);
-		if(!ipxServerSocket) return false;
+	if (ipx_server_running) {
+		return false;
+	}
+	if (SDLNet_ResolveHost(&ipxServerIp, nullptr, portnum) != 0) {
+		return false;
+	}
+	if (!open_server_socket(portnum)) {
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> lock(clients_mutex);
+		clients.clear();
+	}
+
+	ipx_server_running = true;
+	ipx_server_thread  = std::thread(server_loop);
+	return true;
+}
+
+static std::atomic_bool standalone_stop_requested = false;
+
+static void request_standalone_stop(int /*signal*/)
+{
+	standalone_stop_requested = true;
+}
 
-		for (auto& i : connBuffer) {
-			i.connected = false;
-		}
+int IPX_RunStandaloneServer(const int portnum)
+{
+	if (portnum <= 0 || portnum > UINT16_MAX) {
+		LOG_ERR("IPXSERVER: Invalid port number %d", portnum);
+		return 1;
+	}
+	if (!NetWrapper_InitializeSDLNet()) {
+		return 1;
+	}
+	if (!IPX_StartServer(static_cast<uint16_t>(portnum))) {
+		LOG_ERR("IPXSERVER: Failed to start the server on UDP port %d", portnum);
+		return 1;
+	}
+	LOG_MSG("IPXSERVER: Listening on UDP port %d, press Ctrl+C to stop",
+	        portnum);
 
-		if (!socket_set) {
-			socket_set = SDLNet_AllocSocketSet(1);
-			if (!socket_set) {
-				LOG_ERR("IPXSERVER: %s", SDLNet_GetError());
-				return false;
-			}
-			if (SDLNet_UDP_AddSocket(socket_set, ipxServerSocket) == -1) {
-				LOG_ERR("IPXSERVER: %s", SDLNet_GetError());
-				return false;
-			}
-		}
+	std::signal(SIGINT, request_standalone_stop);
+	std::signal(SIGTERM, request_standalone_stop);
 
-		if (!ipx_server_running) {
-			ipx_server_running = true;
-			ipx_server_thread  = std::thread([]() {
-                                while (ipx_server_running) {
-                                        const int num_ready = SDLNet_CheckSockets(
-                                                socket_set, 100);
-                                        if (num_ready == -1) {
-                                                LOG_ERR("IPXSERVER: %s",
-                                                        SDLNet_GetError());
-                                                continue;
-                                        }
-                                        if (num_ready > 0) {
-                                                IPX_ServerLoop();
-                                        }
-                                }
-                        });
-		}
-		return true;
+	while (!standalone_stop_requested) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
 	}
-	return false;
+
+	LOG_MSG("IPXSERVER: Stopping");
+	IPX_StopServer();
+	return 0;
 }
 
 #endif
@@ -19,13 +19,16 @@
 
 #include "mem.h"
 
+#include <algorithm>
 #include <cstring>
 
+#include "cpu.h"
 #include "inout.h"
 #include "paging.h"
 #include "pci_bus.h"
 #include "regs.h"
 #include "setup.h"
+#include "snapshot.h"
 #include "support.h"
 
 constexpr auto Megabyte = 1024 * 1024;
@@ -210,18 +213,86 @@ void mem_memcpy(PhysPt dest,PhysPt src,Bitu size) {
 	while (size--) mem_writeb_inline(dest++,mem_readb_inline(src++));
 }
 
+// The block functions work a page at a time. Pages mapped to host memory
+// are copied directly, pages with block access handlers go through these,
+// and everything else goes byte by byte through the regular accessors, which
+// also takes care of filling the TLB.
+static size_t bytes_to_page_end(const PhysPt pt, const size_t size)
+{
+	return std::min<size_t>(size, MEM_PAGE_SIZE - (pt & (MEM_PAGE_SIZE - 1)));
+}
+
 void MEM_BlockRead(PhysPt pt,void * data,Bitu size) {
 	uint8_t * write=reinterpret_cast<uint8_t *>(data);
-	while (size--) {
-		*write++=mem_readb_inline(pt++);
+	while (size > 0) {
+		const auto chunk = bytes_to_page_end(pt, size);
+#if !(C_DEBUG && C_HEAVY_DEBUG)
+		// The memory read breakpoints need to see every byte
+		const auto host_page = get_tlb_read(pt);
+		if (host_page) {
+			memcpy(write, host_page + pt, chunk);
+		} else if (auto handler = get_tlb_readhandler(pt);
+		           handler->flags & PFLAG_BLOCKACCESS) {
+			handler->readblock(pt, write, chunk, 1);
+		} else
+#endif
+		{
+			*write = mem_readb_inline(pt);
+			pt += 1;
+			write += 1;
+			size -= 1;
+			continue;
+		}
+		pt += static_cast<PhysPt>(chunk);
+		write += chunk;
+		size -= chunk;
 	}
 }
 
 void MEM_BlockWrite(PhysPt pt, const void *data, size_t size)
 {
 	const uint8_t *read = static_cast<const uint8_t *>(data);
-	while (size--) {
-		mem_writeb_inline(pt++,*read++);
+	while (size > 0) {
+		const auto chunk = bytes_to_page_end(pt, size);
+
+		const auto host_page = get_tlb_write(pt);
+		if (host_page) {
+			memcpy(host_page + pt, read, chunk);
+		} else if (auto handler = get_tlb_writehandler(pt);
+		           handler->flags & PFLAG_BLOCKACCESS) {
+			handler->writeblock(pt, read, chunk, 1);
+		} else {
+			mem_writeb_inline(pt, *read);
+			pt += 1;
+			read += 1;
+			size -= 1;
+			continue;
+		}
+		pt += static_cast<PhysPt>(chunk);
+		read += chunk;
+		size -= chunk;
+	}
+}
+
+void MEM_BlockFill(PhysPt pt, const uint8_t val, size_t size)
+{
+	while (size > 0) {
+		const auto chunk = bytes_to_page_end(pt, size);
+
+		const auto host_page = get_tlb_write(pt);
+		if (host_page) {
+			memset(host_page + pt, val, chunk);
+		} else if (auto handler = get_tlb_writehandler(pt);
+		           handler->flags & PFLAG_BLOCKACCESS) {
+			handler->fillblock(pt, val, chunk, 1);
+		} else {
+			mem_writeb_inline(pt, val);
+			pt += 1;
+			size -= 1;
+			continue;
+		}
+		pt += static_cast<PhysPt>(chunk);
+		size -= chunk;
 	}
 }
 
@@ -783,6 +854,47 @@ public:
 
 static MEMORY* test;
 
+static void memory_save_snapshot(SnapshotWriter& writer)
+{
+	writer.Write(check_cast<uint32_t>(memory.pages.size()));
+	writer.WriteBytes(memory.pages.data(),
+	                  memory.pages.size() * sizeof(MemoryBlock::page_t));
+	writer.WriteBytes(memory.mhandles.data(),
+	                  memory.mhandles.size() * sizeof(MemHandle));
+
+	writer.Write(memory.a20.enabled);
+	writer.Write(memory.a20.controlport);
+}
+
+static void memory_load_snapshot(SnapshotReader& reader)
+{
+	// The memory size is part of the configuration, which has already
+	// been checked to match
+	const auto num_pages = reader.Read<uint32_t>();
+	if (num_pages != memory.pages.size()) {
+		E_Exit("MEMORY: Snapshot has %u pages but %u are present",
+		       num_pages,
+		       static_cast<uint32_t>(memory.pages.size()));
+	}
+
+	// The pages are overwritten without going through the page handlers,
+	// so any code translated from them is stale
+	CPU_ResetCodeCache();
+
+	reader.ReadBytes(memory.pages.data(),
+	                 memory.pages.size() * sizeof(MemoryBlock::page_t));
+	reader.ReadBytes(memory.mhandles.data(),
+	                 memory.mhandles.size() * sizeof(MemHandle));
+
+	// The paging state was rebuilt before us, so always remap the A20
+	// pages rather than relying on the current state
+	const auto a20_enabled = reader.Read<bool>();
+	memory.a20.enabled     = !a20_enabled;
+	MEM_A20_Enable(a20_enabled);
+
+	reader.Read(memory.a20.controlport);
+}
+
 static void MEM_ShutDown([[maybe_unused]] Section *sec)
 {
 	delete test;
@@ -795,4 +907,6 @@ void MEM_Init(Section* sec)
 	/* shutdown function */
 	test = new MEMORY(sec);
 	sec->AddDestroyFunction(&MEM_ShutDown);
+
+	SNAPSHOT_AddComponent("memory", memory_save_snapshot, memory_load_snapshot);
 }
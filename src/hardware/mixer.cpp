@@ -27,6 +27,7 @@
 #include <cstdint>
 #include <cstring>
 #include <optional>
+#include <set>
 #include <sys/types.h>
 
 #include <SDL.h>
@@ -46,6 +47,7 @@
 #include "ring_buffer.h"
 #include "rwqueue.h"
 #include "setup.h"
+#include "snapshot.h"
 #include "string_utils.h"
 #include "timer.h"
 #include "tracy.h"
@@ -1117,6 +1119,18 @@ const std::string& MixerChannel::GetName() const
 	return name;
 }
 
+// Name of the profiler plot of the queue of a device feeding this channel
+// through MIXER_PullFromQueueCallback. The profiler keeps using the pointer
+// after the channel is gone, so the names are kept for the whole run.
+const char* MixerChannel::GetQueuePlotName()
+{
+	if (!queue_plot_name) {
+		static std::set<std::string> plot_names = {};
+		queue_plot_name = plot_names.emplace(name + " queue").first->c_str();
+	}
+	return queue_plot_name;
+}
+
 int MixerChannel::GetSampleRate() const
 {
 	return sample_rate_hz;
@@ -1168,6 +1182,9 @@ void MixerChannel::Mix(const int frames_requested)
 		return;
 	}
 
+	ZoneScoped;
+	ZoneText(name.c_str(), name.size());
+
 	frames_needed = frames_requested;
 
 	while (frames_needed > audio_frames.size()) {
@@ -2293,6 +2310,8 @@ static void mix_samples(const int frames_requested)
 {
 	assert(frames_requested > 0);
 
+	ZoneScoped;
+
 	mixer.output_buffer.clear();
 	mixer.output_buffer.resize(frames_requested);
 
@@ -2393,7 +2412,8 @@ static void mix_samples(const int frames_requested)
 	}
 
 	// Capture audio output if requested
-	if (CAPTURE_IsCapturingAudio() || CAPTURE_IsCapturingVideo()) {
+	if (CAPTURE_IsCapturingAudio() || CAPTURE_IsCapturingVideo() ||
+	    CAPTURE_IsStreaming()) {
 		mixer.capture_buffer.clear();
 		mixer.capture_buffer.reserve(mixer.output_buffer.size() * 2);
 
@@ -2434,10 +2454,16 @@ static void mix_samples(const int frames_requested)
 	}
 }
 
+void MIXER_MixBlock(const int frames_requested)
+{
+	mix_samples(frames_requested);
+}
+
 // Run in the main thread by a PIC Callback
 static void capture_callback()
 {
-	if (!(CAPTURE_IsCapturingAudio() || CAPTURE_IsCapturingVideo())) {
+	if (!(CAPTURE_IsCapturingAudio() || CAPTURE_IsCapturingVideo() ||
+	      CAPTURE_IsStreaming())) {
 		return;
 	}
 
@@ -2490,6 +2516,8 @@ static void SDLCALL mixer_callback([[maybe_unused]] void* userdata,
 	// the rest of the request is silence.
 	const auto frames_to_dequeue = std::min(mixer.final_output.Size(),
 	                                        frames_requested);
+	TracyPlot("Mixer output queue",
+	          static_cast<int64_t>(mixer.final_output.Size()));
 
 	const auto frame_stream = reinterpret_cast<AudioFrame*>(stream);
 
@@ -2514,6 +2542,20 @@ static void mixer_thread_loop()
 		const double expected_time = (static_cast<double>(mixer.blocksize) /
 		                              static_cast<double>(mixer.sample_rate_hz)) *
 		                             1000.0;
+
+		// Without an audio device, there's nothing to pace the mixer
+		// to when the emulation isn't running in real-time (e.g., when
+		// fast-forwarding or in headless mode). So we wait for a
+		// blocksize worth of emulated time instead, which keeps the
+		// mixed audio and captures in step with the emulation.
+		if (mixer.state == MixerState::NoSound && mixer.fast_forward_mode &&
+		    actual_time >= 0.0 && actual_time < expected_time) {
+			lock.unlock();
+
+			constexpr auto PollInterval = std::chrono::microseconds(500);
+			std::this_thread::sleep_for(PollInterval);
+			continue;
+		}
 		last_mixed = now;
 
 		// "Underflow" is not a concern since moving to a threaded
@@ -2539,6 +2581,12 @@ static void mixer_thread_loop()
 		lock.unlock();
 
 		if (mixer.state == MixerState::NoSound) {
+			// The emulated time is what paces us when
+			// fast-forwarding, see above
+			if (mixer.fast_forward_mode) {
+				continue;
+			}
+
 			// SDL callback is not running. Mixed sound gets
 			// discarded. Sleep for the expected duration to
 			// simulate the time it would have taken to playback the
@@ -2795,6 +2843,25 @@ static void init_master_highpass_filter()
 	MIXER_UnlockMixerThread();
 }
 
+// The sound devices aren't part of snapshots, so saving waits until the
+// channels that can sleep have gone quiet and nothing is lost by leaving
+// them out
+static std::optional<std::string> check_channels_asleep()
+{
+	std::vector<std::string> awake_channels = {};
+	for (const auto& [name, channel] : mixer.channels) {
+		if (channel->do_sleep && channel->is_enabled) {
+			awake_channels.push_back(name);
+		}
+	}
+	if (awake_channels.empty()) {
+		return {};
+	}
+	return format_str("the %s audio %s playing",
+	                  join_with_commas(awake_channels, "and", "").c_str(),
+	                  awake_channels.size() == 1 ? "channel is" : "channels are");
+}
+
 void MIXER_Init(Section* sec)
 {
 	Section_prop* secprop = static_cast<Section_prop*>(sec);
@@ -2806,7 +2873,10 @@ void MIXER_Init(Section* sec)
 		// Initialize the 8-bit to 16-bit lookup table
 		fill_8to16_lut();
 
-		const auto mixer_state = secprop->Get_bool("nosound")
+		// Headless mode has a null audio sink that consumes audio at
+		// the emulated rate
+		const auto mixer_state = (secprop->Get_bool("nosound") ||
+		                          control->arguments.headless)
 		                               ? MixerState::NoSound
 		                               : MixerState::On;
 
@@ -2855,6 +2925,8 @@ void MIXER_Init(Section* sec)
 		set_thread_name(mixer.thread, "dosbox:mixer");
 
 		TIMER_AddTickHandler(capture_callback);
+
+		SNAPSHOT_AddSaveCheck(check_channels_asleep);
 	}
 
 	// Initialise crossfeed
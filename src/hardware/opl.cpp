@@ -33,6 +33,7 @@
 #include "mem.h"
 #include "opl_capture.h"
 #include "setup.h"
+#include "snapshot.h"
 #include "string_utils.h"
 #include "support.h"
 
@@ -42,6 +43,18 @@ constexpr auto OplSampleRateHz = 49716;
 
 static std::unique_ptr<Opl> opl = {};
 
+// The chip's registers aren't part of snapshots, so saving is refused once a
+// program has written to them and the chip has left its power-on state
+static bool has_register_writes = false;
+
+static std::optional<std::string> check_opl_unused()
+{
+	if (opl && has_register_writes) {
+		return "the OPL synth is in use";
+	}
+	return {};
+}
+
 static const char* to_string(const OplMode opl_mode)
 {
 	// clang-format off
@@ -315,13 +328,36 @@ void Opl::WriteReg(const io_port_t selected_reg, const uint8_t val)
 
 
 	} else { // OPL
-		OPL3_WriteRegBuffered(&opl.chip, selected_reg, val);
+		LogWrite(OplWrite::Target::Synth, selected_reg, val);
 		if (selected_reg == 0x105) {
 			opl.newm = selected_reg & 0x01;
 		}
 	}
 }
 
+void Opl::LogWrite(const OplWrite::Target target, const uint16_t reg,
+                   const uint8_t val)
+{
+	std::lock_guard lock(write_log_mutex);
+	write_log.push_back({PIC_FullIndex(), reg, val, target});
+}
+
+void Opl::ApplyWrite(const OplWrite& write)
+{
+	switch (write.target) {
+	case OplWrite::Target::Synth:
+		OPL3_WriteRegBuffered(&opl.chip, write.reg, write.val);
+		break;
+	case OplWrite::Target::GoldStereo:
+		adlib_gold->StereoControlWrite(
+		        static_cast<StereoProcessorControlReg>(write.reg), write.val);
+		break;
+	case OplWrite::Target::GoldSurround:
+		adlib_gold->SurroundControlWrite(write.val);
+		break;
+	}
+}
+
 io_port_t Opl::WriteAddr(const io_port_t port, const uint8_t val)
 {
 	if (opl.mode == OplMode::Esfm) {
@@ -441,8 +477,61 @@ void Opl::RenderUpToNow()
 	}
 }
 
+// Renders the requested frames, applying the logged writes at the frames
+// matching their timestamps. The frames follow on from the time of the
+// previous callback; the writes up to the current time are all applied by
+// the last frame at the latest.
+void Opl::RenderLoggedWrites(const int requested_frames)
+{
+	assert(channel);
+	assert(requested_frames > 0);
+
+	const auto now = PIC_FullIndex();
+
+	// Take over the logged writes
+	{
+		std::lock_guard lock(write_log_mutex);
+		std::swap(write_log, received_writes);
+	}
+	pending_writes.insert(pending_writes.end(),
+	                      received_writes.begin(),
+	                      received_writes.end());
+	received_writes.clear();
+
+	// After a quiet period, such as when the channel was asleep, the
+	// frames start from the first write instead
+	const auto span_ms = requested_frames * ms_per_frame;
+	if (!pending_writes.empty() &&
+	    pending_writes.front().timestamp_ms > last_rendered_ms + span_ms) {
+		last_rendered_ms = pending_writes.front().timestamp_ms;
+	}
+
+	for (auto i = 0; i < requested_frames; ++i) {
+		const auto is_last_frame = (i == requested_frames - 1);
+		const auto frame_end_ms  = last_rendered_ms + (i + 1) * ms_per_frame;
+
+		while (!pending_writes.empty()) {
+			const auto timestamp_ms = pending_writes.front().timestamp_ms;
+			if (timestamp_ms > now ||
+			    (timestamp_ms >= frame_end_ms && !is_last_frame)) {
+				break;
+			}
+			ApplyWrite(pending_writes.front());
+			pending_writes.pop_front();
+		}
+		const auto frame = RenderFrame();
+		channel->AddSamples_sfloat(1, &frame[0]);
+	}
+	last_rendered_ms = now;
+}
+
 void Opl::AudioCallback(const int requested_frames)
 {
+	if (opl.mode != OplMode::Esfm) {
+		RenderLoggedWrites(requested_frames);
+		return;
+	}
+
 	std::lock_guard lock(mutex);
 	assert(channel);
 #if 0
@@ -511,26 +600,28 @@ void Opl::DualWrite(const uint8_t index, const uint8_t port, const uint8_t value
 
 void Opl::AdlibGoldControlWrite(const uint8_t val)
 {
+	// The processors are applied along with the synth writes
+	auto write_stereo_control = [&](const StereoProcessorControlReg reg) {
+		LogWrite(OplWrite::Target::GoldStereo, static_cast<uint16_t>(reg), val);
+	};
+
 	switch (ctrl.index) {
 	case 0x04:
-		adlib_gold->StereoControlWrite(StereoProcessorControlReg::VolumeLeft,
-		                               val);
+		write_stereo_control(StereoProcessorControlReg::VolumeLeft);
 		break;
 	case 0x05:
-		adlib_gold->StereoControlWrite(StereoProcessorControlReg::VolumeRight,
-		                               val);
+		write_stereo_control(StereoProcessorControlReg::VolumeRight);
 		break;
 	case 0x06:
-		adlib_gold->StereoControlWrite(StereoProcessorControlReg::Bass, val);
+		write_stereo_control(StereoProcessorControlReg::Bass);
 		break;
 
 	case 0x07:
-		adlib_gold->StereoControlWrite(StereoProcessorControlReg::Treble, val);
+		write_stereo_control(StereoProcessorControlReg::Treble);
 		break;
 
 	case 0x08:
-		adlib_gold->StereoControlWrite(StereoProcessorControlReg::SwitchFunctions,
-		                               val);
+		write_stereo_control(StereoProcessorControlReg::SwitchFunctions);
 		break;
 
 	case 0x09: // Left FM Volume
@@ -551,7 +642,7 @@ void Opl::AdlibGoldControlWrite(const uint8_t val)
 		break;
 
 	case 0x18: // Surround
-		adlib_gold->SurroundControlWrite(val);
+		LogWrite(OplWrite::Target::GoldSurround, 0, val);
 	}
 }
 
@@ -579,11 +670,23 @@ uint8_t Opl::AdlibGoldControlRead()
 
 void Opl::PortWrite(const io_port_t port, const io_val_t value, const io_width_t)
 {
-	std::lock_guard lock(mutex);
-	RenderUpToNow();
+	// ESFM's native mode address latch and registers are read back from the
+	// chip, so it's rendered up to now before every write. The OPL modes
+	// only log their writes, with the timers and register state the
+	// emulation thread needs kept outside the chip.
+	std::unique_lock lock(mutex, std::defer_lock);
+	if (opl.mode == OplMode::Esfm) {
+		lock.lock();
+		RenderUpToNow();
+	} else {
+		assert(channel);
+		channel->WakeUp();
+	}
 
 	const auto val = check_cast<uint8_t>(value);
 
+	has_register_writes = true;
+
 	if (opl.mode == OplMode::Esfm && esfm.mode == EsfmMode::Native) {
 		switch (port & 3) {
 		case 0:
@@ -1022,6 +1125,9 @@ void OPL_Init(Section* sec, const OplMode oplmode)
 {
 	assert(sec);
 	opl = std::make_unique<Opl>(sec, oplmode);
+	has_register_writes = false;
+
+	SNAPSHOT_AddSaveCheck(check_opl_unused);
 
 	constexpr auto changeable_at_runtime = true;
 	sec->AddDestroyFunction(&OPL_ShutDown, changeable_at_runtime);
@@ -22,8 +22,11 @@
 #include "dosbox.h"
 
 #include <cmath>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <queue>
+#include <vector>
 
 #include "adlib_gold.h"
 #include "hardware.h"
@@ -89,6 +92,18 @@ public:
 	uint8_t EsfmReadbackReg(const uint16_t reg);
 };
 
+// A write to the synthesiser or the AdLib Gold processors, logged by the
+// emulation thread and applied by the mixer callback at the frame matching
+// its timestamp
+struct OplWrite {
+	enum class Target : uint8_t { Synth, GoldStereo, GoldSurround };
+
+	double timestamp_ms = 0.0;
+	uint16_t reg        = 0;
+	uint8_t val         = 0;
+	Target target       = Target::Synth;
+};
+
 // The cache for two OPL chips (Dual OPL2) or an OPL3 (stereo)
 typedef uint8_t OplRegisterCache[512];
 
@@ -118,9 +133,17 @@ private:
 	IO_ReadHandleObject ReadHandler[3];
 	IO_WriteHandleObject WriteHandler[3];
 
+	// Only used by ESFM, which is still rendered on the emulation thread
 	std::queue<AudioFrame> fifo = {};
 	std::mutex mutex = {};
 
+	// The OPL modes log their writes instead, for the mixer callback to
+	// apply at the right frames
+	std::vector<OplWrite> write_log       = {};
+	std::mutex write_log_mutex            = {};
+	std::vector<OplWrite> received_writes = {};
+	std::deque<OplWrite> pending_writes   = {};
+
 	OplChip chip[2]  = {};
 
 	struct {
@@ -161,9 +184,14 @@ private:
 	void Init();
 
 	void AudioCallback(const int frames);
+	void RenderLoggedWrites(const int requested_frames);
 	AudioFrame RenderFrame();
 	void RenderUpToNow();
 
+	void LogWrite(const OplWrite::Target target, const uint16_t reg,
+	              const uint8_t val);
+	void ApplyWrite(const OplWrite& write);
+
 	void PortWrite(const io_port_t port, const io_val_t value,
 	               const io_width_t width);
 
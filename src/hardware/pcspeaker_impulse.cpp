@@ -25,6 +25,10 @@
 
 #include "pcspeaker_impulse.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "checks.h"
 #include "math_utils.h"
 
@@ -391,6 +395,23 @@ float PcSpeakerImpulse::CalcImpulse(const double t) const
 		return 0.0f;
 }
 
+// Adds the amplitude-scaled taps onto the destination samples
+static void accumulate_taps(float* dest, const float* taps, const int num_taps,
+                            const float amplitude)
+{
+	auto i = 0;
+#if defined(__SSE2__)
+	const auto amplitude_x4 = _mm_set1_ps(amplitude);
+	for (; i + 4 <= num_taps; i += 4) {
+		const auto product = _mm_mul_ps(amplitude_x4, _mm_loadu_ps(taps + i));
+		_mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), product));
+	}
+#endif
+	for (; i < num_taps; ++i) {
+		dest[i] += amplitude * taps[i];
+	}
+}
+
 void PcSpeakerImpulse::AddImpulse(float index, const int16_t amplitude)
 {
 	if (channel->WakeUp())
@@ -414,23 +435,32 @@ void PcSpeakerImpulse::AddImpulse(float index, const int16_t amplitude)
 		offset++;
 		phase = sinc_oversampling_factor - phase;
 	}
-
-	for (auto i = 0; i < sinc_filter_quality; ++i) {
-		const auto wave_i    = check_cast<uint16_t>(offset + i);
-		const auto impulse_i = check_cast<uint16_t>(
-		        phase + i * sinc_oversampling_factor);
-		waveform_deque.at(wave_i) += amplitude * impulse_lut.at(impulse_i);
-	}
+	assert(offset + sinc_filter_quality <= waveform_size);
+
+	const auto& taps  = impulse_lut[check_cast<size_t>(phase)];
+	const auto gain   = static_cast<float>(amplitude);
+	const auto start  = (waveform_head + offset) & waveform_ring_mask;
+
+	// The taps are split in two contiguous runs where they wrap around
+	// the end of the ring
+	const auto first_run = std::min(sinc_filter_quality,
+	                                waveform_ring_size - start);
+	accumulate_taps(&waveform[check_cast<size_t>(start)], taps.data(), first_run, gain);
+	accumulate_taps(waveform.data(),
+	                taps.data() + first_run,
+	                sinc_filter_quality - first_run,
+	                gain);
 }
 
 #else
 	// Mathematically intensive reference implementation
 	const auto portion_of_ms = static_cast <double>(index) / MillisInSecond;
-	for (size_t i = 0; i < waveform_deque.size(); ++i) {
+	for (auto i = 0; i < waveform_size; ++i) {
 		const auto impulse_time = static_cast<double>(i) / sample_rate_hz -
 		                          portion_of_ms;
 
-		waveform_deque[i] += amplitude * CalcImpulse(impulse_time);
+		const auto wave_i = (waveform_head + i) & waveform_ring_mask;
+		waveform[check_cast<size_t>(wave_i)] += amplitude * CalcImpulse(impulse_time);
 	}
 }
 #endif
@@ -442,11 +472,13 @@ void PcSpeakerImpulse::PicCallback(const int requested_frames)
 	int remaining_frames = requested_frames;
 
 	static float accumulator = 0;
-	while (remaining_frames > 0 && waveform_deque.size()) {
-		// Pop the first sample off the waveform
-		accumulator += waveform_deque.front();
-		waveform_deque.pop_front();
-		waveform_deque.push_back(0.0f);
+	while (remaining_frames > 0) {
+		// Take the first sample off the waveform and clear its slot for
+		// reuse at the far end of the ring
+		auto& sample = waveform[check_cast<size_t>(waveform_head)];
+		accumulator += sample;
+		sample = 0.0f;
+		waveform_head = (waveform_head + 1) & waveform_ring_mask;
 
 		// std::move only used here because it won't compile without
 		// This is just a float so it's safe to use afterwards
@@ -462,25 +494,23 @@ void PcSpeakerImpulse::PicCallback(const int requested_frames)
 		// hit 0 if no other waveforms are generated.
 		accumulator *= sinc_amplitude_fade;
 	}
-
-	// Write silence if the waveform deque ran out
-	if (remaining_frames)
-		pit.prev_amplitude = neutral_amplitude;
-
-	while (remaining_frames) {
-		output_queue.NonblockingEnqueue(neutral_amplitude);
-		++tally_of_silence;
-		--remaining_frames;
-	}
 }
 
 void PcSpeakerImpulse::InitializeImpulseLUT()
 {
-	assert(impulse_lut.size() == sinc_filter_width);
-
-	for (auto i = 0u; i < sinc_filter_width; ++i) {
-		impulse_lut[i] = CalcImpulse(i / (static_cast<double>(sample_rate_hz) *
-		                                  sinc_oversampling_factor));
+	static_assert(sinc_oversampling_factor * sinc_filter_quality ==
+	              sinc_filter_width);
+
+	// Tap 'i' of a given phase is at 'phase + i * sinc_oversampling_factor'
+	// in the oversampled impulse
+	for (auto phase = 0; phase < sinc_oversampling_factor; ++phase) {
+		auto& taps = impulse_lut[check_cast<size_t>(phase)];
+		for (auto i = 0; i < sinc_filter_quality; ++i) {
+			const auto n = phase + i * sinc_oversampling_factor;
+			taps[check_cast<size_t>(i)] = CalcImpulse(
+			        n / (static_cast<double>(sample_rate_hz) *
+			             sinc_oversampling_factor));
+		}
 	}
 }
 
@@ -527,10 +557,6 @@ PcSpeakerImpulse::PcSpeakerImpulse()
 
 	InitializeImpulseLUT();
 
-	// Size the waveform queue
-	constexpr auto waveform_size = sinc_filter_quality + sample_rate_per_ms;
-	waveform_deque.resize(waveform_size, 0.0f);
-
 	// Register the sound channel
 	constexpr bool Stereo = false;
 	constexpr bool SignedData = true;
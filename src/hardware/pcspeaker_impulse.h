@@ -21,7 +21,6 @@
 #include "pcspeaker.h"
 
 #include <array>
-#include <deque>
 #include <string>
 
 #include "channel_names.h"
@@ -87,6 +86,15 @@ private:
 
 	static constexpr float max_possible_pit_ms = 1320000.0f / PIT_TICK_RATE;
 
+	// An impulse starting anywhere within the current millisecond must fit
+	// in the waveform. The ring is sized to the next power of two so the
+	// read position wraps with a mask.
+	static constexpr auto waveform_size = sinc_filter_quality + sample_rate_per_ms;
+	static constexpr auto waveform_ring_size = 256;
+	static constexpr auto waveform_ring_mask = waveform_ring_size - 1;
+	static_assert(waveform_size <= waveform_ring_size);
+	static_assert((waveform_ring_size & waveform_ring_mask) == 0);
+
 	// Compound types and containers
 	struct PitState {
 		// PIT starts in mode 3 (SquareWave) at ~903 Hz (pit_max) with
@@ -110,9 +118,14 @@ private:
 		int16_t prev_amplitude = negative_amplitude;
 	} pit = {};
 
-	std::deque<float> waveform_deque = {};
+	// Circular buffer of upcoming output samples, read from waveform_head
+	std::array<float, waveform_ring_size> waveform = {};
+	int waveform_head = 0;
 
-	std::array<float, sinc_filter_width> impulse_lut = {};
+	// Polyphase layout: each oversampling phase holds its taps contiguously,
+	// so adding an impulse is a straight multiply-accumulate over memory.
+	using impulse_taps_t = std::array<float, sinc_filter_quality>;
+	std::array<impulse_taps_t, sinc_oversampling_factor> impulse_lut = {};
 
 	PpiPortB prev_port_b = {};
 
@@ -23,8 +23,14 @@
 #include "pic.h"
 #include "timer.h"
 #include "setup.h"
+#include "snapshot.h"
+#include "support.h"
+#include "tracy.h"
 
+#include <algorithm>
+#include <cstring>
 #include <mutex>
+#include <vector>
 
 // PIC Controllers
 // ~~~~~~~~~~~~~~~
@@ -197,6 +203,9 @@ struct PICEntry {
 	double index;
 	Bitu value;
 	PIC_EventHandler pic_event;
+#if C_TRACY
+	const char* name;
+#endif
 	PICEntry * next;
 };
 
@@ -468,7 +477,12 @@ static void AddEntry(PICEntry * entry) {
 static bool InEventService = false;
 static double srv_lag = 0.0;
 
+#if C_TRACY
+void PIC_AddNamedEvent(const char* name, PIC_EventHandler handler,
+                       double delay, uint32_t val)
+#else
 void PIC_AddEvent(PIC_EventHandler handler, double delay, uint32_t val)
+#endif
 {
 	if (!pic_queue.free_entry) {
 		LOG(LOG_PIC,LOG_ERROR)("Event queue full");
@@ -480,6 +494,9 @@ void PIC_AddEvent(PIC_EventHandler handler, double delay, uint32_t val)
 
 	entry->pic_event=handler;
 	entry->value=val;
+#if C_TRACY
+	entry->name = name;
+#endif
 	pic_queue.free_entry=pic_queue.free_entry->next;
 	AddEntry(entry);
 }
@@ -554,7 +571,11 @@ bool PIC_RunQueue(void) {
 		pic_queue.next_entry = entry->next;
 
 		srv_lag = entry->index;
-		(entry->pic_event)(entry->value); // call the event handler
+		{
+			ZoneScopedN("PIC event");
+			ZoneName(entry->name, strlen(entry->name));
+			(entry->pic_event)(entry->value); // call the event handler
+		}
 
 		/* Put the entry in the free list */
 		entry->next=pic_queue.free_entry;
@@ -616,6 +637,7 @@ void TIMER_AddTick(void) {
 	CPU_CycleLeft = CPU_CycleMax.load();
 	CPU_Cycles = 0;
 	PIC_Ticks++;
+	TracyPlot("Cycles per tick", static_cast<int64_t>(CPU_CycleLeft));
 	/* Go through the list of scheduled events and lower their index with 1000 */
 	PICEntry * entry=pic_queue.next_entry;
 	while (entry) {
@@ -696,6 +718,115 @@ public:
 	}
 };
 
+// Only the events of modules that are part of snapshots are saved and
+// restored. The other devices start in their power-on state when loading, so
+// they keep the events they've armed themselves in the current session.
+static std::vector<PIC_EventHandler> snapshot_event_handlers = {};
+
+void PIC_AddSnapshotEventHandler(const PIC_EventHandler handler)
+{
+	if (!contains(snapshot_event_handlers, handler)) {
+		snapshot_event_handlers.push_back(handler);
+	}
+}
+
+static bool is_snapshot_event(const PICEntry& entry)
+{
+	return contains(snapshot_event_handlers, entry.pic_event);
+}
+
+static void pic_save_snapshot(SnapshotWriter& writer)
+{
+	{
+		std::lock_guard lock(pic_mutex);
+		writer.Write(pics);
+	}
+	writer.Write(PIC_Ticks.load());
+	writer.Write(PIC_IRQCheck.load());
+
+	uint32_t num_events = 0;
+	for (auto entry = pic_queue.next_entry; entry; entry = entry->next) {
+		if (is_snapshot_event(*entry)) {
+			++num_events;
+		}
+	}
+	writer.Write(num_events);
+
+	for (auto entry = pic_queue.next_entry; entry; entry = entry->next) {
+		if (is_snapshot_event(*entry)) {
+			writer.Write(entry->index);
+			writer.Write(entry->value);
+			writer.WriteCodePointer(entry->pic_event);
+		}
+	}
+}
+
+static void pic_load_snapshot(SnapshotReader& reader)
+{
+	{
+		std::lock_guard lock(pic_mutex);
+		reader.Read(pics);
+	}
+	PIC_Ticks    = reader.Read<uint32_t>();
+	PIC_IRQCheck = reader.Read<uint32_t>();
+
+	const auto num_events = reader.Read<uint32_t>();
+	if (num_events > PIC_QUEUESIZE) {
+		E_Exit("PIC: Snapshot has %u events, more than the queue holds",
+		       num_events);
+	}
+
+	// The indexes are relative to the start of the current tick, so the
+	// events kept from this session line up with the restored ones
+	std::vector<PICEntry> events = {};
+	for (auto entry = pic_queue.next_entry; entry; entry = entry->next) {
+		if (!is_snapshot_event(*entry)) {
+			events.push_back(*entry);
+		}
+	}
+
+	for (uint32_t i = 0; i < num_events; ++i) {
+		PICEntry entry = {};
+		reader.Read(entry.index);
+		reader.Read(entry.value);
+		entry.pic_event = reader.ReadCodePointer<void(uint32_t)>();
+#if C_TRACY
+		entry.name = "Restored PIC event";
+#endif
+		if (is_snapshot_event(entry)) {
+			events.push_back(entry);
+		}
+	}
+
+	if (events.size() > PIC_QUEUESIZE) {
+		E_Exit("PIC: Restoring the snapshot needs %zu events, more than the queue holds",
+		       events.size());
+	}
+	std::stable_sort(events.begin(),
+	                 events.end(),
+	                 [](const PICEntry& a, const PICEntry& b) {
+		                 return a.index < b.index;
+	                 });
+
+	for (size_t i = 0; i < PIC_QUEUESIZE; ++i) {
+		auto& entry = pic_queue.entries[i];
+		if (i < events.size()) {
+			entry = events[i];
+		}
+		entry.next = (i + 1 < PIC_QUEUESIZE) ? &pic_queue.entries[i + 1]
+		                                     : nullptr;
+	}
+	if (events.empty()) {
+		pic_queue.next_entry = nullptr;
+	} else {
+		pic_queue.next_entry = &pic_queue.entries[0];
+		pic_queue.entries[events.size() - 1].next = nullptr;
+	}
+	pic_queue.free_entry = (events.size() < PIC_QUEUESIZE)
+	                             ? &pic_queue.entries[events.size()]
+	                             : nullptr;
+}
+
 static PIC_8259A* test;
 
 void PIC_Destroy(Section* /*sec*/){
@@ -705,4 +836,6 @@ void PIC_Destroy(Section* /*sec*/){
 void PIC_Init(Section* sec) {
 	test = new PIC_8259A(sec);
 	sec->AddDestroyFunction(&PIC_Destroy);
+
+	SNAPSHOT_AddComponent("pic", pic_save_snapshot, pic_load_snapshot);
 }
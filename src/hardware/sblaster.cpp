@@ -43,6 +43,7 @@
 #include "sblaster.h"
 #include "setup.h"
 #include "shell.h"
+#include "snapshot.h"
 #include "string_utils.h"
 #include "support.h"
 #include "timer.h"
@@ -59,7 +60,6 @@ constexpr uint8_t DspAck16Bit    = 0x0f;
 
 constexpr uint8_t DspNoCommand = 0;
 
-constexpr uint16_t DmaBufSize = 1024;
 constexpr uint8_t DspBufSize  = 64;
 
 constexpr uint8_t SbShift      = 14;
@@ -168,14 +168,13 @@ struct SbInfo {
 		uint32_t left       = 0; // Left in active cycle
 		uint32_t min        = 0;
 
-		union {
-			uint8_t b8[DmaBufSize];
-			int16_t b16[DmaBufSize];
-		} buf = {};
-
 		uint32_t bits        = 0;
 		DmaChannel* chan     = nullptr;
-		uint32_t remain_size = 0;
+
+		// Bytes of a partial frame carried over into the next transfer,
+		// i.e., one sample of a stereo frame that straddled two reads
+		std::array<uint8_t, 4> remain_buf = {};
+		uint32_t remain_size              = 0;
 	} dma = {};
 
 	bool speaker_enabled = false;
@@ -283,6 +282,18 @@ static SbInfo sb = {};
 
 std::unique_ptr<SBLASTER> sblaster = {};
 
+// The DSP and mixer state isn't part of snapshots, so saving is refused once
+// a program has written to the card and it has left its power-on state
+static bool has_register_writes = false;
+
+static std::optional<std::string> check_sb_unused()
+{
+	if (sblaster && has_register_writes) {
+		return "the Sound Blaster is in use";
+	}
+	return {};
+}
+
 class CallbackType {
 public:
 	void SetNone();
@@ -971,6 +982,38 @@ static constexpr float to_float(T sample)
 	return 0.0f;
 }
 
+// Reads a little-endian sample of the given type from a (possibly unaligned)
+// byte location
+template <typename T>
+static T read_sample(const uint8_t* data)
+{
+	T sample;
+	memcpy(&sample, data, sizeof(T));
+	return sample;
+}
+
+// Appends AudioFrames converted from the interleaved samples at the given
+// (possibly unaligned) byte location
+template <FrameType frame_type, typename T>
+static void append_frames(const uint8_t* data, const size_t num_frames,
+                          std::vector<AudioFrame>& frames)
+{
+	constexpr auto SamplesPerFrame = (frame_type == FrameType::Mono) ? 1 : 2;
+	constexpr auto BytesPerFrame   = SamplesPerFrame * sizeof(T);
+
+	for (size_t i = 0; i < num_frames; ++i) {
+		const auto frame = data + i * BytesPerFrame;
+
+		const float left = to_float(read_sample<T>(frame));
+
+		const float right = (frame_type == FrameType::Mono)
+		                          ? left
+		                          : to_float(read_sample<T>(frame + sizeof(T)));
+
+		frames.emplace_back(left, right);
+	}
+}
+
 // Returns a vector of AudioFrames from the source samples. If the Sound Blaster
 // is still warming up or the speaker's off, then the frames will be silent.
 template <FrameType frame_type, typename T>
@@ -998,41 +1041,86 @@ static std::vector<AudioFrame>& maybe_silence(const T* samples,
 		return frames;
 	}
 	// Process samples into AudioFrames
-	for (size_t i = 0; i < num_frames; ++i) {
-		const float left = to_float(samples[i * SamplesPerFrame]);
-
-		const float right = (frame_type == FrameType::Mono)
-		                          ? left
-		                          : to_float(samples[i * 2 + 1]);
-
-		frames.emplace_back(left, right);
-	}
-
+	append_frames<frame_type, T>(reinterpret_cast<const uint8_t*>(samples),
+	                             num_frames,
+	                             frames);
 	return frames;
 }
 
-static uint32_t read_dma_8bit(const uint32_t bytes_to_read, const uint32_t i = 0)
+static void enqueue_frames(std::vector<AudioFrame>& frames)
 {
-	const auto bytes_read = sb.dma.chan->Read(bytes_to_read, sb.dma.buf.b8 + i);
-	assert(bytes_read <= DmaBufSize * sizeof(sb.dma.buf.b8[0]));
-
-	return check_cast<uint32_t>(bytes_read);
+	assert(sblaster);
+	frames_added_this_tick += static_cast<int>(frames.size());
+	sblaster->output_queue.NonblockingBulkEnqueue(frames);
 }
 
-static uint32_t read_dma_16bit(const uint32_t bytes_to_read, const uint32_t i = 0)
+// Converts the PCM samples of a DMA transfer into AudioFrames straight from
+// guest memory and sends them off to the mixer. A frame that straddles two
+// spans, or the end of the transfer, is assembled in the remain buffer.
+// Returns the number of DMA words read, samples, and whole frames.
+template <FrameType frame_type, typename T>
+static std::tuple<uint32_t, uint32_t, uint16_t> play_dma_pcm(const uint32_t words_to_read)
 {
-	const auto unsigned_buf = reinterpret_cast<uint8_t*>(sb.dma.buf.b16 + i);
-	const auto bytes_read = sb.dma.chan->Read(bytes_to_read, unsigned_buf);
-	assert(bytes_read <= DmaBufSize * sizeof(sb.dma.buf.b16[0]));
+	constexpr uint8_t SamplesPerFrame = (frame_type == FrameType::Mono) ? 1 : 2;
+	constexpr uint8_t BytesPerFrame = SamplesPerFrame * sizeof(T);
+	static_assert(BytesPerFrame <= std::tuple_size_v<decltype(sb.dma.remain_buf)>);
 
-	return check_cast<uint32_t>(bytes_read);
-}
+	static std::vector<AudioFrame> frames = {};
+	frames.clear();
 
-static void enqueue_frames(std::vector<AudioFrame>& frames)
-{
-	assert(sblaster);
-	frames_added_this_tick += static_cast<int>(frames.size());
-	sblaster->output_queue.NonblockingBulkEnqueue(frames);
+	// Skip the conversion if the frames will be silenced anyway
+	const auto is_silent = sb.dsp.warmup_remaining_ms > 0 ||
+	                       !sb.speaker_enabled;
+	size_t num_frames = 0;
+
+	auto add_frames = [&](const uint8_t* data, const size_t count) {
+		num_frames += count;
+		if (!is_silent) {
+			append_frames<frame_type, T>(data, count, frames);
+		}
+	};
+
+	auto& remain_buf  = sb.dma.remain_buf;
+	auto& remain_size = sb.dma.remain_size;
+
+	auto convert_span = [&](const uint8_t* data, size_t num_bytes) {
+		// Complete the partial frame from the previous span first
+		if (remain_size > 0) {
+			const auto fill = std::min<size_t>(BytesPerFrame - remain_size,
+			                                   num_bytes);
+			memcpy(remain_buf.data() + remain_size, data, fill);
+			remain_size += check_cast<uint32_t>(fill);
+			data += fill;
+			num_bytes -= fill;
+
+			if (remain_size < BytesPerFrame) {
+				return;
+			}
+			add_frames(remain_buf.data(), 1);
+			remain_size = 0;
+		}
+		const auto whole_frames = num_bytes / BytesPerFrame;
+		add_frames(data, whole_frames);
+
+		// Carry over any dangling bytes into the next span or transfer
+		remain_size = check_cast<uint32_t>(num_bytes % BytesPerFrame);
+		memcpy(remain_buf.data(), data + whole_frames * BytesPerFrame, remain_size);
+	};
+
+	const auto words_read = sb.dma.chan->ReadSpans(words_to_read, convert_span);
+
+	if (num_frames > 0) {
+		if (is_silent) {
+			frames.resize(num_frames);
+			if (sb.dsp.warmup_remaining_ms > 0) {
+				--sb.dsp.warmup_remaining_ms;
+			}
+		}
+		enqueue_frames(frames);
+	}
+	return {check_cast<uint32_t>(words_read),
+	        check_cast<uint32_t>(num_frames * SamplesPerFrame),
+	        check_cast<uint16_t>(num_frames)};
 }
 
 static void play_dma_transfer(const uint32_t bytes_requested)
@@ -1049,46 +1137,38 @@ static void play_dma_transfer(const uint32_t bytes_requested)
 	uint32_t samples    = 0;
 	uint16_t frames     = 0;
 
-	// In DmaMode::Pcm16BitAliased mode temporarily divide by 2 to get
-	// number of 16-bit samples, because 8-bit DMA Read returns byte size,
-	// while in DmaMode::Pcm16Bit mode 16-bit DMA Read returns word size.
-	const uint8_t dma16_to_sample_divisor = sb.dma.mode == DmaMode::Pcm16BitAliased
-	                                              ? 2
-	                                              : 1;
-
-	// Used to convert from samples to frames (which is what AddSamples
-	// unintuitively uses.. )
-	const uint8_t channels = sb.dma.stereo ? 2 : 1;
-
 	last_dma_callback = PIC_FullIndex();
 
-	// Temporary counter for ADPCM modes
-
 	auto decode_adpcm_dma =
 	        [&](auto decode_adpcm_fn) -> std::tuple<uint32_t, uint32_t, uint16_t> {
-		const uint32_t num_bytes = read_dma_8bit(bytes_to_read);
-		uint32_t num_samples     = 0;
-		uint16_t num_frames      = 0;
-
-		// Parse the reference ADPCM byte, if provided
-		uint32_t i = 0;
-		if (num_bytes > 0 && sb.adpcm.haveref) {
-			sb.adpcm.haveref   = false;
-			sb.adpcm.reference = sb.dma.buf.b8[0];
-			sb.adpcm.stepsize  = MinAdaptiveStepSize;
-			++i;
-		}
-		// Decode the remaining DMA buffer into samples using the
-		// provided function
-		while (i < num_bytes) {
-			const auto decoded = decode_adpcm_fn(sb.dma.buf.b8[i]);
-			constexpr auto NumDecoded = check_cast<uint8_t>(
-			        decoded.size());
-
-			enqueue_frames(maybe_silence<FrameType::Mono>(decoded.data(), NumDecoded));
-			num_samples += NumDecoded;
-			i++;
-		}
+		uint32_t num_samples = 0;
+		uint16_t num_frames  = 0;
+
+		auto decode_span = [&](const uint8_t* data, const size_t num_bytes) {
+			size_t i = 0;
+
+			// Parse the reference ADPCM byte, if provided
+			if (num_bytes > 0 && sb.adpcm.haveref) {
+				sb.adpcm.haveref   = false;
+				sb.adpcm.reference = data[0];
+				sb.adpcm.stepsize  = MinAdaptiveStepSize;
+				++i;
+			}
+			// Decode the remaining DMA span into samples using the
+			// provided function
+			while (i < num_bytes) {
+				const auto decoded = decode_adpcm_fn(data[i]);
+				constexpr auto NumDecoded = check_cast<uint8_t>(
+				        decoded.size());
+
+				enqueue_frames(maybe_silence<FrameType::Mono>(decoded.data(), NumDecoded));
+				num_samples += NumDecoded;
+				i++;
+			}
+		};
+		const auto num_bytes = check_cast<uint32_t>(
+		        sb.dma.chan->ReadSpans(bytes_to_read, decode_span));
+
 		// ADPCM is mono
 		num_frames = check_cast<uint16_t>(num_samples);
 		return {num_bytes, num_samples, num_frames};
@@ -1112,87 +1192,38 @@ static void play_dma_transfer(const uint32_t bytes_requested)
 		break;
 
 	case DmaMode::Pcm8Bit:
+		// Only whole frames are added when in stereo DMA mode. The
+		// number of frames comes from the DMA request, and therefore
+		// user-space data.
 		if (sb.dma.stereo) {
-			bytes_read = read_dma_8bit(bytes_to_read, sb.dma.remain_size);
-			samples = bytes_read + sb.dma.remain_size;
-			frames  = check_cast<uint16_t>(samples / channels);
-
-			// Only add whole frames when in stereo DMA mode. The
-			// number of frames comes from the DMA request, and
-			// therefore user-space data.
-			if (frames) {
-				if (sb.dma.sign) {
-					const auto signed_buf = reinterpret_cast<int8_t*>(sb.dma.buf.b8);
-					enqueue_frames(maybe_silence<FrameType::Stereo>(signed_buf, samples));
-				} else {
-					enqueue_frames(maybe_silence<FrameType::Stereo>(sb.dma.buf.b8, samples));
-				}
-			}
-			// Otherwise there's an unhandled dangling sample from
-			// the last round
-			if (samples & 1) {
-				sb.dma.remain_size = 1;
-				sb.dma.buf.b8[0]   = sb.dma.buf.b8[samples - 1];
-			} else {
-				sb.dma.remain_size = 0;
-			}
-
-		} else { // Mono
-			bytes_read = read_dma_8bit(bytes_to_read);
-			samples    = bytes_read;
-			// mono sanity-check
-			assert(channels == 1);
-			if (sb.dma.sign) {
-				const auto signed_buf = reinterpret_cast<int8_t*>(sb.dma.buf.b8);
-				enqueue_frames(maybe_silence<FrameType::Mono>(signed_buf, samples));
-			} else {
-				enqueue_frames(maybe_silence<FrameType::Mono>(sb.dma.buf.b8, samples));
-			}
+			std::tie(bytes_read, samples, frames) =
+			        sb.dma.sign
+			                ? play_dma_pcm<FrameType::Stereo, int8_t>(bytes_to_read)
+			                : play_dma_pcm<FrameType::Stereo, uint8_t>(bytes_to_read);
+		} else {
+			std::tie(bytes_read, samples, frames) =
+			        sb.dma.sign
+			                ? play_dma_pcm<FrameType::Mono, int8_t>(bytes_to_read)
+			                : play_dma_pcm<FrameType::Mono, uint8_t>(bytes_to_read);
 		}
 		break;
 
 	case DmaMode::Pcm16BitAliased:
-		assert(dma16_to_sample_divisor == 2);
+		// 16-bit samples over an 8-bit DMA channel; the reads return
+		// the byte size, which the PCM reader assembles into samples
 		[[fallthrough]];
 
 	case DmaMode::Pcm16Bit:
 		if (sb.dma.stereo) {
-			bytes_read = read_dma_16bit(bytes_to_read, sb.dma.remain_size);
-			samples = (bytes_read + sb.dma.remain_size) /
-			          dma16_to_sample_divisor;
-			frames = check_cast<uint16_t>(samples / channels);
-
-			// Only add whole frames when in stereo DMA mode
-			if (frames) {
-				if (sb.dma.sign) {
-					enqueue_frames(maybe_silence<FrameType::Stereo>(sb.dma.buf.b16, samples));
-				} else {
-					const auto unsigned_buf = reinterpret_cast<uint16_t*>(sb.dma.buf.b16);
-					enqueue_frames(maybe_silence<FrameType::Stereo>(unsigned_buf, samples));
-				}
-			}
-			if (samples & 1) {
-				// Carry over the dangling sample into the next
-				// round, or...
-				sb.dma.remain_size = 1;
-				sb.dma.buf.b16[0] = sb.dma.buf.b16[samples - 1];
-			} else {
-				// ...the DMA transfer is done
-				sb.dma.remain_size = 0;
-			}
-		} else { // 16-bit mono
-			bytes_read = read_dma_16bit(bytes_to_read);
-			samples    = bytes_read / dma16_to_sample_divisor;
-
-			// mono sanity check
-			assert(channels == 1);
-
-			if (sb.dma.sign) {
-				enqueue_frames(maybe_silence<FrameType::Mono>(sb.dma.buf.b16, samples));
-			} else {
-				const auto unsigned_buf = reinterpret_cast<uint16_t*>(sb.dma.buf.b16);
-				enqueue_frames(maybe_silence<FrameType::Mono>(unsigned_buf, samples));
-			}
+			std::tie(bytes_read, samples, frames) =
+			        sb.dma.sign
+			                ? play_dma_pcm<FrameType::Stereo, int16_t>(bytes_to_read)
+			                : play_dma_pcm<FrameType::Stereo, uint16_t>(bytes_to_read);
+		} else {
+			std::tie(bytes_read, samples, frames) =
+			        sb.dma.sign
+			                ? play_dma_pcm<FrameType::Mono, int16_t>(bytes_to_read)
+			                : play_dma_pcm<FrameType::Mono, uint16_t>(bytes_to_read);
 		}
 		break;
 
@@ -1267,7 +1298,9 @@ static void suppress_dma_transfer(const uint32_t bytes_to_read)
 		num_bytes = sb.dma.left;
 	}
 
-	const auto read = read_dma_8bit(num_bytes);
+	// Advance the transfer without looking at the data
+	const auto read = sb.dma.chan->ReadSpans(num_bytes,
+	                                         [](const uint8_t*, size_t) {});
 
 	sb.dma.left -= read;
 	if (!sb.dma.left) {
@@ -3034,6 +3067,8 @@ static void write_sb(const io_port_t port, const io_val_t value, const io_width_
 {
 	const auto val = check_cast<uint8_t>(value);
 
+	has_register_writes = true;
+
 	switch (port - sb.hw.base) {
 	case DspReset: dsp_do_reset(val); break;
 
@@ -3698,6 +3733,9 @@ void init_sblaster(Section* sec)
 	sblaster = std::make_unique<SBLASTER>(sec);
 	MIXER_UnlockMixerThread();
 
+	has_register_writes = false;
+	SNAPSHOT_AddSaveCheck(check_sb_unused);
+
 	constexpr auto ChangeableAtRuntime = true;
 	sec->AddDestroyFunction(&shutdown_sblaster, ChangeableAtRuntime);
 }
@@ -24,7 +24,9 @@
 
 #include "misc_util.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 #include "timer.h"
 
@@ -450,13 +452,25 @@ bool ENETClientSocket::GetRemoteAddressString(char *buffer)
 	return true;
 }
 
-void ENETClientSocket::updateState()
+bool ENETClientSocket::WaitForData(const uint32_t timeout_ms)
+{
+	if (receiveBuffer.empty()) {
+		updateState(timeout_ms);
+	}
+	return !receiveBuffer.empty();
+}
+
+void ENETClientSocket::updateState(const uint32_t timeout_ms)
 {
 	if (!isopen || !client)
 		return;
 
+	// Only the first service call waits; the rest drain the queued events
+	auto wait_ms = timeout_ms;
+
 	ENetEvent event;
-	while (enet_host_service(client, &event, 0) > 0) {
+	while (enet_host_service(client, &event, wait_ms) > 0) {
+		wait_ms = 0;
 		switch (event.type) {
 #ifndef ENET_BLOCKING_CONNECT
 		case ENET_EVENT_TYPE_CONNECT:
@@ -674,6 +688,11 @@ bool TCPClientSocket::ReceiveArray(uint8_t *data, size_t &n)
 	}
 }
 
+bool TCPClientSocket::WaitForData(const uint32_t timeout_ms)
+{
+	return SDLNet_CheckSockets(listensocketset, timeout_ms) > 0;
+}
+
 SocketState TCPClientSocket::GetcharNonBlock(uint8_t &val)
 {
 	SocketState state = SocketState::Empty;
@@ -748,4 +767,154 @@ NETClientSocket *TCPServerSocket::Accept()
 	return new TCPClientSocket(new_tcpsock);
 }
 
+// --- THREADED NET INTERFACE ------------------------------------------------
+
+// How long the I/O thread waits for incoming data before checking for
+// outgoing data again
+constexpr uint32_t io_wait_timeout_ms = 1;
+
+// Stop reading from the socket when this much received data is still
+// waiting for the emulation, so the peer is throttled by the transport's
+// own flow control
+constexpr size_t rx_queue_capacity = 64 * 1024;
+
+ThreadedClientSocket::ThreadedClientSocket(NETClientSocket *connected_socket)
+        : socket(connected_socket)
+{
+	assert(socket);
+	isopen       = socket->isopen;
+	is_connected = socket->isopen;
+	if (!isopen) {
+		return;
+	}
+	if (!socket->GetRemoteAddressString(remote_address)) {
+		remote_address[0] = '\0';
+	}
+
+	is_running = true;
+	thread     = std::thread(&ThreadedClientSocket::Run, this);
+}
+
+ThreadedClientSocket::~ThreadedClientSocket()
+{
+	is_running = false;
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+void ThreadedClientSocket::Run()
+{
+	std::vector<uint8_t> tx_data = {};
+	std::vector<uint8_t> rx_data(4096);
+
+	auto is_stopping = false;
+	while (!is_stopping) {
+		// Send whatever is still queued before leaving
+		is_stopping = !is_running;
+
+		bool has_rx_room = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tx_data.assign(tx_queue.begin(), tx_queue.end());
+			tx_queue.clear();
+			has_rx_room = rx_queue.size() < rx_queue_capacity;
+		}
+
+		bool is_open = true;
+		if (!tx_data.empty()) {
+			is_open = socket->SendArray(tx_data.data(), tx_data.size());
+		}
+
+		auto num_received = size_t{0};
+		if (is_open && has_rx_room && !is_stopping &&
+		    socket->WaitForData(io_wait_timeout_ms)) {
+			num_received = rx_data.size();
+			is_open = socket->ReceiveArray(rx_data.data(), num_received);
+		} else if (!has_rx_room) {
+			std::this_thread::sleep_for(
+			        std::chrono::milliseconds(io_wait_timeout_ms));
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		rx_queue.insert(rx_queue.end(),
+		                rx_data.begin(),
+		                rx_data.begin() + static_cast<std::ptrdiff_t>(num_received));
+
+		if (!is_open || !socket->isopen) {
+			is_connected = false;
+			return;
+		}
+	}
+}
+
+SocketState ThreadedClientSocket::GetcharNonBlock(uint8_t &val)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!rx_queue.empty()) {
+		val = rx_queue.front();
+		rx_queue.pop_front();
+		return SocketState::Good;
+	}
+	if (!is_connected) {
+		isopen = false;
+		return SocketState::Closed;
+	}
+	return SocketState::Empty;
+}
+
+bool ThreadedClientSocket::Putchar(uint8_t val)
+{
+	return SendArray(&val, 1);
+}
+
+bool ThreadedClientSocket::SendArray(const uint8_t *data, const size_t n)
+{
+	assert(data);
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!is_connected) {
+		isopen = false;
+		return false;
+	}
+	tx_queue.insert(tx_queue.end(), data, data + n);
+	return true;
+}
+
+bool ThreadedClientSocket::ReceiveArray(uint8_t *data, size_t &n)
+{
+	assert(data);
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const auto num_bytes = std::min(n, rx_queue.size());
+	std::copy_n(rx_queue.begin(), num_bytes, data);
+	rx_queue.erase(rx_queue.begin(),
+	               rx_queue.begin() + static_cast<std::ptrdiff_t>(num_bytes));
+	n = num_bytes;
+
+	// Like the sockets themselves, report the closure only once all the
+	// received data has been handed over
+	if (num_bytes == 0 && !is_connected) {
+		isopen = false;
+		return false;
+	}
+	return true;
+}
+
+bool ThreadedClientSocket::GetRemoteAddressString(char *buffer)
+{
+	assert(buffer);
+	if (remote_address[0] == '\0') {
+		return false;
+	}
+	strcpy(buffer, remote_address);
+	return true;
+}
+
+bool ThreadedClientSocket::WaitForData(const uint32_t /*timeout_ms*/)
+{
+	// The emulation polls the queues rather than waiting on them
+	std::lock_guard<std::mutex> lock(mutex);
+	return !rx_queue.empty();
+}
+
 #endif // C_MODEM
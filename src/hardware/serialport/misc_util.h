@@ -23,6 +23,12 @@
 
 #if C_MODEM
 
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "support.h"
@@ -97,6 +103,10 @@ public:
 	virtual bool ReceiveArray(uint8_t *data, size_t &n) = 0;
 	virtual bool GetRemoteAddressString(char *buffer) = 0;
 
+	// Blocks until data can be received or the timeout expires. Returns
+	// true if there's data to receive.
+	virtual bool WaitForData(const uint32_t timeout_ms) = 0;
+
 	void FlushBuffer();
 	void SetSendBufferSize(size_t n);
 	bool SendByteBuffered(uint8_t val);
@@ -158,9 +168,10 @@ public:
 	bool SendArray(const uint8_t *data, size_t n) override;
 	bool ReceiveArray(uint8_t *data, size_t &n) override;
 	bool GetRemoteAddressString(char *buffer) override;
+	bool WaitForData(const uint32_t timeout_ms) override;
 
 private:
-	void updateState();
+	void updateState(const uint32_t timeout_ms = 0);
 
 #ifndef ENET_BLOCKING_CONNECT
 	int64_t              connectStart  = 0;
@@ -201,6 +212,7 @@ public:
 	bool SendArray(const uint8_t *data, size_t n) override;
 	bool ReceiveArray(uint8_t *data, size_t &n) override;
 	bool GetRemoteAddressString(char *buffer) override;
+	bool WaitForData(const uint32_t timeout_ms) override;
 
 private:
 
@@ -225,6 +237,43 @@ public:
 	NETClientSocket *Accept() override;
 };
 
+// --- THREADED NET INTERFACE ------------------------------------------------
+
+// Moves a connected socket's I/O onto its own thread. The emulation only
+// exchanges bytes with the thread through in-memory queues, so it never waits
+// on the network or makes socket calls itself.
+class ThreadedClientSocket : public NETClientSocket {
+public:
+	// Takes ownership of the connected socket
+	ThreadedClientSocket(NETClientSocket *connected_socket);
+	ThreadedClientSocket(const ThreadedClientSocket &) = delete; // prevent copying
+	ThreadedClientSocket &operator=(const ThreadedClientSocket &) = delete; // prevent assignment
+
+	~ThreadedClientSocket() override;
+
+	SocketState GetcharNonBlock(uint8_t &val) override;
+	bool Putchar(uint8_t val) override;
+	bool SendArray(const uint8_t *data, size_t n) override;
+	bool ReceiveArray(uint8_t *data, size_t &n) override;
+	bool GetRemoteAddressString(char *buffer) override;
+	bool WaitForData(const uint32_t timeout_ms) override;
+
+private:
+	void Run();
+
+	std::unique_ptr<NETClientSocket> socket = {};
+	std::thread thread                      = {};
+	std::atomic<bool> is_running            = false;
+
+	// Guards the queues and the connection state
+	std::mutex mutex                 = {};
+	std::deque<uint8_t> rx_queue     = {};
+	std::deque<uint8_t> tx_queue     = {};
+	bool is_connected                = false;
+
+	char remote_address[INET_ADDRSTRLEN] = {};
+};
+
 #endif // C_MODEM
 
 #endif
@@ -201,15 +201,15 @@ SocketState CNullModem::readChar(uint8_t &val)
 bool CNullModem::ClientConnect(NETClientSocket *newsocket)
 {
 	char peernamebuf[INET_ADDRSTRLEN];
-	clientsocket = newsocket;
- 
-	if (!clientsocket->isopen) {
+
+	if (!newsocket->isopen) {
 		LOG_MSG("SERIAL: Port %" PRIu8 " connection failed.", GetPortNumber());
-		delete clientsocket;
+		delete newsocket;
 		clientsocket=nullptr;
 		setCD(false);
 		return false;
 	}
+	clientsocket = new ThreadedClientSocket(newsocket);
 	clientsocket->SetSendBufferSize(256);
 	clientsocket->GetRemoteAddressString(peernamebuf);
 	// transmit the line status
@@ -237,8 +237,9 @@ bool CNullModem::ServerListen() {
 
 bool CNullModem::ServerConnect() {
 	// check if a connection is available.
-	clientsocket=serversocket->Accept();
-	if (!clientsocket) return false;
+	const auto accepted = serversocket->Accept();
+	if (!accepted) return false;
+	clientsocket = new ThreadedClientSocket(accepted);
 
 	char peeripbuf[INET_ADDRSTRLEN];
 	clientsocket->GetRemoteAddressString(peeripbuf);
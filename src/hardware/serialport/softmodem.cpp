@@ -323,6 +323,8 @@ bool CSerialModem::Dial(const char * host) {
 		EnterIdleState();
 		return false;
 	} else {
+		clientsocket = std::make_unique<ThreadedClientSocket>(
+		        clientsocket.release());
 		EnterConnectedState();
 		return true;
 	}
@@ -1043,8 +1045,9 @@ void CSerialModem::Timer2()
 
 	// Check for incoming calls
 	if (!connected && !waitingclientsocket && serversocket) {
-		waitingclientsocket.reset(serversocket->Accept());
-		if (waitingclientsocket) {
+		if (const auto accepted = serversocket->Accept(); accepted) {
+			waitingclientsocket = std::make_unique<ThreadedClientSocket>(
+			        accepted);
 			if (!CSerial::getDTR() && dtrmode != 0) {
 				// accept no calls with DTR off
 				EnterIdleState();
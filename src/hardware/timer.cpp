@@ -28,6 +28,7 @@
 #include "math_utils.h"
 #include "mixer.h"
 #include "setup.h"
+#include "snapshot.h"
 
 const std::chrono::steady_clock::time_point system_start_time = std::chrono::steady_clock::now();
 
@@ -688,6 +689,25 @@ public:
 		PIC_RemoveEvents(PIT0_Event);
 	}
 };
+static void timer_save_snapshot(SnapshotWriter& writer)
+{
+	writer.Write(pit);
+	writer.Write(gate2);
+	writer.Write(latched_timerstatus);
+	writer.Write(latched_timerstatus_locked);
+}
+
+// The channel start times are relative to the PIC's tick count, which is
+// restored before us. The PC speaker follows channel 2 but isn't part of
+// the snapshot, so it stays silent until the program reprograms it.
+static void timer_load_snapshot(SnapshotReader& reader)
+{
+	reader.Read(pit);
+	reader.Read(gate2);
+	reader.Read(latched_timerstatus);
+	reader.Read(latched_timerstatus_locked);
+}
+
 static TIMER* test;
 
 void TIMER_Destroy(Section*){
@@ -696,4 +716,7 @@ void TIMER_Destroy(Section*){
 void TIMER_Init(Section* sec) {
 	test = new TIMER(sec);
 	sec->AddDestroyFunction(&TIMER_Destroy);
+
+	SNAPSHOT_AddComponent("timer", timer_save_snapshot, timer_load_snapshot);
+	PIC_AddSnapshotEventHandler(PIT0_Event);
 }
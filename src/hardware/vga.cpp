@@ -18,6 +18,7 @@
 
 #include "vga.h"
 
+#include <array>
 #include <cassert>
 #include <cstring>
 #include <string>
@@ -27,6 +28,7 @@
 #include "logging.h"
 #include "math_utils.h"
 #include "pic.h"
+#include "snapshot.h"
 #include "string_utils.h"
 #include "video.h"
 
@@ -390,6 +392,101 @@ void VGA_AllowPixelDoubling(const bool allow)
 	vga.draw.pixel_doubling_allowed = allow;
 }
 
+static void vga_save_snapshot(SnapshotWriter& writer)
+{
+	// Not trivially copyable as a whole, but everything in it other than
+	// the pointers fixed up on loading is plain data
+	writer.WriteBytes(&vga, sizeof(vga));
+
+	writer.Write(reinterpret_cast<uintptr_t>(&vga));
+	writer.Write(reinterpret_cast<uintptr_t>(vga.mem.linear));
+	writer.Write(reinterpret_cast<uintptr_t>(vga.fastmem));
+	writer.Write(reinterpret_cast<uintptr_t>(MemBase));
+
+	writer.WriteBytes(vga.mem.linear, vga.vmemsize);
+	writer.WriteBytes(vga.fastmem, vga.vmemsize * 2);
+
+	writer.Write(CGA_2_Table);
+	writer.Write(CGA_4_Table);
+	writer.Write(CGA_4_HiRes_Table);
+}
+
+static void vga_load_snapshot(SnapshotReader& reader)
+{
+	// The buffers belong to this session, so keep pointing at them
+	const auto linear      = vga.mem.linear;
+	const auto fastmem     = vga.fastmem;
+	const auto lfb_handler = vga.lfb.handler;
+#ifdef VGA_KEEP_CHANGES
+	const auto changes_map = vga.changes.map;
+#endif
+	reader.ReadBytes(&vga, sizeof(vga));
+
+	vga.mem.linear  = linear;
+	vga.fastmem     = fastmem;
+	vga.lfb.handler = lfb_handler;
+#ifdef VGA_KEEP_CHANGES
+	vga.changes.map = changes_map;
+#endif
+
+	struct Region {
+		uintptr_t old_start = 0;
+		uint8_t* new_start  = nullptr;
+	};
+	const std::array<Region, 4> regions = {{
+	        {reader.Read<uintptr_t>(), reinterpret_cast<uint8_t*>(&vga)},
+	        {reader.Read<uintptr_t>(), linear},
+	        {reader.Read<uintptr_t>(), fastmem},
+	        {reader.Read<uintptr_t>(), MemBase},
+	}};
+
+	// The regions are separate allocations, so a pointer belongs to the
+	// closest one starting at or below it
+	auto relocate = [&](uint8_t*& ptr) {
+		if (!ptr) {
+			return;
+		}
+		const auto address  = reinterpret_cast<uintptr_t>(ptr);
+		const Region* owner = nullptr;
+		for (const auto& region : regions) {
+			if (region.old_start <= address &&
+			    (!owner || region.old_start > owner->old_start)) {
+				owner = &region;
+			}
+		}
+		if (!owner) {
+			E_Exit("VGA: Can't relocate a pointer from the snapshot");
+		}
+		ptr = owner->new_start + (address - owner->old_start);
+	};
+	relocate(vga.draw.linear_base);
+	relocate(vga.draw.font_tables[0]);
+	relocate(vga.draw.font_tables[1]);
+	relocate(vga.tandy.draw_base);
+	relocate(vga.tandy.mem_base);
+
+	reader.ReadBytes(vga.mem.linear, vga.vmemsize);
+	reader.ReadBytes(vga.fastmem, vga.vmemsize * 2);
+
+	reader.Read(CGA_2_Table);
+	reader.Read(CGA_4_Table);
+	reader.Read(CGA_4_HiRes_Table);
+
+	// Drop anything the drawers have cached from the previous contents
+	++vga.draw.font_generation;
+	++vga.dac.palette_generation;
+
+	VGA_SetupHandlers();
+	if (vga.s3.la_window) {
+		VGA_StartUpdateLFB();
+	}
+
+	// Forces the renderer to be set up for the restored mode
+	vga.draw.resizing   = false;
+	vga.draw.image_info = {};
+	VGA_SetupDrawing(0);
+}
+
 void VGA_Init(Section* sec)
 {
 	vga.draw.resizing = false;
@@ -456,6 +553,9 @@ void VGA_Init(Section* sec)
 #endif
 		}
 	}
+
+	SNAPSHOT_AddComponent("vga", vga_save_snapshot, vga_load_snapshot);
+	VGA_AddSnapshotEvents();
 }
 
 void SVGA_Setup_Driver(void) {
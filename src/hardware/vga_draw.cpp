@@ -23,9 +23,11 @@
 
 #include <algorithm>
 #include <array>
+#include <bitset>
 #include <cmath>
 #include <cstring>
 #include <utility>
+#include <vector>
 
 #include "../gui/render_scalers.h"
 #include "../ints/int10.h"
@@ -36,7 +38,9 @@
 #include "reelmagic.h"
 #include "render.h"
 #include "rgb565.h"
+#include "tracy.h"
 #include "vga.h"
+#include "vga_palette_expand.h"
 #include "video.h"
 
 // #define DEBUG_VGA_DRAW
@@ -277,33 +281,32 @@ static uint8_t *VGA_Draw_CGA4_Composite_Line(Bitu vidstart, Bitu line)
 	return Composite_Process(vga.tandy.color_select & 0x0f, vga.draw.blocks, true);
 }
 
-static uint8_t * VGA_Draw_4BPP_Line(Bitu vidstart, Bitu line) {
+// Expands the packed 4-bit pixels in contiguous runs up to the end of the
+// address mask, so the palette lookup can work on whole spans at once
+static void draw_4bpp_line(Bitu vidstart, const Bitu line, const bool double_pixels)
+{
 	const uint8_t *base = vga.tandy.draw_base + ((line & vga.tandy.line_mask) << vga.tandy.line_shift);
-	uint8_t* draw=TempLine;
-	Bitu end = vga.draw.blocks*2;
-	while(end) {
-		uint8_t byte = base[vidstart & vga.tandy.addr_mask];
-		*draw++=vga.attr.palette[byte >> 4];
-		*draw++=vga.attr.palette[byte & 0x0f];
-		++vidstart;
-		--end;
+	const Bitu addr_mask = vga.tandy.addr_mask;
+
+	uint8_t* draw = TempLine;
+	Bitu remaining = double_pixels ? vga.draw.blocks : vga.draw.blocks * 2;
+	while (remaining) {
+		const auto pos = vidstart & addr_mask;
+		const auto run = std::min(remaining, addr_mask + 1 - pos);
+		VGA_ExpandNibblePalette(base + pos, run, vga.attr.palette, double_pixels, draw);
+		draw += run * (double_pixels ? 4 : 2);
+		vidstart += run;
+		remaining -= run;
 	}
+}
+
+static uint8_t * VGA_Draw_4BPP_Line(Bitu vidstart, Bitu line) {
+	draw_4bpp_line(vidstart, line, false);
 	return TempLine;
 }
 
 static uint8_t * VGA_Draw_4BPP_Line_Double(Bitu vidstart, Bitu line) {
-	const uint8_t *base = vga.tandy.draw_base + ((line & vga.tandy.line_mask) << vga.tandy.line_shift);
-	uint8_t* draw=TempLine;
-	Bitu end = vga.draw.blocks;
-	while(end) {
-		uint8_t byte = base[vidstart & vga.tandy.addr_mask];
-		uint8_t data = vga.attr.palette[byte >> 4];
-		*draw++ = data; *draw++ = data;
-		data = vga.attr.palette[byte & 0x0f];
-		*draw++ = data; *draw++ = data;
-		++vidstart;
-		--end;
-	}
+	draw_4bpp_line(vidstart, line, true);
 	return TempLine;
 }
 
@@ -377,29 +380,24 @@ static uint8_t* draw_unwrapped_line_from_dac_palette(Bitu vidstart,
 	const auto linear_addr                   = vga.draw.linear_base;
 
 	// Video mode-specific line variables
-	const auto pixels_in_line = static_cast<uint16_t>(vga.draw.line_length /
-	                                                  bytes_per_pixel);
-	const auto video_end = vidstart + pixels_in_line;
+	Bitu pixels_remaining = vga.draw.line_length / bytes_per_pixel;
 
 	// The line address is where the RGB888 palettized pixel is written.
-	// It's incremented forward per pixel.
-	auto line_addr = reinterpret_cast<uint32_t*>(TempLine);
+	// It's incremented forward per run of pixels.
+	auto line_addr = TempLine;
 
-	auto linear_pos = vidstart;
+	// This function typically runs on 640+-wide lines and is a rendering
+	// bottleneck, so the palette is expanded in contiguous runs up to the
+	// end of the linear mask rather than masking every pixel.
+	while (pixels_remaining) {
+		const auto masked_pos = vidstart & linear_mask;
+		const auto run = std::min(pixels_remaining, linear_mask + 1 - masked_pos);
 
-	// Draw in batches of four to let the host pipeline deeper.
-	constexpr auto num_repeats = 4;
-	assert(pixels_in_line % num_repeats == 0);
+		VGA_ExpandDacPalette(linear_addr + masked_pos, run, palette_map, line_addr);
 
-	// This function typically runs on 640+-wide lines and is a rendering
-	// bottleneck.
-	while (linear_pos < video_end) {
-		auto repeats = num_repeats;
-		while (repeats--) {
-			const auto masked_pos    = linear_pos++ & linear_mask;
-			const auto palette_index = *(linear_addr + masked_pos);
-			*line_addr++ = *(palette_map + palette_index);
-		}
+		line_addr += run * bytes_per_pixel;
+		vidstart += run;
+		pixels_remaining -= run;
 	}
 
 	return TempLine;
@@ -412,16 +410,14 @@ static uint8_t* draw_linear_line_from_dac_palette(Bitu vidstart, Bitu /*line*/)
 	constexpr uint8_t bytes_per_pixel = sizeof(palette_map[0]);
 
 	// The line address is where the RGB888 palettized pixel is written.
-	// It's incremented forward per pixel.
 	auto line_addr = TempLine;
 
-	// The palette index iterator is used to lookup the DAC palette colour.
-	// It starts at the current VGA line's offset and is incremented per
-	// pixel.
-	auto palette_index_it = vga.draw.linear_base + offset;
+	// The palette indexes used to lookup the DAC palette colour start at
+	// the current VGA line's offset.
+	const auto palette_indexes = vga.draw.linear_base + offset;
 
 	// Pixels remaining starts as the total pixels in this current line and
-	// is decremented per pixel rendered. It acts as a lower-bound cutoff
+	// is reduced by each chunk rendered. It acts as a lower-bound cutoff
 	// regardless of how long the wrapped and unwrapped regions are.
 	auto pixels_remaining = check_cast<uint16_t>(vga.draw.line_length /
 	                                             bytes_per_pixel);
@@ -448,36 +444,21 @@ static uint8_t* draw_linear_line_from_dac_palette(Bitu vidstart, Bitu /*line*/)
 		        vga.draw.line_length - wrapped_len);
 
 		// unwrapped chunk: to top of memory block
-		auto palette_index_end = palette_index_it +
-		                         std::min(unwrapped_len, pixels_remaining);
-		while (palette_index_it != palette_index_end) {
-			memcpy(line_addr,
-			       palette_map + *palette_index_it++,
-			       bytes_per_pixel);
-			line_addr += bytes_per_pixel;
-			--pixels_remaining;
-		}
+		const auto unwrapped_pixels = std::min(unwrapped_len, pixels_remaining);
+		VGA_ExpandDacPalette(palette_indexes, unwrapped_pixels, palette_map, line_addr);
+		line_addr += unwrapped_pixels * bytes_per_pixel;
+		pixels_remaining = static_cast<uint16_t>(pixels_remaining -
+		                                         unwrapped_pixels);
 
 		// wrapped chunk: from the base of the memory block
-		palette_index_it  = vga.draw.linear_base;
-		palette_index_end = palette_index_it +
-		                    std::min(wrapped_len, pixels_remaining);
-		while (palette_index_it != palette_index_end) {
-			memcpy(line_addr,
-			       palette_map + *palette_index_it++,
-			       bytes_per_pixel);
-			line_addr += bytes_per_pixel;
-			--pixels_remaining;
-		}
+		const auto wrapped_pixels = std::min(wrapped_len, pixels_remaining);
+		VGA_ExpandDacPalette(vga.draw.linear_base,
+		                     wrapped_pixels,
+		                     palette_map,
+		                     line_addr);
 
 	} else {
-		auto palette_index_end = palette_index_it + pixels_remaining;
-		while (palette_index_it != palette_index_end) {
-			memcpy(line_addr,
-			       palette_map + *palette_index_it++,
-			       bytes_per_pixel);
-			line_addr += bytes_per_pixel;
-		}
+		VGA_ExpandDacPalette(palette_indexes, pixels_remaining, palette_map, line_addr);
 	}
 	return TempLine;
 }
@@ -794,32 +775,150 @@ static uint8_t *VGA_TEXT_Herc_Draw_Line(Bitu vidstart, Bitu line)
 	}
 	return TempLine;
 }
-// combined 8/9-dot wide text mode line drawing function
-static uint8_t* draw_text_line_from_dac_palette(Bitu vidstart, Bitu line)
+// Text mode glyph rows expanded to DAC colours. A row only depends on the
+// font's bit pattern and the foreground/background colour pair, so the rows
+// of a colour pair are expanded once on first use and then reused until the
+// DAC palette changes. The 9th pixel of 9-dot modes is either colour and
+// doesn't need caching.
+struct GlyphRowCache {
+	using Row = std::array<Bgrx8888, 8>;
+
+	static constexpr auto NumPatterns    = 256;
+	static constexpr auto NumColourPairs = 16 * 16;
+
+	std::array<std::vector<Row>, NumColourPairs> rows = {};
+	std::bitset<NumColourPairs> is_pair_expanded      = {};
+	uint32_t palette_generation                       = 0;
+};
+
+static GlyphRowCache glyph_row_cache = {};
+
+static void validate_glyph_row_cache()
 {
-	// pointer to chars+attribs
-	const uint8_t* vidmem  = VGA_Text_Memwrap(vidstart);
-	const auto palette_map = vga.dac.palette_map;
+	auto& cache = glyph_row_cache;
+	if (cache.palette_generation != vga.dac.palette_generation) {
+		cache.palette_generation = vga.dac.palette_generation;
+		cache.is_pair_expanded.reset();
+	}
+}
 
-	auto blocks = vga.draw.blocks;
-	if (vga.draw.panning) {
-		++blocks; // if the text is panned part of an
-		          // additional character becomes visible
+static const GlyphRowCache::Row& get_glyph_row(const uint8_t pattern,
+                                               const uint8_t fg_palette_idx,
+                                               const uint8_t bg_palette_idx)
+{
+	auto& cache = glyph_row_cache;
+
+	const auto pair = (fg_palette_idx << 4) | bg_palette_idx;
+	auto& rows      = cache.rows[pair];
+
+	if (!cache.is_pair_expanded[pair]) {
+		const auto fg_colour = vga.dac.palette_map[fg_palette_idx];
+		const auto bg_colour = vga.dac.palette_map[bg_palette_idx];
+
+		rows.resize(GlyphRowCache::NumPatterns);
+		for (auto font = 0; font < GlyphRowCache::NumPatterns; ++font) {
+			for (auto n = 0; n < 8; ++n) {
+				rows[font][n] = (font & (0x80 >> n)) ? fg_colour
+				                                     : bg_colour;
+			}
+		}
+		cache.is_pair_expanded.set(pair);
 	}
+	return rows[pattern];
+}
 
-	// The first write-index into the draw buffer. Increasing this shifts
-	// the console text right (and vice-versa)
-	const uint16_t draw_idx_start = 8 + vga.draw.panning;
+// Text mode scanlines from the previous frame. If the characters and
+// attributes of a scanline haven't changed (and neither has anything else
+// that affects how they're drawn), its pixels are reused as-is.
+struct TextLineCache {
+	struct Line {
+		std::vector<uint8_t> cells  = {};
+		std::vector<uint8_t> pixels = {};
+		Bitu font_row               = 0;
+		bool is_valid               = false;
+	};
+
+	// Everything besides the cells that affects the drawn pixels
+	struct State {
+		uint32_t palette_generation   = 0;
+		uint32_t font_generation      = 0;
+		const uint8_t* font_tables[2] = {nullptr, nullptr};
+		Bitu blocks                   = 0;
+		Bitu blinking                 = 0;
+		bool blink                    = false;
+		uint16_t panning              = 0;
+		bool is_eight_dot_mode        = false;
+		bool is_line_graphics_enabled = false;
+		uint8_t underline_location    = 0;
+
+		bool operator==(const State&) const = default;
+	};
+
+	// Enough for the tallest text modes; taller frames draw the rest
+	// uncached
+	static constexpr Bitu MaxLines = 1024;
+
+	std::vector<Line> lines = {};
+	State state             = {};
+};
+
+static TextLineCache text_line_cache = {};
+
+// Returns the cache entry for the current scanline, or nullptr if it's
+// beyond the cached range
+static TextLineCache::Line* get_text_line_cache_entry()
+{
+	auto& cache = text_line_cache;
+
+	const TextLineCache::State state = {
+	        vga.dac.palette_generation,
+	        vga.draw.font_generation,
+	        {vga.draw.font_tables[0], vga.draw.font_tables[1]},
+	        vga.draw.blocks,
+	        vga.draw.blinking,
+	        vga.draw.blink,
+	        vga.draw.panning,
+	        static_cast<bool>(vga.seq.clocking_mode.is_eight_dot_mode),
+	        static_cast<bool>(vga.attr.mode_control.is_line_graphics_enabled),
+	        static_cast<uint8_t>(vga.crtc.underline_location & 0x1f)};
+
+	if (state != cache.state) {
+		cache.state = state;
+		for (auto& line : cache.lines) {
+			line.is_valid = false;
+		}
+	}
+
+	const auto line_idx = vga.draw.lines_done;
+	if (line_idx >= TextLineCache::MaxLines) {
+		return nullptr;
+	}
+	if (line_idx >= cache.lines.size()) {
+		cache.lines.resize(line_idx + 1);
+	}
+	return &cache.lines[line_idx];
+}
+
+// Draws the characters and attributes of a text mode scanline using the
+// cached glyph rows, returning the number of pixels written
+static uint16_t draw_text_cells(const uint8_t* vidmem, Bitu blocks,
+                                const Bitu line, uint8_t* line_buffer,
+                                const uint16_t draw_idx_start)
+{
+	const auto palette_map = vga.dac.palette_map;
+	const auto is_eight_dot_mode = vga.seq.clocking_mode.is_eight_dot_mode;
+
+	validate_glyph_row_cache();
 
 	// This holds the to-be-written pixel offset, and is incremented per
-	// pixel and also per character block.
+	// character block.
 	auto draw_idx = draw_idx_start;
 
 	while (blocks--) { // for each character in the line
 		const auto chr  = *vidmem++;
 		const auto attr = *vidmem++;
 		// the font pattern
-		uint16_t font = vga.draw.font_tables[(attr >> 3) & 1][(chr << 5) + line];
+		const uint8_t font = vga.draw.font_tables[(attr >> 3) & 1][(chr << 5) + line];
 
 		uint8_t bg_palette_idx = attr >> 4;
 		// if blinking is enabled bit7 is not mapped to attributes
@@ -838,39 +937,80 @@ static uint8_t* draw_text_line_from_dac_palette(Bitu vidstart, Bitu line)
 			bg_palette_idx = fg_palette_idx;
 		}
 
-		// The font's bits will indicate which color is used per pixel
-		const auto fg_colour = palette_map[fg_palette_idx];
-		const auto bg_colour = palette_map[bg_palette_idx];
+		// The font's bits indicate which color is used per pixel
+		const auto& row = get_glyph_row(font, fg_palette_idx, bg_palette_idx);
+		memcpy(&line_buffer[draw_idx * sizeof(Bgrx8888)], row.data(), sizeof(row));
+		draw_idx += check_cast<uint16_t>(row.size());
 
-		if (vga.seq.clocking_mode.is_eight_dot_mode) {
-			for (auto n = 0; n < 8; ++n) {
-				const auto color = (font & 0x80) ? fg_colour
-				                                 : bg_colour;
-				write_unaligned_uint32_at(TempLine, draw_idx++, color);
-				font <<= 1;
-			}
-		} else {
-			font <<= 1; // 9 pixels
+		if (!is_eight_dot_mode) {
 			// Extend to the 9th pixel if needed
-			if ((font & 0x2) &&
-			    vga.attr.mode_control.is_line_graphics_enabled &&
-			    (chr >= 0xc0) && (chr <= 0xdf)) {
-				font |= 1;
-			}
-			for (auto n = 0; n < 9; ++n) {
-				const auto color = (font & 0x100) ? fg_colour
-				                                  : bg_colour;
-				write_unaligned_uint32_at(TempLine, draw_idx++, color);
-				font <<= 1;
-			}
+			const bool is_extended = (font & 0x1) &&
+			                         vga.attr.mode_control.is_line_graphics_enabled &&
+			                         (chr >= 0xc0) && (chr <= 0xdf);
+			const auto color = palette_map[is_extended ? fg_palette_idx
+			                                           : bg_palette_idx];
+			write_unaligned_uint32_at(line_buffer, draw_idx++, color);
+		}
+	}
+	return draw_idx;
+}
+
+// combined 8/9-dot wide text mode line drawing function
+static uint8_t* draw_text_line_from_dac_palette(Bitu vidstart, Bitu line)
+{
+	// pointer to chars+attribs
+	const uint8_t* vidmem  = VGA_Text_Memwrap(vidstart);
+	const auto palette_map = vga.dac.palette_map;
+
+	auto blocks = vga.draw.blocks;
+	if (vga.draw.panning) {
+		++blocks; // if the text is panned part of an
+		          // additional character becomes visible
+	}
+	const auto num_cell_bytes = blocks * 2;
+
+	// The first write-index into the draw buffer. Increasing this shifts
+	// the console text right (and vice-versa)
+	const uint16_t draw_idx_start = 8 + vga.draw.panning;
+
+	// Reuse the previous frame's pixels if nothing changed on this
+	// scanline, otherwise draw them into the cache
+	uint8_t* line_buffer = TempLine;
+	size_t line_bytes    = 0;
+
+	auto cached = get_text_line_cache_entry();
+	if (cached && cached->is_valid && cached->font_row == line &&
+	    memcmp(cached->cells.data(), vidmem, num_cell_bytes) == 0) {
+		line_buffer = cached->pixels.data();
+		line_bytes  = cached->pixels.size();
+	} else {
+		if (cached) {
+			cached->cells.assign(vidmem, vidmem + num_cell_bytes);
+			cached->font_row = line;
+			cached->is_valid = true;
+
+			const auto max_pixels = draw_idx_start +
+			                        blocks * static_cast<uint8_t>(PixelsPerChar::Nine);
+			cached->pixels.resize(max_pixels * sizeof(Bgrx8888));
+			line_buffer = cached->pixels.data();
 		}
+		const auto num_pixels = draw_text_cells(
+		        vidmem, blocks, line, line_buffer, draw_idx_start);
+		line_bytes = num_pixels * sizeof(Bgrx8888);
 	}
+
 	// draw the text mode cursor if needed
 	if (!SkipCursor(vidstart, line)) {
 		// the adress of the attribute that makes up the cell the cursor is in
 		const auto attr_addr = check_cast<uint16_t>(
 		        (vga.draw.cursor.address - vidstart) >> 1);
 		if (attr_addr < vga.draw.blocks) {
+			// Keep the cached scanline free of the cursor
+			if (line_buffer != TempLine) {
+				memcpy(TempLine, line_buffer, line_bytes);
+				line_buffer = TempLine;
+			}
+
 			const auto fg_palette_idx =
 			        vga.tandy.draw_base[vga.draw.cursor.address + 1] & 0xf;
 			const auto fg_colour = palette_map[fg_palette_idx];
@@ -883,13 +1023,13 @@ static uint8_t* draw_text_line_from_dac_palette(Bitu vidstart, Bitu line)
 
 			auto draw_addr = &TempLine[cursor_draw_offset];
 
-			draw_idx = draw_idx_start;
+			auto draw_idx = draw_idx_start;
 			for (uint8_t n = 0; n < 8; ++n) {
 				write_unaligned_uint32_at(draw_addr, draw_idx++, fg_colour);
 			}
 		}
 	}
-	return TempLine + 32;
+	return line_buffer + 32;
 }
 
 #ifdef VGA_KEEP_CHANGES
@@ -931,6 +1071,8 @@ static void VGA_ProcessSplit()
 static uint8_t bg_color_index = 0; // screen-off black index
 static void VGA_DrawSingleLine(uint32_t /*blah*/)
 {
+	ZoneScoped;
+
 	if (vga.attr.disabled) {
 		switch(machine) {
 		case MCH_PCJR:
@@ -1029,6 +1171,8 @@ static void VGA_DrawSingleLine(uint32_t /*blah*/)
 
 static void VGA_DrawEGASingleLine(uint32_t /*blah*/)
 {
+	ZoneScoped;
+
 	if (vga.attr.disabled) {
 		std::fill(templine_buffer.begin(), templine_buffer.end(), 0);
 		ReelMagic_RENDER_DrawLine(TempLine);
@@ -1053,6 +1197,9 @@ static void VGA_DrawEGASingleLine(uint32_t /*blah*/)
 
 static void VGA_DrawPart(uint32_t lines)
 {
+	ZoneScoped;
+	ZoneValue(lines);
+
 	while (lines--) {
 		uint8_t * data=VGA_DrawLine( vga.draw.address, vga.draw.address_line );
 		ReelMagic_RENDER_DrawLine(data);
@@ -1158,6 +1305,10 @@ static void VGA_PanningLatch(uint32_t /*val*/)
 
 static void VGA_VerticalTimer(uint32_t /*val*/)
 {
+	// Marks the emulated frames, next to the host's frames marked when
+	// presenting
+	FrameMarkNamed("VGA frame");
+
 	vga.draw.delay.framestart = PIC_FullIndex();
 	PIC_AddEvent(VGA_VerticalTimer, vga.draw.delay.vtotal);
 
@@ -3026,3 +3177,16 @@ void VGA_SetOverride(const bool vga_override, const double override_refresh_hz)
 		}
 	}
 }
+
+void VGA_AddSnapshotEvents()
+{
+	PIC_AddSnapshotEventHandler(VGA_DrawSingleLine);
+	PIC_AddSnapshotEventHandler(VGA_DrawEGASingleLine);
+	PIC_AddSnapshotEventHandler(VGA_DrawPart);
+	PIC_AddSnapshotEventHandler(VGA_VertInterrupt);
+	PIC_AddSnapshotEventHandler(VGA_Other_VertInterrupt);
+	PIC_AddSnapshotEventHandler(VGA_DisplayStartLatch);
+	PIC_AddSnapshotEventHandler(VGA_PanningLatch);
+	PIC_AddSnapshotEventHandler(VGA_VerticalTimer);
+	PIC_AddSnapshotEventHandler(VGA_SetupDrawing);
+}
@@ -119,26 +119,103 @@ static struct {
 	Bitu base, mask;
 } vgapages;
 
-static void read_delay()
+static void read_delay(const size_t num_accesses = 1)
 {
 	if (vga.vmem_delay_ns > 0) {
 		const int32_t delay_cycles = (CPU_CycleMax * vga.vmem_delay_ns) /
 		                             1000000;
-		CPU_Cycles -= delay_cycles;
-		CPU_IODelayRemoved += delay_cycles;
+		CPU_Cycles -= delay_cycles * static_cast<int32_t>(num_accesses);
+		CPU_IODelayRemoved += delay_cycles * static_cast<int32_t>(num_accesses);
 	}
 }
 
-static void write_delay()
+static void write_delay(const size_t num_accesses = 1)
 {
 	if (vga.vmem_delay_ns > 0) {
 		const int32_t delay_cycles = (CPU_CycleMax * vga.vmem_delay_ns * 3) /
 		                             (1000000 * 4);
-		CPU_Cycles -= delay_cycles;
-		CPU_IODelayRemoved += delay_cycles;
+		CPU_Cycles -= delay_cycles * static_cast<int32_t>(num_accesses);
+		CPU_IODelayRemoved += delay_cycles * static_cast<int32_t>(num_accesses);
 	}
 }
 
+// Block accesses translate the address and account for the memory delay once
+// for the whole block, then replay the individual accesses against video
+// memory. The checked_t functions wrap the offset of each access the same way
+// the single accesses do.
+template <typename checked_t, typename read_t>
+static inline void read_accesses(const PhysPt start, uint8_t* dest,
+                                 const size_t num_bytes,
+                                 const uint8_t access_size,
+                                 checked_t checked, read_t read)
+{
+	read_delay(num_bytes / access_size);
+	for (size_t offset = 0; offset < num_bytes; offset += access_size) {
+		const PhysPt addr = checked(start + static_cast<PhysPt>(offset));
+		for (uint8_t i = 0; i < access_size; ++i) {
+			dest[offset + i] = read(addr + i);
+		}
+	}
+}
+
+template <typename checked_t, typename write_t>
+static inline void write_accesses(const PhysPt start, const uint8_t* src,
+                                  const size_t num_bytes,
+                                  const uint8_t access_size,
+                                  [[maybe_unused]] const uint8_t changed_shift,
+                                  checked_t checked, write_t write)
+{
+	write_delay(num_bytes / access_size);
+	for (size_t offset = 0; offset < num_bytes; offset += access_size) {
+		const PhysPt addr = checked(start + static_cast<PhysPt>(offset));
+		MEM_CHANGED(addr << changed_shift);
+		for (uint8_t i = 0; i < access_size; ++i) {
+			write(addr + i, src[offset + i]);
+		}
+	}
+}
+
+// Fills only write a single value, so the write mode is applied once and the
+// resulting plane data is stored for every byte
+template <typename checked_t, typename write_t>
+static inline void fill_accesses(const PhysPt start, const uint32_t data,
+                                 const size_t num_bytes,
+                                 const uint8_t access_size,
+                                 [[maybe_unused]] const uint8_t changed_shift,
+                                 checked_t checked, write_t write)
+{
+	write_delay(num_bytes / access_size);
+	for (size_t offset = 0; offset < num_bytes; offset += access_size) {
+		const PhysPt addr = checked(start + static_cast<PhysPt>(offset));
+		MEM_CHANGED(addr << changed_shift);
+		for (uint8_t i = 0; i < access_size; ++i) {
+			write(addr + i, data);
+		}
+	}
+}
+
+static inline PhysPt block_read_start(const PhysPt addr)
+{
+	return (PAGING_GetPhysicalAddress(addr) & vgapages.mask) +
+	       vga.svga.bank_read_full;
+}
+
+static inline PhysPt block_write_start(const PhysPt addr)
+{
+	return (PAGING_GetPhysicalAddress(addr) & vgapages.mask) +
+	       vga.svga.bank_write_full;
+}
+
+static inline PhysPt checked_linear(const PhysPt addr)
+{
+	return CHECKED(addr);
+}
+
+static inline PhysPt checked_planar(const PhysPt addr)
+{
+	return CHECKED2(addr);
+}
+
 class VGA_UnchainedRead_Handler : public PageHandler {
 public:
 	uint8_t readHandler(PhysPt start)
@@ -186,6 +263,14 @@ public:
 		                             (readHandler(addr + 2) << 16) |
 		                             (readHandler(addr + 3) << 24));
 	}
+
+	void readblock(PhysPt addr, uint8_t* dest, size_t num_bytes,
+	               uint8_t access_size) override
+	{
+		read_accesses(block_read_start(addr), dest, num_bytes, access_size,
+		              checked_planar,
+		              [this](PhysPt pos) { return readHandler(pos); });
+	}
 };
 
 class VGA_ChainedEGA_Handler final : public PageHandler {
@@ -220,7 +305,34 @@ public:
 	}
 public:	
 	VGA_ChainedEGA_Handler()  {
-		flags=PFLAG_NOCODE;
+		flags=PFLAG_NOCODE|PFLAG_BLOCKACCESS;
+	}
+
+	void readblock(PhysPt addr, uint8_t* dest, size_t num_bytes,
+	               uint8_t access_size) override
+	{
+		read_accesses(block_read_start(addr), dest, num_bytes, access_size,
+		              checked_linear,
+		              [this](PhysPt pos) { return readHandler(pos); });
+	}
+
+	void writeblock(PhysPt addr, const uint8_t* src, size_t num_bytes,
+	                uint8_t access_size) override
+	{
+		write_accesses(block_write_start(addr), src, num_bytes, access_size,
+		               3, checked_linear, [this](PhysPt pos, uint8_t data) {
+			               writeHandler(pos, data);
+		               });
+	}
+
+	void fillblock(PhysPt addr, uint8_t val, size_t num_bytes,
+	               uint8_t access_size) override
+	{
+		// Only the host data ends up in memory in this mode
+		fill_accesses(block_write_start(addr), val, num_bytes, access_size,
+		              3, checked_linear, [this](PhysPt pos, uint32_t data) {
+			              writeHandler(pos, static_cast<uint8_t>(data));
+		              });
 	}
 
 	void writeb(PhysPt addr, uint8_t val) override
@@ -292,7 +404,9 @@ public:
 class VGA_UnchainedEGA_Handler : public VGA_UnchainedRead_Handler {
 public:
 	void writeHandler(PhysPt start, uint8_t val) {
-		uint32_t data=ModeOperation(val);
+		writeData(start, ModeOperation(val));
+	}
+	void writeData(PhysPt start, uint32_t data) {
 		/* Update video memory and the pixel buffer */
 		VgaLatch pixels;
 		pixels.d=((uint32_t*)vga.mem.linear)[start];
@@ -320,7 +434,26 @@ public:
 	}
 public:	
 	VGA_UnchainedEGA_Handler()  {
-		flags=PFLAG_NOCODE;
+		flags=PFLAG_NOCODE|PFLAG_BLOCKACCESS;
+	}
+
+	void writeblock(PhysPt addr, const uint8_t* src, size_t num_bytes,
+	                uint8_t access_size) override
+	{
+		write_accesses(block_write_start(addr), src, num_bytes, access_size,
+		               3, checked_planar, [this](PhysPt pos, uint8_t data) {
+			               writeHandler(pos, data);
+		               });
+	}
+
+	void fillblock(PhysPt addr, uint8_t val, size_t num_bytes,
+	               uint8_t access_size) override
+	{
+		fill_accesses(block_write_start(addr), ModeOperation(val),
+		              num_bytes, access_size, 3, checked_planar,
+		              [this](PhysPt pos, uint32_t data) {
+			              writeData(pos, data);
+		              });
 	}
 
 	void writeb(PhysPt addr, uint8_t val) override
@@ -362,7 +495,7 @@ public:
 class VGA_ChainedVGA_Handler final : public PageHandler {
 public:
 	VGA_ChainedVGA_Handler()  {
-		flags=PFLAG_NOCODE;
+		flags=PFLAG_NOCODE|PFLAG_BLOCKACCESS;
 	}
 	static inline uint8_t *ToLinear(PhysPt addr)
 	{
@@ -514,12 +647,58 @@ public:
 		}
 		writeCache_dword(addr, val);
 	}
+
+	void readblock(PhysPt addr, uint8_t* dest, size_t num_bytes,
+	               uint8_t access_size) override
+	{
+		read_accesses(block_read_start(addr), dest, num_bytes, access_size,
+		              checked_linear,
+		              [](PhysPt pos) { return readHandler_byte(pos); });
+	}
+
+	// The bytes of an access end up in the same places whichever its size,
+	// only the replication of the first line is decided per access
+	template <typename src_t>
+	static inline void writeAccesses(const PhysPt start, const size_t num_bytes,
+	                                 const uint8_t access_size, src_t src_at)
+	{
+		write_delay(num_bytes / access_size);
+		for (size_t offset = 0; offset < num_bytes; offset += access_size) {
+			const PhysPt addr = CHECKED(start + static_cast<PhysPt>(offset));
+			MEM_CHANGED( addr );
+			const bool replicate = (addr < 320);
+			for (uint8_t i = 0; i < access_size; ++i) {
+				const auto val = src_at(offset + i);
+				writeHandler_byte(addr + i, val);
+				vga.fastmem[addr + i] = val;
+				if (replicate) {
+					vga.fastmem[addr + i + 64 * 1024] = val;
+				}
+			}
+		}
+	}
+
+	void writeblock(PhysPt addr, const uint8_t* src, size_t num_bytes,
+	                uint8_t access_size) override
+	{
+		writeAccesses(block_write_start(addr), num_bytes, access_size,
+		              [src](size_t offset) { return src[offset]; });
+	}
+
+	void fillblock(PhysPt addr, uint8_t val, size_t num_bytes,
+	               uint8_t access_size) override
+	{
+		writeAccesses(block_write_start(addr), num_bytes, access_size,
+		              [val](size_t) { return val; });
+	}
 };
 
 class VGA_UnchainedVGA_Handler final : public VGA_UnchainedRead_Handler {
 public:
 	void writeHandler( PhysPt addr, uint8_t val ) {
-		uint32_t data=ModeOperation(val);
+		writeData(addr, ModeOperation(val));
+	}
+	void writeData(PhysPt addr, uint32_t data) {
 		VgaLatch pixels;
 		pixels.d=((uint32_t*)vga.mem.linear)[addr];
 		pixels.d&=vga.config.full_not_map_mask;
@@ -530,7 +709,26 @@ public:
 	}
 public:
 	VGA_UnchainedVGA_Handler()  {
-		flags=PFLAG_NOCODE;
+		flags=PFLAG_NOCODE|PFLAG_BLOCKACCESS;
+	}
+
+	void writeblock(PhysPt addr, const uint8_t* src, size_t num_bytes,
+	                uint8_t access_size) override
+	{
+		write_accesses(block_write_start(addr), src, num_bytes, access_size,
+		               2, checked_planar, [this](PhysPt pos, uint8_t data) {
+			               writeHandler(pos, data);
+		               });
+	}
+
+	void fillblock(PhysPt addr, uint8_t val, size_t num_bytes,
+	               uint8_t access_size) override
+	{
+		fill_accesses(block_write_start(addr), ModeOperation(val),
+		              num_bytes, access_size, 2, checked_planar,
+		              [this](PhysPt pos, uint32_t data) {
+			              writeData(pos, data);
+		              });
 	}
 
 	void writeb(PhysPt addr, uint8_t val) override
@@ -597,9 +795,12 @@ public:
 
 		if (vga.seq.map_mask == 0x4) {
 			vga.draw.font[addr] = val;
+			++vga.draw.font_generation;
 		} else {
-			if (vga.seq.map_mask & 0x4) // font map
+			if (vga.seq.map_mask & 0x4) { // font map
 				vga.draw.font[addr] = val;
+				++vga.draw.font_generation;
+			}
 			if (vga.seq.map_mask & 0x2) // character attribute
 				vga.mem.linear[CHECKED3(vga.svga.bank_read_full +
 				                        addr + 1)] = val;
@@ -690,7 +891,43 @@ public:
 class VGA_LIN4_Handler final : public VGA_UnchainedEGA_Handler {
 public:
 	VGA_LIN4_Handler() {
-		flags=PFLAG_NOCODE;
+		flags=PFLAG_NOCODE|PFLAG_BLOCKACCESS;
+	}
+
+	static PhysPt checked_lin4(const PhysPt addr)
+	{
+		return CHECKED4(addr);
+	}
+
+	void readblock(PhysPt addr, uint8_t* dest, size_t num_bytes,
+	               uint8_t access_size) override
+	{
+		const auto start = vga.svga.bank_read_full +
+		                   (PAGING_GetPhysicalAddress(addr) & 0xffff);
+		read_accesses(start, dest, num_bytes, access_size, checked_lin4,
+		              [this](PhysPt pos) { return readHandler(pos); });
+	}
+
+	void writeblock(PhysPt addr, const uint8_t* src, size_t num_bytes,
+	                uint8_t access_size) override
+	{
+		const auto start = vga.svga.bank_write_full +
+		                   (PAGING_GetPhysicalAddress(addr) & 0xffff);
+		write_accesses(start, src, num_bytes, access_size, 3, checked_lin4,
+		               [this](PhysPt pos, uint8_t data) {
+			               writeHandler(pos, data);
+		               });
+	}
+
+	void fillblock(PhysPt addr, uint8_t val, size_t num_bytes,
+	               uint8_t access_size) override
+	{
+		const auto start = vga.svga.bank_write_full +
+		                   (PAGING_GetPhysicalAddress(addr) & 0xffff);
+		fill_accesses(start, ModeOperation(val), num_bytes, access_size, 3,
+		              checked_lin4, [this](PhysPt pos, uint32_t data) {
+			              writeData(pos, data);
+		              });
 	}
 	void writeb(PhysPt addr, uint8_t val) override
 	{
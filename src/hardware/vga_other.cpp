@@ -1357,6 +1357,7 @@ void VGA_SetupOther()
 			memcpy(&vga.draw.font[i * 32], &int10_font_08[i * 8], 8);
 		}
 		vga.draw.font_tables[0] = vga.draw.font_tables[1] = vga.draw.font;
+		++vga.draw.font_generation;
 	}
 	if (machine==MCH_CGA || IS_TANDY_ARCH || machine==MCH_HERC) {
 		IO_RegisterWriteHandler(0x3db, write_lightpen, io_width_t::byte);
@@ -1368,6 +1369,7 @@ void VGA_SetupOther()
 			memcpy(&vga.draw.font[i * 32], &int10_font_14[i * 14], 14);
 		}
 		vga.draw.font_tables[0] = vga.draw.font_tables[1] = vga.draw.font;
+		++vga.draw.font_generation;
 		MAPPER_AddHandler(cycle_hercules_palette, SDL_SCANCODE_F11, 0,
 		                  "hercpal", "Herc Pal");
 	}
@@ -0,0 +1,218 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "vga_palette_expand.h"
+
+#include <cstring>
+
+#include "host_cpu.h"
+
+static_assert(sizeof(Bgrx8888) == sizeof(uint32_t));
+
+using DacPaletteExpander = void (*)(const uint8_t* indexes, size_t num_pixels,
+                                    const Bgrx8888* palette_map, uint8_t* dest);
+
+using NibblePaletteExpander = void (*)(const uint8_t* src, size_t num_bytes,
+                                       const uint8_t* palette,
+                                       bool double_pixels, uint8_t* dest);
+
+// Scalar implementations
+// ~~~~~~~~~~~~~~~~~~~~~~
+static void expand_dac_palette_scalar(const uint8_t* indexes,
+                                      const size_t num_pixels,
+                                      const Bgrx8888* palette_map, uint8_t* dest)
+{
+	constexpr auto BytesPerPixel = sizeof(Bgrx8888);
+
+	// Draw in batches of four to let the host pipeline deeper
+	size_t i = 0;
+	for (; i + 4 <= num_pixels; i += 4) {
+		memcpy(dest + 0 * BytesPerPixel, palette_map + indexes[i + 0], BytesPerPixel);
+		memcpy(dest + 1 * BytesPerPixel, palette_map + indexes[i + 1], BytesPerPixel);
+		memcpy(dest + 2 * BytesPerPixel, palette_map + indexes[i + 2], BytesPerPixel);
+		memcpy(dest + 3 * BytesPerPixel, palette_map + indexes[i + 3], BytesPerPixel);
+		dest += 4 * BytesPerPixel;
+	}
+	for (; i < num_pixels; ++i) {
+		memcpy(dest, palette_map + indexes[i], BytesPerPixel);
+		dest += BytesPerPixel;
+	}
+}
+
+static void expand_nibble_palette_scalar(const uint8_t* src, const size_t num_bytes,
+                                         const uint8_t* palette,
+                                         const bool double_pixels, uint8_t* dest)
+{
+	if (double_pixels) {
+		for (size_t i = 0; i < num_bytes; ++i) {
+			const auto high = palette[src[i] >> 4];
+			const auto low  = palette[src[i] & 0x0f];
+			*dest++ = high;
+			*dest++ = high;
+			*dest++ = low;
+			*dest++ = low;
+		}
+	} else {
+		for (size_t i = 0; i < num_bytes; ++i) {
+			*dest++ = palette[src[i] >> 4];
+			*dest++ = palette[src[i] & 0x0f];
+		}
+	}
+}
+
+// x86 implementations
+// ~~~~~~~~~~~~~~~~~~~
+#if HOST_CPU_X86
+
+// Looks up eight pixels per gather
+HOST_CPU_TARGET("avx2") static void expand_dac_palette_avx2(
+        const uint8_t* indexes, const size_t num_pixels,
+        const Bgrx8888* palette_map, uint8_t* dest)
+{
+	const auto palette = reinterpret_cast<const int*>(palette_map);
+	constexpr auto Scale = static_cast<int>(sizeof(Bgrx8888));
+
+	size_t i = 0;
+	for (; i + 8 <= num_pixels; i += 8) {
+		const auto packed = _mm_loadl_epi64(
+		        reinterpret_cast<const __m128i*>(indexes + i));
+		const auto colours = _mm256_i32gather_epi32(palette,
+		                                            _mm256_cvtepu8_epi32(packed),
+		                                            Scale);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), colours);
+		dest += 8 * sizeof(Bgrx8888);
+	}
+	expand_dac_palette_scalar(indexes + i, num_pixels - i, palette_map, dest);
+}
+
+// Looks up both nibbles of 16 bytes with byte shuffles, using the 16-entry
+// palette as the shuffle table
+HOST_CPU_TARGET("ssse3") static void expand_nibble_palette_ssse3(
+        const uint8_t* src, const size_t num_bytes, const uint8_t* palette,
+        const bool double_pixels, uint8_t* dest)
+{
+	const auto table    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(palette));
+	const auto low_mask = _mm_set1_epi8(0x0f);
+
+	auto store = [&dest](const __m128i pixels) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), pixels);
+		dest += sizeof(__m128i);
+	};
+
+	size_t i = 0;
+	for (; i + 16 <= num_bytes; i += 16) {
+		const auto bytes = _mm_loadu_si128(
+		        reinterpret_cast<const __m128i*>(src + i));
+
+		const auto high = _mm_shuffle_epi8(
+		        table, _mm_and_si128(_mm_srli_epi16(bytes, 4), low_mask));
+		const auto low = _mm_shuffle_epi8(table, _mm_and_si128(bytes, low_mask));
+
+		const auto first  = _mm_unpacklo_epi8(high, low);
+		const auto second = _mm_unpackhi_epi8(high, low);
+		if (double_pixels) {
+			store(_mm_unpacklo_epi8(first, first));
+			store(_mm_unpackhi_epi8(first, first));
+			store(_mm_unpacklo_epi8(second, second));
+			store(_mm_unpackhi_epi8(second, second));
+		} else {
+			store(first);
+			store(second);
+		}
+	}
+	expand_nibble_palette_scalar(src + i, num_bytes - i, palette, double_pixels, dest);
+}
+
+#endif // HOST_CPU_X86
+
+// ARM implementations
+// ~~~~~~~~~~~~~~~~~~~
+#if HOST_CPU_NEON
+
+// NEON has no gather, so the DAC palette stays scalar; the nibble lookups use
+// the 16-entry palette as a table
+static void expand_nibble_palette_neon(const uint8_t* src, const size_t num_bytes,
+                                       const uint8_t* palette,
+                                       const bool double_pixels, uint8_t* dest)
+{
+	const auto table    = vld1q_u8(palette);
+	const auto low_mask = vdupq_n_u8(0x0f);
+
+	size_t i = 0;
+	for (; i + 16 <= num_bytes; i += 16) {
+		const auto bytes = vld1q_u8(src + i);
+		const auto high  = vqtbl1q_u8(table, vshrq_n_u8(bytes, 4));
+		const auto low   = vqtbl1q_u8(table, vandq_u8(bytes, low_mask));
+
+		if (double_pixels) {
+			const uint8x16x4_t pixels = {{high, high, low, low}};
+			vst4q_u8(dest, pixels);
+			dest += 4 * sizeof(uint8x16_t);
+		} else {
+			const uint8x16x2_t pixels = {{high, low}};
+			vst2q_u8(dest, pixels);
+			dest += 2 * sizeof(uint8x16_t);
+		}
+	}
+	expand_nibble_palette_scalar(src + i, num_bytes - i, palette, double_pixels, dest);
+}
+
+#endif // HOST_CPU_NEON
+
+// Runtime selection
+// ~~~~~~~~~~~~~~~~~
+static DacPaletteExpander select_dac_palette_expander()
+{
+#if HOST_CPU_X86
+	if (get_host_cpu_features().avx2) {
+		return expand_dac_palette_avx2;
+	}
+#endif
+	return expand_dac_palette_scalar;
+}
+
+static NibblePaletteExpander select_nibble_palette_expander()
+{
+#if HOST_CPU_X86
+	if (get_host_cpu_features().ssse3) {
+		return expand_nibble_palette_ssse3;
+	}
+#endif
+#if HOST_CPU_NEON
+	return expand_nibble_palette_neon;
+#else
+	return expand_nibble_palette_scalar;
+#endif
+}
+
+void VGA_ExpandDacPalette(const uint8_t* indexes, const size_t num_pixels,
+                          const Bgrx8888* palette_map, uint8_t* dest)
+{
+	static const auto expand = select_dac_palette_expander();
+	expand(indexes, num_pixels, palette_map, dest);
+}
+
+void VGA_ExpandNibblePalette(const uint8_t* src, const size_t num_bytes,
+                             const uint8_t* palette, const bool double_pixels,
+                             uint8_t* dest)
+{
+	static const auto expand = select_nibble_palette_expander();
+	expand(src, num_bytes, palette, double_pixels, dest);
+}
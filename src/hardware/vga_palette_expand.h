@@ -0,0 +1,44 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_VGA_PALETTE_EXPAND_H
+#define DOSBOX_VGA_PALETTE_EXPAND_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "bgrx8888.h"
+
+// Palette lookups of the VGA line drawers. The fastest implementation the
+// host CPU supports is selected at runtime.
+
+// Expands 8-bit palette indexes into the 32-bit colours of the 256-entry DAC
+// palette map.
+void VGA_ExpandDacPalette(const uint8_t* indexes, size_t num_pixels,
+                          const Bgrx8888* palette_map, uint8_t* dest);
+
+// Expands bytes of two packed 4-bit palette indexes (high nibble first) into
+// the 8-bit colours of the 16-entry attribute palette, optionally writing
+// every pixel twice.
+void VGA_ExpandNibblePalette(const uint8_t* src, size_t num_bytes,
+                             const uint8_t* palette, bool double_pixels,
+                             uint8_t* dest);
+
+#endif
@@ -73,6 +73,8 @@
   TODO: Import and adapt Aaron's latest MAME Voodoo sources.
 */
 
+#include "voodoo.h"
+
 #include "dosbox.h"
 
 #include <algorithm>
@@ -84,6 +86,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #include <SDL.h>
 #include <SDL_cpuinfo.h> // for proper SSE defines for MSVC
@@ -103,6 +107,7 @@
 #include "pci_bus.h"
 #include "pic.h"
 #include "render.h"
+#include "rwqueue.h"
 #include "setup.h"
 #include "support.h"
 #include "vga.h"
@@ -943,6 +948,38 @@ struct triangle_worker
 	std::atomic<int> done_count = 0;
 };
 
+// Writes to the card are queued here in asynchronous mode, mirroring the real
+// card's PCI FIFO, and executed by the Voodoo thread. The emulation thread
+// collects them into batches to keep the locking overhead per write low.
+struct command_fifo
+{
+	std::thread thread = {};
+
+	// When full, the emulation thread stalls like the CPU does on a full
+	// PCI FIFO
+	RWQueue<VoodooWriteBatch> batches{64};
+	RWQueue<VoodooWriteBatch> spare_batches{64};
+
+	VoodooWriteBatch pending = {};
+
+	std::mutex mutex                = {};
+	std::condition_variable drained = {};
+	size_t num_queued               = 0;
+	size_t num_processed            = 0;
+
+	// Held by the Voodoo thread while it executes a batch, so the emulation
+	// thread can scan out the frame buffer in between
+	std::mutex execute_mutex = {};
+
+	// Writes handed to the FIFO by the emulation thread and executed by the
+	// Voodoo thread; the difference is what the status register reports as
+	// the FIFO fill level
+	uint64_t num_writes_queued                = 0;
+	std::atomic<uint64_t> num_writes_executed = 0;
+
+	bool is_running = false;
+};
+
 struct voodoo_state
 {
 	voodoo_state(const int num_threads)
@@ -993,6 +1030,8 @@ struct voodoo_state
 	draw_state draw = {};
 	triangle_worker tworker;
 	std::vector<stats_block> thread_stats = {};
+
+	command_fifo cmd_fifo = {};
 };
 
 #ifdef C_ENABLE_VOODOO_OPENGL
@@ -3056,6 +3095,7 @@ static voodoo_state* v = nullptr;
 static auto vtype = VOODOO_1;
 
 static auto voodoo_bilinear_filtering = false;
+static auto voodoo_async              = false;
 
 #define LOG_VOODOO LOG_PCI
 enum {
@@ -6841,19 +6881,29 @@ static uint32_t register_r(const uint32_t offset)
 	/* some registers are dynamic; compute them */
 	switch (regnum)
 	{
-		case status:
-
+		case status: {
 			/* start with a blank slate */
 			result = 0;
 
+			// Writes the Voodoo thread hasn't executed yet count as
+			// sitting in the FIFOs, so Glide's idle polls wait for them
+			const auto& fifo = v->cmd_fifo;
+			const auto num_writes_pending = fifo.is_running
+			        ? fifo.num_writes_queued - fifo.num_writes_executed
+			        : 0;
+
+			constexpr uint64_t PciFifoSize    = 0x3f;
+			constexpr uint64_t MemoryFifoSize = 0xffff;
+
 			/* bits 5:0 are the PCI FIFO free space */
-			result |= 0x3f << 0;
+			result |= static_cast<uint32_t>(
+			        PciFifoSize - std::min(num_writes_pending, PciFifoSize));
 
 			/* bit 6 is the vertical retrace */
 			//result |= v->fbi.vblank << 6;
 			result |= (Voodoo_GetRetrace() ? 0x40 : 0);
 
-			if (v->pci.op_pending) {
+			if (v->pci.op_pending || num_writes_pending > 0) {
 				// bit 7 is FBI graphics engine busy
 				// bit 8 is TREX busy
 				// bit 9 is overall busy
@@ -6864,7 +6914,10 @@ static uint32_t register_r(const uint32_t offset)
 			result |= v->fbi.frontbuf << 10;
 
 			/* bits 27:12 indicate memory FIFO freespace */
-			result |= 0xffff << 12;
+			result |= static_cast<uint32_t>(
+			                  MemoryFifoSize -
+			                  std::min(num_writes_pending, MemoryFifoSize))
+			       << 12;
 
 			/* bits 30:28 are the number of pending swaps */
 			// result |= 0 << 28; // TODO: pending swaps are not currently trackedgit
@@ -6873,6 +6926,7 @@ static uint32_t register_r(const uint32_t offset)
 
 
 			break;
+		}
 
 		case hvRetrace:
 			if (vtype < VOODOO_2) {
@@ -7019,10 +7073,9 @@ constexpr uint32_t next_addr(const uint32_t addr)
 	return addr + next_offset;
 }
 
-static void voodoo_w(const uint32_t addr, const uint32_t data, const uint32_t mask)
+static void execute_write(const uint32_t offset, const uint32_t data,
+                          const uint32_t mask)
 {
-	const auto offset = (addr >> 2) & offset_mask;
-
 	if ((offset & offset_base) == 0) {
 		register_w(offset, data);
 	} else if ((offset & lfb_base) == 0) {
@@ -7032,10 +7085,174 @@ static void voodoo_w(const uint32_t addr, const uint32_t data, const uint32_t ma
 	}
 }
 
-static constexpr uint32_t voodoo_r(const uint32_t addr)
+/*************************************
+ *
+ *  Command FIFO
+ *
+ *************************************/
+
+// Up to this many writes are handed over to the Voodoo thread at once
+constexpr size_t CommandBatchSize = 256;
+
+static void command_fifo_thread_func()
+{
+	auto& fifo = v->cmd_fifo;
+
+	while (auto batch = fifo.batches.Dequeue()) {
+		{
+			std::lock_guard<std::mutex> lock(fifo.execute_mutex);
+			for (const auto& write : *batch) {
+				execute_write(write.offset, write.data, write.mask);
+			}
+		}
+		fifo.num_writes_executed += batch->size();
+		batch->clear();
+		fifo.spare_batches.NonblockingEnqueue(std::move(*batch));
+		{
+			std::lock_guard<std::mutex> lock(fifo.mutex);
+			++fifo.num_processed;
+		}
+		fifo.drained.notify_one();
+	}
+}
+
+// Hands the pending writes over to the Voodoo thread without waiting
+static void command_fifo_flush()
+{
+	auto& fifo = v->cmd_fifo;
+	if (!fifo.is_running || fifo.pending.empty()) {
+		return;
+	}
+
+	VoodooWriteBatch batch = {};
+	if (!fifo.spare_batches.IsEmpty()) {
+		batch = std::move(*fifo.spare_batches.Dequeue());
+	}
+	std::swap(batch, fifo.pending);
+	fifo.pending.reserve(CommandBatchSize);
+
+	++fifo.num_queued;
+	fifo.batches.Enqueue(std::move(batch));
+}
+
+// Blocks until the Voodoo thread has executed all the queued writes, after
+// which the emulation thread has the card's state to itself
+static void command_fifo_drain()
+{
+	auto& fifo = v->cmd_fifo;
+	if (!fifo.is_running) {
+		return;
+	}
+	command_fifo_flush();
+
+	std::unique_lock<std::mutex> lock(fifo.mutex);
+	fifo.drained.wait(lock, [&fifo] {
+		return fifo.num_processed == fifo.num_queued;
+	});
+}
+
+static void command_fifo_start()
+{
+	auto& fifo = v->cmd_fifo;
+	if (fifo.is_running) {
+		return;
+	}
+	fifo.pending.reserve(CommandBatchSize);
+	fifo.batches.Clear();
+	fifo.batches.Start();
+
+	fifo.num_queued          = 0;
+	fifo.num_processed       = 0;
+	fifo.num_writes_queued   = 0;
+	fifo.num_writes_executed = 0;
+	fifo.is_running          = true;
+
+	fifo.thread = std::thread(command_fifo_thread_func);
+	set_thread_name(fifo.thread, "dosbox:voodoo");
+}
+
+static void command_fifo_stop()
+{
+	auto& fifo = v->cmd_fifo;
+	if (!fifo.is_running) {
+		return;
+	}
+	command_fifo_drain();
+
+	fifo.batches.Stop();
+	fifo.thread.join();
+	fifo.is_running = false;
+}
+
+// Writes to these registers bypass the FIFO on the real card, or affect what
+// the emulation thread displays, so they're executed by the emulation thread
+// once the FIFO has drained.
+static bool is_synchronous_register(const uint32_t offset)
+{
+	// The aliased register map only covers the first 64 registers, so the
+	// register number can be taken as-is
+	switch (offset & 0xff) {
+	case swapbufferCMD:
+	case hSync:
+	case vSync:
+	case backPorch:
+	case videoDimensions:
+	case fbiInit0:
+	case fbiInit1:
+	case fbiInit2:
+	case fbiInit3:
+	case fbiInit4:
+	case fbiInit5:
+	case fbiInit6:
+	case fbiInit7: return true;
+	default: return false;
+	}
+}
+
+static void voodoo_w(const uint32_t addr, const uint32_t data, const uint32_t mask)
+{
+	const auto offset = (addr >> 2) & offset_mask;
+
+	auto& fifo = v->cmd_fifo;
+	if (!fifo.is_running) {
+		execute_write(offset, data, mask);
+		return;
+	}
+
+	if ((offset & offset_base) == 0 && is_synchronous_register(offset)) {
+		command_fifo_drain();
+		execute_write(offset, data, mask);
+		return;
+	}
+
+	fifo.pending.push_back({offset, data, mask});
+	++fifo.num_writes_queued;
+	if (fifo.pending.size() >= CommandBatchSize) {
+		command_fifo_flush();
+	}
+}
+
+// The status and retrace registers are kept up to date by the emulation
+// thread, and status reports the FIFO fill level, so polling them doesn't wait
+// for the FIFO to drain
+static bool can_read_while_busy(const uint32_t offset)
+{
+	const auto regnum = offset & 0xff;
+	return (offset & offset_base) == 0 && (regnum == status || regnum == hvRetrace);
+}
+
+static uint32_t voodoo_r(const uint32_t addr)
 {
 	const auto offset = (addr >> 2) & offset_mask;
 
+	if (can_read_while_busy(offset)) {
+		// Programs poll the status until the card is idle, so the
+		// partial batch mustn't wait for the next vertical timer
+		command_fifo_flush();
+	} else {
+		command_fifo_drain();
+	}
+
 	if ((offset & offset_base) == 0) {
 		return register_r(offset);
 	}
@@ -7323,6 +7540,12 @@ static void Voodoo_VerticalTimer(uint32_t /*val*/)
 	v->draw.frame_start = PIC_FullIndex();
 	PIC_AddEvent(Voodoo_VerticalTimer, v->draw.frame_period_ms);
 
+	// Don't leave a partial batch of writes waiting until the next swap.
+	// The front buffer is scanned out without waiting for the FIFO to
+	// drain, so drawing into it shows up as it progresses, as on the real
+	// card.
+	command_fifo_flush();
+
 	if (v->fbi.vblank_flush_pending) {
 		voodoo_vblank_flush();
 #ifdef C_ENABLE_VOODOO_OPENGL
@@ -7347,12 +7570,20 @@ static void Voodoo_VerticalTimer(uint32_t /*val*/)
 		r.max_y = (int)v->fbi.height;
 #endif
 
-		// draw all lines at once
-		auto* viewbuf = (uint16_t*)(v->fbi.ram +
-		                            v->fbi.rgboffs[v->fbi.frontbuf]);
-		for(Bitu i = 0; i < v->fbi.height; i++) {
-			RENDER_DrawLine((uint8_t*)viewbuf);
-			viewbuf += v->fbi.rowpixels;
+		// draw all lines at once, in between the batches the Voodoo
+		// thread executes
+		{
+			std::unique_lock<std::mutex> lock(v->cmd_fifo.execute_mutex,
+			                                  std::defer_lock);
+			if (v->cmd_fifo.is_running) {
+				lock.lock();
+			}
+			auto* viewbuf = (uint16_t*)(v->fbi.ram +
+			                            v->fbi.rgboffs[v->fbi.frontbuf]);
+			for (Bitu i = 0; i < v->fbi.height; i++) {
+				RENDER_DrawLine((uint8_t*)viewbuf);
+				viewbuf += v->fbi.rowpixels;
+			}
 		}
 		RENDER_EndUpdate(false);
 	}
@@ -7845,6 +8076,8 @@ static void voodoo_shutdown()
 	}
 #endif
 
+	command_fifo_stop();
+
 	v->active = false;
 	triangle_worker_shutdown(v->tworker);
 
@@ -7866,6 +8099,16 @@ static void Voodoo_Startup() {
 
 	v->tworker.disable_bilinear_filter = (voodoo_bilinear_filtering == false);
 
+	// The OpenGL context is bound to the emulation thread, so only the
+	// software renderer can run asynchronously
+	if (voodoo_async
+#ifdef C_ENABLE_VOODOO_OPENGL
+	    && !v->ogl
+#endif
+	) {
+		command_fifo_start();
+	}
+
 	// Switch the pagehandler now that v has been allocated and is in use
 	voodoo_pagehandler = &voodoo_real_pagehandler;
 	PAGING_InitTLB();
@@ -7893,6 +8136,7 @@ void VOODOO_Init(Section* sec)
 	vtype = (memsize_pref == "4" ? VOODOO_1 : VOODOO_1_DTMU);
 
 	voodoo_bilinear_filtering = section->Get_bool("voodoo_bilinear_filtering");
+	voodoo_async = section->Get_bool("voodoo_async");
 
 	sec->AddDestroyFunction(&VOODOO_Destroy,false);
 
@@ -7907,9 +8151,11 @@ void VOODOO_Init(Section* sec)
 	// Log the startup
 	const auto num_threads = get_num_total_threads();
 
-	LOG_MSG("VOODOO: Initialized with %s MB of RAM, %d %s, and %sbilinear filtering",
+	LOG_MSG("VOODOO: Initialized with %s MB of RAM, %d %s, %sbilinear filtering, "
+	        "and %s command processing",
 	        memsize_pref.c_str(),
 	        num_threads,
 	        num_threads == 1 ? "thread" : "threads",
-	        (voodoo_bilinear_filtering ? "" : "no "));
+	        (voodoo_bilinear_filtering ? "" : "no "),
+	        (voodoo_async ? "asynchronous" : "synchronous"));
 }
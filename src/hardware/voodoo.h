@@ -0,0 +1,39 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_VOODOO_H
+#define DOSBOX_VOODOO_H
+
+#include <cstdint>
+#include <vector>
+
+// A write to the Voodoo's registers, linear frame buffer, or texture memory,
+// as queued in the command FIFO. The offset is in 32-bit words from the
+// start of the card's memory space.
+struct VoodooWrite {
+	uint32_t offset = 0;
+	uint32_t data   = 0;
+	uint32_t mask   = 0;
+};
+
+// The command FIFO hands writes over to the Voodoo thread in batches
+using VoodooWriteBatch = std::vector<VoodooWrite>;
+
+#endif
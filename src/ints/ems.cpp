@@ -32,6 +32,7 @@
 #include "inout.h"
 #include "dos_inc.h"
 #include "setup.h"
+#include "snapshot.h"
 #include "support.h"
 #include "cpu.h"
 #include "dma.h"
@@ -1550,6 +1551,31 @@ public:
 	}
 };
 
+static void ems_save_snapshot(SnapshotWriter& writer)
+{
+	writer.Write(ems_type);
+	writer.Write(emm_handles);
+	writer.Write(emm_mappings);
+	writer.Write(emm_segmentmappings);
+	writer.Write(vcpi);
+	writer.Write(GEMMIS_seg);
+}
+
+static void ems_load_snapshot(SnapshotReader& reader)
+{
+	reader.Read(ems_type);
+	reader.Read(emm_handles);
+	reader.Read(emm_mappings);
+	reader.Read(emm_segmentmappings);
+	reader.Read(vcpi);
+	reader.Read(GEMMIS_seg);
+
+	// The paging state was rebuilt without the page frame mappings
+	if (ems_type > 0) {
+		EMM_RestoreMappingTable();
+	}
+}
+
 static EMS* test;
 
 void EMS_ShutDown(Section* /*sec*/) {
@@ -1564,4 +1590,6 @@ void EMS_Init(Section* sec)
 
 	constexpr auto changeable_at_runtime = true;
 	sec->AddDestroyFunction(&EMS_ShutDown, changeable_at_runtime);
+
+	SNAPSHOT_AddComponent("ems", ems_save_snapshot, ems_load_snapshot);
 }
@@ -31,6 +31,11 @@ Int10Data int10;
 static callback_number_t call_10 = 0;
 static bool warned_ff=false;
 
+bool INT10_IsVectorHooked()
+{
+	return RealGetVec(0x10) != CALLBACK_RealPointer(call_10);
+}
+
 static Bitu INT10_Handler(void) {
 #if 0
 	switch (reg_ah) {
@@ -927,4 +932,6 @@ void INT10_Init(Section* /*sec*/) {
 	INT10_SetupRomMemory();
 	INT10_Seg40Init();
 	INT10_SetVideoMode(0x3);
+
+	INT10_AddSnapshotComponent();
 }
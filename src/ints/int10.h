@@ -21,6 +21,7 @@
 
 #include "dosbox.h"
 
+#include <optional>
 #include <vector>
 
 #include "bit_view.h"
@@ -337,8 +338,13 @@ bool INT10_SetVideoMode(uint16_t mode);
 void INT10_SetCurMode(void);
 bool INT10_VideoModeChangeInProgress();
 
+void INT10_AddSnapshotComponent();
+
 bool INT10_IsTextMode(const VideoModeBlock& mode_block);
 
+// Returns true if a program has taken over the INT 10h vector
+bool INT10_IsVectorHooked();
+
 void INT10_ScrollWindow(uint8_t rul,uint8_t cul,uint8_t rlr,uint8_t clr,int8_t nlines,uint8_t attr,uint8_t page);
 
 void INT10_SetActivePage(uint8_t page);
@@ -361,6 +367,18 @@ void INT10_TeletypeOutputAttrViaInterrupt(const uint8_t char_value,
                                           const uint8_t attribute,
                                           const bool use_attribute);
 
+// Outputs a run of characters to the current page of a text mode with the
+// same result as teletype outputting them one by one, but updates video
+// memory and the cursor only once. Tabs are expanded to the next multiple of
+// eight columns with `expand_tabs`. The lines scrolled in get
+// `scroll_attribute` if set, otherwise the attribute at the cursor, like in
+// the teletype function. The text must not contain bells. Returns false,
+// without any output, if the current mode or cursor state isn't supported.
+bool INT10_TeletypeOutputText(const uint8_t* text, const size_t count,
+                              const uint8_t attribute, const bool use_attribute,
+                              const bool expand_tabs,
+                              const std::optional<uint8_t> scroll_attribute);
+
 void INT10_ReadCharAttr(uint16_t* result, uint8_t page);
 
 void INT10_WriteChar(const uint8_t char_value, const uint8_t attribute,
@@ -21,6 +21,13 @@
 
 #include "int10.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+#include "ascii.h"
 #include "bios.h"
 #include "callback.h"
 #include "inout.h"
@@ -92,9 +99,13 @@ static void VGA_CopyRow(uint8_t cleft,uint8_t cright,uint8_t rold,uint8_t rnew,P
 	src=base+8*((CurMode->twidth*rold)*cheight+cleft);
 	Bitu nextline=8*CurMode->twidth;
 	Bitu rowsize=8*(cright-cleft);
+	// Chained reads have no side effects, so the lines can be copied
+	// through a buffer
+	std::vector<uint8_t> line(rowsize);
 	copy=cheight;
 	for (;copy>0;copy--) {
-		for (Bitu x=0;x<rowsize;x++) mem_writeb(dest+x,mem_readb(src+x));
+		MEM_BlockRead(src, line.data(), rowsize);
+		MEM_BlockWrite(dest, line.data(), rowsize);
 		dest+=nextline;src+=nextline;
 	}
 }
@@ -113,10 +124,8 @@ static void CGA2_FillRow(uint8_t cleft,uint8_t cright,uint8_t row,PhysPt base,ui
 	Bitu nextline=CurMode->twidth;
 	attr=(attr & 0x3) | ((attr & 0x3) << 2) | ((attr & 0x3) << 4) | ((attr & 0x3) << 6);
 	for (Bitu i=0;i<cheight/2U;i++) {
-		for (Bitu x=0;x<copy;x++) {
-			mem_writeb(dest+x,attr);
-			mem_writeb(dest+8*1024+x,attr);
-		}
+		MEM_BlockFill(dest,attr,copy);
+		MEM_BlockFill(dest+8*1024,attr,copy);
 		dest+=nextline;
 	}
 }
@@ -127,10 +136,8 @@ static void CGA4_FillRow(uint8_t cleft,uint8_t cright,uint8_t row,PhysPt base,ui
 	Bitu copy=(cright-cleft)*2;Bitu nextline=CurMode->twidth*2;
 	attr=(attr & 0x3) | ((attr & 0x3) << 2) | ((attr & 0x3) << 4) | ((attr & 0x3) << 6);
 	for (Bitu i=0;i<cheight/2U;i++) {
-		for (Bitu x=0;x<copy;x++) {
-			mem_writeb(dest+x,attr);
-			mem_writeb(dest+8*1024+x,attr);
-		}
+		MEM_BlockFill(dest,attr,copy);
+		MEM_BlockFill(dest+8*1024,attr,copy);
 		dest+=nextline;
 	}
 }
@@ -142,9 +149,7 @@ static void TANDY16_FillRow(uint8_t cleft,uint8_t cright,uint8_t row,PhysPt base
 	Bitu copy=(cright-cleft)*4;Bitu nextline=CurMode->twidth*4;
 	attr=(attr & 0xf) | (attr & 0xf) << 4;
 	for (Bitu i=0;i<static_cast<Bitu>(cheight/banks);i++) {
-		for (Bitu x=0;x<copy;x++) {
-			for (Bitu b=0;b<banks;b++) mem_writeb(dest+b*8*1024+x,attr);
-		}
+		for (Bitu b=0;b<banks;b++) MEM_BlockFill(dest+b*8*1024,attr,copy);
 		dest+=nextline;
 	}
 }
@@ -162,7 +167,7 @@ static void EGA16_FillRow(uint8_t cleft,uint8_t cright,uint8_t row,PhysPt base,u
 	Bitu nextline=CurMode->twidth;
 	Bitu copy = cheight;Bitu rowsize=(cright-cleft);
 	for (;copy>0;copy--) {
-		for (Bitu x=0;x<rowsize;x++) mem_writeb(dest+x,0xff);
+		MEM_BlockFill(dest,0xff,rowsize);
 		dest+=nextline;
 	}
 	IO_Write(0x3cf,0);
@@ -175,7 +180,7 @@ static void VGA_FillRow(uint8_t cleft,uint8_t cright,uint8_t row,PhysPt base,uin
 	Bitu nextline=8*CurMode->twidth;
 	Bitu copy = cheight;Bitu rowsize=8*(cright-cleft);
 	for (;copy>0;copy--) {
-		for (Bitu x=0;x<rowsize;x++) mem_writeb(dest+x,attr);
+		MEM_BlockFill(dest,attr,rowsize);
 		dest+=nextline;
 	}
 }
@@ -859,6 +864,138 @@ void INT10_TeletypeOutputViaInterrupt(const uint8_t char_value, const uint8_t at
 	reg_bx = old_bx;
 }
 
+bool INT10_TeletypeOutputText(const uint8_t* text, const size_t count,
+                              const uint8_t attribute, const bool use_attribute,
+                              const bool expand_tabs,
+                              const std::optional<uint8_t> scroll_attribute)
+{
+	if (CurMode->type != M_TEXT) {
+		return false;
+	}
+	const auto page = real_readb(BIOSMEM_SEG, BIOSMEM_CURRENT_PAGE);
+	if (CurMode->ptotal == 1 && page != 0) {
+		return false;
+	}
+	BIOS_NCOLS;
+	BIOS_NROWS;
+	uint8_t cur_row = CURSOR_POS_ROW(page);
+	uint8_t cur_col = CURSOR_POS_COL(page);
+	if (cur_row >= nrows || cur_col >= ncols) {
+		// Leave the odd cases to the regular teletype function
+		return false;
+	}
+
+	// The cursor moves the same way whatever is on the screen, so a quick
+	// first pass finds the rows the run touches. Video memory only has to
+	// be read and written for those, unless the run scrolls the screen.
+	auto move_cursor = [&](const uint8_t chr, uint8_t& row, uint8_t& col) {
+		switch (chr) {
+		case 8:
+			if (col > 0) {
+				col--;
+			}
+			break;
+		case '\r': col = 0; break;
+		case '\n': row++; break;
+		default: col++;
+		}
+		if (col == ncols) {
+			col = 0;
+			row++;
+		}
+		if (row == nrows) {
+			row--;
+			return true;
+		}
+		return false;
+	};
+	auto for_each_output_char = [&](auto&& output) {
+		for (size_t i = 0; i < count; ++i) {
+			const auto chr = text[i];
+			assert(chr != Ascii::Bell);
+			if (chr == '\t' && expand_tabs) {
+				do {
+					output(' ');
+				} while (cur_col % 8);
+			} else {
+				output(chr);
+			}
+		}
+	};
+
+	const auto start_row = cur_row;
+	const auto start_col = cur_col;
+
+	auto last_row    = cur_row;
+	auto is_scrolled = false;
+	for_each_output_char([&](const uint8_t chr) {
+		is_scrolled |= move_cursor(chr, cur_row, cur_col);
+		last_row = std::max(last_row, cur_row);
+	});
+	cur_row = start_row;
+	cur_col = start_col;
+
+	const size_t first_row = is_scrolled ? 0 : start_row;
+	const size_t num_rows  = is_scrolled ? nrows : last_row - start_row + 1u;
+
+	// The page is edited in a buffer that holds a few screens worth of
+	// lines. Scrolling only moves the start of the visible lines down,
+	// and the lines are moved back to the top when the buffer is full.
+	const size_t row_bytes    = ncols * 2;
+	const size_t screen_bytes = nrows * row_bytes;
+	const size_t buffer_rows  = nrows * 4;
+
+	static std::vector<uint8_t> buffer = {};
+	buffer.resize(buffer_rows * row_bytes);
+
+	const PhysPt base = CurMode->pstart +
+	                    page * real_readw(BIOSMEM_SEG, BIOSMEM_PAGE_SIZE);
+	const auto first_byte = first_row * row_bytes;
+	const auto num_bytes  = num_rows * row_bytes;
+	MEM_BlockRead(base + first_byte, buffer.data() + first_byte, num_bytes);
+
+	size_t top_row = 0;
+	auto cell = [&](const size_t row, const size_t col) {
+		return buffer.data() + (top_row + row) * row_bytes + col * 2;
+	};
+
+	auto scroll_up = [&](const uint8_t fill) {
+		if (top_row + nrows == buffer_rows) {
+			memmove(buffer.data(), cell(1, 0), screen_bytes - row_bytes);
+			top_row = 0;
+		} else {
+			++top_row;
+		}
+		auto new_row = cell(nrows - 1, 0);
+		for (size_t col = 0; col < ncols; ++col) {
+			new_row[col * 2]     = ' ';
+			new_row[col * 2 + 1] = fill;
+		}
+	};
+
+	// Same as teletype_output_attr(), minus the bell
+	for_each_output_char([&](const uint8_t chr) {
+		const auto row = cur_row;
+		const auto col = cur_col;
+		if (chr != 8 && chr != '\r' && chr != '\n') {
+			cell(row, col)[0] = chr;
+			if (use_attribute) {
+				cell(row, col)[1] = attribute;
+			}
+		}
+		if (move_cursor(chr, cur_row, cur_col)) {
+			// Without a scroll attribute, the attribute at the cursor
+			// is used
+			scroll_up(scroll_attribute ? *scroll_attribute
+			                           : cell(row, col)[1]);
+		}
+	});
+
+	MEM_BlockWrite(base + first_byte, cell(first_row, 0), num_bytes);
+	INT10_SetCursorPos(cur_row, cur_col, page);
+	return true;
+}
+
 void INT10_WriteString(uint8_t row,uint8_t col,uint8_t flag,uint8_t attr,PhysPt string,uint16_t count,uint8_t page) {
 	uint8_t cur_row=CURSOR_POS_ROW(page);
 	uint8_t cur_col=CURSOR_POS_COL(page);
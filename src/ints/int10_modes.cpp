@@ -33,6 +33,7 @@
 #include "rgb666.h"
 #include "rgb888.h"
 #include "setup.h"
+#include "snapshot.h"
 #include "string_utils.h"
 #include "vga.h"
 #include "video.h"
@@ -661,6 +662,28 @@ static void init_all_palettes(const cga_colors_t& cga_colors)
 
 video_mode_block_iterator_t CurMode = std::prev(ModeList_VGA.end());
 
+// CurMode points into one of the mode lists, so it's saved as the list's
+// position here and the index within it. The lists themselves only depend
+// on the configuration.
+static const std::array<std::vector<VideoModeBlock>*, 8> snapshot_mode_lists = {
+        &ModeList_VGA,
+        &ModeList_VGA_Text_200lines,
+        &ModeList_VGA_Text_350lines,
+        &ModeList_VGA_Tseng,
+        &ModeList_VGA_Paradise,
+        &ModeList_EGA,
+        &ModeList_OTHER,
+        &Hercules_Mode,
+};
+
+static void int10_save_snapshot(SnapshotWriter& writer);
+static void int10_load_snapshot(SnapshotReader& reader);
+
+void INT10_AddSnapshotComponent()
+{
+	SNAPSHOT_AddComponent("int10", int10_save_snapshot, int10_load_snapshot);
+}
+
 static void log_invalid_video_mode_error(const uint16_t mode) {
 	LOG_ERR("INT10H: Trying to set invalid video mode: %02Xh", mode);
 }
@@ -672,6 +695,48 @@ bool INT10_VideoModeChangeInProgress()
 	return video_mode_change_in_progress;
 }
 
+static void int10_save_snapshot(SnapshotWriter& writer)
+{
+	// Iterators into different containers can't be compared, so look
+	// for the block itself
+	auto find_cur_mode = [](uint8_t& list_num, uint32_t& mode_num) {
+		const auto cur_mode_block = &*CurMode;
+		for (list_num = 0; list_num < snapshot_mode_lists.size(); ++list_num) {
+			const auto& list = *snapshot_mode_lists[list_num];
+			for (mode_num = 0; mode_num < list.size(); ++mode_num) {
+				if (&list[mode_num] == cur_mode_block) {
+					return true;
+				}
+			}
+		}
+		return false;
+	};
+	uint8_t list_num  = 0;
+	uint32_t mode_num = 0;
+	if (!find_cur_mode(list_num, mode_num)) {
+		E_Exit("INT10: The current video mode isn't in any mode list");
+	}
+	writer.Write(list_num);
+	writer.Write(mode_num);
+
+	writer.Write(int10);
+	writer.Write(video_mode_change_in_progress);
+}
+
+static void int10_load_snapshot(SnapshotReader& reader)
+{
+	const auto list_num = reader.Read<uint8_t>();
+	const auto mode_num = reader.Read<uint32_t>();
+	if (list_num >= snapshot_mode_lists.size() ||
+	    mode_num >= snapshot_mode_lists[list_num]->size()) {
+		E_Exit("INT10: Invalid video mode in the snapshot");
+	}
+	CurMode = snapshot_mode_lists[list_num]->begin() + mode_num;
+
+	reader.Read(int10);
+	reader.Read(video_mode_change_in_progress);
+}
+
 static bool set_cur_mode(const std::vector<VideoModeBlock>& modeblock, uint16_t mode)
 {
 	size_t i = 0;
@@ -30,6 +30,7 @@
 #include "mem.h"
 #include "regs.h"
 #include "setup.h"
+#include "snapshot.h"
 #include "support.h"
 
 #include <cstddef>
@@ -843,6 +844,22 @@ static void XMS_ShutDown(Section* /* sec */)
 	instance = {};
 }
 
+static void xms_save_snapshot(SnapshotWriter& writer)
+{
+	writer.Write(a20);
+	writer.Write(hma);
+	writer.Write(umb);
+	writer.Write(xms);
+}
+
+static void xms_load_snapshot(SnapshotReader& reader)
+{
+	reader.Read(a20);
+	reader.Read(hma);
+	reader.Read(umb);
+	reader.Read(xms);
+}
+
 void XMS_Init(Section* sec)
 {
 	assert(sec);
@@ -853,4 +870,6 @@ void XMS_Init(Section* sec)
 
 	constexpr auto changeable_at_runtime = true;
 	sec->AddDestroyFunction(&XMS_ShutDown, changeable_at_runtime);
+
+	SNAPSHOT_AddComponent("xms", xms_save_snapshot, xms_load_snapshot);
 }
@@ -21,8 +21,16 @@
 
 #include "pacer.h"
 
+#include <algorithm>
 #include <cinttypes>
 
+#if defined(__linux__)
+#include <cerrno>
+#include <ctime>
+#endif
+
+#include "support.h"
+
 Pacer::Pacer(const std::string &name, const int timeout, const LogLevel level)
         : pacer_name(name),
           iteration_start(GetTicksUs())
@@ -96,3 +104,125 @@ void Pacer::SetTimeout(const int timeout)
 	assert(timeout >= 0);
 	skip_timeout = timeout;
 }
+
+// Tick pacing
+// ~~~~~~~~~~~
+
+static struct {
+	// Estimate of how late the host wakes us from a sleep
+	int64_t average_oversleep_us = 100;
+
+	PacingStats current    = {};
+	PacingStats last       = {};
+	int64_t period_start_us = 0;
+} pacing = {};
+
+constexpr int64_t StatsPeriodUs = 1'000'000;
+
+static void maybe_finish_stats_period(const int64_t now_us)
+{
+	const auto elapsed_us = now_us - pacing.period_start_us;
+	if (elapsed_us < StatsPeriodUs) {
+		return;
+	}
+
+	auto& stats      = pacing.current;
+	stats.period_us  = elapsed_us;
+	stats.emulate_us = std::max(static_cast<int64_t>(0),
+	                            elapsed_us - stats.sleep_us - stats.render_us);
+
+	LOG_DEBUG("PACER: Slept %" PRId64 "us, emulated %" PRId64
+	          "us, rendered %" PRId64 "us, ticks woken within 100us: %d",
+	          stats.sleep_us,
+	          stats.emulate_us,
+	          stats.render_us,
+	          stats.lateness_counts[0] + stats.lateness_counts[1] +
+	                  stats.lateness_counts[2]);
+
+	pacing.last            = stats;
+	pacing.current         = {};
+	pacing.period_start_us = now_us;
+}
+
+static void sleep_until(const int64_t deadline_us)
+{
+	const auto deadline = system_start_time +
+	                      std::chrono::microseconds(deadline_us);
+#if defined(__linux__)
+	// Both libstdc++ and libc++ implement the steady clock on top of
+	// CLOCK_MONOTONIC, so its time points can be passed on as they are
+	const auto since_epoch_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+	                                    deadline.time_since_epoch())
+	                                    .count();
+	timespec ts = {};
+	ts.tv_sec   = static_cast<time_t>(since_epoch_ns / 1'000'000'000);
+	ts.tv_nsec  = static_cast<long>(since_epoch_ns % 1'000'000'000);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+		// Interrupted by a signal, so carry on sleeping
+	}
+#else
+	std::this_thread::sleep_until(deadline);
+#endif
+}
+
+int64_t PACER_WaitUntilUs(const int64_t deadline_us)
+{
+	// The spin has to stay well below the ~1 ms between ticks, otherwise a
+	// single long oversleep would keep us from ever sleeping again
+	constexpr int64_t MinSpinUs = 20;
+	constexpr int64_t MaxSpinUs = 250;
+
+	const auto start_us = GetTicksUs();
+
+	const auto spin_us = std::clamp(pacing.average_oversleep_us + MinSpinUs,
+	                                MinSpinUs,
+	                                MaxSpinUs);
+
+	const auto wake_up_us = deadline_us - spin_us;
+	if (wake_up_us > start_us) {
+		sleep_until(wake_up_us);
+
+		// Move the estimate an eighth of the way towards this oversleep
+		const auto oversleep_us = std::max(static_cast<int64_t>(0),
+		                                   GetTicksUs() - wake_up_us);
+		pacing.average_oversleep_us += (oversleep_us -
+		                                pacing.average_oversleep_us) / 8;
+	} else {
+		// Too close to the deadline to sleep, so there's nothing to
+		// measure; let the estimate decay so an old outlier doesn't
+		// stick around
+		pacing.average_oversleep_us -= pacing.average_oversleep_us / 8;
+	}
+
+	auto now_us = GetTicksUs();
+	while (now_us < deadline_us) {
+		std::this_thread::yield();
+		now_us = GetTicksUs();
+	}
+
+	const auto lateness_us = now_us - deadline_us;
+
+	auto& stats = pacing.current;
+	stats.sleep_us += now_us - start_us;
+
+	const auto& bounds = PacingStats::LatenessBucketsUs;
+	const auto bucket  = std::lower_bound(bounds.begin(), bounds.end(), lateness_us) -
+	                    bounds.begin();
+	++stats.lateness_counts[check_cast<size_t>(bucket)];
+
+	maybe_finish_stats_period(now_us);
+	return lateness_us;
+}
+
+void PACER_AddRenderTime(const int64_t render_us)
+{
+	pacing.current.render_us += render_us;
+	maybe_finish_stats_period(GetTicksUs());
+}
+
+PacingStats PACER_GetStats()
+{
+	maybe_finish_stats_period(GetTicksUs());
+	return pacing.last;
+}
@@ -20,6 +20,7 @@
 
 #include "rwqueue.h"
 
+#include "../capture/capture_stream.h"
 #include "../capture/image/image_saver.h"
 
 #include <cassert>
@@ -323,6 +324,26 @@ size_t RWQueue<T>::BulkDequeue(T* const into_target, const size_t num_requested)
 	return (num_requested - num_remaining);
 }
 
+template <typename T>
+size_t RWQueue<T>::NonblockingBulkDequeue(std::vector<T>& into_target,
+                                          const size_t num_requested)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	const auto num_items = std::min(queue.size(), num_requested);
+	const auto queue_end = queue.begin() + static_cast<difference_t>(num_items);
+
+	into_target.resize(num_items);
+	std::move(queue.begin(), queue_end, into_target.begin());
+	queue.erase(queue.begin(), queue_end);
+	lock.unlock();
+
+	if (num_items > 0) {
+		has_room.notify_one();
+	}
+	return num_items;
+}
+
 // Explicit template instantiations
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 #include <vector>
@@ -348,3 +369,18 @@ template class RWQueue<uint8_t>;
 
 // Audio capture
 template class RWQueue<int16_t>;
+
+// Render thread
+template class RWQueue<std::vector<uint8_t>>;
+template class RWQueue<RenderThreadWork>;
+
+// Raw stream capture
+template class RWQueue<StreamPacket>;
+
+// Innovation SSI-2001
+#include "../hardware/innovation.h"
+template class RWQueue<SidRegisterWrite>;
+
+// 3dfx Voodoo command FIFO
+#include "../hardware/voodoo.h"
+template class RWQueue<VoodooWriteBatch>;
@@ -1931,9 +1931,13 @@ void Config::ParseArguments()
 	arguments.list_glshaders = cmdline->FindRemoveBoolArgument("list-glshaders");
 	arguments.noconsole   = cmdline->FindRemoveBoolArgument("noconsole");
 	arguments.startmapper = cmdline->FindRemoveBoolArgument("startmapper");
-	arguments.exit        = cmdline->FindRemoveBoolArgument("exit");
 	arguments.securemode = cmdline->FindRemoveBoolArgument("securemode");
 	arguments.noautoexec = cmdline->FindRemoveBoolArgument("noautoexec");
+	arguments.headless   = cmdline->FindRemoveBoolArgument("headless");
+
+	// Nobody can type 'exit' in headless mode
+	arguments.exit = cmdline->FindRemoveBoolArgument("exit") ||
+	                 arguments.headless;
 
 	arguments.eraseconf = cmdline->FindRemoveBoolArgument("eraseconf") ||
 	                      cmdline->FindRemoveBoolArgument("resetconf");
@@ -1946,9 +1950,12 @@ void Config::ParseArguments()
 
 	arguments.working_dir = cmdline->FindRemoveStringArgument("working-dir");
 	arguments.lang = cmdline->FindRemoveStringArgument("lang");
-	arguments.machine = cmdline->FindRemoveStringArgument("machine");
+	arguments.machine  = cmdline->FindRemoveStringArgument("machine");
+	arguments.speed    = cmdline->FindRemoveStringArgument("speed");
+	arguments.snapshot = cmdline->FindRemoveStringArgument("snapshot");
 
-	arguments.socket = cmdline->FindRemoveIntArgument("socket");
+	arguments.socket     = cmdline->FindRemoveIntArgument("socket");
+	arguments.ipx_server = cmdline->FindRemoveIntArgument("ipx-server");
 
 	arguments.conf = cmdline->FindRemoveVectorArgument("conf");
 	arguments.set  = cmdline->FindRemoveVectorArgument("set");
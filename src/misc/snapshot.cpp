@@ -0,0 +1,522 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "snapshot.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <optional>
+
+#include "config.h"
+#include "control.h"
+#include "dosbox.h"
+#include "setup.h"
+#include "support.h"
+
+#if defined(C_SYSTEM_ZLIB_NG)
+#include <zlib-ng.h>
+#define deflateInit zng_deflateInit
+#define deflate zng_deflate
+#define deflateEnd zng_deflateEnd
+#define inflateInit zng_inflateInit
+#define inflate zng_inflate
+#define inflateEnd zng_inflateEnd
+#define z_stream zng_stream
+#else
+#include <zlib.h>
+#endif
+
+constexpr std::array<char, 8> SnapshotMagic = {'D', 'O', 'S', 'B', 'S', 'N', 'A', 'P'};
+
+// Bump whenever the layout of the header or component table changes
+constexpr uint32_t SnapshotFormatVersion = 1;
+
+struct Component {
+	std::string name          = {};
+	SnapshotSaveFunction save = nullptr;
+	SnapshotLoadFunction load = nullptr;
+};
+
+static std::vector<Component> components = {};
+
+static std::vector<SnapshotSaveCheck> save_checks = {};
+
+// ***************************************************************************
+// Writer and reader
+// ***************************************************************************
+
+// Code offsets are measured from this function; any function in the
+// executable would do
+static void code_anchor() {}
+
+constexpr auto NullCodeOffset = std::numeric_limits<int64_t>::min();
+
+void SnapshotWriter::WriteBytes(const void* src, const size_t num_bytes)
+{
+	const auto bytes = static_cast<const uint8_t*>(src);
+	data.insert(data.end(), bytes, bytes + num_bytes);
+}
+
+void SnapshotWriter::WriteString(const std::string& str)
+{
+	Write(check_cast<uint32_t>(str.size()));
+	WriteBytes(str.data(), str.size());
+}
+
+int64_t SnapshotWriter::ToCodeOffset(const uintptr_t address)
+{
+	if (address == 0) {
+		return NullCodeOffset;
+	}
+	const auto anchor = reinterpret_cast<uintptr_t>(&code_anchor);
+	return static_cast<int64_t>(address - anchor);
+}
+
+SnapshotReader::SnapshotReader(const uint8_t* bytes, const size_t num_bytes)
+        : data(bytes),
+          size(num_bytes)
+{}
+
+void SnapshotReader::ReadBytes(void* dest, const size_t num_bytes)
+{
+	// The component table is validated before anything is restored, so
+	// running out of data here means a component's layout didn't match
+	// and the machine is already half-restored
+	if (num_bytes > GetNumBytesLeft()) {
+		E_Exit("SNAPSHOT: Ran out of data while restoring the machine state");
+	}
+	std::memcpy(dest, data + pos, num_bytes);
+	pos += num_bytes;
+}
+
+void SnapshotReader::Skip(const size_t num_bytes)
+{
+	if (num_bytes > GetNumBytesLeft()) {
+		E_Exit("SNAPSHOT: Ran out of data while restoring the machine state");
+	}
+	pos += num_bytes;
+}
+
+bool SnapshotReader::CanReadString() const
+{
+	uint32_t length = 0;
+	if (!CanRead(sizeof(length))) {
+		return false;
+	}
+	std::memcpy(&length, data + pos, sizeof(length));
+	return CanRead(sizeof(length) + length);
+}
+
+std::string SnapshotReader::ReadString()
+{
+	std::string str(Read<uint32_t>(), '\0');
+	ReadBytes(str.data(), str.size());
+	return str;
+}
+
+uintptr_t SnapshotReader::FromCodeOffset(const int64_t offset)
+{
+	if (offset == NullCodeOffset) {
+		return 0;
+	}
+	const auto anchor = reinterpret_cast<uintptr_t>(&code_anchor);
+	return anchor + static_cast<uintptr_t>(offset);
+}
+
+// ***************************************************************************
+// Registry
+// ***************************************************************************
+
+void SNAPSHOT_AddComponent(const std::string& name, SnapshotSaveFunction save,
+                           SnapshotLoadFunction load)
+{
+	assert(save && load);
+
+	// Modules re-register when they're restarted; keep their place in
+	// the order
+	auto it = std::find_if(components.begin(),
+	                       components.end(),
+	                       [&](const Component& c) { return c.name == name; });
+	if (it != components.end()) {
+		it->save = save;
+		it->load = load;
+		return;
+	}
+	components.push_back({name, save, load});
+}
+
+void SNAPSHOT_AddSaveCheck(const SnapshotSaveCheck check)
+{
+	assert(check);
+	if (!contains(save_checks, check)) {
+		save_checks.push_back(check);
+	}
+}
+
+std::optional<std::string> SNAPSHOT_GetSaveBlocker()
+{
+	for (const auto check : save_checks) {
+		if (auto reason = check()) {
+			return reason;
+		}
+	}
+	return {};
+}
+
+bool SNAPSHOT_CanSave()
+{
+	return DOSBOX_GetRunDepth() == 1;
+}
+
+// ***************************************************************************
+// File handling
+// ***************************************************************************
+
+// The settings that can't change while running decide how the machine
+// is laid out (memory size, machine type, devices and their resources), so
+// a snapshot is only usable with the same values
+static uint64_t get_config_fingerprint()
+{
+	// 64-bit FNV-1a
+	uint64_t hash = 0xcbf29ce484222325;
+
+	auto add = [&hash](const std::string& str) {
+		for (const auto c : str) {
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 0x100000001b3;
+		}
+		hash ^= '\n';
+		hash *= 0x100000001b3;
+	};
+
+	for (const auto section : *control) {
+		const auto secprop = dynamic_cast<const Section_prop*>(section);
+		if (!secprop) {
+			continue;
+		}
+		for (const auto prop : *secprop) {
+			if (prop->GetChange() == Property::Changeable::Always ||
+			    prop->IsDeprecated()) {
+				continue;
+			}
+			add(std::string(secprop->GetName()) + "." + prop->propname + "=" +
+			    prop->GetValue().ToString());
+		}
+	}
+	return hash;
+}
+
+static std::optional<std::vector<uint8_t>> compress(const std::vector<uint8_t>& input)
+{
+	z_stream stream = {};
+	if (deflateInit(&stream, Z_BEST_SPEED) != Z_OK) {
+		return {};
+	}
+
+	// Keep each step within the 32-bit counts zlib works with
+	constexpr size_t ChunkSize = 4 * 1024 * 1024;
+
+	std::vector<uint8_t> output = {};
+	size_t in_pos  = 0;
+	size_t out_pos = 0;
+	int result     = Z_OK;
+	while (result == Z_OK) {
+		if (stream.avail_in == 0 && in_pos < input.size()) {
+			const auto num_bytes = std::min(ChunkSize, input.size() - in_pos);
+			stream.next_in = const_cast<uint8_t*>(input.data() + in_pos);
+			stream.avail_in = static_cast<decltype(stream.avail_in)>(num_bytes);
+			in_pos += num_bytes;
+		}
+		output.resize(out_pos + ChunkSize);
+		stream.next_out  = output.data() + out_pos;
+		stream.avail_out = static_cast<decltype(stream.avail_out)>(ChunkSize);
+
+		const auto is_last_input = in_pos == input.size();
+		result = deflate(&stream, is_last_input ? Z_FINISH : Z_NO_FLUSH);
+
+		out_pos += ChunkSize - stream.avail_out;
+	}
+	deflateEnd(&stream);
+
+	if (result != Z_STREAM_END) {
+		return {};
+	}
+	output.resize(out_pos);
+	return output;
+}
+
+static std::optional<std::vector<uint8_t>> decompress(const uint8_t* input,
+                                                      const size_t input_size,
+                                                      const size_t output_size)
+{
+	z_stream stream = {};
+	if (inflateInit(&stream) != Z_OK) {
+		return {};
+	}
+
+	constexpr size_t ChunkSize = 4 * 1024 * 1024;
+
+	std::vector<uint8_t> output(output_size);
+	size_t in_pos  = 0;
+	size_t out_pos = 0;
+	int result     = Z_OK;
+	while (result == Z_OK) {
+		if (stream.avail_in == 0 && in_pos < input_size) {
+			const auto num_bytes = std::min(ChunkSize, input_size - in_pos);
+			stream.next_in = const_cast<uint8_t*>(input + in_pos);
+			stream.avail_in = static_cast<decltype(stream.avail_in)>(num_bytes);
+			in_pos += num_bytes;
+		}
+		if (stream.avail_out == 0) {
+			const auto num_bytes = std::min(ChunkSize, output_size - out_pos);
+			stream.next_out = output.data() + out_pos;
+			stream.avail_out = static_cast<decltype(stream.avail_out)>(num_bytes);
+			out_pos += num_bytes;
+		}
+		result = inflate(&stream, Z_NO_FLUSH);
+
+		// Input that inflates to more than the recorded size
+		if (result == Z_BUF_ERROR && out_pos == output_size &&
+		    stream.avail_out == 0) {
+			break;
+		}
+	}
+	const auto is_complete = result == Z_STREAM_END && stream.avail_out == 0 &&
+	                         out_pos == output_size;
+	inflateEnd(&stream);
+
+	if (!is_complete) {
+		return {};
+	}
+	return output;
+}
+
+bool SNAPSHOT_Save(const std_fs::path& path, const bool compress_payload)
+{
+	if (!SNAPSHOT_CanSave()) {
+		LOG_WARNING("SNAPSHOT: Snapshots can only be saved by programs started from the first shell");
+		return false;
+	}
+	if (const auto reason = SNAPSHOT_GetSaveBlocker()) {
+		LOG_WARNING("SNAPSHOT: Can't save the machine state while %s",
+		            reason->c_str());
+		return false;
+	}
+
+	SnapshotWriter payload = {};
+	payload.Write(check_cast<uint32_t>(components.size()));
+	for (const auto& component : components) {
+		SnapshotWriter writer = {};
+		component.save(writer);
+
+		payload.WriteString(component.name);
+		payload.Write(static_cast<uint64_t>(writer.GetData().size()));
+		payload.WriteBytes(writer.GetData().data(), writer.GetData().size());
+	}
+
+	const auto& raw_data = payload.GetData();
+
+	std::optional<std::vector<uint8_t>> compressed_data = {};
+	if (compress_payload) {
+		compressed_data = compress(raw_data);
+		if (!compressed_data) {
+			LOG_WARNING("SNAPSHOT: Failed compressing the machine state");
+			return false;
+		}
+	}
+	const auto& stored_data = compressed_data ? *compressed_data : raw_data;
+
+	SnapshotWriter header = {};
+	header.Write(SnapshotMagic);
+	header.Write(SnapshotFormatVersion);
+	header.WriteString(DOSBOX_GetDetailedVersion());
+	header.Write(get_config_fingerprint());
+	header.Write(compress_payload);
+	header.Write(static_cast<uint64_t>(raw_data.size()));
+	header.Write(static_cast<uint64_t>(stored_data.size()));
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(header.GetData().data()),
+	           static_cast<std::streamsize>(header.GetData().size()));
+	file.write(reinterpret_cast<const char*>(stored_data.data()),
+	           static_cast<std::streamsize>(stored_data.size()));
+	file.close();
+
+	if (!file) {
+		LOG_WARNING("SNAPSHOT: Failed writing '%s'", path.string().c_str());
+		return false;
+	}
+
+	LOG_MSG("SNAPSHOT: Saved the machine state to '%s' (%zu KB)",
+	        path.string().c_str(),
+	        (header.GetData().size() + stored_data.size()) / 1024);
+	return true;
+}
+
+static std::optional<std::vector<uint8_t>> read_file(const std_fs::path& path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) {
+		return {};
+	}
+	const auto size = file.tellg();
+	if (size < 0) {
+		return {};
+	}
+	std::vector<uint8_t> contents(static_cast<size_t>(size));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(contents.data()), size);
+	if (!file) {
+		return {};
+	}
+	return contents;
+}
+
+bool SNAPSHOT_Load(const std_fs::path& path)
+{
+	const auto path_str = path.string();
+
+	auto fail = [&](const char* reason) {
+		LOG_WARNING("SNAPSHOT: Can't restore '%s': %s", path_str.c_str(), reason);
+		return false;
+	};
+
+	const auto contents = read_file(path);
+	if (!contents) {
+		return fail("the file couldn't be read");
+	}
+
+	// Everything is checked before the first component is restored, so a
+	// file that can't be used leaves the machine as it was
+	constexpr auto MinHeaderSize = sizeof(SnapshotMagic) + sizeof(uint32_t);
+	SnapshotReader header(contents->data(), contents->size());
+	if (!header.CanRead(MinHeaderSize)) {
+		return fail("it isn't a snapshot");
+	}
+	if (header.Read<std::remove_const_t<decltype(SnapshotMagic)>>() != SnapshotMagic) {
+		return fail("it isn't a snapshot");
+	}
+	if (header.Read<uint32_t>() != SnapshotFormatVersion) {
+		return fail("it was saved in a different snapshot format");
+	}
+
+	if (!header.CanReadString()) {
+		return fail("the file is truncated");
+	}
+	if (header.ReadString() != DOSBOX_GetDetailedVersion()) {
+		return fail("it was saved by a different version of DOSBox Staging");
+	}
+	if (!header.CanRead(sizeof(uint64_t) + sizeof(bool) + 2 * sizeof(uint64_t))) {
+		return fail("the file is truncated");
+	}
+	const auto config_fingerprint = header.Read<uint64_t>();
+	const auto is_compressed      = header.Read<bool>();
+	const auto raw_size           = header.Read<uint64_t>();
+	const auto stored_size        = header.Read<uint64_t>();
+	if (stored_size != header.GetNumBytesLeft()) {
+		return fail("the file is truncated");
+	}
+	if (!is_compressed && raw_size != stored_size) {
+		return fail("the file is truncated");
+	}
+	if (config_fingerprint != get_config_fingerprint()) {
+		return fail("it was saved with different start-up settings");
+	}
+
+	const auto stored_data = contents->data() + (contents->size() - stored_size);
+
+	std::optional<std::vector<uint8_t>> decompressed_data = {};
+	if (is_compressed) {
+		decompressed_data = decompress(stored_data,
+		                               static_cast<size_t>(stored_size),
+		                               static_cast<size_t>(raw_size));
+		if (!decompressed_data) {
+			return fail("the machine state is corrupt");
+		}
+	}
+	const auto payload_data = decompressed_data ? decompressed_data->data()
+	                                            : stored_data;
+	const auto payload_size = static_cast<size_t>(raw_size);
+
+	// Walk the component table and match every entry to a registered
+	// component before restoring any of them
+	struct Entry {
+		const uint8_t* data = nullptr;
+		size_t size         = 0;
+	};
+	std::vector<std::optional<Entry>> entries(components.size());
+
+	SnapshotReader table(payload_data, payload_size);
+	if (!table.CanRead(sizeof(uint32_t))) {
+		return fail("the machine state is corrupt");
+	}
+	const auto num_entries = table.Read<uint32_t>();
+	if (num_entries != components.size()) {
+		return fail("it was saved with a different set of devices");
+	}
+	for (uint32_t i = 0; i < num_entries; ++i) {
+		if (!table.CanReadString()) {
+			return fail("the machine state is corrupt");
+		}
+		const auto name = table.ReadString();
+		if (!table.CanRead(sizeof(uint64_t))) {
+			return fail("the machine state is corrupt");
+		}
+		const auto size = table.Read<uint64_t>();
+		if (!table.CanRead(static_cast<size_t>(size))) {
+			return fail("the machine state is corrupt");
+		}
+
+		const auto it = std::find_if(components.begin(),
+		                             components.end(),
+		                             [&](const Component& c) {
+			                             return c.name == name;
+		                             });
+		if (it == components.end()) {
+			return fail("it was saved with a different set of devices");
+		}
+		const auto index = static_cast<size_t>(it - components.begin());
+		if (entries[index]) {
+			return fail("the machine state is corrupt");
+		}
+		entries[index] = Entry{payload_data + (payload_size -
+		                                       table.GetNumBytesLeft()),
+		                       static_cast<size_t>(size)};
+		table.Skip(static_cast<size_t>(size));
+	}
+
+	for (size_t i = 0; i < components.size(); ++i) {
+		SnapshotReader reader(entries[i]->data, entries[i]->size);
+		components[i].load(reader);
+		if (reader.GetNumBytesLeft() != 0) {
+			E_Exit("SNAPSHOT: The '%s' state in '%s' doesn't match this build",
+			       components[i].name.c_str(),
+			       path_str.c_str());
+		}
+	}
+
+	LOG_MSG("SNAPSHOT: Restored the machine state from '%s'", path_str.c_str());
+	LOG_MSG("SNAPSHOT: Sound, CD-ROM, network, and input devices start in their power-on state");
+	return true;
+}
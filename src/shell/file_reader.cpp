@@ -72,3 +72,27 @@ void FileReader::Reset()
 {
 	cursor = 0;
 }
+
+std::optional<uint64_t> FileReader::GetContentsStamp()
+{
+	uint16_t entry = {};
+	if (!DOS_OpenFile(filename.c_str(), (DOS_NOT_INHERIT | OPEN_READ), &entry)) {
+		return {};
+	}
+
+	uint32_t size = 0;
+	DOS_SeekFile(entry, &size, DOS_SEEK_END);
+
+	uint16_t time = 0;
+	uint16_t date = 0;
+	const auto has_date = DOS_GetFileDate(entry, &time, &date);
+	DOS_CloseFile(entry);
+
+	if (!has_date) {
+		return {};
+	}
+
+	// The DOS timestamp only has a two-second resolution, so the size
+	// catches most edits made within the same window
+	return (static_cast<uint64_t>(size) << 32) | (static_cast<uint64_t>(date) << 16) | time;
+}
@@ -32,6 +32,7 @@ public:
 
 	void Reset() final;
 	std::optional<std::string> Read() final;
+	std::optional<uint64_t> GetContentsStamp() final;
 
 	FileReader(const FileReader&)            = delete;
 	FileReader& operator=(const FileReader&) = delete;
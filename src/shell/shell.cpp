@@ -34,6 +34,7 @@
 #include "fs_utils.h"
 #include "mapper.h"
 #include "regs.h"
+#include "snapshot.h"
 #include "string_utils.h"
 #include "support.h"
 #include "timer.h"
@@ -426,6 +427,11 @@ void DOS_Shell::RunBatchFile()
 			ParseLine(input_line);
 		} else {
 			batchfiles.pop();
+
+			// The batch file returned from might have modified its caller
+			if (!batchfiles.empty()) {
+				batchfiles.top().RecheckContents();
+			}
 		}
 	}
 }
@@ -454,7 +460,23 @@ void DOS_Shell::Run()
 		return;
 	}
 	/* Start a normal shell and check for a first command init */
-	if (cmd->FindString("/INIT",line,true)) {
+	if (resume_state && cmd->FindString("/INIT", line, true)) {
+		// Carry on from where the snapshot was taken instead of
+		// greeting the user and running AUTOEXEC.BAT from the top
+		const auto state = *resume_state;
+		resume_state.reset();
+
+		echo = state.echo;
+		if (state.autoexec_offset) {
+			safe_strcpy(input_line, line.c_str());
+			line.erase();
+			ParseLine(input_line);
+			if (!batchfiles.empty()) {
+				batchfiles.top().SetEcho(state.autoexec_echo);
+				batchfiles.top().SeekTo(*state.autoexec_offset);
+			}
+		}
+	} else if (cmd->FindString("/INIT",line,true)) {
 		const bool wants_welcome_banner = control->GetStartupVerbosity() >=
 		                                  Verbosity::High;
 		if (wants_welcome_banner) {
@@ -494,6 +516,26 @@ void DOS_Shell::Run()
 	}
 }
 
+DOS_Shell::SnapshotState DOS_Shell::GetSnapshotState()
+{
+	SnapshotState state = {};
+	state.echo          = echo;
+
+	// Only AUTOEXEC.BAT can be resumed, as it's what the first shell
+	// starts with; anything it called has its own arguments and state
+	if (batchfiles.size() == 1 &&
+	    iequals(batchfiles.top().GetFileName(), "AUTOEXEC.BAT")) {
+		state.autoexec_offset = batchfiles.top().GetOffset();
+		state.autoexec_echo   = batchfiles.top().Echo();
+	}
+	return state;
+}
+
+void DOS_Shell::ResumeFromSnapshot(const SnapshotState& state)
+{
+	resume_state = state;
+}
+
 void DOS_Shell::SyntaxError()
 {
 	WriteOut(MSG_Get("SHELL_SYNTAX_ERROR"));
@@ -610,6 +652,38 @@ static Bitu INT2E_Handler()
 	return CBRET_NONE;
 }
 
+static void shell_save_snapshot(SnapshotWriter& writer)
+{
+	assert(first_shell);
+	writer.Write(first_shell->GetSnapshotState());
+}
+
+static void shell_load_snapshot(SnapshotReader& reader)
+{
+	assert(first_shell);
+	first_shell->ResumeFromSnapshot(reader.Read<DOS_Shell::SnapshotState>());
+}
+
+// Restores the machine from the snapshot and lets the program that saved
+// it finish, which returns control to the first shell
+static void resume_from_snapshot(const std_fs::path& path)
+{
+	const auto old_eip = reg_eip;
+	const auto old_cs  = SegValue(cs);
+	const auto old_esp = reg_esp;
+
+	if (!SNAPSHOT_Load(path)) {
+		return;
+	}
+	DOSBOX_RunMachine();
+
+	// Like CALLBACK_RunRealInt and the shell's program execution, which
+	// were running when the snapshot was taken
+	reg_eip = old_eip;
+	SegSet16(cs, old_cs);
+	reg_esp = old_esp;
+}
+
 static const char* const path_string    = "PATH=Z:\\";
 static const char* const comspec_string = "COMSPEC=Z:\\COMMAND.COM";
 static const char* const full_name      = "Z:\\COMMAND.COM";
@@ -1425,6 +1499,12 @@ void SHELL_Init() {
 	// first_shell is only setup here, so may as well invoke
 	// it's constructor directly
 	first_shell = new DOS_Shell;
+
+	SNAPSHOT_AddComponent("shell", shell_save_snapshot, shell_load_snapshot);
+	if (!control->arguments.snapshot.empty()) {
+		resume_from_snapshot(control->arguments.snapshot);
+	}
+
 	first_shell->Run();
 	delete first_shell;
 	first_shell = nullptr; // Make clear that it shouldn't be used anymore
@@ -23,8 +23,11 @@
 
 #include "logging.h"
 #include "string_utils.h"
+#include "support.h"
 
 [[nodiscard]] static bool found_label(std::string_view line, std::string_view label);
+[[nodiscard]] static std::vector<std::string> get_label_keys(std::string_view line);
+static void clean_line(std::string& line);
 
 BatchFile::BatchFile(const Environment& host, std::unique_ptr<LineReader> input_reader,
                      const std::string_view entered_name,
@@ -62,6 +65,83 @@ bool BatchFile::ReadLine(char* lineout)
 }
 
 std::optional<std::string> BatchFile::GetLine()
+{
+	if (UpdateCache()) {
+		if (next_line >= cached_lines.size()) {
+			return {};
+		}
+		return cached_lines[next_line++].text;
+	}
+
+	auto line = reader->Read();
+	if (!line) {
+		return {};
+	}
+	clean_line(*line);
+	return *line;
+}
+
+// Makes sure the cache is built. The contents are only stamped again after
+// RecheckContents(), as stamping a file means opening it; the shell asks for
+// that whenever a program or a CALLed batch file returns, and on GOTO, which
+// is when the file can have changed under us. Returns false if
+// the reader can't tell when its contents change, in which case lines are
+// read from it directly.
+bool BatchFile::UpdateCache()
+{
+	if (!contents_checked) {
+		contents_checked = true;
+
+		const auto stamp = reader->GetContentsStamp();
+		if (stamp && stamp != cache_stamp) {
+			RebuildCache(*stamp);
+		}
+	}
+	return cache_stamp.has_value();
+}
+
+void BatchFile::RecheckContents()
+{
+	contents_checked = false;
+}
+
+void BatchFile::RebuildCache(const uint64_t stamp)
+{
+	// Like DOS, carry on from the same byte offset if the batch file was
+	// modified while running
+	const auto resume_offset = next_line < cached_lines.size()
+	                                 ? cached_lines[next_line].offset
+	                                 : cached_size;
+
+	cached_lines.clear();
+	label_index.clear();
+	cached_size = 0;
+
+	reader->Reset();
+	while (auto line = reader->Read()) {
+		const auto offset = cached_size;
+		cached_size += check_cast<uint32_t>(line->size());
+
+		clean_line(*line);
+
+		// Only the first definition of a label can be jumped to
+		for (auto& key : get_label_keys(*line)) {
+			label_index.try_emplace(std::move(key), cached_lines.size());
+		}
+		cached_lines.push_back({std::move(*line), offset});
+	}
+
+	const auto resume_line = std::find_if(cached_lines.begin(),
+	                                      cached_lines.end(),
+	                                      [resume_offset](const CachedLine& line) {
+		                                      return line.offset >= resume_offset;
+	                                      });
+	next_line   = static_cast<size_t>(resume_line - cached_lines.begin());
+	cache_stamp = stamp;
+}
+
+// Removes the characters we don't handle and the surrounding whitespace
+static void clean_line(std::string& line)
 {
 	auto invalid_character = [](char c) {
 		const auto data = static_cast<uint8_t>(c);
@@ -83,14 +163,9 @@ std::optional<std::string> BatchFile::GetLine()
 		return false;
 	};
 
-	auto line = reader->Read();
-	if (!line) {
-		return {};
-	}
-	line->erase(std::remove_if(line->begin(), line->end(), invalid_character),
-	            line->end());
-	trim(*line);
-	return *line;
+	line.erase(std::remove_if(line.begin(), line.end(), invalid_character),
+	           line.end());
+	trim(line);
 }
 
 std::string BatchFile::ExpandedBatchLine(std::string_view line) const
@@ -135,6 +210,23 @@ std::string BatchFile::ExpandedBatchLine(std::string_view line) const
 
 bool BatchFile::Goto(const std::string_view label)
 {
+	// Loops jump back with GOTO, which makes it the natural point to pick
+	// up edits made to the batch file while it runs
+	RecheckContents();
+
+	if (UpdateCache()) {
+		std::string key(label);
+		upcase(key);
+
+		const auto it = label_index.find(key);
+		if (it == label_index.end()) {
+			next_line = cached_lines.size();
+			return false;
+		}
+		next_line = it->second + 1;
+		return true;
+	}
+
 	reader->Reset();
 
 	while (auto line = GetLine()) {
@@ -151,6 +243,33 @@ void BatchFile::Shift()
 	cmd.Shift(1);
 }
 
+const char* BatchFile::GetFileName() const
+{
+	return cmd.GetFileName();
+}
+
+std::optional<uint32_t> BatchFile::GetOffset()
+{
+	if (!UpdateCache()) {
+		return {};
+	}
+	return next_line < cached_lines.size() ? cached_lines[next_line].offset
+	                                       : cached_size;
+}
+
+void BatchFile::SeekTo(const uint32_t offset)
+{
+	if (!UpdateCache()) {
+		return;
+	}
+	const auto line = std::find_if(cached_lines.begin(),
+	                               cached_lines.end(),
+	                               [offset](const CachedLine& cached_line) {
+		                               return cached_line.offset >= offset;
+	                               });
+	next_line = static_cast<size_t>(line - cached_lines.begin());
+}
+
 static bool found_label(std::string_view line, const std::string_view label)
 {
 	const auto label_start  = line.find_first_not_of("=\t :");
@@ -171,6 +290,33 @@ static bool found_label(std::string_view line, const std::string_view label)
 	return iequals(line, label);
 }
 
+// Returns the upper-cased forms of the label defined on the line that
+// found_label() would match, if any
+static std::vector<std::string> get_label_keys(std::string_view line)
+{
+	const auto label_start  = line.find_first_not_of("=\t :");
+	const auto label_prefix = line.substr(0, label_start);
+
+	if (label_start == std::string::npos ||
+	    std::count(label_prefix.begin(), label_prefix.end(), ':') != 1) {
+		return {};
+	}
+
+	line = line.substr(label_start);
+
+	std::vector<std::string> keys = {std::string(line)};
+
+	// The label also matches up to the first whitespace
+	const auto label_end = line.find_first_of("\t\r\n ");
+	if (label_end != std::string::npos) {
+		keys.emplace_back(line.substr(0, label_end));
+	}
+	for (auto& key : keys) {
+		upcase(key);
+	}
+	return keys;
+}
+
 void BatchFile::SetEcho(const bool echo_on)
 {
 	echo = echo_on;
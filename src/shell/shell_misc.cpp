@@ -530,6 +530,12 @@ bool DOS_Shell::ExecuteProgram(std::string_view name, std::string_view args)
 
 	if (iequals(extension, ".COM") || iequals(extension, ".EXE")) {
 		run_binary_executable(fullname, args);
+
+		// The program, or a shell it started, might have rewritten the
+		// running batch file, as installers and menus often do
+		if (!batchfiles.empty()) {
+			batchfiles.top().RecheckContents();
+		}
 		return true;
 	}
 
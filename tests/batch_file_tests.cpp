@@ -41,14 +41,30 @@ public:
 		return data;
 	}
 
+	std::optional<uint64_t> GetContentsStamp() override
+	{
+		++num_stamps;
+		return stamp;
+	}
+
 	explicit FakeReader(std::string&& str) : contents(split(std::move(str))) {}
 
+	// Simulates the batch file being modified on disk
+	void Modify(std::string&& str, const uint64_t new_stamp)
+	{
+		contents = split(std::move(str));
+		stamp    = new_stamp;
+	}
+
 	FakeReader(const FakeReader&)            = delete;
 	FakeReader& operator=(const FakeReader&) = delete;
 	FakeReader(FakeReader&&)                 = delete;
 	FakeReader& operator=(FakeReader&&)      = delete;
 	~FakeReader() override                   = default;
 
+	std::optional<uint64_t> stamp = {};
+	int num_stamps                = 0;
+
 private:
 	std::vector<std::string> contents;
 	decltype(contents)::size_type index = 0;
@@ -217,3 +233,95 @@ TEST(BatchFileGoto, SkipLines)
 	batchfile.ReadLine(line);
 	ASSERT_STREQ(line, "after");
 }
+
+TEST(BatchFileGoto, IndexedFirstLabel)
+{
+	const auto shell = FakeShell({});
+	auto reader      = std::make_unique<FakeReader>(
+                ":skip\nbefore\n:Label\nfirst\n:label\nsecond");
+	reader->stamp = 1;
+
+	auto batchfile = BatchFile(shell, std::move(reader), "", "", true);
+	char line[CMD_MAXLINE];
+
+	const auto found_label = batchfile.Goto("LABEL");
+	ASSERT_TRUE(found_label);
+
+	batchfile.ReadLine(line);
+	ASSERT_STREQ(line, "first");
+
+	ASSERT_FALSE(batchfile.Goto("nolabel"));
+	ASSERT_FALSE(batchfile.ReadLine(line));
+}
+
+TEST(BatchFileRead, ReloadModifiedFile)
+{
+	const auto shell = FakeShell({});
+	auto reader = std::make_unique<FakeReader>("one\ntwo\nthree");
+	reader->stamp = 1;
+
+	auto reader_ptr = reader.get();
+	auto batchfile  = BatchFile(shell, std::move(reader), "", "", true);
+	char line[CMD_MAXLINE];
+
+	batchfile.ReadLine(line);
+	ASSERT_STREQ(line, "one");
+
+	reader_ptr->Modify("one\nTWO\nthree", 2);
+	batchfile.RecheckContents();
+
+	batchfile.ReadLine(line);
+	ASSERT_STREQ(line, "TWO");
+}
+
+TEST(BatchFileRead, StampOncePerInvocation)
+{
+	const auto shell = FakeShell({});
+	auto reader = std::make_unique<FakeReader>("one\ntwo\n:loop\nthree");
+	reader->stamp = 1;
+
+	auto reader_ptr = reader.get();
+	auto batchfile  = BatchFile(shell, std::move(reader), "", "", true);
+	char line[CMD_MAXLINE];
+
+	batchfile.ReadLine(line);
+	batchfile.ReadLine(line);
+	ASSERT_STREQ(line, "two");
+	EXPECT_EQ(reader_ptr->num_stamps, 1);
+
+	// Edits aren't picked up until the next GOTO
+	reader_ptr->Modify("one\ntwo\n:loop\nTHREE", 2);
+	batchfile.ReadLine(line);
+	ASSERT_STREQ(line, "three");
+	EXPECT_EQ(reader_ptr->num_stamps, 1);
+
+	ASSERT_TRUE(batchfile.Goto("loop"));
+	EXPECT_EQ(reader_ptr->num_stamps, 2);
+	batchfile.ReadLine(line);
+	ASSERT_STREQ(line, "THREE");
+}
+
+TEST(BatchFileRead, RewrittenByLaunchedProgram)
+{
+	const auto shell = FakeShell({});
+	auto reader = std::make_unique<FakeReader>("setup\nold\nstale");
+	reader->stamp = 1;
+
+	auto reader_ptr = reader.get();
+	auto batchfile  = BatchFile(shell, std::move(reader), "", "", true);
+	char line[CMD_MAXLINE];
+
+	batchfile.ReadLine(line);
+	ASSERT_STREQ(line, "setup");
+
+	// The program run by the first line rewrites the batch file, and the
+	// shell rechecks it once the program returns
+	reader_ptr->Modify("setup\nnew\nfresh", 2);
+	batchfile.RecheckContents();
+
+	batchfile.ReadLine(line);
+	ASSERT_STREQ(line, "new");
+	batchfile.ReadLine(line);
+	ASSERT_STREQ(line, "fresh");
+	EXPECT_EQ(reader_ptr->num_stamps, 2);
+}
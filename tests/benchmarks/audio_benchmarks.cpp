@@ -0,0 +1,321 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark_environment.h"
+#include "cpu.h"
+#include "inout.h"
+#include "mixer.h"
+#include "timer.h"
+
+#include "../../src/hardware/gus.h"
+#include "../../src/hardware/pcspeaker_impulse.h"
+#include "nuked/opl3.h"
+
+// The mixer's default block size
+constexpr int FramesPerBlock = 512;
+
+// Mixer
+// ~~~~~
+// Channels that produce a sine tone at a given rate, so the mixer has to
+// pull, resample, and accumulate real audio data.
+class SineChannels {
+public:
+	SineChannels(const int num_channels, const int sample_rate_hz)
+	{
+		for (auto i = 0; i < num_channels; ++i) {
+			const auto name = "BENCH" + std::to_string(i + 1);
+
+			auto handler = [this, i](const int num_frames) {
+				Generate(channels[static_cast<size_t>(i)], num_frames);
+			};
+			auto channel = MIXER_AddChannel(handler,
+			                                sample_rate_hz,
+			                                name.c_str(),
+			                                {ChannelFeature::Stereo});
+			channels.push_back(channel);
+		}
+		// The handlers look up their channels, so only let the mixer
+		// call them once all are in place
+		for (auto& channel : channels) {
+			channel->Enable(true);
+		}
+	}
+
+	~SineChannels()
+	{
+		for (auto& channel : channels) {
+			MIXER_DeregisterChannel(channel);
+		}
+	}
+
+	SineChannels(const SineChannels&)            = delete;
+	SineChannels& operator=(const SineChannels&) = delete;
+
+	const std::vector<MixerChannelPtr>& Channels() const
+	{
+		return channels;
+	}
+
+private:
+	void Generate(MixerChannelPtr& channel, const int num_frames)
+	{
+		samples.resize(static_cast<size_t>(num_frames) * 2);
+		for (auto& sample : samples) {
+			sample = static_cast<int16_t>(8192.0 * std::sin(phase));
+			phase += 0.05;
+		}
+		channel->AddSamples_s16(num_frames, samples.data());
+	}
+
+	std::vector<MixerChannelPtr> channels = {};
+	std::vector<int16_t> samples          = {};
+	double phase                          = 0.0;
+};
+
+// Mixes a block from every channel through the mixer's own mixing path,
+// including the master effects, like the mixer thread does
+static BenchmarkFunction mix_block(const int num_channels, const int sample_rate_hz)
+{
+	return [num_channels, sample_rate_hz](BenchmarkState& state) {
+		SineChannels sines(num_channels, sample_rate_hz);
+
+		// Keep the mixer thread from mixing blocks as well
+		MIXER_LockMixerThread();
+		while (state.KeepRunning()) {
+			MIXER_MixBlock(FramesPerBlock);
+		}
+		MIXER_UnlockMixerThread();
+
+		state.SetItemsProcessed(state.Iterations() * FramesPerBlock);
+	};
+}
+
+static void add_mixer_benchmarks(BenchmarkRunner& runner)
+{
+	const auto mixer_rate_hz = MIXER_GetSampleRate();
+
+	for (const auto num_channels : {1, 8, 32}) {
+		runner.Add("mixer/mix_block/" + std::to_string(num_channels) + "ch",
+		           mix_block(num_channels, mixer_rate_hz));
+	}
+
+	// Channels at a different rate go through the resampler
+	runner.Add("mixer/mix_block/8ch_resampled", mix_block(8, 22050));
+}
+
+// OPL
+// ~~~
+constexpr uint32_t OplSampleRateHz = 49716;
+
+static void opl_key_on_voices(opl3_chip& chip, const int num_voices)
+{
+	// Operator offsets of the modulators of the nine voices of each bank;
+	// the carriers are 3 above
+	constexpr std::array<uint8_t, 9> ModulatorOffsets = {
+	        0x00, 0x01, 0x02, 0x08, 0x09, 0x0a, 0x10, 0x11, 0x12};
+
+	// Enable OPL3 mode and waveform selection
+	OPL3_WriteReg(&chip, 0x105, 0x01);
+	OPL3_WriteReg(&chip, 0x01, 0x20);
+
+	for (auto voice = 0; voice < num_voices; ++voice) {
+		const uint16_t bank = voice < 9 ? 0x000 : 0x100;
+		const auto channel  = static_cast<uint16_t>(voice % 9);
+
+		const auto modulator = static_cast<uint16_t>(
+		        bank + ModulatorOffsets[channel]);
+		const auto carrier = static_cast<uint16_t>(modulator + 3);
+
+		for (const auto op : {modulator, carrier}) {
+			OPL3_WriteReg(&chip, 0x20 + op, 0x21); // sustain, multiple 1
+			OPL3_WriteReg(&chip, 0x60 + op, 0xf4); // fast attack
+			OPL3_WriteReg(&chip, 0x80 + op, 0x26); // sustain level
+			OPL3_WriteReg(&chip, 0xe0 + op, static_cast<uint8_t>(voice % 4));
+		}
+		OPL3_WriteReg(&chip, 0x40 + modulator, 0x18);
+		OPL3_WriteReg(&chip, 0x40 + carrier, 0x00);
+
+		// Both outputs, feedback 3
+		OPL3_WriteReg(&chip, 0xc0 + bank + channel, 0x36);
+
+		// Spread the voices over a few octaves and key them on
+		const auto fnum = static_cast<uint16_t>(0x16b + voice * 7);
+		const auto block = static_cast<uint8_t>(3 + voice % 3);
+		OPL3_WriteReg(&chip, 0xa0 + bank + channel, fnum & 0xff);
+		OPL3_WriteReg(&chip,
+		              0xb0 + bank + channel,
+		              static_cast<uint8_t>(0x20 | (block << 2) | (fnum >> 8)));
+	}
+}
+
+static BenchmarkFunction opl_render_block(const int num_voices)
+{
+	return [num_voices](BenchmarkState& state) {
+		auto chip = std::make_unique<opl3_chip>();
+		OPL3_Reset(chip.get(), OplSampleRateHz);
+		opl_key_on_voices(*chip, num_voices);
+
+		std::vector<int16_t> buf(FramesPerBlock * 2);
+		while (state.KeepRunning()) {
+			OPL3_GenerateStream(chip.get(), buf.data(), FramesPerBlock);
+			benchmark_do_not_optimize(buf.data());
+		}
+		state.SetItemsProcessed(state.Iterations() * FramesPerBlock);
+	};
+}
+
+// GUS
+// ~~~
+constexpr io_port_t GusPort = 0x240;
+constexpr uint8_t GusDma    = 3;
+constexpr uint8_t GusIrq    = 5;
+
+// Size of the sample the voices loop over
+constexpr uint32_t GusSampleBytes = 64 * 1024;
+
+static void gus_write_register(const uint8_t reg, const uint16_t value)
+{
+	IO_WriteB(GusPort + 0x103, reg);
+	IO_WriteW(GusPort + 0x104, value);
+}
+
+static void gus_start_voices(const int num_voices)
+{
+	// Take the GF1 out of reset with the DAC enabled
+	gus_write_register(0x4c, 0x0300);
+
+	// Fill the start of the RAM with noise through the DRAM peek/poke
+	// registers
+	uint32_t seed = 1;
+	for (uint32_t addr = 0; addr < GusSampleBytes; ++addr) {
+		gus_write_register(0x43, static_cast<uint16_t>(addr & 0xffff));
+		gus_write_register(0x44, static_cast<uint16_t>((addr >> 16) << 8));
+		seed = seed * 1664525 + 1013904223;
+		IO_WriteB(GusPort + 0x107, static_cast<uint8_t>(seed >> 24));
+	}
+
+	gus_write_register(0x0e, static_cast<uint16_t>((num_voices - 1) << 8));
+
+	// Wave addresses have 9 fractional bits
+	constexpr uint32_t LoopEnd = (GusSampleBytes - 1) << 9;
+
+	for (auto voice = 0; voice < num_voices; ++voice) {
+		IO_WriteB(GusPort + 0x102, static_cast<uint8_t>(voice));
+
+		gus_write_register(0x02, 0); // start
+		gus_write_register(0x03, 0);
+		gus_write_register(0x04, static_cast<uint16_t>(LoopEnd >> 16)); // end
+		gus_write_register(0x05, static_cast<uint16_t>(LoopEnd & 0xffff));
+		gus_write_register(0x0a, 0); // current position
+		gus_write_register(0x0b, 0);
+
+		gus_write_register(0x01, static_cast<uint16_t>(0x0400 + voice * 0x20));
+		gus_write_register(0x09, 0xe000); // current volume
+		gus_write_register(0x0c, static_cast<uint16_t>((voice % 16) << 8));
+		gus_write_register(0x0d, 0x0300); // volume ramp stopped
+
+		// Running 8-bit voice, looping forward
+		gus_write_register(0x00, 0x0800);
+	}
+}
+
+static BenchmarkFunction gus_render_block(const int num_voices)
+{
+	return [num_voices](BenchmarkState& state) {
+		auto gus = std::make_unique<Gus>(
+		        GusPort, GusDma, GusIrq, "C:\\ULTRASND", "off");
+
+		// The rendered frames are dropped instead of handed to the mixer
+		gus->output_queue.Stop();
+
+		gus_start_voices(num_voices);
+
+		while (state.KeepRunning()) {
+			gus->PicCallback(FramesPerBlock);
+		}
+		state.SetItemsProcessed(state.Iterations() * FramesPerBlock);
+	};
+}
+
+// PC speaker
+// ~~~~~~~~~~
+static void add_pc_speaker_benchmarks(BenchmarkRunner& runner)
+{
+	// Square waves of a few tones, from beeps to the high pitches that
+	// produce the most impulses per tick
+	for (const auto frequency_hz : {440, 4000, 12000}) {
+		const auto name = "audio/pcspeaker_impulse/square_" +
+		                  std::to_string(frequency_hz) + "hz";
+
+		runner.Add(name, [frequency_hz](BenchmarkState& state) {
+			auto speaker = std::make_unique<PcSpeakerImpulse>();
+			speaker->output_queue.Stop();
+
+			// Start at the beginning of a tick
+			CPU_Cycles    = 0;
+			CPU_CycleLeft = CPU_CycleMax.load();
+
+			PpiPortB port_b = {};
+			port_b.timer2_gating_and_speaker_out = 0b11;
+
+			speaker->SetPITControl(PitMode::SquareWave);
+			speaker->SetCounter(PIT_TICK_RATE / frequency_hz,
+			                    PitMode::SquareWave);
+			speaker->SetType(port_b);
+
+			// One emulated millisecond per iteration
+			const auto frames_per_tick = static_cast<int>(
+			        speaker->channel->GetFramesPerTick());
+
+			while (state.KeepRunning()) {
+				speaker->PicCallback(frames_per_tick);
+			}
+			state.SetItemsProcessed(state.Iterations() * frames_per_tick);
+		});
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	BenchmarkEnvironment environment;
+
+	BenchmarkRunner runner(argc, argv);
+
+	add_mixer_benchmarks(runner);
+
+	runner.Add("audio/opl3/render_block/9_voices", opl_render_block(9));
+	runner.Add("audio/opl3/render_block/18_voices", opl_render_block(18));
+
+	runner.Add("audio/gus/render_block/14_voices", gus_render_block(14));
+	runner.Add("audio/gus/render_block/32_voices", gus_render_block(32));
+
+	add_pc_speaker_benchmarks(runner);
+
+	return runner.Run();
+}
@@ -0,0 +1,353 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+
+// The mixer and other device threads keep running while the benchmarks are
+// measured, so the CPU time is taken from the benchmark's own thread where
+// the platform allows it
+static double get_cpu_time_s()
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+	timespec ts = {};
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+#else
+	return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+BenchmarkState::BenchmarkState(const int64_t iterations)
+        : max_iterations(iterations),
+          iterations_left(iterations)
+{
+	assert(iterations > 0);
+}
+
+bool BenchmarkState::KeepRunning()
+{
+	if (!is_started) {
+		is_started = true;
+		StartTimer();
+	}
+	if (iterations_left > 0) {
+		--iterations_left;
+		return true;
+	}
+	if (is_running) {
+		StopTimer();
+	}
+	return false;
+}
+
+void BenchmarkState::PauseTiming()
+{
+	assert(is_running);
+	StopTimer();
+}
+
+void BenchmarkState::ResumeTiming()
+{
+	assert(!is_running);
+	StartTimer();
+}
+
+void BenchmarkState::StartTimer()
+{
+	is_running  = true;
+	cpu_start_s = get_cpu_time_s();
+	real_start  = Clock::now();
+}
+
+void BenchmarkState::StopTimer()
+{
+	const auto real_end = Clock::now();
+	const auto cpu_end  = get_cpu_time_s();
+
+	real_time_s += std::chrono::duration<double>(real_end - real_start).count();
+	cpu_time_s += cpu_end - cpu_start_s;
+	is_running = false;
+}
+
+static bool starts_with(const std::string& str, const std::string& prefix)
+{
+	return str.compare(0, prefix.size(), prefix) == 0;
+}
+
+BenchmarkRunner::BenchmarkRunner(int argc, char* argv[])
+{
+	if (argc > 0) {
+		executable = argv[0];
+	}
+	for (auto i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+
+		auto value_of = [&](const std::string& option) {
+			return arg.substr(option.size());
+		};
+
+		if (starts_with(arg, "--filter=")) {
+			filter = value_of("--filter=");
+		} else if (starts_with(arg, "--min-time=")) {
+			min_time_s = std::strtod(value_of("--min-time=").c_str(), nullptr);
+			if (min_time_s <= 0.0) {
+				has_invalid_args = true;
+			}
+		} else if (starts_with(arg, "--format=")) {
+			format = value_of("--format=");
+			if (format != "console" && format != "json") {
+				has_invalid_args = true;
+			}
+		} else if (starts_with(arg, "--out=")) {
+			out_path = value_of("--out=");
+		} else {
+			fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+			has_invalid_args = true;
+		}
+	}
+}
+
+void BenchmarkRunner::Add(const std::string& name, BenchmarkFunction function)
+{
+	benchmarks.push_back({name, std::move(function)});
+}
+
+BenchmarkRunner::Result BenchmarkRunner::Measure(const std::string& name,
+                                                 const BenchmarkFunction& function) const
+{
+	// Grow the iteration count until a run takes long enough to be
+	// measured reliably, aiming a little past the minimum time to avoid
+	// falling just short of it again
+	constexpr int64_t MaxIterations = 1'000'000'000;
+
+	int64_t iterations = 1;
+	while (true) {
+		BenchmarkState state(iterations);
+		function(state);
+		assert(!state.is_running);
+
+		if (state.real_time_s >= min_time_s || iterations >= MaxIterations) {
+			const auto n = static_cast<double>(iterations);
+
+			Result result       = {};
+			result.name         = name;
+			result.iterations   = iterations;
+			result.real_time_ns = state.real_time_s * 1e9 / n;
+			result.cpu_time_ns  = state.cpu_time_s * 1e9 / n;
+			if (state.real_time_s > 0.0) {
+				result.bytes_per_sec = static_cast<double>(state.bytes_processed) /
+				                       state.real_time_s;
+				result.items_per_sec = static_cast<double>(state.items_processed) /
+				                       state.real_time_s;
+			}
+			return result;
+		}
+
+		const auto multiplier = state.real_time_s > 0.0
+		                              ? min_time_s * 1.4 / state.real_time_s
+		                              : 10.0;
+
+		const auto next = static_cast<double>(iterations) *
+		                  std::clamp(multiplier, 2.0, 10.0);
+
+		iterations = std::min(static_cast<int64_t>(next), MaxIterations);
+	}
+}
+
+static std::string format_rate(const double per_sec, const char* unit)
+{
+	constexpr const char* Prefixes[] = {"", "k", "M", "G", "T"};
+
+	auto value   = per_sec;
+	size_t index = 0;
+	while (value >= 1000.0 && index + 1 < std::size(Prefixes)) {
+		value /= 1000.0;
+		++index;
+	}
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%.2f %s%s/s", value, Prefixes[index], unit);
+	return buf;
+}
+
+std::string BenchmarkRunner::FormatConsole(const std::vector<Result>& results) const
+{
+	size_t name_width = 9;
+	for (const auto& result : results) {
+		name_width = std::max(name_width, result.name.size());
+	}
+	const auto width = static_cast<int>(name_width);
+
+	std::string out = {};
+	char line[512];
+
+	snprintf(line, sizeof(line), "%-*s %15s %15s %12s  %s\n", width,
+	         "Benchmark", "Time", "CPU", "Iterations", "Throughput");
+	out += line;
+	out += std::string(name_width + 64, '-') + "\n";
+
+	for (const auto& result : results) {
+		std::string throughput = {};
+		if (result.bytes_per_sec > 0.0) {
+			throughput += format_rate(result.bytes_per_sec, "B");
+		}
+		if (result.items_per_sec > 0.0) {
+			if (!throughput.empty()) {
+				throughput += ", ";
+			}
+			throughput += format_rate(result.items_per_sec, "items");
+		}
+		snprintf(line, sizeof(line),
+		         "%-*s %12.1f ns %12.1f ns %12" PRId64 "  %s\n", width,
+		         result.name.c_str(), result.real_time_ns,
+		         result.cpu_time_ns, result.iterations, throughput.c_str());
+		out += line;
+	}
+	return out;
+}
+
+static std::string json_escape(const std::string& str)
+{
+	std::string out = {};
+	for (const auto c : str) {
+		switch (c) {
+		case '"': out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\n': out += "\\n"; break;
+		case '\t': out += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) {
+				char buf[8];
+				snprintf(buf, sizeof(buf), "\\u%04x", c);
+				out += buf;
+			} else {
+				out += c;
+			}
+		}
+	}
+	return out;
+}
+
+std::string BenchmarkRunner::FormatJson(const std::vector<Result>& results) const
+{
+	char date[64] = {};
+
+	const auto now = std::time(nullptr);
+	if (const auto tm = std::localtime(&now); tm) {
+		std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", tm);
+	}
+
+#if defined(NDEBUG)
+	constexpr auto BuildType = "release";
+#else
+	constexpr auto BuildType = "debug";
+#endif
+
+	std::string out = {};
+	char line[512];
+
+	out += "{\n";
+	out += "  \"context\": {\n";
+	out += "    \"date\": \"" + json_escape(date) + "\",\n";
+	out += "    \"executable\": \"" + json_escape(executable) + "\",\n";
+	snprintf(line, sizeof(line), "    \"num_cpus\": %u,\n",
+	         std::thread::hardware_concurrency());
+	out += line;
+	out += "    \"library_build_type\": \"" + std::string(BuildType) + "\"\n";
+	out += "  },\n";
+	out += "  \"benchmarks\": [";
+
+	for (size_t i = 0; i < results.size(); ++i) {
+		const auto& result = results[i];
+		const auto name    = json_escape(result.name);
+
+		out += i ? ",\n" : "\n";
+		out += "    {\n";
+		out += "      \"name\": \"" + name + "\",\n";
+		out += "      \"run_name\": \"" + name + "\",\n";
+		out += "      \"run_type\": \"iteration\",\n";
+		snprintf(line, sizeof(line),
+		         "      \"iterations\": %" PRId64 ",\n"
+		         "      \"real_time\": %.3f,\n"
+		         "      \"cpu_time\": %.3f,\n"
+		         "      \"time_unit\": \"ns\"",
+		         result.iterations, result.real_time_ns, result.cpu_time_ns);
+		out += line;
+		if (result.bytes_per_sec > 0.0) {
+			snprintf(line, sizeof(line),
+			         ",\n      \"bytes_per_second\": %.3f",
+			         result.bytes_per_sec);
+			out += line;
+		}
+		if (result.items_per_sec > 0.0) {
+			snprintf(line, sizeof(line),
+			         ",\n      \"items_per_second\": %.3f",
+			         result.items_per_sec);
+			out += line;
+		}
+		out += "\n    }";
+	}
+	out += results.empty() ? "]\n" : "\n  ]\n";
+	out += "}\n";
+	return out;
+}
+
+int BenchmarkRunner::Run()
+{
+	if (has_invalid_args) {
+		fprintf(stderr,
+		        "Usage: %s [--filter=<text>] [--min-time=<secs>] "
+		        "[--format=console|json] [--out=<file>]\n",
+		        executable.c_str());
+		return 1;
+	}
+
+	std::vector<Result> results = {};
+	for (const auto& benchmark : benchmarks) {
+		if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) {
+			continue;
+		}
+		results.push_back(Measure(benchmark.name, benchmark.function));
+	}
+
+	const auto output = (format == "json") ? FormatJson(results)
+	                                       : FormatConsole(results);
+	if (out_path.empty()) {
+		fputs(output.c_str(), stdout);
+		fflush(stdout);
+		return 0;
+	}
+
+	auto file = fopen(out_path.c_str(), "w");
+	if (!file) {
+		fprintf(stderr, "Failed to open '%s' for writing\n", out_path.c_str());
+		return 1;
+	}
+	fputs(output.c_str(), file);
+	fclose(file);
+	return 0;
+}
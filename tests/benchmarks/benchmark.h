@@ -0,0 +1,154 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_BENCHMARK_H
+#define DOSBOX_BENCHMARK_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A minimal microbenchmark harness for the emulator's hot paths.
+//
+// Each benchmark is a function that runs its workload inside a
+// `while (state.KeepRunning())` loop. The runner calls it with increasing
+// iteration counts until a run takes at least the minimum time, then reports
+// the time per iteration and, if the benchmark sets them, the bytes and items
+// processed per second.
+//
+// The JSON output follows the layout of Google Benchmark's JSON reporter, so
+// its comparison tools (e.g., compare.py) can be used to track regressions
+// between builds.
+//
+// Command line options:
+//
+//   --filter=<text>      Only run benchmarks whose name contains <text>
+//   --min-time=<secs>    Minimum run time of each benchmark (default: 0.5)
+//   --format=<format>    Output format, 'console' (default) or 'json'
+//   --out=<file>         Write the results to <file> instead of stdout
+//
+class BenchmarkState {
+public:
+	explicit BenchmarkState(const int64_t iterations);
+
+	// Returns true while there are iterations left to run; starts the
+	// timer on the first call and stops it after the last iteration.
+	bool KeepRunning();
+
+	// Excludes per-iteration setup work from the measured time.
+	void PauseTiming();
+	void ResumeTiming();
+
+	int64_t Iterations() const
+	{
+		return max_iterations;
+	}
+
+	// Totals over all iterations
+	void SetBytesProcessed(const int64_t bytes)
+	{
+		bytes_processed = bytes;
+	}
+	void SetItemsProcessed(const int64_t items)
+	{
+		items_processed = items;
+	}
+
+private:
+	friend class BenchmarkRunner;
+
+	using Clock = std::chrono::steady_clock;
+
+	void StartTimer();
+	void StopTimer();
+
+	int64_t max_iterations  = 0;
+	int64_t iterations_left = 0;
+
+	bool is_started = false;
+	bool is_running = false;
+
+	Clock::time_point real_start = {};
+	double cpu_start_s           = 0.0;
+
+	double real_time_s = 0.0;
+	double cpu_time_s  = 0.0;
+
+	int64_t bytes_processed = 0;
+	int64_t items_processed = 0;
+};
+
+using BenchmarkFunction = std::function<void(BenchmarkState& state)>;
+
+class BenchmarkRunner {
+public:
+	BenchmarkRunner(int argc, char* argv[]);
+
+	// Benchmarks are named 'group/name[/argument]' and run in the order
+	// they were added.
+	void Add(const std::string& name, BenchmarkFunction function);
+
+	// Returns the process exit code
+	int Run();
+
+private:
+	struct Result {
+		std::string name     = {};
+		int64_t iterations   = 0;
+		double real_time_ns  = 0.0;
+		double cpu_time_ns   = 0.0;
+		double bytes_per_sec = 0.0;
+		double items_per_sec = 0.0;
+	};
+
+	Result Measure(const std::string& name, const BenchmarkFunction& function) const;
+
+	std::string FormatConsole(const std::vector<Result>& results) const;
+	std::string FormatJson(const std::vector<Result>& results) const;
+
+	struct Benchmark {
+		std::string name           = {};
+		BenchmarkFunction function = {};
+	};
+	std::vector<Benchmark> benchmarks = {};
+
+	std::string executable = {};
+	std::string filter     = {};
+	std::string format     = "console";
+	std::string out_path   = {};
+	double min_time_s      = 0.5;
+	bool has_invalid_args  = false;
+};
+
+// Prevents the compiler from optimising away a value computed by a benchmark
+template <typename T>
+inline void benchmark_do_not_optimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const T* sink = nullptr;
+	sink                          = &value;
+#endif
+}
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_BENCHMARK_ENVIRONMENT_H
+#define DOSBOX_BENCHMARK_ENVIRONMENT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+
+#include "control.h"
+#include "video.h"
+
+// Brings up the emulated machine the same way as the unit test fixture, using
+// the tests' configuration file, and tears it down again on destruction. The
+// benchmarks are run from the project's source root, see meson.build.
+class BenchmarkEnvironment {
+public:
+	BenchmarkEnvironment()
+	        : arg_c_str("-conf tests/files/dosbox-staging-tests.conf\0"),
+	          argv{arg_c_str},
+	          com_line(1, argv)
+	{
+		control = std::make_unique<Config>(&com_line);
+
+		// Create DOSBox Staging's config directory, which is a
+		// pre-requisite that's asserted during the Init process.
+		//
+		InitConfigDir();
+		const auto config_path = GetConfigDir();
+		control->ParseConfigFiles(config_path);
+
+		// This will register all the init functions, but won't run them
+		DOSBOX_Init();
+
+		for (const auto& section_name : sections) {
+			control->GetSection(section_name)->ExecuteInit();
+		}
+	}
+
+	~BenchmarkEnvironment()
+	{
+		for (auto r = sections.rbegin(); r != sections.rend(); ++r) {
+			control->GetSection(*r)->ExecuteDestroy();
+		}
+		GFX_RequestExit(true);
+	}
+
+	BenchmarkEnvironment(const BenchmarkEnvironment&)            = delete;
+	BenchmarkEnvironment& operator=(const BenchmarkEnvironment&) = delete;
+
+private:
+	char const* arg_c_str;
+	const char* argv[1];
+	CommandLine com_line;
+
+	// Only init the sections the benchmarks rely on. The audio devices
+	// are left out, as the benchmarks create their own instances.
+	std::vector<std::string> sections{"dosbox", "cpu", "mixer", "dos", "autoexec"};
+};
+
+#endif
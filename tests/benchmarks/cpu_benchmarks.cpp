@@ -0,0 +1,294 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "benchmark_environment.h"
+#include "cpu.h"
+#include "inout.h"
+#include "mem.h"
+#include "pic.h"
+#include "regs.h"
+
+#if C_DYNAMIC_X86
+void CPU_Core_Dyn_X86_Cache_Init(bool enable_cache);
+#elif C_DYNREC
+void CPU_Core_Dynrec_Cache_Init(bool enable_cache);
+#endif
+
+// Guest code loops
+// ~~~~~~~~~~~~~~~~
+// The loops are placed in conventional memory well above the DOS kernel and
+// run in real mode for a fixed number of cycles per iteration.
+
+constexpr uint16_t CodeSegment = 0x6000;
+constexpr uint16_t DataSegment = 0x7000;
+
+constexpr int CyclesPerIteration = 100'000;
+
+// An arithmetic loop with a memory store, the shape of a typical inner loop:
+//
+//   0000  mov cx, 0100h
+//   0003  add ax, bx
+//   0005  xor dx, ax
+//   0007  inc bx
+//   0008  mov [si], ax
+//   000A  add si, 2
+//   000D  and si, 0FFEh
+//   0011  loop 0003
+//   0013  jmp 0000
+//
+constexpr std::array<uint8_t, 21> AluLoop = {
+        0xb9, 0x00, 0x01, 0x01, 0xd8, 0x31, 0xc2, 0x43, 0x89, 0x04, 0x83,
+        0xc6, 0x02, 0x81, 0xe6, 0xfe, 0x0f, 0xe2, 0xf0, 0xeb, 0xeb};
+
+// A block copy within the data segment:
+//
+//   0000  mov si, 0
+//   0003  mov di, 8000h
+//   0006  mov cx, 4000h
+//   0009  rep movsw
+//   000B  jmp 0000
+//
+constexpr std::array<uint8_t, 13> RepMovswLoop = {0xbe, 0x00, 0x00, 0xbf, 0x00,
+                                                  0x80, 0xb9, 0x00, 0x40, 0xf3,
+                                                  0xa5, 0xeb, 0xf3};
+
+template <size_t N>
+static void load_guest_code(const std::array<uint8_t, N>& code)
+{
+	MEM_BlockWrite(PhysicalMake(CodeSegment, 0), code.data(), code.size());
+
+	SegSet16(cs, CodeSegment);
+	SegSet16(ds, DataSegment);
+	SegSet16(es, DataSegment);
+	reg_eip = 0;
+	reg_esi = 0;
+	reg_edi = 0;
+}
+
+static void run_guest_cycles(CPU_Decoder* decoder, const int num_cycles)
+{
+	CPU_Cycles    = num_cycles;
+	CPU_CycleLeft = 0;
+	while (CPU_Cycles > 0) {
+		decoder();
+	}
+}
+
+template <size_t N>
+static BenchmarkFunction guest_loop(CPU_Decoder* decoder,
+                                    const std::array<uint8_t, N>& code)
+{
+	return [decoder, &code](BenchmarkState& state) {
+		load_guest_code(code);
+		while (state.KeepRunning()) {
+			run_guest_cycles(decoder, CyclesPerIteration);
+		}
+		state.SetItemsProcessed(state.Iterations() * CyclesPerIteration);
+	};
+}
+
+static void add_cpu_benchmarks(BenchmarkRunner& runner)
+{
+	runner.Add("cpu/normal/alu_loop", guest_loop(&CPU_Core_Normal_Run, AluLoop));
+	runner.Add("cpu/normal/rep_movsw",
+	           guest_loop(&CPU_Core_Normal_Run, RepMovswLoop));
+
+	runner.Add("cpu/simple/alu_loop", guest_loop(&CPU_Core_Simple_Run, AluLoop));
+	runner.Add("cpu/simple/rep_movsw",
+	           guest_loop(&CPU_Core_Simple_Run, RepMovswLoop));
+
+#if C_DYNAMIC_X86
+	CPU_Core_Dyn_X86_Cache_Init(true);
+
+	runner.Add("cpu/dyn_x86/alu_loop", guest_loop(&CPU_Core_Dyn_X86_Run, AluLoop));
+	runner.Add("cpu/dyn_x86/rep_movsw",
+	           guest_loop(&CPU_Core_Dyn_X86_Run, RepMovswLoop));
+#elif C_DYNREC
+	CPU_Core_Dynrec_Cache_Init(true);
+
+	runner.Add("cpu/dynrec/alu_loop", guest_loop(&CPU_Core_Dynrec_Run, AluLoop));
+	runner.Add("cpu/dynrec/rep_movsw",
+	           guest_loop(&CPU_Core_Dynrec_Run, RepMovswLoop));
+#endif
+}
+
+// Memory block transfers
+// ~~~~~~~~~~~~~~~~~~~~~~
+constexpr PhysPt BlockAddress = 0x20000;
+constexpr size_t BlockSize    = 64 * 1024;
+
+static void add_memory_benchmarks(BenchmarkRunner& runner)
+{
+	runner.Add("mem/block_write/64k", [](BenchmarkState& state) {
+		std::vector<uint8_t> buf(BlockSize, 0x5a);
+		while (state.KeepRunning()) {
+			MEM_BlockWrite(BlockAddress, buf.data(), buf.size());
+		}
+		state.SetBytesProcessed(state.Iterations() * BlockSize);
+	});
+
+	runner.Add("mem/block_read/64k", [](BenchmarkState& state) {
+		std::vector<uint8_t> buf(BlockSize);
+		while (state.KeepRunning()) {
+			MEM_BlockRead(BlockAddress, buf.data(), buf.size());
+			benchmark_do_not_optimize(buf.data());
+		}
+		state.SetBytesProcessed(state.Iterations() * BlockSize);
+	});
+
+	runner.Add("mem/block_fill/64k", [](BenchmarkState& state) {
+		while (state.KeepRunning()) {
+			MEM_BlockFill(BlockAddress, 0xa5, BlockSize);
+		}
+		state.SetBytesProcessed(state.Iterations() * BlockSize);
+	});
+
+	runner.Add("mem/block_copy/64k", [](BenchmarkState& state) {
+		while (state.KeepRunning()) {
+			MEM_BlockCopy(BlockAddress + BlockSize, BlockAddress, BlockSize);
+		}
+		state.SetBytesProcessed(state.Iterations() * BlockSize);
+	});
+}
+
+// IO port dispatch
+// ~~~~~~~~~~~~~~~~
+// A port no device of the benchmark environment uses
+constexpr io_port_t BenchmarkPort = 0x00e0;
+
+constexpr int IoAccessesPerIteration = 1000;
+
+static void add_io_benchmarks(BenchmarkRunner& runner)
+{
+	runner.Add("io/write_byte", [](BenchmarkState& state) {
+		uint32_t sink = 0;
+		IO_RegisterWriteHandler(
+		        BenchmarkPort,
+		        [&](io_port_t, io_val_t value, io_width_t) { sink += value; },
+		        io_width_t::byte);
+
+		while (state.KeepRunning()) {
+			for (auto i = 0; i < IoAccessesPerIteration; ++i) {
+				IO_WriteB(BenchmarkPort, static_cast<uint8_t>(i));
+			}
+		}
+		benchmark_do_not_optimize(sink);
+		IO_FreeWriteHandler(BenchmarkPort, io_width_t::byte);
+		state.SetItemsProcessed(state.Iterations() * IoAccessesPerIteration);
+	});
+
+	runner.Add("io/read_byte", [](BenchmarkState& state) {
+		uint8_t value = 0;
+		IO_RegisterReadHandler(
+		        BenchmarkPort,
+		        [&](io_port_t, io_width_t) { return ++value; },
+		        io_width_t::byte);
+
+		uint32_t sum = 0;
+		while (state.KeepRunning()) {
+			for (auto i = 0; i < IoAccessesPerIteration; ++i) {
+				sum += IO_ReadB(BenchmarkPort);
+			}
+		}
+		benchmark_do_not_optimize(sum);
+		IO_FreeReadHandler(BenchmarkPort, io_width_t::byte);
+		state.SetItemsProcessed(state.Iterations() * IoAccessesPerIteration);
+	});
+
+	// Word writes to a byte-wide handler are split into two byte writes
+	runner.Add("io/write_word_split", [](BenchmarkState& state) {
+		uint32_t sink = 0;
+		IO_RegisterWriteHandler(
+		        BenchmarkPort,
+		        [&](io_port_t, io_val_t value, io_width_t) { sink += value; },
+		        io_width_t::byte,
+		        2);
+
+		while (state.KeepRunning()) {
+			for (auto i = 0; i < IoAccessesPerIteration; ++i) {
+				IO_WriteW(BenchmarkPort, static_cast<uint16_t>(i));
+			}
+		}
+		benchmark_do_not_optimize(sink);
+		IO_FreeWriteHandler(BenchmarkPort, io_width_t::byte, 2);
+		state.SetItemsProcessed(state.Iterations() * IoAccessesPerIteration);
+	});
+
+	// Accesses to unclaimed ports go through the default handlers
+	runner.Add("io/read_byte_unhandled", [](BenchmarkState& state) {
+		uint32_t sum = 0;
+		while (state.KeepRunning()) {
+			for (auto i = 0; i < IoAccessesPerIteration; ++i) {
+				sum += IO_ReadB(BenchmarkPort);
+			}
+		}
+		benchmark_do_not_optimize(sum);
+		state.SetItemsProcessed(state.Iterations() * IoAccessesPerIteration);
+	});
+}
+
+// PIC event queue
+// ~~~~~~~~~~~~~~~
+static void benchmark_pic_event(uint32_t) {}
+
+static void add_pic_benchmarks(BenchmarkRunner& runner)
+{
+	// Half of the queue's capacity, leaving room for the events of the
+	// emulated devices
+	constexpr int EventsPerIteration = 256;
+
+	runner.Add("pic/add_event/256", [](BenchmarkState& state) {
+		// Spread the delays so insertions land all over the sorted queue
+		std::vector<double> delays = {};
+		uint32_t seed              = 1;
+		for (auto i = 0; i < EventsPerIteration; ++i) {
+			seed = seed * 1664525 + 1013904223;
+			delays.push_back(static_cast<double>(seed >> 16) / 65536.0 * 10.0);
+		}
+
+		while (state.KeepRunning()) {
+			for (const auto delay : delays) {
+				PIC_AddEvent(benchmark_pic_event, delay);
+			}
+			PIC_RemoveEvents(benchmark_pic_event);
+		}
+		state.SetItemsProcessed(state.Iterations() * EventsPerIteration);
+	});
+}
+
+int main(int argc, char* argv[])
+{
+	BenchmarkEnvironment environment;
+
+	BenchmarkRunner runner(argc, argv);
+
+	add_cpu_benchmarks(runner);
+	add_memory_benchmarks(runner);
+	add_io_benchmarks(runner);
+	add_pic_benchmarks(runner);
+
+	return runner.Run();
+}
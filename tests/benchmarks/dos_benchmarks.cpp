@@ -0,0 +1,209 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark_environment.h"
+#include "cross.h"
+#include "dos_inc.h"
+#include "drives.h"
+#include "fs_utils.h"
+#include "std_filesystem.h"
+
+// Overlay drive
+// ~~~~~~~~~~~~~
+// A base directory and an overlay with a few thousand files between them,
+// the size of a large game install with saved games and patches in the
+// overlay.
+
+constexpr int NumBaseFiles    = 2000;
+constexpr int NumOverlayFiles = 500;
+
+constexpr uint8_t DriveIndex = 25; // Z:
+
+static std::string dos_name(const char* prefix, const int number)
+{
+	char name[16];
+	snprintf(name, sizeof(name), "%s%04d.DAT", prefix, number);
+	return name;
+}
+
+static void create_files(const std_fs::path& dir, const char* prefix,
+                         const int num_files)
+{
+	std_fs::create_directories(dir);
+	for (auto i = 0; i < num_files; ++i) {
+		const auto path = dir / dos_name(prefix, i);
+		if (auto fp = fopen(path.string().c_str(), "wb"); fp) {
+			fputs(prefix, fp);
+			fclose(fp);
+		}
+	}
+}
+
+class OverlayFixture {
+public:
+	OverlayFixture()
+	        : root(std_fs::temp_directory_path() / "dosbox_overlay_benchmark")
+	{
+		std_fs::remove_all(root);
+
+		create_files(root / "base", "BASE", NumBaseFiles);
+		create_files(root / "base" / "DATA", "DATA", NumBaseFiles);
+		create_files(root / "overlay", "SAVE", NumOverlayFiles);
+
+		// Files in the overlay's copy of a base directory
+		create_files(root / "overlay" / "DATA", "PTCH", NumOverlayFiles);
+	}
+
+	~OverlayFixture()
+	{
+		std::error_code ec = {};
+		std_fs::remove_all(root, ec);
+	}
+
+	OverlayFixture(const OverlayFixture&)            = delete;
+	OverlayFixture& operator=(const OverlayFixture&) = delete;
+
+	// Both directories have to end with a path separator
+	std::string BaseDir() const
+	{
+		return (root / "base").string() + CROSS_FILESPLIT;
+	}
+	std::string OverlayDir() const
+	{
+		return (root / "overlay").string() + CROSS_FILESPLIT;
+	}
+
+	std::shared_ptr<Overlay_Drive> Mount() const
+	{
+		uint8_t error = 0;
+
+		auto drive = std::make_shared<Overlay_Drive>(BaseDir().c_str(),
+		                                             OverlayDir().c_str(),
+		                                             512,
+		                                             32,
+		                                             32765,
+		                                             16000,
+		                                             0xF8,
+		                                             error);
+		if (error) {
+			fprintf(stderr, "Failed to mount the overlay, error %u\n", error);
+			exit(1);
+		}
+		return drive;
+	}
+
+private:
+	std_fs::path root = {};
+};
+
+// A mix of names from the base, the overlay, and missing files, in both
+// directories
+static std::vector<std::string> lookup_names()
+{
+	std::vector<std::string> names = {};
+	for (auto i = 0; i < NumOverlayFiles; i += 5) {
+		names.push_back(dos_name("BASE", i * 3));
+		names.push_back(dos_name("SAVE", i));
+		names.push_back("DATA\\" + dos_name("DATA", i * 3));
+		names.push_back("DATA\\" + dos_name("PTCH", i));
+		names.push_back(dos_name("MISS", i));
+	}
+	return names;
+}
+
+static void add_overlay_benchmarks(BenchmarkRunner& runner,
+                                   const OverlayFixture& fixture)
+{
+	runner.Add("dos/overlay/mount", [&fixture](BenchmarkState& state) {
+		while (state.KeepRunning()) {
+			auto drive = fixture.Mount();
+			benchmark_do_not_optimize(drive.get());
+		}
+		state.SetItemsProcessed(state.Iterations() *
+		                        (NumBaseFiles + NumOverlayFiles) * 2);
+	});
+
+	runner.Add("dos/overlay/file_exists", [&fixture](BenchmarkState& state) {
+		auto drive       = fixture.Mount();
+		const auto names = lookup_names();
+
+		while (state.KeepRunning()) {
+			for (const auto& name : names) {
+				benchmark_do_not_optimize(drive->FileExists(name.c_str()));
+			}
+		}
+		state.SetItemsProcessed(state.Iterations() *
+		                        static_cast<int64_t>(names.size()));
+	});
+
+	runner.Add("dos/overlay/get_file_attr", [&fixture](BenchmarkState& state) {
+		auto drive       = fixture.Mount();
+		const auto names = lookup_names();
+
+		FatAttributeFlags attr = {};
+		while (state.KeepRunning()) {
+			for (const auto& name : names) {
+				benchmark_do_not_optimize(
+				        drive->GetFileAttr(name.c_str(), &attr));
+			}
+		}
+		state.SetItemsProcessed(state.Iterations() *
+		                        static_cast<int64_t>(names.size()));
+	});
+
+	// Lists a directory present in both the base and the overlay
+	runner.Add("dos/overlay/find_all", [&fixture](BenchmarkState& state) {
+		auto drive = fixture.Mount();
+
+		DOS_DTA dta(dos.dta());
+		char pattern[] = "*.*";
+
+		int64_t num_found = 0;
+		while (state.KeepRunning()) {
+			dta.SetupSearch(DriveIndex, FatAttributeFlags{}, pattern);
+			auto found = drive->FindFirst("DATA", dta, false);
+			while (found) {
+				++num_found;
+				found = drive->FindNext(dta);
+			}
+		}
+		state.SetItemsProcessed(num_found);
+	});
+}
+
+int main(int argc, char* argv[])
+{
+	BenchmarkEnvironment environment;
+	OverlayFixture overlay;
+
+	BenchmarkRunner runner(argc, argv);
+
+	add_overlay_benchmarks(runner, overlay);
+
+	return runner.Run();
+}
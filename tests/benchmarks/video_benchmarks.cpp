@@ -0,0 +1,377 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "bgrx8888.h"
+#include "fraction.h"
+#include "render.h"
+#include "video.h"
+
+#include "../../src/capture/image/png_writer.h"
+#include "../../src/gui/render_line_cache.h"
+#include "../../src/gui/render_scalers.h"
+#include "../../src/hardware/vga_palette_expand.h"
+#include "zmbv/zmbv.h"
+
+// The video benchmarks work on synthetic frames and don't need the emulated
+// machine to be set up.
+
+static std::vector<uint8_t> make_noise(const size_t num_bytes, uint32_t seed)
+{
+	std::vector<uint8_t> data(num_bytes);
+	for (auto& byte : data) {
+		seed = seed * 1664525 + 1013904223;
+		byte = static_cast<uint8_t>(seed >> 24);
+	}
+	return data;
+}
+
+// A frame with a moving horizontal band, so consecutive frames share most of
+// their content like in most games
+static std::vector<uint8_t> make_frame(const int width, const int height,
+                                       const int bytes_per_pixel, const int frame_number)
+{
+	const auto pitch = static_cast<size_t>(width * bytes_per_pixel);
+
+	auto frame = make_noise(pitch * static_cast<size_t>(height), 1);
+
+	const auto band_start = (frame_number * 8) % height;
+	for (auto y = band_start; y < std::min(band_start + 16, height); ++y) {
+		const auto row = make_noise(pitch, static_cast<uint32_t>(frame_number + y));
+		std::copy(row.begin(), row.end(), frame.begin() + static_cast<ptrdiff_t>(y * pitch));
+	}
+	return frame;
+}
+
+// VGA line drawers
+// ~~~~~~~~~~~~~~~~
+// The line drawers themselves depend on the whole VGA state, so their palette
+// lookups are measured through the exported expansion functions with the
+// line widths of the common modes.
+static void add_vga_benchmarks(BenchmarkRunner& runner)
+{
+	struct DacMode {
+		const char* name;
+		size_t width;
+	};
+	// Mode 13h and the VESA 256-colour modes
+	constexpr std::array<DacMode, 4> DacModes = {{{"320x200", 320},
+	                                              {"640x480", 640},
+	                                              {"800x600", 800},
+	                                              {"1024x768", 1024}}};
+
+	for (const auto& mode : DacModes) {
+		const auto width = mode.width;
+
+		runner.Add(std::string("vga/dac_expand/") + mode.name,
+		           [width](BenchmarkState& state) {
+			           const auto indexes = make_noise(width, 1);
+
+			           std::array<Bgrx8888, 256> palette = {};
+			           for (size_t i = 0; i < palette.size(); ++i) {
+				           const auto c = static_cast<uint8_t>(i);
+				           palette[i] = Bgrx8888(c, static_cast<uint8_t>(c ^ 0x55),
+				                                 static_cast<uint8_t>(255 - c));
+			           }
+			           std::vector<uint8_t> dest(width * sizeof(uint32_t));
+
+			           while (state.KeepRunning()) {
+				           VGA_ExpandDacPalette(indexes.data(), width,
+				                                palette.data(), dest.data());
+				           benchmark_do_not_optimize(dest.data());
+			           }
+			           state.SetItemsProcessed(state.Iterations() *
+			                                   static_cast<int64_t>(width));
+		           });
+	}
+
+	struct NibbleMode {
+		const char* name;
+		size_t width;
+		bool double_pixels;
+	};
+	// The 16-colour EGA and VGA modes
+	constexpr std::array<NibbleMode, 3> NibbleModes = {
+	        {{"320x200", 320, true}, {"640x350", 640, false}, {"640x480", 640, false}}};
+
+	for (const auto& mode : NibbleModes) {
+		const auto width         = mode.width;
+		const auto double_pixels = mode.double_pixels;
+
+		runner.Add(std::string("vga/nibble_expand/") + mode.name,
+		           [width, double_pixels](BenchmarkState& state) {
+			           // Two pixels per byte, each written twice when
+			           // doubling
+			           const auto num_bytes = double_pixels ? width / 4
+			                                                : width / 2;
+			           const auto src = make_noise(num_bytes, 1);
+
+			           std::array<uint8_t, 16> palette = {};
+			           for (size_t i = 0; i < palette.size(); ++i) {
+				           palette[i] = static_cast<uint8_t>(i * 3);
+			           }
+			           std::vector<uint8_t> dest(width);
+
+			           while (state.KeepRunning()) {
+				           VGA_ExpandNibblePalette(src.data(), num_bytes,
+				                                   palette.data(), double_pixels,
+				                                   dest.data());
+				           benchmark_do_not_optimize(dest.data());
+			           }
+			           state.SetItemsProcessed(state.Iterations() *
+			                                   static_cast<int64_t>(width));
+		           });
+	}
+}
+
+// Render scalers
+// ~~~~~~~~~~~~~~
+struct ScalerSetup {
+	const char* name;
+	ScalerSimpleBlock_t* block;
+	int width;
+	int height;
+	PixelFormat pixel_format;
+};
+
+static void scale_frame(const ScalerLineHandler_t line_handler,
+                        const std::vector<uint8_t>& frame, const size_t src_pitch,
+                        const int height, std::vector<uint8_t>& out,
+                        const int out_pitch)
+{
+	render.scale.cacheRead  = reinterpret_cast<uint8_t*>(&scalerSourceCache);
+	render.scale.outWrite   = out.data();
+	render.scale.outPitch   = out_pitch;
+	Scaler_ChangedLines[0]  = 0;
+	Scaler_ChangedLineIndex = 0;
+
+	for (auto y = 0; y < height; ++y) {
+		line_handler(frame.data() + static_cast<size_t>(y) * src_pitch);
+	}
+}
+
+static void add_scaler_benchmarks(BenchmarkRunner& runner)
+{
+	const std::array<ScalerSetup, 4> setups = {
+	        {{"normal1x/8_32/320x200", &ScaleNormal1x, 320, 200, PixelFormat::Indexed8},
+	         {"normal2x/8_32/320x200", &ScaleNormal2x, 320, 200, PixelFormat::Indexed8},
+	         {"normal1x/8_32/640x480", &ScaleNormal1x, 640, 480, PixelFormat::Indexed8},
+	         {"normal1x/32_32/640x480", &ScaleNormal1x, 640, 480, PixelFormat::BGRX32_ByteArray}}};
+
+	for (const auto& setup : setups) {
+		// Frames where only a band changes go through the change
+		// detection, fully static frames skip scaling altogether
+		for (const auto is_static : {false, true}) {
+			const auto name = std::string("render/scaler/") + setup.name +
+			                  (is_static ? "/static" : "/moving");
+
+			runner.Add(name, [setup, is_static](BenchmarkState& state) {
+				const auto is_indexed = setup.pixel_format == PixelFormat::Indexed8;
+
+				const auto bytes_per_pixel = is_indexed ? 1 : 4;
+				const auto src_pitch = static_cast<size_t>(setup.width *
+				                                           bytes_per_pixel);
+
+				const auto line_handler =
+				        setup.block->Linear[is_indexed ? 0 : 4][scalerMode32];
+
+				render.src.width        = static_cast<uint16_t>(setup.width);
+				render.scale.cachePitch = static_cast<uint32_t>(src_pitch);
+
+				const auto out_pitch = setup.width * setup.block->xscale *
+				                       static_cast<int>(sizeof(uint32_t));
+				std::vector<uint8_t> out(static_cast<size_t>(
+				        out_pitch * setup.height * setup.block->yscale));
+
+				std::vector<std::vector<uint8_t>> frames = {};
+				for (auto i = 0; i < 16; ++i) {
+					frames.push_back(make_frame(setup.width,
+					                            setup.height,
+					                            bytes_per_pixel,
+					                            is_static ? 0 : i));
+				}
+
+				size_t frame_number = 0;
+				while (state.KeepRunning()) {
+					const auto& frame = frames[frame_number++ % frames.size()];
+					scale_frame(line_handler, frame, src_pitch,
+					            setup.height, out, out_pitch);
+				}
+				state.SetItemsProcessed(state.Iterations() * setup.width *
+				                        setup.height);
+			});
+		}
+	}
+
+	constexpr size_t LineBytes = 640 * sizeof(uint32_t);
+
+	for (const auto is_static : {false, true}) {
+		const auto name = std::string("render/line_cache/640x32bpp") +
+		                  (is_static ? "/static" : "/changed");
+
+		runner.Add(name, [is_static](BenchmarkState& state) {
+			const auto line_a = make_noise(LineBytes, 1);
+			const auto line_b = make_noise(LineBytes, 2);
+
+			auto cache = line_a;
+
+			LineCacheDirtyBitmap dirty_blocks = {};
+
+			bool use_b = false;
+			while (state.KeepRunning()) {
+				const auto& line = (!is_static && use_b) ? line_b : line_a;
+				use_b = !use_b;
+				const auto changed = RENDER_UpdateLineCache(line.data(),
+				                                            cache.data(),
+				                                            LineBytes,
+				                                            dirty_blocks);
+				benchmark_do_not_optimize(changed);
+			}
+			state.SetBytesProcessed(state.Iterations() *
+			                        static_cast<int64_t>(LineBytes));
+		});
+	}
+}
+
+// ZMBV video capture
+// ~~~~~~~~~~~~~~~~~~
+static void add_zmbv_benchmarks(BenchmarkRunner& runner)
+{
+	struct ZmbvSetup {
+		const char* name;
+		int width;
+		int height;
+		ZMBV_FORMAT format;
+	};
+	constexpr std::array<ZmbvSetup, 2> setups = {
+	        {{"320x200x8", 320, 200, ZMBV_FORMAT::BPP_8},
+	         {"640x480x32", 640, 480, ZMBV_FORMAT::BPP_32}}};
+
+	for (const auto& setup : setups) {
+		for (const auto is_keyframe : {true, false}) {
+			const auto name = std::string("capture/zmbv/") + setup.name +
+			                  (is_keyframe ? "/keyframe" : "/delta");
+
+			runner.Add(name, [setup, is_keyframe](BenchmarkState& state) {
+				const auto bytes_per_pixel = ZMBV_ToBytesPerPixel(setup.format);
+				const auto pitch = static_cast<size_t>(setup.width *
+				                                       bytes_per_pixel);
+
+				VideoCodec codec;
+				codec.SetupCompress(setup.width, setup.height);
+
+				const auto buf_size = codec.NeededSize(setup.width,
+				                                       setup.height,
+				                                       setup.format);
+				std::vector<uint8_t> buf(static_cast<size_t>(buf_size));
+
+				std::array<uint8_t, 256 * 4> palette = {};
+
+				std::vector<std::vector<uint8_t>> frames = {};
+				for (auto i = 0; i < 16; ++i) {
+					frames.push_back(make_frame(setup.width,
+					                            setup.height,
+					                            bytes_per_pixel,
+					                            i));
+				}
+
+				std::vector<const uint8_t*> lines(static_cast<size_t>(setup.height));
+
+				// The first frame is always a keyframe
+				auto flags = 1;
+
+				size_t frame_number = 0;
+				while (state.KeepRunning()) {
+					const auto& frame = frames[frame_number++ % frames.size()];
+					for (size_t y = 0; y < lines.size(); ++y) {
+						lines[y] = frame.data() + y * pitch;
+					}
+					codec.PrepareCompressFrame(flags,
+					                           setup.format,
+					                           palette.data(),
+					                           buf.data(),
+					                           static_cast<uint32_t>(buf_size));
+					codec.CompressLines(setup.height, lines.data());
+					benchmark_do_not_optimize(codec.FinishCompressFrame());
+
+					flags = is_keyframe ? 1 : 0;
+				}
+				state.SetBytesProcessed(state.Iterations() *
+				                        static_cast<int64_t>(pitch) *
+				                        setup.height);
+			});
+		}
+	}
+}
+
+// PNG writing
+// ~~~~~~~~~~~
+static void add_png_benchmarks(BenchmarkRunner& runner)
+{
+	runner.Add("capture/png/rgb888/640x480", [](BenchmarkState& state) {
+		constexpr uint16_t Width  = 640;
+		constexpr uint16_t Height = 480;
+
+		const auto frame = make_frame(Width, Height, 3, 0);
+
+		VideoMode video_mode        = {};
+		video_mode.is_graphics_mode = true;
+		video_mode.width            = Width;
+		video_mode.height           = Height;
+
+		while (state.KeepRunning()) {
+			auto fp = tmpfile();
+			if (!fp) {
+				continue;
+			}
+			{
+				PngWriter writer;
+				writer.InitRgb888(fp, Width, Height, Fraction(1), video_mode);
+
+				for (size_t y = 0; y < Height; ++y) {
+					writer.WriteRow(frame.cbegin() +
+					                static_cast<ptrdiff_t>(y * Width * 3));
+				}
+			}
+			fclose(fp);
+		}
+		state.SetBytesProcessed(state.Iterations() * Width * Height * 3);
+	});
+}
+
+int main(int argc, char* argv[])
+{
+	BenchmarkRunner runner(argc, argv);
+
+	add_vga_benchmarks(runner);
+	add_scaler_benchmarks(runner);
+	add_zmbv_benchmarks(runner);
+	add_png_benchmarks(runner);
+
+	return runner.Run();
+}
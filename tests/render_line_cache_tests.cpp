@@ -0,0 +1,362 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/gui/render_line_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// The line cache picks the fastest implementation the host supports, so
+// these check whichever one that is against the expected blocks
+
+constexpr size_t Rgb888Bytes = 3;
+
+// Pixel sizes of the 8-bit, 16-bit, 24-bit and 32-bit source formats
+constexpr size_t PixelSizes[] = {1, 2, Rgb888Bytes, 4};
+
+// Widths in pixels, including ones that don't fill the last block
+constexpr size_t Widths[] = {1, 7, 10, 11, 31, 32, 33, 100, 320, 321, 640, SCALER_MAXWIDTH};
+
+size_t num_blocks_of(const size_t num_bytes)
+{
+	return (num_bytes + LineCacheBlockSize - 1) / LineCacheBlockSize;
+}
+
+std::vector<uint8_t> make_line(const size_t num_bytes)
+{
+	std::mt19937 rng(2024);
+	std::vector<uint8_t> line(num_bytes);
+	for (auto& byte : line) {
+		byte = static_cast<uint8_t>(rng() & 0xff);
+	}
+	return line;
+}
+
+bool is_dirty(const LineCacheDirtyBitmap dirty_blocks, const size_t block)
+{
+	return (dirty_blocks[block / 64] >> (block % 64)) & 1;
+}
+
+void set_dirty(LineCacheDirtyBitmap dirty_blocks, const size_t block)
+{
+	dirty_blocks[block / 64] |= uint64_t{1} << (block % 64);
+}
+
+std::vector<std::pair<size_t, size_t>> get_dirty_runs(const LineCacheDirtyBitmap dirty_blocks,
+                                                      const size_t num_blocks)
+{
+	std::vector<std::pair<size_t, size_t>> runs = {};
+
+	size_t first_block = 0;
+	size_t end_block   = 0;
+	while (find_dirty_run(dirty_blocks, num_blocks, first_block, end_block)) {
+		runs.emplace_back(first_block, end_block);
+		first_block = end_block;
+	}
+	return runs;
+}
+
+// Updates the cache from the changed line, checks the blocks it reports and
+// that the cache holds the new line afterwards
+void expect_update(const std::vector<uint8_t>& src, std::vector<uint8_t>& cache,
+                   const std::vector<size_t>& expected_blocks)
+{
+	LineCacheDirtyBitmap dirty_blocks;
+	std::memset(dirty_blocks, 0xff, sizeof(dirty_blocks));
+
+	const auto changed = RENDER_UpdateLineCache(src.data(),
+	                                            cache.data(),
+	                                            src.size(),
+	                                            dirty_blocks);
+
+	EXPECT_EQ(changed, !expected_blocks.empty());
+	EXPECT_EQ(RENDER_LineDiffers(src.data(), cache.data(), src.size()), false);
+	EXPECT_EQ(cache, src);
+
+	for (size_t block = 0; block < LineCacheMaxBlocks; ++block) {
+		const auto expected = std::find(expected_blocks.begin(),
+		                                expected_blocks.end(),
+		                                block) != expected_blocks.end();
+		EXPECT_EQ(is_dirty(dirty_blocks, block), expected)
+		        << "line of " << src.size() << " bytes, block " << block;
+	}
+}
+
+TEST(RenderLineCache, NoChanges)
+{
+	for (const auto pixel_size : PixelSizes) {
+		for (const auto width : Widths) {
+			const auto src = make_line(width * pixel_size);
+			auto cache     = src;
+
+			EXPECT_FALSE(RENDER_LineDiffers(src.data(), cache.data(), src.size()));
+			expect_update(src, cache, {});
+		}
+	}
+}
+
+// Changes every byte of one pixel, which marks each block the pixel overlaps
+void test_single_pixel_change(const size_t pixel_size, const size_t width,
+                              const size_t pixel)
+{
+	const auto cache_line = make_line(width * pixel_size);
+	auto cache            = cache_line;
+	auto src              = cache_line;
+
+	const auto first_byte = pixel * pixel_size;
+	const auto last_byte  = first_byte + pixel_size - 1;
+	for (auto i = first_byte; i <= last_byte; ++i) {
+		src[i] = static_cast<uint8_t>(~src[i]);
+	}
+
+	SCOPED_TRACE(testing::Message() << pixel_size << "-byte pixels, width "
+	                                << width << ", pixel " << pixel);
+
+	EXPECT_TRUE(RENDER_LineDiffers(src.data(), cache.data(), src.size()));
+
+	std::vector<size_t> expected_blocks = {};
+	for (auto block = first_byte / LineCacheBlockSize;
+	     block <= last_byte / LineCacheBlockSize;
+	     ++block) {
+		expected_blocks.push_back(block);
+	}
+	expect_update(src, cache, expected_blocks);
+
+	// The changed blocks form one run that scales the changed pixel
+	LineCacheDirtyBitmap dirty_blocks = {};
+	for (const auto block : expected_blocks) {
+		set_dirty(dirty_blocks, block);
+	}
+	const auto runs = get_dirty_runs(dirty_blocks, num_blocks_of(src.size()));
+	ASSERT_EQ(runs.size(), 1);
+	EXPECT_EQ(runs[0].first, expected_blocks.front());
+	EXPECT_EQ(runs[0].second, expected_blocks.back() + 1);
+
+	const auto [first_px, end_px] = dirty_run_to_pixels(runs[0].first,
+	                                                    runs[0].second,
+	                                                    pixel_size,
+	                                                    width);
+	EXPECT_LE(first_px, pixel);
+	EXPECT_GT(end_px, pixel);
+	EXPECT_LE(end_px, width);
+}
+
+TEST(RenderLineCache, SinglePixelChange)
+{
+	for (const auto pixel_size : PixelSizes) {
+		for (const auto width : Widths) {
+			test_single_pixel_change(pixel_size, width, 0);
+			test_single_pixel_change(pixel_size, width, width / 2);
+			test_single_pixel_change(pixel_size, width, width - 1);
+		}
+	}
+}
+
+TEST(RenderLineCache, Rgb888PixelStraddlingBlocks)
+{
+	// Pixel 10 spans bytes 30 to 32, so it's split across the first two
+	// blocks
+	constexpr size_t Width = 64;
+	constexpr size_t Pixel = 10;
+	static_assert(Pixel * Rgb888Bytes < LineCacheBlockSize);
+	static_assert((Pixel + 1) * Rgb888Bytes > LineCacheBlockSize);
+
+	const auto cache_line = make_line(Width * Rgb888Bytes);
+
+	// Only the byte in the first block changes
+	{
+		auto cache = cache_line;
+		auto src   = cache_line;
+		src[Pixel * Rgb888Bytes] ^= 0xff;
+		expect_update(src, cache, {0});
+
+		const auto [first_px, end_px] = dirty_run_to_pixels(0, 1, Rgb888Bytes, Width);
+		EXPECT_EQ(first_px, 0);
+		EXPECT_EQ(end_px, Pixel + 1);
+	}
+	// Only the byte in the second block changes
+	{
+		auto cache = cache_line;
+		auto src   = cache_line;
+		src[Pixel * Rgb888Bytes + 2] ^= 0xff;
+		expect_update(src, cache, {1});
+
+		const auto [first_px, end_px] = dirty_run_to_pixels(1, 2, Rgb888Bytes, Width);
+		EXPECT_EQ(first_px, Pixel);
+		EXPECT_EQ(end_px, 2 * LineCacheBlockSize / Rgb888Bytes + 1);
+	}
+	// The whole pixel changes
+	{
+		auto cache = cache_line;
+		auto src   = cache_line;
+		for (size_t i = 0; i < Rgb888Bytes; ++i) {
+			src[Pixel * Rgb888Bytes + i] ^= 0xff;
+		}
+		expect_update(src, cache, {0, 1});
+	}
+}
+
+TEST(RenderLineCache, PartialLastBlock)
+{
+	// 100 Rgb888 pixels are 300 bytes, leaving 12 bytes in the last block
+	constexpr size_t Width     = 100;
+	constexpr size_t NumBytes  = Width * Rgb888Bytes;
+	constexpr size_t NumBlocks = (NumBytes + LineCacheBlockSize - 1) /
+	                             LineCacheBlockSize;
+	static_assert(NumBytes % LineCacheBlockSize != 0);
+
+	const auto cache_line = make_line(NumBytes);
+	auto cache            = cache_line;
+	auto src              = cache_line;
+	src[NumBytes - 1] ^= 0xff;
+
+	// Bytes beyond the line must neither be compared nor copied
+	cache.resize(NumBlocks * LineCacheBlockSize, 0xaa);
+	src.resize(NumBlocks * LineCacheBlockSize, 0x55);
+
+	LineCacheDirtyBitmap dirty_blocks;
+	EXPECT_TRUE(RENDER_UpdateLineCache(src.data(), cache.data(), NumBytes, dirty_blocks));
+
+	const auto runs = get_dirty_runs(dirty_blocks, NumBlocks);
+	ASSERT_EQ(runs.size(), 1);
+	EXPECT_EQ(runs[0].first, NumBlocks - 1);
+	EXPECT_EQ(runs[0].second, NumBlocks);
+
+	for (size_t i = NumBytes; i < cache.size(); ++i) {
+		EXPECT_EQ(cache[i], 0xaa) << "byte " << i;
+	}
+
+	const auto [first_px, end_px] = dirty_run_to_pixels(runs[0].first,
+	                                                    runs[0].second,
+	                                                    Rgb888Bytes,
+	                                                    Width);
+	EXPECT_EQ(first_px, (NumBlocks - 1) * LineCacheBlockSize / Rgb888Bytes);
+	EXPECT_EQ(end_px, Width);
+}
+
+TEST(RenderLineCache, MatchesScalarOnRandomChanges)
+{
+	std::mt19937 rng(640);
+
+	for (const auto num_bytes : {size_t{1}, size_t{31}, size_t{32}, size_t{33},
+	                             size_t{1000}, LineCacheMaxBlocks * LineCacheBlockSize}) {
+		for (auto round = 0; round < 50; ++round) {
+			const auto cache_line = make_line(num_bytes);
+			auto cache            = cache_line;
+			auto src              = cache_line;
+
+			const auto num_changes = rng() % 8;
+			for (size_t i = 0; i < num_changes; ++i) {
+				src[rng() % num_bytes] ^= static_cast<uint8_t>(rng() | 1);
+			}
+
+			std::vector<size_t> expected_blocks = {};
+			for (size_t block = 0; block < num_blocks_of(num_bytes); ++block) {
+				const auto offset = block * LineCacheBlockSize;
+				const auto size = std::min(LineCacheBlockSize, num_bytes - offset);
+				if (std::memcmp(&src[offset], &cache[offset], size) != 0) {
+					expected_blocks.push_back(block);
+				}
+			}
+			EXPECT_EQ(RENDER_LineDiffers(src.data(), cache.data(), num_bytes),
+			          !expected_blocks.empty());
+			expect_update(src, cache, expected_blocks);
+		}
+	}
+}
+
+TEST(RenderLineCacheFindDirtyRun, NoDirtyBlocks)
+{
+	LineCacheDirtyBitmap dirty_blocks = {};
+	EXPECT_TRUE(get_dirty_runs(dirty_blocks, LineCacheMaxBlocks).empty());
+}
+
+TEST(RenderLineCacheFindDirtyRun, SeparateRuns)
+{
+	LineCacheDirtyBitmap dirty_blocks = {};
+	for (const auto block : {0, 1, 2, 5, 9, 10}) {
+		set_dirty(dirty_blocks, block);
+	}
+	const std::vector<std::pair<size_t, size_t>> expected = {{0, 3}, {5, 6}, {9, 11}};
+	EXPECT_EQ(get_dirty_runs(dirty_blocks, 20), expected);
+}
+
+TEST(RenderLineCacheFindDirtyRun, RunAcrossBitmapWords)
+{
+	LineCacheDirtyBitmap dirty_blocks = {};
+	for (size_t block = 62; block < 130; ++block) {
+		set_dirty(dirty_blocks, block);
+	}
+	const std::vector<std::pair<size_t, size_t>> expected = {{62, 130}};
+	EXPECT_EQ(get_dirty_runs(dirty_blocks, LineCacheMaxBlocks), expected);
+}
+
+TEST(RenderLineCacheFindDirtyRun, SkipsCleanWords)
+{
+	LineCacheDirtyBitmap dirty_blocks = {};
+	set_dirty(dirty_blocks, LineCacheMaxBlocks - 1);
+
+	const std::vector<std::pair<size_t, size_t>> expected = {
+	        {LineCacheMaxBlocks - 1, LineCacheMaxBlocks}};
+	EXPECT_EQ(get_dirty_runs(dirty_blocks, LineCacheMaxBlocks), expected);
+}
+
+TEST(RenderLineCacheFindDirtyRun, IgnoresBlocksBeyondLine)
+{
+	LineCacheDirtyBitmap dirty_blocks = {};
+	set_dirty(dirty_blocks, 3);
+	set_dirty(dirty_blocks, 4);
+	set_dirty(dirty_blocks, 8);
+
+	// The run is cut at the end of the line and the block after it ignored
+	const std::vector<std::pair<size_t, size_t>> expected = {{3, 4}};
+	EXPECT_EQ(get_dirty_runs(dirty_blocks, 4), expected);
+}
+
+TEST(RenderLineCacheFindDirtyRun, StartsAtFirstBlock)
+{
+	LineCacheDirtyBitmap dirty_blocks = {};
+	for (const auto block : {2, 3, 4, 70}) {
+		set_dirty(dirty_blocks, block);
+	}
+
+	size_t first_block = 3;
+	size_t end_block   = 0;
+	ASSERT_TRUE(find_dirty_run(dirty_blocks, LineCacheMaxBlocks, first_block, end_block));
+	EXPECT_EQ(first_block, 3);
+	EXPECT_EQ(end_block, 5);
+
+	first_block = 5;
+	ASSERT_TRUE(find_dirty_run(dirty_blocks, LineCacheMaxBlocks, first_block, end_block));
+	EXPECT_EQ(first_block, 70);
+	EXPECT_EQ(end_block, 71);
+
+	first_block = 71;
+	EXPECT_FALSE(find_dirty_run(dirty_blocks, LineCacheMaxBlocks, first_block, end_block));
+}
+
+} // namespace
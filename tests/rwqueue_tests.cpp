@@ -558,4 +558,42 @@ TEST(RWQueue, StopBulkMidway)
 	EXPECT_TRUE(items.empty());
 }
 
+TEST(RWQueue, NonblockingBulkDequeue)
+{
+	RWQueue<int> q(8);
+
+	// Nothing queued, so nothing is dequeued and we don't block
+	std::vector<int> items = {1, 2, 3};
+	auto num_dequeued = q.NonblockingBulkDequeue(items, 4);
+	EXPECT_EQ(num_dequeued, 0);
+	EXPECT_TRUE(items.empty());
+
+	items = {1, 2, 3};
+	q.BulkEnqueue(items);
+
+	// Over-request, and get what's available without blocking
+	num_dequeued = q.NonblockingBulkDequeue(items, 5);
+	EXPECT_EQ(num_dequeued, 3u);
+	EXPECT_TRUE(q.IsEmpty());
+	std::vector<int> expected_items = {1, 2, 3};
+	EXPECT_EQ(items, expected_items);
+
+	// Under-request, and leave the rest queued
+	items = {4, 5, 6};
+	q.BulkEnqueue(items);
+	num_dequeued = q.NonblockingBulkDequeue(items, 2);
+	EXPECT_EQ(num_dequeued, 2u);
+	EXPECT_EQ(q.Size(), 1);
+	expected_items = {4, 5};
+	EXPECT_EQ(items, expected_items);
+
+	// Emptying the queue from under a would-be reader can't hang it
+	q.Stop();
+	q.Clear();
+	q.Start();
+	num_dequeued = q.NonblockingBulkDequeue(items, 1);
+	EXPECT_EQ(num_dequeued, 0);
+	EXPECT_TRUE(items.empty());
+}
+
 } // namespace
@@ -0,0 +1,315 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "snapshot.h"
+
+#include <array>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dosbox.h"
+
+namespace {
+
+struct Registers {
+	uint16_t ax  = 0;
+	uint32_t ebx = 0;
+	uint8_t flags[3] = {};
+};
+
+bool operator==(const Registers& a, const Registers& b)
+{
+	return a.ax == b.ax && a.ebx == b.ebx && a.flags[0] == b.flags[0] &&
+	       a.flags[1] == b.flags[1] && a.flags[2] == b.flags[2];
+}
+
+SnapshotReader make_reader(const SnapshotWriter& writer)
+{
+	return SnapshotReader(writer.GetData().data(), writer.GetData().size());
+}
+
+TEST(SnapshotWriterReader, RoundTrip)
+{
+	const Registers regs = {0x1234, 0xdeadbeef, {1, 2, 3}};
+	const std::array<uint8_t, 5> bytes = {9, 8, 7, 6, 5};
+
+	SnapshotWriter writer = {};
+	writer.Write(uint8_t{0xab});
+	writer.Write(int64_t{-42});
+	writer.Write(3.25);
+	writer.Write(true);
+	writer.Write(regs);
+	writer.WriteString("C:\\GAMES");
+	writer.WriteString("");
+	writer.WriteBytes(bytes.data(), bytes.size());
+
+	auto reader = make_reader(writer);
+	EXPECT_EQ(reader.Read<uint8_t>(), 0xab);
+	EXPECT_EQ(reader.Read<int64_t>(), -42);
+	EXPECT_EQ(reader.Read<double>(), 3.25);
+	EXPECT_TRUE(reader.Read<bool>());
+	EXPECT_EQ(reader.Read<Registers>(), regs);
+	EXPECT_EQ(reader.ReadString(), "C:\\GAMES");
+	EXPECT_EQ(reader.ReadString(), "");
+
+	std::array<uint8_t, 5> read_bytes = {};
+	reader.ReadBytes(read_bytes.data(), read_bytes.size());
+	EXPECT_EQ(read_bytes, bytes);
+
+	EXPECT_EQ(reader.GetNumBytesLeft(), 0);
+}
+
+TEST(SnapshotWriterReader, ReadIntoExisting)
+{
+	SnapshotWriter writer = {};
+	writer.Write(uint32_t{0x01020304});
+
+	auto reader    = make_reader(writer);
+	uint32_t value = 0;
+	reader.Read(value);
+	EXPECT_EQ(value, 0x01020304);
+}
+
+TEST(SnapshotWriterReader, Skip)
+{
+	SnapshotWriter writer = {};
+	writer.Write(uint32_t{1});
+	writer.Write(uint16_t{2});
+
+	auto reader = make_reader(writer);
+	reader.Skip(sizeof(uint32_t));
+	EXPECT_EQ(reader.GetNumBytesLeft(), sizeof(uint16_t));
+	EXPECT_EQ(reader.Read<uint16_t>(), 2);
+}
+
+TEST(SnapshotWriterReader, CanRead)
+{
+	SnapshotWriter writer = {};
+	writer.Write(uint32_t{1});
+
+	const auto reader = make_reader(writer);
+	EXPECT_TRUE(reader.CanRead(0));
+	EXPECT_TRUE(reader.CanRead(sizeof(uint32_t)));
+	EXPECT_FALSE(reader.CanRead(sizeof(uint32_t) + 1));
+}
+
+TEST(SnapshotWriterReader, CanReadString)
+{
+	SnapshotWriter writer = {};
+	writer.WriteString("AUTOEXEC");
+
+	const auto& data = writer.GetData();
+
+	const SnapshotReader whole(data.data(), data.size());
+	EXPECT_TRUE(whole.CanReadString());
+
+	// The length says there's more than what's left
+	const SnapshotReader truncated(data.data(), data.size() - 1);
+	EXPECT_FALSE(truncated.CanReadString());
+
+	// Not even the whole length
+	const SnapshotReader no_length(data.data(), sizeof(uint32_t) - 1);
+	EXPECT_FALSE(no_length.CanReadString());
+}
+
+int event_handler_a(int value)
+{
+	return value + 1;
+}
+
+int event_handler_b(int value)
+{
+	return value * 2;
+}
+
+int static_object = 0;
+
+TEST(SnapshotWriterReader, CodePointers)
+{
+	SnapshotWriter writer = {};
+	writer.WriteCodePointer(&event_handler_a);
+	writer.WriteCodePointer(&event_handler_b);
+	writer.WriteCodePointer(&static_object);
+
+	auto reader = make_reader(writer);
+
+	const auto handler_a = reader.ReadCodePointer<int(int)>();
+	EXPECT_EQ(handler_a, &event_handler_a);
+	EXPECT_EQ(handler_a(1), 2);
+
+	const auto handler_b = reader.ReadCodePointer<int(int)>();
+	EXPECT_EQ(handler_b, &event_handler_b);
+	EXPECT_EQ(handler_b(3), 6);
+
+	EXPECT_EQ(reader.ReadCodePointer<int>(), &static_object);
+	EXPECT_EQ(reader.GetNumBytesLeft(), 0);
+}
+
+TEST(SnapshotWriterReader, NullCodePointer)
+{
+	using Handler = void(uint32_t);
+
+	SnapshotWriter writer = {};
+	writer.WriteCodePointer<Handler>(nullptr);
+
+	auto reader = make_reader(writer);
+	EXPECT_EQ(reader.ReadCodePointer<Handler>(), nullptr);
+}
+
+// Loading checks the whole file before restoring anything, so broken or
+// mismatching files are rejected without touching the machine
+
+constexpr std::array<char, 8> Magic = {'D', 'O', 'S', 'B', 'S', 'N', 'A', 'P'};
+constexpr uint32_t FormatVersion    = 1;
+
+struct Header {
+	std::array<char, 8> magic  = Magic;
+	uint32_t format_version    = FormatVersion;
+	std::string dosbox_version = DOSBOX_GetDetailedVersion();
+	uint64_t config_fingerprint = 0;
+	bool is_compressed         = false;
+	uint64_t raw_size          = 0;
+	uint64_t stored_size       = 0;
+};
+
+std::vector<uint8_t> make_file(const Header& header, const std::vector<uint8_t>& payload)
+{
+	SnapshotWriter writer = {};
+	writer.Write(header.magic);
+	writer.Write(header.format_version);
+	writer.WriteString(header.dosbox_version);
+	writer.Write(header.config_fingerprint);
+	writer.Write(header.is_compressed);
+	writer.Write(header.raw_size);
+	writer.Write(header.stored_size);
+	writer.WriteBytes(payload.data(), payload.size());
+	return writer.GetData();
+}
+
+class SnapshotLoad : public ::testing::Test {
+protected:
+	void TearDown() override
+	{
+		std::error_code ec = {};
+		std_fs::remove(path, ec);
+	}
+
+	bool Load(const std::vector<uint8_t>& contents)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(contents.data()),
+		           static_cast<std::streamsize>(contents.size()));
+		file.close();
+		return SNAPSHOT_Load(path);
+	}
+
+	const std_fs::path path = std_fs::temp_directory_path() /
+	                          "dosbox_snapshot_test.snp";
+};
+
+const std::vector<uint8_t> Payload = {1, 2, 3, 4};
+
+Header make_valid_header()
+{
+	Header header      = {};
+	header.raw_size    = Payload.size();
+	header.stored_size = Payload.size();
+	return header;
+}
+
+TEST_F(SnapshotLoad, MissingFile)
+{
+	std::error_code ec = {};
+	std_fs::remove(path, ec);
+	EXPECT_FALSE(SNAPSHOT_Load(path));
+}
+
+TEST_F(SnapshotLoad, EmptyFile)
+{
+	EXPECT_FALSE(Load({}));
+}
+
+TEST_F(SnapshotLoad, WrongMagic)
+{
+	auto header     = make_valid_header();
+	header.magic[7] = 'X';
+	EXPECT_FALSE(Load(make_file(header, Payload)));
+}
+
+TEST_F(SnapshotLoad, OlderFormatVersion)
+{
+	auto header           = make_valid_header();
+	header.format_version = FormatVersion - 1;
+	EXPECT_FALSE(Load(make_file(header, Payload)));
+}
+
+TEST_F(SnapshotLoad, NewerFormatVersion)
+{
+	auto header           = make_valid_header();
+	header.format_version = FormatVersion + 1;
+	EXPECT_FALSE(Load(make_file(header, Payload)));
+}
+
+TEST_F(SnapshotLoad, DifferentDosboxVersion)
+{
+	auto header = make_valid_header();
+	header.dosbox_version += "-other";
+	EXPECT_FALSE(Load(make_file(header, Payload)));
+}
+
+TEST_F(SnapshotLoad, TruncatedVersionString)
+{
+	auto file = make_file(make_valid_header(), Payload);
+	file.resize(Magic.size() + sizeof(uint32_t) + sizeof(uint32_t) + 1);
+	EXPECT_FALSE(Load(file));
+}
+
+TEST_F(SnapshotLoad, TruncatedHeader)
+{
+	auto file = make_file(make_valid_header(), {});
+	file.resize(file.size() - 1);
+	EXPECT_FALSE(Load(file));
+}
+
+TEST_F(SnapshotLoad, StoredSizeLargerThanFile)
+{
+	auto header = make_valid_header();
+	++header.stored_size;
+	EXPECT_FALSE(Load(make_file(header, Payload)));
+}
+
+TEST_F(SnapshotLoad, StoredSizeSmallerThanFile)
+{
+	auto header = make_valid_header();
+	--header.stored_size;
+	EXPECT_FALSE(Load(make_file(header, Payload)));
+}
+
+TEST_F(SnapshotLoad, UncompressedSizesDiffer)
+{
+	auto header = make_valid_header();
+	++header.raw_size;
+	EXPECT_FALSE(Load(make_file(header, Payload)));
+}
+
+} // namespace
@@ -0,0 +1,367 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/cpu/string_spans.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "mem.h"
+
+#include "dosbox_test_fixture.h"
+
+namespace {
+
+// The spans and REP loops run against the emulated memory and are checked
+// against plain element by element copies and stores through the memory
+// handlers, which is what the interpreter cores did before the spans.
+
+// Free conventional memory, away from the DOS data structures
+constexpr PhysPt RegionStart = 0x80000;
+constexpr PhysPt RegionEnd   = 0xa0000;
+
+constexpr uint32_t Mask16 = 0xffff;
+constexpr uint32_t Mask32 = 0xffffffff;
+
+class StringSpansTest : public DOSBoxTestFixture {
+protected:
+	void SetUp() override
+	{
+		DOSBoxTestFixture::SetUp();
+		FillRegion();
+	}
+
+	// Writing the whole region also maps its pages into the TLB, which
+	// the spans need
+	static void FillRegion()
+	{
+		for (auto address = RegionStart; address < RegionEnd; ++address) {
+			mem_writeb(address, static_cast<uint8_t>(address * 7 + 3));
+		}
+	}
+
+	static std::vector<uint8_t> ReadRegion()
+	{
+		std::vector<uint8_t> region = {};
+		region.reserve(RegionEnd - RegionStart);
+		for (auto address = RegionStart; address < RegionEnd; ++address) {
+			region.push_back(mem_readb(address));
+		}
+		return region;
+	}
+};
+
+template <typename T>
+T load(const PhysPt address)
+{
+	if constexpr (sizeof(T) == 1) {
+		return mem_readb(address);
+	} else if constexpr (sizeof(T) == 2) {
+		return mem_readw(address);
+	} else {
+		return mem_readd(address);
+	}
+}
+
+template <typename T>
+void store(const PhysPt address, const T value)
+{
+	if constexpr (sizeof(T) == 1) {
+		mem_writeb(address, value);
+	} else if constexpr (sizeof(T) == 2) {
+		mem_writew(address, value);
+	} else {
+		mem_writed(address, value);
+	}
+}
+
+struct StringOp {
+	PhysPt si_base    = RegionStart;
+	uint32_t si_index = 0;
+	PhysPt di_base    = RegionStart;
+	uint32_t di_index = 0;
+	uint32_t add_mask = Mask32;
+	bool is_backward  = false;
+	int64_t count     = 0;
+};
+
+template <typename T>
+Bits add_index_of(const StringOp& op)
+{
+	return (op.is_backward ? -1 : 1) * static_cast<Bits>(sizeof(T));
+}
+
+template <typename T>
+void movs_reference(StringOp& op)
+{
+	const auto add_index = add_index_of<T>(op);
+	for (; op.count > 0; --op.count) {
+		store<T>(op.di_base + op.di_index, load<T>(op.si_base + op.si_index));
+		op.di_index = (op.di_index + add_index) & op.add_mask;
+		op.si_index = (op.si_index + add_index) & op.add_mask;
+	}
+}
+
+template <typename T>
+void stos_reference(StringOp& op, const T value)
+{
+	const auto add_index = add_index_of<T>(op);
+	for (; op.count > 0; --op.count) {
+		store<T>(op.di_base + op.di_index, value);
+		op.di_index = (op.di_index + add_index) & op.add_mask;
+	}
+}
+
+void expect_same_registers(const StringOp& actual, const StringOp& expected)
+{
+	EXPECT_EQ(actual.si_index, expected.si_index);
+	EXPECT_EQ(actual.di_index, expected.di_index);
+	EXPECT_EQ(actual.count, expected.count);
+}
+
+class RepStringTest : public StringSpansTest {
+protected:
+	template <typename T>
+	void ExpectMovsMatchesReference(const StringOp& op)
+	{
+		SCOPED_TRACE(testing::Message()
+		             << sizeof(T) << "-byte MOVS from " << op.si_index
+		             << " to " << op.di_index << ", count " << op.count
+		             << (op.is_backward ? ", backward" : ""));
+
+		FillRegion();
+		auto expected = op;
+		movs_reference<T>(expected);
+		const auto expected_region = ReadRegion();
+
+		FillRegion();
+		auto actual = op;
+		rep_movs<T>(actual.si_base,
+		            actual.si_index,
+		            actual.di_base,
+		            actual.di_index,
+		            actual.add_mask,
+		            add_index_of<T>(op),
+		            actual.count,
+		            load<T>,
+		            store<T>);
+
+		EXPECT_EQ(ReadRegion(), expected_region);
+		expect_same_registers(actual, expected);
+	}
+
+	template <typename T>
+	void ExpectStosMatchesReference(const StringOp& op, const T value)
+	{
+		SCOPED_TRACE(testing::Message()
+		             << sizeof(T) << "-byte STOS to " << op.di_index << ", count "
+		             << op.count << (op.is_backward ? ", backward" : ""));
+
+		FillRegion();
+		auto expected = op;
+		stos_reference<T>(expected, value);
+		const auto expected_region = ReadRegion();
+
+		FillRegion();
+		auto actual = op;
+		rep_stos<T>(actual.di_base,
+		            actual.di_index,
+		            actual.add_mask,
+		            add_index_of<T>(op),
+		            actual.count,
+		            value,
+		            store<T>);
+
+		EXPECT_EQ(ReadRegion(), expected_region);
+		expect_same_registers(actual, expected);
+	}
+
+	template <typename T>
+	void ExpectMovsForAllDirections(StringOp op)
+	{
+		op.is_backward = false;
+		ExpectMovsMatchesReference<T>(op);
+		op.is_backward = true;
+		ExpectMovsMatchesReference<T>(op);
+	}
+
+	template <typename T>
+	void ExpectStosForAllDirections(StringOp op, const T value)
+	{
+		op.is_backward = false;
+		ExpectStosMatchesReference<T>(op, value);
+		op.is_backward = true;
+		ExpectStosMatchesReference<T>(op, value);
+	}
+};
+
+// Span limits
+// ~~~~~~~~~~~
+
+TEST_F(StringSpansTest, MovsSpanWithinPage)
+{
+	EXPECT_EQ(movs_span<uint8_t>(RegionStart, 0x10, RegionStart, 0x1020, Mask32, 100), 100);
+	EXPECT_EQ(movs_span<uint16_t>(RegionStart, 0x10, RegionStart, 0x1020, Mask32, 100), 100);
+	EXPECT_EQ(movs_span<uint32_t>(RegionStart, 0x10, RegionStart, 0x1020, Mask32, 100), 100);
+
+	for (uint32_t i = 0; i < 100 * sizeof(uint32_t); ++i) {
+		ASSERT_EQ(mem_readb(RegionStart + 0x1020 + i),
+		          static_cast<uint8_t>((RegionStart + 0x10 + i) * 7 + 3));
+	}
+}
+
+TEST_F(StringSpansTest, SpansStopAtPageBoundary)
+{
+	// The source reaches the end of its page 8 bytes in, the destination
+	// 24 bytes in
+	constexpr uint32_t SrcIndex = 0x0ff8;
+	constexpr uint32_t DstIndex = 0x2fe8;
+
+	EXPECT_EQ(movs_span<uint8_t>(RegionStart, SrcIndex, RegionStart, DstIndex, Mask32, 100), 8);
+	EXPECT_EQ(movs_span<uint16_t>(RegionStart, SrcIndex, RegionStart, DstIndex, Mask32, 100), 4);
+	EXPECT_EQ(movs_span<uint32_t>(RegionStart, SrcIndex, RegionStart, DstIndex, Mask32, 100), 2);
+
+	EXPECT_EQ(movs_span<uint8_t>(RegionStart, DstIndex, RegionStart, SrcIndex, Mask32, 100), 8);
+
+	EXPECT_EQ(stos_span<uint8_t>(RegionStart, DstIndex, Mask32, 100, uint8_t{1}), 24);
+	EXPECT_EQ(stos_span<uint16_t>(RegionStart, DstIndex, Mask32, 100, uint16_t{1}), 12);
+	EXPECT_EQ(stos_span<uint32_t>(RegionStart, DstIndex, Mask32, 100, uint32_t{1}), 6);
+}
+
+TEST_F(StringSpansTest, SpansStopAtIndexWrap)
+{
+	// The wrap of the 16-bit index comes 16 bytes before the page ends
+	constexpr PhysPt Base     = RegionStart + 0x800;
+	constexpr uint32_t Index  = 0xffe0;
+	constexpr uint32_t Other  = 0x1000;
+
+	EXPECT_EQ(movs_span<uint8_t>(Base, Index, Base, Other, Mask16, 100), 32);
+	EXPECT_EQ(movs_span<uint16_t>(Base, Other, Base, Index, Mask16, 100), 16);
+	EXPECT_EQ(stos_span<uint32_t>(Base, Index, Mask16, 100, uint32_t{1}), 8);
+
+	// The same offsets with 32-bit addressing run to the end of the page
+	EXPECT_EQ(stos_span<uint8_t>(Base, Index, Mask32, 0x1000, uint8_t{1}), 0x820);
+}
+
+TEST_F(StringSpansTest, SingleElementsGoThroughHandlers)
+{
+	EXPECT_EQ(movs_span<uint16_t>(RegionStart, 0, RegionStart, 0x100, Mask32, 1), 0);
+	EXPECT_EQ(stos_span<uint16_t>(RegionStart, 0, Mask32, 1, uint16_t{1}), 0);
+
+	// Only one element left before the page boundary
+	EXPECT_EQ(stos_span<uint32_t>(RegionStart, 0xffc, Mask32, 10, uint32_t{1}), 0);
+}
+
+TEST_F(StringSpansTest, StosSpanStoresValue)
+{
+	EXPECT_EQ(stos_span<uint16_t>(RegionStart, 0x101, Mask32, 50, uint16_t{0x1234}), 50);
+	for (uint32_t i = 0; i < 50; ++i) {
+		ASSERT_EQ(mem_readw(RegionStart + 0x101 + i * 2), 0x1234);
+	}
+	EXPECT_EQ(mem_readb(RegionStart + 0x100),
+	          static_cast<uint8_t>((RegionStart + 0x100) * 7 + 3));
+	EXPECT_EQ(mem_readb(RegionStart + 0x101 + 100),
+	          static_cast<uint8_t>((RegionStart + 0x101 + 100) * 7 + 3));
+}
+
+// REP loops
+// ~~~~~~~~~
+
+TEST_F(RepStringTest, MovsSeparate)
+{
+	const StringOp op = {RegionStart, 0x2000, RegionStart, 0x8000, Mask32, false, 1000};
+	ExpectMovsForAllDirections<uint8_t>(op);
+	ExpectMovsForAllDirections<uint16_t>(op);
+	ExpectMovsForAllDirections<uint32_t>(op);
+}
+
+TEST_F(RepStringTest, MovsOverlappingHigherDestination)
+{
+	// Forward copies onto a higher destination repeat the start of the
+	// source, which programs use to fill memory with a pattern
+	for (const uint32_t distance : {1, 2, 3, 4, 7, 64}) {
+		const StringOp op = {RegionStart, 0x1000, RegionStart, 0x1000 + distance, Mask32, false, 500};
+		ExpectMovsForAllDirections<uint8_t>(op);
+		ExpectMovsForAllDirections<uint16_t>(op);
+		ExpectMovsForAllDirections<uint32_t>(op);
+	}
+}
+
+TEST_F(RepStringTest, MovsOverlappingLowerDestination)
+{
+	for (const uint32_t distance : {1, 2, 3, 4, 7, 64}) {
+		const StringOp op = {RegionStart, 0x1000 + distance, RegionStart, 0x1000, Mask32, false, 500};
+		ExpectMovsForAllDirections<uint8_t>(op);
+		ExpectMovsForAllDirections<uint16_t>(op);
+		ExpectMovsForAllDirections<uint32_t>(op);
+	}
+}
+
+TEST_F(RepStringTest, MovsAcrossPageBoundaries)
+{
+	// The source and destination cross their page boundaries at different
+	// points, so the spans get split at both
+	const StringOp op = {RegionStart, 0x4ffd, RegionStart + 0x8000, 0x4803, Mask32, false, 3000};
+	ExpectMovsForAllDirections<uint8_t>(op);
+	ExpectMovsForAllDirections<uint16_t>(op);
+	ExpectMovsForAllDirections<uint32_t>(op);
+}
+
+TEST_F(RepStringTest, Movs16BitWraparound)
+{
+	// The source index wraps from 0xffff to 0 partway through
+	const StringOp op = {RegionStart, 0xff00, RegionStart + 0x10000, 0x1000, Mask16, false, 200};
+	ExpectMovsForAllDirections<uint8_t>(op);
+	ExpectMovsForAllDirections<uint16_t>(op);
+	ExpectMovsForAllDirections<uint32_t>(op);
+
+	// Both wrap, going backward from the start
+	const StringOp from_start = {RegionStart, 0x0010, RegionStart + 0x10000, 0x0020, Mask16, true, 100};
+	ExpectMovsMatchesReference<uint8_t>(from_start);
+	ExpectMovsMatchesReference<uint16_t>(from_start);
+	ExpectMovsMatchesReference<uint32_t>(from_start);
+}
+
+TEST_F(RepStringTest, StosAcrossPageBoundaries)
+{
+	const StringOp op = {0, 0, RegionStart, 0x4ffd, Mask32, false, 3000};
+	ExpectStosForAllDirections<uint8_t>(op, 0xa5);
+	ExpectStosForAllDirections<uint16_t>(op, 0x1234);
+	ExpectStosForAllDirections<uint32_t>(op, 0xdeadbeef);
+}
+
+TEST_F(RepStringTest, Stos16BitWraparound)
+{
+	const StringOp op = {0, 0, RegionStart + 0x800, 0xff80, Mask16, false, 300};
+	ExpectStosForAllDirections<uint8_t>(op, 0xa5);
+	ExpectStosForAllDirections<uint16_t>(op, 0x1234);
+	ExpectStosForAllDirections<uint32_t>(op, 0xdeadbeef);
+}
+
+TEST_F(RepStringTest, SingleElement)
+{
+	const StringOp op = {RegionStart, 0x10, RegionStart, 0x20, Mask16, false, 1};
+	ExpectMovsForAllDirections<uint32_t>(op);
+	ExpectStosForAllDirections<uint16_t>(op, 0x1234);
+}
+
+} // namespace
@@ -0,0 +1,144 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/hardware/vga_palette_expand.h"
+
+#include <array>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+// The expanders pick the fastest implementation the host supports, so these
+// compare whichever one that is against plain scalar lookups. The widths
+// cover the whole vectors, the tails and lines shorter than one vector.
+constexpr std::array<size_t, 18> Widths = {
+        0, 1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 65, 100, 321, 641};
+
+// Extra bytes after the end of the output that must stay untouched
+constexpr size_t GuardBytes = 64;
+constexpr uint8_t GuardByte = 0xa5;
+
+static std::mt19937 make_rng()
+{
+	return std::mt19937(2024);
+}
+
+static uint8_t random_byte(std::mt19937& rng)
+{
+	return static_cast<uint8_t>(rng() & 0xff);
+}
+
+static void expect_guard_intact(const std::vector<uint8_t>& dest, const size_t num_bytes)
+{
+	for (size_t i = num_bytes; i < dest.size(); ++i) {
+		ASSERT_EQ(dest[i], GuardByte) << "overrun at byte " << i;
+	}
+}
+
+TEST(VgaPaletteExpand, DacPaletteMatchesScalar)
+{
+	auto rng = make_rng();
+
+	for (auto round = 0; round < 8; ++round) {
+		std::array<Bgrx8888, 256> palette_map = {};
+		for (auto& colour : palette_map) {
+			colour.Set(random_byte(rng), random_byte(rng), random_byte(rng));
+		}
+
+		for (const auto width : Widths) {
+			// Start one byte in, so the loads aren't aligned either
+			std::vector<uint8_t> indexes(width + 1);
+			for (auto& index : indexes) {
+				index = random_byte(rng);
+			}
+
+			const auto num_bytes = width * sizeof(Bgrx8888);
+			std::vector<uint8_t> dest(num_bytes + GuardBytes, GuardByte);
+
+			VGA_ExpandDacPalette(indexes.data() + 1,
+			                     width,
+			                     palette_map.data(),
+			                     dest.data());
+
+			for (size_t i = 0; i < width; ++i) {
+				const auto& expected = palette_map[indexes[i + 1]];
+				const auto pixel     = &dest[i * sizeof(Bgrx8888)];
+
+				ASSERT_EQ(pixel[0], expected.Blue8()) << "width " << width << ", pixel " << i;
+				ASSERT_EQ(pixel[1], expected.Green8()) << "width " << width << ", pixel " << i;
+				ASSERT_EQ(pixel[2], expected.Red8()) << "width " << width << ", pixel " << i;
+			}
+			expect_guard_intact(dest, num_bytes);
+		}
+	}
+}
+
+static void test_nibble_palette(const bool double_pixels)
+{
+	auto rng = make_rng();
+
+	const size_t pixel_repeat = double_pixels ? 2 : 1;
+
+	for (auto round = 0; round < 8; ++round) {
+		std::array<uint8_t, 16> palette = {};
+		for (auto& colour : palette) {
+			colour = random_byte(rng);
+		}
+
+		for (const auto width : Widths) {
+			std::vector<uint8_t> src(width + 1);
+			for (auto& byte : src) {
+				byte = random_byte(rng);
+			}
+
+			const auto num_bytes = width * 2 * pixel_repeat;
+			std::vector<uint8_t> dest(num_bytes + GuardBytes, GuardByte);
+
+			VGA_ExpandNibblePalette(src.data() + 1,
+			                        width,
+			                        palette.data(),
+			                        double_pixels,
+			                        dest.data());
+
+			std::vector<uint8_t> expected = {};
+			for (size_t i = 0; i < width; ++i) {
+				const auto byte = src[i + 1];
+				expected.insert(expected.end(), pixel_repeat, palette[byte >> 4]);
+				expected.insert(expected.end(), pixel_repeat, palette[byte & 0x0f]);
+			}
+
+			for (size_t i = 0; i < num_bytes; ++i) {
+				ASSERT_EQ(dest[i], expected[i]) << "width " << width << ", byte " << i;
+			}
+			expect_guard_intact(dest, num_bytes);
+		}
+	}
+}
+
+TEST(VgaPaletteExpand, NibblePaletteMatchesScalar)
+{
+	test_nibble_palette(false);
+}
+
+TEST(VgaPaletteExpand, NibblePaletteDoubledMatchesScalar)
+{
+	test_nibble_palette(true);
+}